@@ -1,90 +1,251 @@
 #include "babl.h"
+#include "babl_intrinsics.h"
+#include "babl_debug.h"
 
-internal void
-RenderWeirdGradient(game_offscreen_buffer* buffer, int x_offset, int y_offset)
+#include "babl_meta.cpp"
+#include "babl_render.cpp"
+#include "babl_png.cpp"
+#include "babl_asset.cpp"
+#include "babl_audio.cpp"
+
+//Sounds are made at the rate every platform runs its output at - the mixer plays them back 1:1
+#define GAME_SOUND_SAMPLES_PER_SECOND 48000
+
+//Lives at the bottom of TransientStorage. Everything here can be rebuilt, so a snapshot restore is free to clobber it
+struct transient_state
 {
-	uint8_t* row = (uint8_t*)buffer->Memory;
-	for (int y = 0; y < buffer->Height; ++y)
-	{
-		uint32_t* pixel = (uint32_t*)row;
-		for (int x = 0; x < buffer->Width; ++x)
-		{
-			uint8_t r = (uint8_t)(y + y_offset);
-			uint8_t g = (uint8_t)(x + x_offset);
-			uint8_t b = 0;
+	bool32 IsInitialized;
+	memory_arena TranArena;
 
-			*pixel++ = ((r << 16) | (g << 8) | b);
-		}
-		row += buffer->Pitch;
+	render_frame_history* FrameHistory;
+	game_assets* Assets;
+
+	//Only set when there is no pack to stream the fern from
+	loaded_bitmap FernBitmap;
+
+	//The mixer can run on a thread of its own, so it has its own arena and never touches TranArena
+	audio_state Audio;
+	memory_arena MixArena;
+	loaded_sound JumpSound;
+	oscillator_id ToneOscillator;
+};
+
+/*
+	The front of PermanentStorage: the layout game_state was last written in, then game_state in a slot of its
+	own, so it can grow without moving the arena after it. A reloaded game that finds a layout other than its own
+	there migrates the state into its own layout before it does anything else.
+*/
+#define GAME_STATE_SLOT_SIZE Kilobytes(4)
+static_assert(sizeof(game_state) <= GAME_STATE_SLOT_SIZE, "game_state has outgrown its slot - growing the slot moves PermanentArena, so it needs a restart");
+
+struct game_state_root
+{
+	meta_layout Layout;
+	uint8_t StateSlot[GAME_STATE_SLOT_SIZE];
+};
+
+global_variable member_definition MembersOf_game_state[] = {GAME_STATE_MEMBERS(META_MEMBER_DEFINITION)};
+
+//Built the first time the code asks - every load of the library starts with it zeroed
+global_variable meta_layout GameStateLayout;
+
+internal meta_layout*
+GetGameStateLayout()
+{
+	if (!GameStateLayout.Version)
+	{
+		BuildMetaLayout(&GameStateLayout, MembersOf_game_state, (uint32_t)ArrayCount(MembersOf_game_state), sizeof(game_state));
 	}
+	return(&GameStateLayout);
 }
 
+//Where a fresh game starts, and what members that are new to a reloaded game start at
 internal void
-RenderPlayer(game_offscreen_buffer* buffer, int player_x, int player_y)
+SetGameStateDefaults(game_state* GameState)
 {
-	uint8_t* end_of_buffer = (uint8_t*)buffer->Memory + buffer->Pitch * buffer->Height;
-	uint32_t Color = 0xFFFFFFFF;
-	int Top = player_y;
-	int Bottom = player_y + 10;
-	for (int X = player_x; X < player_x + 10; X++)
-	{
-		uint8_t* Pixel = (uint8_t*)buffer->Memory + X*buffer->BytesPerPixel + Top*buffer->Pitch;
-		if (Pixel >= buffer->Memory && Pixel <= end_of_buffer)
-		{
-			for (int Y = Top; Y < Bottom; Y++)
-			{
+	GameState->ToneHz = 256;
+	GameState->GreenOffset = 0;
+	GameState->BlueOffset = 0;
+	GameState->PlayerX = 100;
+	GameState->PlayerY = 100;
 
-				*(uint32_t*)Pixel = Color;
-				Pixel += buffer->Pitch;
-			}
-		}
-	}
+	GameState->tJump = 0.0f;
 }
 
-void
-OutputGameSound(game_sound_buffer *SoundBuffer, game_state* GameState)
+internal void
+RenderPlayer(render_group* RenderGroup, int player_x, int player_y)
 {
-	int16_t tone_volume = 3000;
-	int WavePeriod = SoundBuffer->SamplesPerSecond / GameState->ToneHz;
+	uint32_t Color = 0xFFFFFFFF;
+	rectangle2i PlayerRect = {player_x, player_y, player_x + 10, player_y + 10};
+	PushRect(RenderGroup, 1, PlayerRect, Color);
+}
 
-	int16_t* SampleOut = SoundBuffer->Samples;
-	for (int SampleIndex = 0; SampleIndex < SoundBuffer->SampleCount; SampleIndex++)
+//A short falling chirp - generated rather than loaded, there are no sound assets yet
+internal loaded_sound
+MakeJumpSound(memory_arena* Arena)
+{
+	loaded_sound Result = {};
+	uint32_t SampleCount = GAME_SOUND_SAMPLES_PER_SECOND / 6;
+	float* Samples = PushArray(Arena, SampleCount, float, 32);
+	if (Samples)
 	{
-		GameState->tSin += 2.0f * 3.14f * (1.0f / (float)WavePeriod);
-		float sin_val = sinf(GameState->tSin);
-		int16_t SampleValue = (int16_t)(sin_val * tone_volume);
-		*SampleOut++ = SampleValue;
-		*SampleOut++ = SampleValue;
+		float Phase = 0.0f;
+		for (uint32_t SampleIndex = 0; SampleIndex < SampleCount; SampleIndex++)
+		{
+			float t = (float)SampleIndex / (float)SampleCount;
+			float Hz = 880.0f - 440.0f*t;
+			Phase += 2.0f*3.14159265f*Hz / (float)GAME_SOUND_SAMPLES_PER_SECOND;
+			Samples[SampleIndex] = sinf(Phase)*(1.0f - t)*0.5f;
+		}
+		Result.SampleCount = SampleCount;
+		Result.SamplesPerSecond = GAME_SOUND_SAMPLES_PER_SECOND;
+		Result.Samples = Samples;
 	}
+	return(Result);
 }
 
 //extern "C" prevents name mangling, allowing us to preserve the function handle when we import from the .dll
 extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 {
-	Assert(sizeof(game_state) <= Memory->PermanentStorageSize)
-	game_state* GameState = (game_state*)Memory->PermanentStorage;
+	Assert(sizeof(game_state_root) <= Memory->PermanentStorageSize)
+	game_state_root* Root = (game_state_root*)Memory->PermanentStorage;
+	game_state* GameState = (game_state*)Root->StateSlot;
+	meta_layout* Layout = GetGameStateLayout();
+	PlatformCommitMemory = Memory->PlatformCommitMemory;
+	GlobalDebugTable = Memory->DebugTable;
+	TIMED_FUNCTION();
+	if (!RenderKernels.FillRow)
+	{
+		InitRenderKernels(DetectCPUFeatures());
+	}
+	if (!AudioKernels.MixVoiceSpan)
+	{
+		InitAudioKernels(DetectCPUFeatures());
+	}
+
 	if (!Memory->IsInitialized)
 	{
-		char* Filename = "C:/Users/adaml/Documents/Babl/l_fern.png";
-		//char* Filename = __FILE__;
-		debug_read_file_result BitmapMemory = Memory->DEBUGPlatformReadEntireFile(Filename);
-		if (BitmapMemory.Contents)
+		//The two root structs sit below their arenas, so nothing else will commit them
+		if (PlatformCommitMemory &&
+			(!PlatformCommitMemory(Root, sizeof(game_state_root)) ||
+			!PlatformCommitMemory(Memory->TransientStorage, sizeof(transient_state))))
 		{
-			Memory->DEBUGPlatformWriteEntireFile("C:/Users/adaml/Documents/Babl/Babl.out", BitmapMemory.ContentSize, BitmapMemory.Contents);
-			Memory->DEBUGPlatformFreeFileMemory(BitmapMemory.Contents);
+			return;
 		}
 
-		GameState->ToneHz = 256;
-		GameState->GreenOffset = 0;
-		GameState->BlueOffset = 0;
-		GameState->PlayerX = 100;
-		GameState->PlayerY = 100;
-
-		GameState->tSin = 0.0f;
-		GameState->tJump = 0.0f;
+		InitializeReservedArena(&GameState->PermanentArena, Memory->PermanentStorageSize - sizeof(game_state_root), Root + 1);
+		SetGameStateDefaults(GameState);
+		Root->Layout = *Layout;
 
 		Memory->IsInitialized = true; //This really makes more sense in the platform layer, who actually doles memory
 	}
+	else if (Root->Layout.Version != Layout->Version)
+	{
+		//Reloaded with game_state laid out differently: start from the defaults and carry across everything the
+		//old state has a member of the same name for, the arena included
+		uint8_t OldState[GAME_STATE_SLOT_SIZE];
+		memcpy(OldState, Root->StateSlot, sizeof(OldState));
+		memset(Root->StateSlot, 0, sizeof(Root->StateSlot));
+		SetGameStateDefaults(GameState);
+		MigrateMembers(&Root->Layout, OldState, Layout, GameState);
+		Root->Layout = *Layout;
+	}
+
+	Assert(sizeof(transient_state) <= Memory->TransientStorageSize);
+	transient_state* TranState = (transient_state*)Memory->TransientStorage;
+	if (!TranState->IsInitialized)
+	{
+		//The asset slab is committed a block at a time, so it takes the top of the reservation, above everything the
+		//arena will push: below an uncommitted hole the arena's committed prefix could never grow past it, and every
+		//push after it - the render group each frame included - would go to the platform
+		uint64_t AssetBudget = Megabytes(64);
+		uint64_t TranSize = Memory->TransientStorageSize - sizeof(transient_state);
+		uint64_t TranArenaSize = (TranSize > 2*AssetBudget) ? TranSize - AssetBudget : TranSize;
+		void* AssetSlab = (TranArenaSize < TranSize) ? (uint8_t*)(TranState + 1) + TranArenaSize : 0;
+		memory_arena* TranArena = &TranState->TranArena;
+		InitializeReservedArena(TranArena, TranArenaSize, TranState + 1);
+
+		//The first pushes are small enough that failing them means the platform gave us nothing to work with
+		TranState->FrameHistory = PushStruct(TranArena, render_frame_history);
+		TranState->Assets = PushStruct(TranArena, game_assets);
+		Assert(TranState->FrameHistory && TranState->Assets);
+		TranState->FrameHistory->IsValid = false;
+
+		//Enough voices that nothing the game does can run the pool dry
+		uint32_t MaxVoiceCount = 256;
+		uint32_t MaxOscillatorCount = 64;
+		uint32_t MaxStreamCount = 4;
+		InitializeAudioState(&TranState->Audio, TranArena, MaxVoiceCount, MaxOscillatorCount, MaxStreamCount);
+		//Committed up front here, so the mixer thread never has to call the platform - room for a bus of 32k samples
+		uint64_t MixArenaSize = Kilobytes(256);
+		void* MixArenaBase = PushSize(TranArena, MixArenaSize, 64);
+		InitializeArena(&TranState->MixArena, MixArenaBase ? MixArenaSize : 0, MixArenaBase);
+		TranState->JumpSound = MakeJumpSound(TranArena);
+		//Equal-power panning leaves a centred sound 3dB down in each channel - this keeps the tone where it always was
+		float ToneVolume = 1.41421356f*3000.0f / 32767.0f;
+		TranState->ToneOscillator = StartOscillator(&TranState->Audio, Waveform_Sine, (float)GameState->ToneHz, ToneVolume, 0.0f);
+		//Streamed, so it can be as long as it likes - without the file the voice just ends
+		PlayStream(&TranState->Audio, Memory, "C:/Users/adaml/Documents/Babl/music.wav", 0.5f, 0.0f, true);
+
+		//The pack is mapped for the life of the process; the asset system streams out of it in the background
+		InitializeAssets(TranState->Assets, AssetSlab, AssetSlab ? AssetBudget : 0);
+		//Only the source's stamp is looked at to see whether the pack is current - it is read only if it is needed
+		char* FernFilename = "C:/Users/adaml/Documents/Babl/l_fern.png";
+		platform_file_stamp FernStamp = {};
+		if (Memory->PlatformGetFileStamp)
+		{
+			FernStamp = Memory->PlatformGetFileStamp(FernFilename);
+		}
+		platform_file_mapping PackMapping = Memory->PlatformMapReadOnlyFile("C:/Users/adaml/Documents/Babl/babl.bpak");
+		if (OpenAssetPack(&TranState->Assets->Pack, PackMapping))
+		{
+			if (IsPackBitmapCurrent(&TranState->Assets->Pack, "l_fern", FernStamp))
+			{
+				GameState->FernAssetID = AddPackBitmap(TranState->Assets, "l_fern");
+			}
+		}
+		else if (PackMapping.Memory)
+		{
+			Memory->PlatformUnmapFile(&PackMapping);
+		}
+
+		//No pack, it predates the fern, or the fern has changed since it was built - decode the source up front
+		if (!GameState->FernAssetID)
+		{
+			debug_read_file_result PNGFile = Memory->DEBUGPlatformReadEntireFile(FernFilename);
+			png_info Info = GetPNGInfo(PNGFile.Contents, PNGFile.ContentSize);
+			if (Info.IsValid && (Info.MemoryRequired <= GetArenaSizeRemaining(TranArena, 64)))
+			{
+				//The decoder's scratch sits after the bitmap, so decode into a scope and then claim back just the bitmap
+				temporary_memory DecodeMemory = BeginTemporaryMemory(TranArena);
+				void* DecodeBase = PushSize(TranArena, Info.MemoryRequired, 64);
+				png_decode_result Fern = {};
+				if (DecodeBase)
+				{
+					Fern = DecodePNG(PNGFile.Contents, PNGFile.ContentSize, DecodeBase, Info.MemoryRequired);
+				}
+				EndTemporaryMemory(DecodeMemory);
+				if (Fern.Success)
+				{
+					void* BitmapMemory = PushSize(TranArena, Fern.BitmapSize, 64);
+					Assert(BitmapMemory == Fern.Bitmap.Memory);
+					TranState->FernBitmap = Fern.Bitmap;
+				}
+			}
+			if (PNGFile.Contents)
+			{
+				Memory->DEBUGPlatformFreeFileMemory(PNGFile.Contents);
+			}
+		}
+
+		//The mixer thread may be waiting on this - everything above has to be visible first
+		CompletePreviousWritesBeforeFutureWrites;
+		TranState->IsInitialized = true;
+	}
+	game_assets* Assets = TranState->Assets;
+
+	UpdateAssets(Assets, Memory);
+	UpdateSoundStreams(&TranState->Audio, Memory);
 
 	for (int ControllerIndex = 0; ControllerIndex < ArrayCount(Input->Controllers); ControllerIndex++)
 	{
@@ -100,6 +261,12 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 		{
 			GameState->tJump = -1.0f;
 		}
+		if (Controller->FaceDown.EndedDown && Controller->FaceDown.HalfTransitionCount)
+		{
+			//Panned to where the player is on screen
+			float Pan = 2.0f*(float)GameState->PlayerX / (float)Buffer->Width - 1.0f;
+			PlaySound(&TranState->Audio, &TranState->JumpSound, 1.0f, Pan, false);
+		}
 		GameState->tJump += 0.033f;
 		if(GameState->tJump < 0)
 			GameState->PlayerY += (int)(sinf(GameState->tJump)*jump_power);
@@ -111,14 +278,74 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
 		GameState->PlayerY += Controller->Down.EndedDown ? player_acceleration : 0;
 	}
 
-	RenderWeirdGradient(Buffer, GameState->BlueOffset, GameState->GreenOffset);
-	RenderPlayer(Buffer, Input->MouseX, Input->MouseY);
+	SetOscillatorFrequency(&TranState->Audio, TranState->ToneOscillator, (float)GameState->ToneHz);
+
+	//The push buffer only lives for the frame
+	temporary_memory RenderMemory = BeginTemporaryMemory(&TranState->TranArena);
+	uint32_t RenderGroupSize = (uint32_t)Megabytes(4);
+	void* RenderGroupMemory = PushSize(&TranState->TranArena, RenderGroupSize);
+	if (!RenderGroupMemory)
+	{
+		//Out of committable memory - keep last frame on screen rather than draw half of this one
+		//The history may not describe that frame (a repaint request would be dropped here), so don't trust it next time
+		Buffer->Dirty = {};
+		TranState->FrameHistory->IsValid = false;
+		EndTemporaryMemory(RenderMemory);
+		return;
+	}
+	render_group* RenderGroup = AllocateRenderGroup(RenderGroupMemory, RenderGroupSize);
+	PushGradient(RenderGroup, 0, GameState->BlueOffset, GameState->GreenOffset);
+	loaded_bitmap* Fern = TranState->FernBitmap.Memory ? &TranState->FernBitmap : 0;
+	if (GameState->FernAssetID)
+	{
+		Fern = RequestBitmap(Assets, GameState->FernAssetID, AssetPriority_OnScreen).Bitmap;
+	}
+	if (Fern)
+	{
+		PushBitmap(RenderGroup, 1, Fern, GameState->PlayerX, GameState->PlayerY);
+	}
+	RenderPlayer(RenderGroup, Input->MouseX, Input->MouseY);
+	TiledRenderGroupToOutput(Memory, RenderGroup, TranState->FrameHistory, Buffer);
+
+	EndTemporaryMemory(RenderMemory);
+	CheckArena(&TranState->TranArena);
 }
 
 extern "C" GAME_GET_SOUND_SAMPLES(GameGetSoundSamples)
 {
-	game_state* GameState = (game_state*)Memory->PermanentStorage;
-	OutputGameSound(SoundBuffer, GameState);
+	transient_state* TranState = (transient_state*)Memory->TransientStorage;
+	PlatformCommitMemory = Memory->PlatformCommitMemory;
+	GlobalDebugTable = Memory->DebugTable;
+	TIMED_FUNCTION();
+	if (!AudioKernels.MixVoiceSpan)
+	{
+		InitAudioKernels(DetectCPUFeatures());
+	}
+
+	//Nothing is set up until the first GameUpdateAndRender, which may still be running on another thread
+	sound_bus Bus = {};
+	temporary_memory MixMemory = {};
+	if (Memory->IsInitialized && TranState->IsInitialized)
+	{
+		CompletePreviousReadsBeforeFutureReads;
+		MixMemory = BeginTemporaryMemory(&TranState->MixArena);
+		Bus = BeginSoundBus(&TranState->MixArena, SoundBuffer->SampleCount);
+	}
+
+	if (Bus.Left)
+	{
+		MixPlayingSounds(&TranState->Audio, &Bus, SoundBuffer->SamplesPerSecond);
+		OutputSoundBus(&Bus, SoundBuffer);
+	}
+	else
+	{
+		memset(SoundBuffer->Samples, 0, SoundBuffer->SampleCount*2*sizeof(int16_t));
+	}
+
+	if (MixMemory.Arena)
+	{
+		EndTemporaryMemory(MixMemory);
+	}
 }
 
 #if BABL_WIN32
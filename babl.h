@@ -33,6 +33,74 @@ SafeTruncateUInt64(uint64_t value)
 	return(FileSize32);
 }
 
+#include "babl_meta.h"
+#include "babl_memory.h"
+
+//Pixel-space rectangle, Max is exclusive
+struct rectangle2i
+{
+	int MinX, MinY;
+	int MaxX, MaxY;
+};
+
+inline rectangle2i
+Intersect(rectangle2i A, rectangle2i B)
+{
+	rectangle2i Result;
+	Result.MinX = (A.MinX < B.MinX) ? B.MinX : A.MinX;
+	Result.MinY = (A.MinY < B.MinY) ? B.MinY : A.MinY;
+	Result.MaxX = (A.MaxX > B.MaxX) ? B.MaxX : A.MaxX;
+	Result.MaxY = (A.MaxY > B.MaxY) ? B.MaxY : A.MaxY;
+	return(Result);
+}
+
+inline rectangle2i
+Union(rectangle2i A, rectangle2i B)
+{
+	rectangle2i Result;
+	Result.MinX = (A.MinX < B.MinX) ? A.MinX : B.MinX;
+	Result.MinY = (A.MinY < B.MinY) ? A.MinY : B.MinY;
+	Result.MaxX = (A.MaxX > B.MaxX) ? A.MaxX : B.MaxX;
+	Result.MaxY = (A.MaxY > B.MaxY) ? A.MaxY : B.MaxY;
+	return(Result);
+}
+
+inline bool32
+HasArea(rectangle2i A)
+{
+	return((A.MinX < A.MaxX) && (A.MinY < A.MaxY));
+}
+
+inline int64_t
+GetArea(rectangle2i A)
+{
+	int64_t Result = HasArea(A) ? (int64_t)(A.MaxX - A.MinX)*(int64_t)(A.MaxY - A.MinY) : 0;
+	return(Result);
+}
+
+//Regions of the backbuffer the game changed this frame - the platform only needs to present these
+//Going in, FullFrame is the platform asking for a full repaint: whenever the backbuffer may not hold the last frame the
+//game drew from the state it has now (the first frame, or after game memory was restored to an earlier frame)
+#define MAX_DIRTY_RECTS 16
+struct dirty_region_set
+{
+	bool32 FullFrame;
+	uint32_t RectCount;
+	rectangle2i Rects[MAX_DIRTY_RECTS];
+};
+
+//Filled in by TiledRenderGroupToOutput - the one place to look for what drawing cost this frame
+//CulledCount is per tile: an entry hidden in three tiles counts three times
+struct render_group_stats
+{
+	uint32_t PushBufferBytes;
+	uint32_t EntryCount;
+	uint32_t MergedCount;
+	uint32_t CulledCount;
+	uint32_t SkippedTileCount;
+	uint64_t RenderCycles;
+};
+
 //Services that the platform layer provides to the game
 #if BABL_INTERNAL
 struct debug_read_file_result
@@ -51,6 +119,66 @@ typedef DEBUG_PLATFORM_FREE_FILE_MEMORY(debug_platform_free_file_memory);
 typedef DEBUG_PLATFORM_WRITE_ENTIRE_FILE(debug_platform_write_entire_file);
 #endif
 
+//Work queue the platform runs on its worker threads - the game only ever sees the opaque pointer
+//Callbacks on one queue may run concurrently, so each entry must only touch memory no other entry touches
+struct platform_work_queue;
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(platform_work_queue* Queue, void* Data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(platform_work_queue_callback);
+
+#define PLATFORM_ADD_ENTRY(name) void name(platform_work_queue* Queue, platform_work_queue_callback* Callback, void* Data)
+typedef PLATFORM_ADD_ENTRY(platform_add_entry);
+
+//Blocks until every entry added so far has finished, with the calling thread pitching in
+#define PLATFORM_COMPLETE_ALL_WORK(name) void name(platform_work_queue* Queue)
+typedef PLATFORM_COMPLETE_ALL_WORK(platform_complete_all_work);
+
+//Read-only view of a whole file, valid until it is unmapped - the OS pages it in on demand
+struct platform_file_mapping
+{
+	void* Memory;
+	uint64_t Size;
+	void* PlatformHandle;
+};
+
+#define PLATFORM_MAP_READ_ONLY_FILE(name) platform_file_mapping name(char* Filename)
+typedef PLATFORM_MAP_READ_ONLY_FILE(platform_map_read_only_file);
+
+#define PLATFORM_UNMAP_FILE(name) void name(platform_file_mapping* Mapping)
+typedef PLATFORM_UNMAP_FILE(platform_unmap_file);
+
+//What a file looks like from outside, without opening it - enough to tell whether something built from it is out
+//of date. WriteTime is whole seconds since 1970 on every platform, so the packer and the game agree on it
+struct platform_file_stamp
+{
+	bool32 Exists;
+	uint64_t Size;
+	uint64_t WriteTime;
+};
+
+#define PLATFORM_GET_FILE_STAMP(name) platform_file_stamp name(char* Filename)
+typedef PLATFORM_GET_FILE_STAMP(platform_get_file_stamp);
+
+//A file read a piece at a time, from any thread, at any offset - for files too big to map or read in one go.
+//Reads are all-or-nothing
+struct platform_file_handle
+{
+	bool32 IsOpen;
+	uint64_t Size;
+	void* PlatformHandle;
+};
+
+#define PLATFORM_OPEN_FILE(name) platform_file_handle name(char* Filename)
+typedef PLATFORM_OPEN_FILE(platform_open_file);
+
+#define PLATFORM_READ_DATA_FROM_FILE(name) bool32 name(platform_file_handle* Handle, uint64_t Offset, uint32_t Size, void* Dest)
+typedef PLATFORM_READ_DATA_FROM_FILE(platform_read_data_from_file);
+
+#define PLATFORM_CLOSE_FILE(name) void name(platform_file_handle* Handle)
+typedef PLATFORM_CLOSE_FILE(platform_close_file);
+
+//The platform's timed-block recordings (see babl_debug.h), which the game records into as well
+struct debug_table;
+
 //Services that the game provides to the platform layer
 struct game_memory
 {
@@ -61,9 +189,28 @@ struct game_memory
 	uint64_t TransientStorageSize;
 	void* TransientStorage;
 
+	platform_work_queue* RenderQueue;
+	platform_work_queue* LowPriorityQueue;
+	platform_add_entry* PlatformAddEntry;
+	platform_complete_all_work* PlatformCompleteAllWork;
+
+	//Storage is only reserved up front when this is set - arenas commit through it as they grow
+	platform_commit_memory* PlatformCommitMemory;
+
+	platform_map_read_only_file* PlatformMapReadOnlyFile;
+	platform_unmap_file* PlatformUnmapFile;
+	platform_get_file_stamp* PlatformGetFileStamp;
+
+	platform_open_file* PlatformOpenFile;
+	platform_read_data_from_file* PlatformReadDataFromFile;
+	platform_close_file* PlatformCloseFile;
+
 	debug_platform_read_entire_file* DEBUGPlatformReadEntireFile;
 	debug_platform_free_file_memory* DEBUGPlatformFreeFileMemory;
 	debug_platform_write_entire_file* DEBUGPlatformWriteEntireFile;
+
+	//0 when the platform isn't profiling - the game's blocks then record nothing
+	debug_table* DebugTable;
 };
 
 struct game_offscreen_buffer
@@ -73,6 +220,20 @@ struct game_offscreen_buffer
 	int Width;
 	int Height;
 	int Pitch;
+
+	dirty_region_set Dirty;
+
+	//What drawing this frame cost, handed back for the platform's frame report
+	render_group_stats RenderStats;
+};
+
+//Pixels are 0xAARRGGBB with premultiplied alpha, Memory points at the top row
+struct loaded_bitmap
+{
+	int Width;
+	int Height;
+	int Pitch;
+	void* Memory;
 };
 
 struct game_sound_buffer
@@ -131,16 +292,22 @@ struct game_clock
 	float SecondsElapsed;
 };
 
+//Declared from its member list, so a hot reload can carry it across a change of layout (see babl_meta.h) -
+//members can be added, removed, reordered or retyped without a restart. PermanentArena is everything else in
+//PermanentStorage, after the state's slot
+#define GAME_STATE_MEMBERS(Member) \
+	Member(game_state, int32_t, ToneHz) \
+	Member(game_state, int32_t, GreenOffset) \
+	Member(game_state, int32_t, BlueOffset) \
+	Member(game_state, int32_t, PlayerX) \
+	Member(game_state, int32_t, PlayerY) \
+	Member(game_state, float, tJump) \
+	Member(game_state, uint32_t, FernAssetID) \
+	Member(game_state, memory_arena, PermanentArena)
+
 struct game_state
 {
-	int ToneHz;
-	int GreenOffset;
-	int BlueOffset;
-	int PlayerX;
-	int PlayerY;
-
-	float tSin = 0;
-	float tJump = 0;
+	GAME_STATE_MEMBERS(META_DECLARE_MEMBER)
 };
 
 //Not defining stubs here eases platform layer development where multiple files will import this header
@@ -151,6 +318,8 @@ typedef GAME_UPDATE_AND_RENDER(game_update_and_render);
 //{}
 //GAME_UPDATE_AND_RENDER(GameUpdateAndRender);
 
+//Can run on a thread of its own, alongside GameUpdateAndRender - but never while the platform reloads the game
+//or saves and restores game memory, which it has to hold the mixer off for
 #define GAME_GET_SOUND_SAMPLES(name) void name(game_memory* Memory, game_sound_buffer* SoundBuffer)
 typedef GAME_GET_SOUND_SAMPLES(game_get_sound_samples);
 //GAME_GET_SOUND_SAMPLES(GameGetSoundSamplesStub)
@@ -0,0 +1,485 @@
+#include "babl_asset.h"
+
+internal bool32
+OpenAssetPack(asset_pack* Pack, platform_file_mapping Mapping)
+{
+	*Pack = {};
+	if (!Mapping.Memory || (Mapping.Size < sizeof(bpak_header)))
+	{
+		return(false);
+	}
+
+	bpak_header* Header = (bpak_header*)Mapping.Memory;
+	uint64_t IndexSize = (uint64_t)Header->BitmapCount*sizeof(bpak_bitmap);
+	bool32 IsValid = ((Header->MagicValue == BPAK_MAGIC_VALUE) &&
+		(Header->Version == BPAK_VERSION) &&
+		(Header->FileSize == Mapping.Size) &&
+		(Header->BitmapsOffset <= Mapping.Size) &&
+		(IndexSize <= Mapping.Size - Header->BitmapsOffset));
+	if (IsValid)
+	{
+		Pack->Mapping = Mapping;
+		Pack->Header = Header;
+		Pack->Bitmaps = (bpak_bitmap*)((uint8_t*)Mapping.Memory + Header->BitmapsOffset);
+	}
+	return(IsValid);
+}
+
+//Costs a name compare per entry and nothing else - the pixels are used where they sit in the mapping
+internal bool32
+GetPackBitmap(asset_pack* Pack, char* Name, loaded_bitmap* Result)
+{
+	for (uint32_t Index = 0; Index < Pack->Header->BitmapCount; Index++)
+	{
+		bpak_bitmap* Entry = &Pack->Bitmaps[Index];
+		if (strncmp(Entry->Name, Name, BPAK_MAX_NAME) == 0)
+		{
+			uint64_t PixelsSize = (uint64_t)Entry->Pitch*Entry->Height;
+			bool32 IsValid = ((Entry->Pitch >= Entry->Width*sizeof(uint32_t)) &&
+				(Entry->PixelsOffset <= Pack->Mapping.Size) &&
+				(PixelsSize <= Pack->Mapping.Size - Entry->PixelsOffset));
+			if (IsValid)
+			{
+				Result->Width = (int)Entry->Width;
+				Result->Height = (int)Entry->Height;
+				Result->Pitch = (int)Entry->Pitch;
+				Result->Memory = (uint8_t*)Pack->Mapping.Memory + Entry->PixelsOffset;
+			}
+			return(IsValid);
+		}
+	}
+	return(false);
+}
+
+//True unless the pack's bitmap was built from something other than the file Source describes - a pack with no
+//such bitmap, or no source to compare against (shipped without it), is taken as it is
+internal bool32
+IsPackBitmapCurrent(asset_pack* Pack, char* Name, platform_file_stamp Source)
+{
+	bool32 Result = true;
+	for (uint32_t Index = 0; Source.Exists && (Index < Pack->Header->BitmapCount); Index++)
+	{
+		bpak_bitmap* Entry = &Pack->Bitmaps[Index];
+		if (strncmp(Entry->Name, Name, BPAK_MAX_NAME) == 0)
+		{
+			Result = ((Entry->SourceSize == Source.Size) && (Entry->SourceWriteTime == Source.WriteTime));
+			break;
+		}
+	}
+	return(Result);
+}
+
+//
+// Slab allocator
+//
+
+inline uint64_t
+AlignAssetSize(uint64_t Size)
+{
+	return((Size + 63) & ~63ULL);
+}
+
+internal void
+InitializeAssets(game_assets* Assets, void* Slab, uint64_t Budget)
+{
+	*Assets = {};
+	Assets->SlotCount = 1;
+	Assets->Budget = Budget;
+	Assets->MaxInFlight = 4;
+
+	asset_memory_block* Sentinel = &Assets->Sentinel;
+	Sentinel->Prev = Sentinel->Next = Sentinel;
+
+	//Keep block payloads cache-line aligned, which keeps bitmap rows 16-byte aligned for the fill kernels
+	uint8_t* Base = (uint8_t*)Slab;
+	uint8_t* AlignedBase = (uint8_t*)(((uintptr_t)Base + 63) & ~(uintptr_t)63);
+	uint64_t Usable = (Budget > (uint64_t)(AlignedBase - Base)) ? Budget - (AlignedBase - Base) : 0;
+	//The slab is only reserved - pages are committed as blocks get handed out, starting with this first header
+	if ((Usable > 2*sizeof(asset_memory_block)) &&
+		(!PlatformCommitMemory || PlatformCommitMemory(AlignedBase, sizeof(asset_memory_block))))
+	{
+		asset_memory_block* Block = (asset_memory_block*)AlignedBase;
+		Block->Size = Usable - sizeof(asset_memory_block);
+		Block->IsUsed = false;
+		Block->Prev = Sentinel;
+		Block->Next = Sentinel;
+		Sentinel->Next = Sentinel->Prev = Block;
+	}
+}
+
+inline void*
+GetBlockMemory(asset_memory_block* Block)
+{
+	return(Block + 1);
+}
+
+internal asset_memory_block*
+AllocateAssetBlock(game_assets* Assets, uint64_t Size)
+{
+	Size = AlignAssetSize(Size);
+	for (asset_memory_block* Block = Assets->Sentinel.Next; Block != &Assets->Sentinel; Block = Block->Next)
+	{
+		if (!Block->IsUsed && (Block->Size >= Size))
+		{
+			//Split off the tail if it is worth keeping as its own free block
+			uint64_t Remaining = Block->Size - Size;
+			bool32 ShouldSplit = (Remaining > sizeof(asset_memory_block) + 4096);
+			uint64_t CommitSize = Size + (ShouldSplit ? sizeof(asset_memory_block) : 0);
+			if (PlatformCommitMemory && !PlatformCommitMemory(GetBlockMemory(Block), CommitSize))
+			{
+				//Over the platform's commit ceiling - as good as the slab being full
+				break;
+			}
+
+			if (ShouldSplit)
+			{
+				asset_memory_block* Tail = (asset_memory_block*)((uint8_t*)GetBlockMemory(Block) + Size);
+				Tail->Size = Remaining - sizeof(asset_memory_block);
+				Tail->IsUsed = false;
+				Tail->Prev = Block;
+				Tail->Next = Block->Next;
+				Tail->Next->Prev = Tail;
+				Block->Next = Tail;
+				Block->Size = Size;
+			}
+			Block->IsUsed = true;
+			return(Block);
+		}
+	}
+	return(0);
+}
+
+inline bool32
+MergeIfPossible(game_assets* Assets, asset_memory_block* First, asset_memory_block* Second)
+{
+	bool32 Result = false;
+	if ((First != &Assets->Sentinel) && (Second != &Assets->Sentinel) && !First->IsUsed && !Second->IsUsed &&
+		((uint8_t*)GetBlockMemory(First) + First->Size == (uint8_t*)Second))
+	{
+		First->Size += sizeof(asset_memory_block) + Second->Size;
+		First->Next = Second->Next;
+		First->Next->Prev = First;
+		Result = true;
+	}
+	return(Result);
+}
+
+internal void
+FreeAssetBlock(game_assets* Assets, asset_memory_block* Block)
+{
+	Block->IsUsed = false;
+	asset_memory_block* Prev = Block->Prev;
+	if (MergeIfPossible(Assets, Prev, Block))
+	{
+		Block = Prev;
+	}
+	MergeIfPossible(Assets, Block, Block->Next);
+}
+
+//
+// Registration
+//
+
+//Pack bitmaps are used where they sit in the mapping - only generated pixels need a block of the slab
+inline bool32
+UsesAssetSlab(asset_source Source)
+{
+	return(Source.Type != AssetSource_Pack);
+}
+
+internal uint32_t
+AddAsset(game_assets* Assets, asset_source Source, uint64_t MemorySize)
+{
+	uint32_t Result = 0;
+	if ((Assets->SlotCount < ArrayCount(Assets->Slots)) &&
+		(!UsesAssetSlab(Source) || (AlignAssetSize(MemorySize) <= Assets->Budget)))
+	{
+		Result = Assets->SlotCount++;
+		asset_slot* Slot = &Assets->Slots[Result];
+		*Slot = {};
+		Slot->Source = Source;
+		Slot->Pack = &Assets->Pack;
+		Slot->MemorySize = MemorySize;
+	}
+	return(Result);
+}
+
+internal uint32_t
+AddPackBitmap(game_assets* Assets, char* Name)
+{
+	uint32_t Result = 0;
+	asset_pack* Pack = &Assets->Pack;
+	for (uint32_t Index = 0; Pack->Header && (Index < Pack->Header->BitmapCount); Index++)
+	{
+		loaded_bitmap Bitmap;
+		if ((strncmp(Pack->Bitmaps[Index].Name, Name, BPAK_MAX_NAME) == 0) && GetPackBitmap(Pack, Name, &Bitmap))
+		{
+			asset_source Source = {};
+			Source.Type = AssetSource_Pack;
+			Source.PackIndex = Index;
+			Result = AddAsset(Assets, Source, (uint64_t)Bitmap.Pitch*Bitmap.Height);
+			break;
+		}
+	}
+	return(Result);
+}
+
+internal uint32_t
+AddSyntheticBitmap(game_assets* Assets, uint32_t Width, uint32_t Height, uint32_t Seed)
+{
+	asset_source Source = {};
+	Source.Type = AssetSource_Synthetic;
+	Source.Width = Width;
+	Source.Height = Height;
+	Source.Seed = Seed;
+	return(AddAsset(Assets, Source, (uint64_t)Width*Height*sizeof(uint32_t)));
+}
+
+//
+// Loading - runs on a worker
+//
+
+internal bool32
+LoadAssetIntoSlot(asset_slot* Slot)
+{
+	bool32 Result = false;
+	asset_source* Source = &Slot->Source;
+	switch (Source->Type)
+	{
+		case AssetSource_Pack:
+		{
+			//Nothing to copy - but reading a byte from every page pulls the pixels in off disk here, so the
+			//main thread does not fault on them the first frame it draws
+			bpak_bitmap* Entry = &Slot->Pack->Bitmaps[Source->PackIndex];
+			if (GetPackBitmap(Slot->Pack, Entry->Name, &Slot->Bitmap))
+			{
+				volatile uint8_t* Pixels = (volatile uint8_t*)Slot->Bitmap.Memory;
+				uint64_t Size = (uint64_t)Slot->Bitmap.Pitch*Slot->Bitmap.Height;
+				for (uint64_t Offset = 0; Offset < Size; Offset += 4096)
+				{
+					(void)Pixels[Offset];
+				}
+				if (Size)
+				{
+					//The pixels start on a cache line, not a page, so the stride can step over the last one
+					(void)Pixels[Size - 1];
+				}
+				Result = true;
+			}
+		}break;
+		case AssetSource_Synthetic:
+		{
+			uint32_t* Pixel = (uint32_t*)GetBlockMemory(Slot->Block);
+			for (uint32_t Y = 0; Y < Source->Height; Y++)
+			{
+				for (uint32_t X = 0; X < Source->Width; X++)
+				{
+					uint32_t Value = (X*2654435761u) ^ (Y*40503u) ^ Source->Seed;
+					*Pixel++ = 0xFF000000 | (Value & 0x00FFFFFF);
+				}
+			}
+			Slot->Bitmap.Width = (int)Source->Width;
+			Slot->Bitmap.Height = (int)Source->Height;
+			Slot->Bitmap.Pitch = (int)(Source->Width*sizeof(uint32_t));
+			Slot->Bitmap.Memory = GetBlockMemory(Slot->Block);
+			Result = true;
+		}break;
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_WORK_QUEUE_CALLBACK(DoLoadAssetWork)
+{
+	TIMED_FUNCTION();
+	asset_slot* Slot = (asset_slot*)Data;
+	bool32 Loaded = LoadAssetIntoSlot(Slot);
+	Slot->LoadedTicks = __rdtsc();
+
+	CompletePreviousWritesBeforeFutureWrites;
+	Slot->State = Loaded ? AssetState_Resident : AssetState_Failed;
+}
+
+//
+// Main thread
+//
+
+inline bool32
+IsValidAssetID(game_assets* Assets, uint32_t ID)
+{
+	return((ID > 0) && (ID < Assets->SlotCount));
+}
+
+//Call every frame the asset is wanted - that is what keeps it from being evicted
+internal asset_handle
+RequestBitmap(game_assets* Assets, uint32_t ID, asset_priority Priority)
+{
+	asset_handle Result = {};
+	if (!IsValidAssetID(Assets, ID))
+	{
+		Result.State = AssetState_Failed;
+		return(Result);
+	}
+
+	asset_slot* Slot = &Assets->Slots[ID];
+	++Assets->Stats.Requests;
+	Slot->LastUsedFrame = Assets->FrameIndex;
+
+	Result.State = (asset_state)Slot->State;
+	switch (Result.State)
+	{
+		case AssetState_Resident:
+		{
+			++Assets->Stats.Hits;
+			Result.Bitmap = &Slot->Bitmap;
+		}break;
+		case AssetState_Unloaded:
+		{
+			Slot->State = AssetState_Queued;
+			Slot->Priority = Priority;
+			Slot->QueuedFrame = Assets->FrameIndex;
+			Slot->RequestTicks = __rdtsc();
+			Result.State = AssetState_Queued;
+		}break;
+		case AssetState_Queued:
+		{
+			if ((uint32_t)Priority > Slot->Priority)
+			{
+				Slot->Priority = Priority;
+			}
+		}break;
+		default:
+		{
+		}break;
+	}
+	return(Result);
+}
+
+internal void
+EvictAsset(game_assets* Assets, asset_slot* Slot)
+{
+	FreeAssetBlock(Assets, Slot->Block);
+	Slot->Block = 0;
+	Slot->Bitmap = {};
+	Slot->State = AssetState_Unloaded;
+	++Assets->Stats.Evictions;
+}
+
+//Evicts least-recently-used resident assets (never one requested this frame) until Size fits
+internal asset_memory_block*
+AllocateWithEviction(game_assets* Assets, uint64_t Size)
+{
+	asset_memory_block* Block = AllocateAssetBlock(Assets, Size);
+	while (!Block)
+	{
+		asset_slot* Oldest = 0;
+		for (uint32_t Index = 1; Index < Assets->SlotCount; Index++)
+		{
+			asset_slot* Slot = &Assets->Slots[Index];
+			if ((Slot->State == AssetState_Resident) && Slot->Block && (Slot->LastUsedFrame < Assets->FrameIndex) &&
+				(!Oldest || (Slot->LastUsedFrame < Oldest->LastUsedFrame)))
+			{
+				Oldest = Slot;
+			}
+		}
+
+		if (!Oldest)
+		{
+			break;
+		}
+		EvictAsset(Assets, Oldest);
+		Block = AllocateAssetBlock(Assets, Size);
+	}
+	return(Block);
+}
+
+//Highest priority first, then whoever has waited longest
+internal asset_slot*
+GetNextQueuedAsset(game_assets* Assets)
+{
+	asset_slot* Result = 0;
+	for (uint32_t Index = 1; Index < Assets->SlotCount; Index++)
+	{
+		asset_slot* Slot = &Assets->Slots[Index];
+		if ((Slot->State == AssetState_Queued) &&
+			(!Result || (Slot->Priority > Result->Priority) ||
+			((Slot->Priority == Result->Priority) && (Slot->QueuedFrame < Result->QueuedFrame))))
+		{
+			Result = Slot;
+		}
+	}
+	return(Result);
+}
+
+/*
+	Once per frame, before anything is requested: collects finished loads, then starts new ones.
+	Only MaxInFlight loads are ever handed to the platform at once - the rest wait here, where a later
+	on-screen request can still overtake them.
+*/
+internal void
+UpdateAssets(game_assets* Assets, game_memory* Memory)
+{
+	++Assets->FrameIndex;
+
+	for (uint32_t Index = 1; Index < Assets->SlotCount; Index++)
+	{
+		asset_slot* Slot = &Assets->Slots[Index];
+		if (Slot->IsInFlight && (Slot->State != AssetState_Loading))
+		{
+			Slot->IsInFlight = false;
+			--Assets->InFlightCount;
+
+			if (Slot->State == AssetState_Resident)
+			{
+				uint64_t Latency = Slot->LoadedTicks - Slot->RequestTicks;
+				++Assets->Stats.LoadsCompleted;
+				Assets->Stats.BytesStreamed += Slot->MemorySize;
+				Assets->Stats.LatencyTicksTotal += Latency;
+				if (Latency > Assets->Stats.LatencyTicksMax)
+				{
+					Assets->Stats.LatencyTicksMax = Latency;
+				}
+			}
+			else
+			{
+				if (Slot->Block)
+				{
+					FreeAssetBlock(Assets, Slot->Block);
+					Slot->Block = 0;
+				}
+				++Assets->Stats.LoadsFailed;
+			}
+		}
+	}
+
+	while (Assets->InFlightCount < Assets->MaxInFlight)
+	{
+		asset_slot* Slot = GetNextQueuedAsset(Assets);
+		if (!Slot)
+		{
+			break;
+		}
+
+		Slot->Block = UsesAssetSlab(Slot->Source) ? AllocateWithEviction(Assets, Slot->MemorySize) : 0;
+		if (UsesAssetSlab(Slot->Source) && !Slot->Block)
+		{
+			//Everything resident is in use this frame - try again next frame
+			break;
+		}
+
+		Slot->State = AssetState_Loading;
+		if (Memory->LowPriorityQueue)
+		{
+			Slot->IsInFlight = true;
+			++Assets->InFlightCount;
+			Memory->PlatformAddEntry(Memory->LowPriorityQueue, DoLoadAssetWork, Slot);
+		}
+		else
+		{
+			//No background queue (a bare-bones platform) - load right here and count it next frame
+			Slot->IsInFlight = true;
+			++Assets->InFlightCount;
+			DoLoadAssetWork(0, Slot);
+		}
+	}
+}
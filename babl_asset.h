@@ -0,0 +1,124 @@
+#if !defined(BABL_ASSET_H)
+#define BABL_ASSET_H
+
+#include "babl_asset_pack.h"
+
+//A validated .bpak sitting in a read-only mapping - bitmaps point straight into it
+struct asset_pack
+{
+	platform_file_mapping Mapping;
+	bpak_header* Header;
+	bpak_bitmap* Bitmaps;
+};
+
+/*
+	Streaming assets. The game asks for an asset by ID every frame it wants it and gets back a handle saying
+	whether it is there yet. Misses are queued by priority; UpdateAssets hands the most important ones to
+	the platform's low-priority queue, where a worker generates the pixels into a block of the asset slab.
+	When the slab is full, the least recently used slab asset is evicted. Pack bitmaps never take a block:
+	they go resident pointing into the mapping once the worker has touched their pages, and stay resident,
+	since the OS can page them back out without our help.
+
+	Ownership: the main thread owns everything except a slot's Bitmap and State while it is AssetState_Loading,
+	which belong to the worker until it publishes AssetState_Resident (or Failed).
+*/
+enum asset_state
+{
+	AssetState_Unloaded,
+	AssetState_Queued,
+	AssetState_Loading,
+	AssetState_Resident,
+	AssetState_Failed,
+};
+
+enum asset_priority
+{
+	AssetPriority_Prefetch,
+	AssetPriority_OnScreen,
+};
+
+enum asset_source_type
+{
+	AssetSource_Pack,
+
+	//Deterministic generated pixels - lets the streaming system run without any files
+	AssetSource_Synthetic,
+};
+
+struct asset_source
+{
+	asset_source_type Type;
+	uint32_t PackIndex;
+
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Seed;
+};
+
+//Lives at the start of every block in the slab; the list is kept in address order so frees can coalesce
+struct asset_memory_block
+{
+	asset_memory_block* Prev;
+	asset_memory_block* Next;
+	uint64_t Size;
+	bool32 IsUsed;
+};
+
+struct asset_slot
+{
+	uint32_t volatile State;
+	asset_source Source;
+	asset_pack* Pack;
+
+	uint64_t MemorySize;
+	asset_memory_block* Block;
+	loaded_bitmap Bitmap;
+
+	uint32_t Priority;
+	bool32 IsInFlight;
+	uint64_t LastUsedFrame;
+	uint64_t QueuedFrame;
+	uint64_t RequestTicks;
+	uint64_t LoadedTicks;
+};
+
+struct asset_handle
+{
+	asset_state State;
+
+	//Only set when State is AssetState_Resident, and only good until the next UpdateAssets
+	loaded_bitmap* Bitmap;
+};
+
+struct asset_stats
+{
+	uint64_t Requests;
+	uint64_t Hits;
+	uint64_t Evictions;
+	uint64_t LoadsCompleted;
+	uint64_t LoadsFailed;
+	uint64_t BytesStreamed;
+	uint64_t LatencyTicksTotal;
+	uint64_t LatencyTicksMax;
+};
+
+#define MAX_ASSET_SLOTS 256
+struct game_assets
+{
+	uint64_t FrameIndex;
+	asset_pack Pack;
+
+	//Slot 0 is never handed out, so an ID of 0 means "no asset"
+	uint32_t SlotCount;
+	asset_slot Slots[MAX_ASSET_SLOTS];
+
+	uint64_t Budget;
+	asset_memory_block Sentinel;
+
+	uint32_t InFlightCount;
+	uint32_t MaxInFlight;
+
+	asset_stats Stats;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#if !defined(BABL_ASSET_PACK_H)
+#define BABL_ASSET_PACK_H
+
+/*
+	.bpak - preprocessed assets the game can use straight out of a read-only memory map.
+	Written offline by babl_packer.cpp, read by the game with no decode and no copy.
+
+	[bpak_header][bpak_bitmap x BitmapCount][pixel data...]
+
+	Pixel data is already 0xAARRGGBB premultiplied, top row first, exactly what DrawBitmap wants.
+	Each bitmap starts on a BPAK_PIXEL_ALIGNMENT boundary and every row on a BPAK_ROW_ALIGNMENT one.
+	All offsets are from the start of the file. Little-endian only, like everything else we run on.
+	Every bitmap remembers the size and write time (a platform_file_stamp) of the file it was made from, so the
+	game can tell the source has been edited since the pack was built without reading it.
+*/
+
+#define BPAK_CODE(a, b, c, d) (((uint32_t)(a) << 0) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define BPAK_MAGIC_VALUE BPAK_CODE('b', 'p', 'a', 'k')
+#define BPAK_VERSION 3
+
+#define BPAK_PIXEL_ALIGNMENT 64
+#define BPAK_ROW_ALIGNMENT 16
+#define BPAK_MAX_NAME 32
+
+struct bpak_header
+{
+	uint32_t MagicValue;
+	uint32_t Version;
+	uint32_t BitmapCount;
+	uint32_t Reserved;
+	uint64_t BitmapsOffset;
+	uint64_t FileSize;
+};
+
+struct bpak_bitmap
+{
+	char Name[BPAK_MAX_NAME];
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Pitch;
+	uint32_t SourceSize;
+	uint64_t PixelsOffset;
+	uint64_t SourceWriteTime;
+};
+
+#endif
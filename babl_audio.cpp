@@ -0,0 +1,1720 @@
+#include <string.h>
+
+#include "babl_spsc_ring.h"
+#include "babl_wav.h"
+#include "babl_audio.h"
+
+//Picked once per DLL load by InitAudioKernels, same as the render kernels
+global_variable audio_kernels AudioKernels;
+
+#define AUDIO_BUS_LANES 8
+
+internal
+MIX_VOICE_SPAN(MixVoiceSpanScalar)
+{
+	for (int Index = 0; Index < Count; Index++)
+	{
+		float Sample = Source[Index];
+		Left[Index] += Sample*(LeftVolume + dLeftVolume*(float)Index);
+		Right[Index] += Sample*(RightVolume + dRightVolume*(float)Index);
+	}
+}
+
+inline int16_t
+ConvertSample(float Value)
+{
+	Value = (Value < -1.0f) ? -1.0f : (Value > 1.0f) ? 1.0f : Value;
+	//Round to nearest even, like cvtps2dq
+	return((int16_t)lrintf(Value*32767.0f));
+}
+
+internal
+CONVERT_BUS(ConvertBusScalar)
+{
+	for (int Index = 0; Index < Count; Index++)
+	{
+		*Dest++ = ConvertSample(Left[Index]);
+		*Dest++ = ConvertSample(Right[Index]);
+	}
+}
+
+//The bus is aligned but spans start wherever the previous one stopped, so everything here is unaligned loads and stores
+internal
+MIX_VOICE_SPAN(MixVoiceSpanSSE2)
+{
+	__m128 LeftStart = _mm_set1_ps(LeftVolume);
+	__m128 RightStart = _mm_set1_ps(RightVolume);
+	__m128 dLeft = _mm_set1_ps(dLeftVolume);
+	__m128 dRight = _mm_set1_ps(dRightVolume);
+	__m128i Lane = _mm_setr_epi32(0, 1, 2, 3);
+	__m128i LaneStep = _mm_set1_epi32(4);
+
+	int Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		__m128 SampleIndex = _mm_cvtepi32_ps(Lane);
+		__m128 Sample = _mm_loadu_ps(Source + Index);
+		__m128 L = _mm_add_ps(LeftStart, _mm_mul_ps(dLeft, SampleIndex));
+		__m128 R = _mm_add_ps(RightStart, _mm_mul_ps(dRight, SampleIndex));
+		_mm_storeu_ps(Left + Index, _mm_add_ps(_mm_loadu_ps(Left + Index), _mm_mul_ps(Sample, L)));
+		_mm_storeu_ps(Right + Index, _mm_add_ps(_mm_loadu_ps(Right + Index), _mm_mul_ps(Sample, R)));
+		Lane = _mm_add_epi32(Lane, LaneStep);
+	}
+	MixVoiceSpanScalar(Left + Index, Right + Index, Source + Index, Count - Index,
+		LeftVolume + dLeftVolume*(float)Index, RightVolume + dRightVolume*(float)Index, dLeftVolume, dRightVolume);
+}
+
+//Saturation comes from the clamp - packs would also saturate, but cvtps2dq turns anything past int32 into INT_MIN first
+internal
+CONVERT_BUS(ConvertBusSSE2)
+{
+	__m128 Min = _mm_set1_ps(-1.0f);
+	__m128 Max = _mm_set1_ps(1.0f);
+	__m128 Scale = _mm_set1_ps(32767.0f);
+
+	int Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		__m128 L = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(Left + Index), Min), Max), Scale);
+		__m128 R = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(Right + Index), Min), Max), Scale);
+		__m128i Low = _mm_cvtps_epi32(_mm_unpacklo_ps(L, R));
+		__m128i High = _mm_cvtps_epi32(_mm_unpackhi_ps(L, R));
+		_mm_storeu_si128((__m128i*)(Dest + 2*Index), _mm_packs_epi32(Low, High));
+	}
+	ConvertBusScalar(Dest + 2*Index, Left + Index, Right + Index, Count - Index);
+}
+
+//No FMA on purpose - a fused multiply-add rounds once where the scalar reference rounds twice
+internal BABL_TARGET_AVX2
+MIX_VOICE_SPAN(MixVoiceSpanAVX2)
+{
+	__m256 LeftStart = _mm256_set1_ps(LeftVolume);
+	__m256 RightStart = _mm256_set1_ps(RightVolume);
+	__m256 dLeft = _mm256_set1_ps(dLeftVolume);
+	__m256 dRight = _mm256_set1_ps(dRightVolume);
+	__m256i Lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i LaneStep = _mm256_set1_epi32(8);
+
+	int Index = 0;
+	for (; Index + 8 <= Count; Index += 8)
+	{
+		__m256 SampleIndex = _mm256_cvtepi32_ps(Lane);
+		__m256 Sample = _mm256_loadu_ps(Source + Index);
+		__m256 L = _mm256_add_ps(LeftStart, _mm256_mul_ps(dLeft, SampleIndex));
+		__m256 R = _mm256_add_ps(RightStart, _mm256_mul_ps(dRight, SampleIndex));
+		_mm256_storeu_ps(Left + Index, _mm256_add_ps(_mm256_loadu_ps(Left + Index), _mm256_mul_ps(Sample, L)));
+		_mm256_storeu_ps(Right + Index, _mm256_add_ps(_mm256_loadu_ps(Right + Index), _mm256_mul_ps(Sample, R)));
+		Lane = _mm256_add_epi32(Lane, LaneStep);
+	}
+	MixVoiceSpanScalar(Left + Index, Right + Index, Source + Index, Count - Index,
+		LeftVolume + dLeftVolume*(float)Index, RightVolume + dRightVolume*(float)Index, dLeftVolume, dRightVolume);
+}
+
+//unpack and packs both work within 128-bit halves, which happens to leave all 16 outputs in interleaved order
+internal BABL_TARGET_AVX2
+CONVERT_BUS(ConvertBusAVX2)
+{
+	__m256 Min = _mm256_set1_ps(-1.0f);
+	__m256 Max = _mm256_set1_ps(1.0f);
+	__m256 Scale = _mm256_set1_ps(32767.0f);
+
+	int Index = 0;
+	for (; Index + 8 <= Count; Index += 8)
+	{
+		__m256 L = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(Left + Index), Min), Max), Scale);
+		__m256 R = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(Right + Index), Min), Max), Scale);
+		__m256i Low = _mm256_cvtps_epi32(_mm256_unpacklo_ps(L, R));
+		__m256i High = _mm256_cvtps_epi32(_mm256_unpackhi_ps(L, R));
+		_mm256_storeu_si256((__m256i*)(Dest + 2*Index), _mm256_packs_epi32(Low, High));
+	}
+	ConvertBusScalar(Dest + 2*Index, Left + Index, Right + Index, Count - Index);
+}
+
+//
+// Resampling
+//
+
+//The fraction of the way from one tabulated phase to the next - the 18 bits under the phase, so exact in a float
+inline float
+GetResamplerPhaseFraction(uint32_t Fraction)
+{
+	float Result = (float)((Fraction >> 8) & ((1 << (24 - RESAMPLER_PHASE_BITS)) - 1))*(1.0f / (float)(1 << (24 - RESAMPLER_PHASE_BITS)));
+	return(Result);
+}
+
+internal
+RESAMPLE_SPAN(ResampleSpanScalar)
+{
+	int TapCount = Filter->TapCount;
+	for (int Index = 0; Index < Count; Index++)
+	{
+		float* Taps = Source + (Position >> 32);
+		uint32_t Fraction = (uint32_t)Position;
+		float t = GetResamplerPhaseFraction(Fraction);
+		float* Coefficients = Filter->Coefficients + (Fraction >> (32 - RESAMPLER_PHASE_BITS))*TapCount;
+		float* Deltas = Filter->Deltas + (Fraction >> (32 - RESAMPLER_PHASE_BITS))*TapCount;
+
+		float Lanes[8] = {};
+		for (int Tap = 0; Tap < TapCount; Tap++)
+		{
+			Lanes[Tap & 7] += (Coefficients[Tap] + t*Deltas[Tap])*Taps[Tap];
+		}
+		Dest[Index] = ((Lanes[0] + Lanes[4]) + (Lanes[2] + Lanes[6])) + ((Lanes[1] + Lanes[5]) + (Lanes[3] + Lanes[7]));
+		Position += Step;
+	}
+}
+
+//Lanes 0-3 and 4-7 in two registers, so the sums come out the same as the scalar and AVX2 ones
+internal
+RESAMPLE_SPAN(ResampleSpanSSE2)
+{
+	int TapCount = Filter->TapCount;
+	for (int Index = 0; Index < Count; Index++)
+	{
+		float* Taps = Source + (Position >> 32);
+		uint32_t Fraction = (uint32_t)Position;
+		__m128 t = _mm_set1_ps(GetResamplerPhaseFraction(Fraction));
+		float* Coefficients = Filter->Coefficients + (Fraction >> (32 - RESAMPLER_PHASE_BITS))*TapCount;
+		float* Deltas = Filter->Deltas + (Fraction >> (32 - RESAMPLER_PHASE_BITS))*TapCount;
+
+		__m128 Low = _mm_setzero_ps();
+		__m128 High = _mm_setzero_ps();
+		for (int Tap = 0; Tap < TapCount; Tap += 8)
+		{
+			__m128 LowKernel = _mm_add_ps(_mm_loadu_ps(Coefficients + Tap), _mm_mul_ps(t, _mm_loadu_ps(Deltas + Tap)));
+			__m128 HighKernel = _mm_add_ps(_mm_loadu_ps(Coefficients + Tap + 4), _mm_mul_ps(t, _mm_loadu_ps(Deltas + Tap + 4)));
+			Low = _mm_add_ps(Low, _mm_mul_ps(LowKernel, _mm_loadu_ps(Taps + Tap)));
+			High = _mm_add_ps(High, _mm_mul_ps(HighKernel, _mm_loadu_ps(Taps + Tap + 4)));
+		}
+		__m128 Sum = _mm_add_ps(Low, High);
+		Sum = _mm_add_ps(Sum, _mm_movehl_ps(Sum, Sum));
+		Sum = _mm_add_ss(Sum, _mm_shuffle_ps(Sum, Sum, 1));
+		Dest[Index] = _mm_cvtss_f32(Sum);
+		Position += Step;
+	}
+}
+
+internal BABL_TARGET_AVX2
+RESAMPLE_SPAN(ResampleSpanAVX2)
+{
+	int TapCount = Filter->TapCount;
+	for (int Index = 0; Index < Count; Index++)
+	{
+		float* Taps = Source + (Position >> 32);
+		uint32_t Fraction = (uint32_t)Position;
+		__m256 t = _mm256_set1_ps(GetResamplerPhaseFraction(Fraction));
+		float* Coefficients = Filter->Coefficients + (Fraction >> (32 - RESAMPLER_PHASE_BITS))*TapCount;
+		float* Deltas = Filter->Deltas + (Fraction >> (32 - RESAMPLER_PHASE_BITS))*TapCount;
+
+		__m256 Lanes = _mm256_setzero_ps();
+		for (int Tap = 0; Tap < TapCount; Tap += 8)
+		{
+			__m256 Kernel = _mm256_add_ps(_mm256_loadu_ps(Coefficients + Tap), _mm256_mul_ps(t, _mm256_loadu_ps(Deltas + Tap)));
+			Lanes = _mm256_add_ps(Lanes, _mm256_mul_ps(Kernel, _mm256_loadu_ps(Taps + Tap)));
+		}
+		__m128 Sum = _mm_add_ps(_mm256_castps256_ps128(Lanes), _mm256_extractf128_ps(Lanes, 1));
+		Sum = _mm_add_ps(Sum, _mm_movehl_ps(Sum, Sum));
+		Sum = _mm_add_ss(Sum, _mm_shuffle_ps(Sum, Sum, 1));
+		Dest[Index] = _mm_cvtss_f32(Sum);
+		Position += Step;
+	}
+}
+
+//Zeroth-order modified Bessel function, for the Kaiser window - the series is done well before 50 terms for any beta used here
+internal double
+BesselI0(double X)
+{
+	double Result = 1.0;
+	double Term = 1.0;
+	for (int K = 1; K < 50; K++)
+	{
+		Term *= (X / (2.0*K))*(X / (2.0*K));
+		Result += Term;
+		if (Term < Result*1e-12)
+		{
+			break;
+		}
+	}
+	return(Result);
+}
+
+/*
+	Kaiser-windowed sinc, cut off at RESAMPLER_CUTOFF of the lower of the two Nyquist rates. Beta trades the
+	stopband against the width of the transition: 8 is about 80dB down, with the band from 0.78 to 1.0 of Nyquist
+	given over to the transition at 32 taps. Each phase is normalised to a gain of exactly 1 at DC.
+*/
+#define RESAMPLER_CUTOFF 0.9
+#define RESAMPLER_KAISER_BETA 8.0
+
+internal bool32
+InitializeResamplerFilters(resampler_filter* Filters, memory_arena* Arena)
+{
+	float MaxSteps[RESAMPLER_FILTER_COUNT] = {1.0f, 1.5f, 2.0f, 3.0f, RESAMPLER_MAX_STEP};
+	for (int FilterIndex = 0; FilterIndex < RESAMPLER_FILTER_COUNT; FilterIndex++)
+	{
+		resampler_filter* Filter = &Filters[FilterIndex];
+		Filter->MaxStep = MaxSteps[FilterIndex];
+		Filter->TapCount = (int)(RESAMPLER_BASE_TAPS*Filter->MaxStep);
+		Filter->Coefficients = PushArray(Arena, RESAMPLER_PHASES*Filter->TapCount, float, 32);
+		Filter->Deltas = PushArray(Arena, RESAMPLER_PHASES*Filter->TapCount, float, 32);
+		if (!Filter->Coefficients || !Filter->Deltas)
+		{
+			return(false);
+		}
+
+		//Row RESAMPLER_PHASES is only needed for the last row of deltas
+		double Row[RESAMPLER_MAX_TAPS];
+		double NextRow[RESAMPLER_MAX_TAPS];
+		double Cutoff = RESAMPLER_CUTOFF / Filter->MaxStep;
+		double HalfWidth = (double)(Filter->TapCount / 2);
+		double WindowScale = 1.0 / BesselI0(RESAMPLER_KAISER_BETA);
+		for (int Phase = RESAMPLER_PHASES; Phase >= 0; Phase--)
+		{
+			double Sum = 0.0;
+			for (int Tap = 0; Tap < Filter->TapCount; Tap++)
+			{
+				//How far this tap's sample is from the output position, in source samples
+				double X = (double)(Tap - (Filter->TapCount / 2 - 1)) - (double)Phase / RESAMPLER_PHASES;
+				double R = X / HalfWidth;
+				double Window = (R*R < 1.0) ? BesselI0(RESAMPLER_KAISER_BETA*sqrt(1.0 - R*R))*WindowScale : 0.0;
+				double Angle = 3.14159265358979323846*Cutoff*X;
+				double Sinc = (Angle == 0.0) ? 1.0 : sin(Angle) / Angle;
+				Row[Tap] = Cutoff*Sinc*Window;
+				Sum += Row[Tap];
+			}
+			for (int Tap = 0; Tap < Filter->TapCount; Tap++)
+			{
+				Row[Tap] /= Sum;
+			}
+
+			if (Phase < RESAMPLER_PHASES)
+			{
+				for (int Tap = 0; Tap < Filter->TapCount; Tap++)
+				{
+					Filter->Coefficients[Phase*Filter->TapCount + Tap] = (float)Row[Tap];
+					Filter->Deltas[Phase*Filter->TapCount + Tap] = (float)(NextRow[Tap] - Row[Tap]);
+				}
+			}
+			memcpy(NextRow, Row, Filter->TapCount*sizeof(double));
+		}
+	}
+	return(true);
+}
+
+//
+// Oscillators
+//
+
+//sin(2*pi*s) on [-0.25, 0.25], Taylor through s^11 - under 1e-7 off at the ends
+#define SINE_C1 6.28318531f
+#define SINE_C3 -41.3417022f
+#define SINE_C5 81.6052493f
+#define SINE_C7 -76.7058597f
+#define SINE_C9 42.0586940f
+#define SINE_C11 -15.0946426f
+
+#define PHASE_TO_FLOAT (1.0f / 16777216.0f)
+
+//Top 24 bits of the phase, as the fraction of a cycle in [0, 1) - exactly representable
+inline float
+GetPhaseFraction(uint32_t Phase)
+{
+	return((float)(int32_t)(Phase >> 8)*PHASE_TO_FLOAT);
+}
+
+//The phase read as signed turns in [-0.5, 0.5), folded onto [-0.25, 0.25] where sin(pi - x) = sin(x)
+inline float
+SineOfPhase(uint32_t Phase)
+{
+	float S = (float)((int32_t)Phase >> 8)*PHASE_TO_FLOAT;
+	if (S > 0.25f)
+	{
+		S = 0.5f - S;
+	}
+	else if (S < -0.25f)
+	{
+		S = -0.5f - S;
+	}
+	float S2 = S*S;
+	return(S*(SINE_C1 + S2*(SINE_C3 + S2*(SINE_C5 + S2*(SINE_C7 + S2*(SINE_C9 + S2*SINE_C11))))));
+}
+
+//What a unit step loses by being band-limited, over the sample either side of it (scaled by 2 - the saw's jump)
+inline float
+PolyBLEP(float T, float dT, float InvdT)
+{
+	float Result = 0.0f;
+	if (T < dT)
+	{
+		float X = T*InvdT;
+		Result = (X + X) - X*X - 1.0f;
+	}
+	else if (T > 1.0f - dT)
+	{
+		float X = (T - 1.0f)*InvdT;
+		Result = X*X + (X + X) + 1.0f;
+	}
+	return(Result);
+}
+
+//The same for a unit change of slope (per sample) - the integral of PolyBLEP
+inline float
+PolyBLAMP(float T, float dT, float InvdT)
+{
+	float Result = 0.0f;
+	if (T < dT)
+	{
+		float X = 1.0f - T*InvdT;
+		Result = X*X*X*(1.0f / 6.0f);
+	}
+	else if (T > 1.0f - dT)
+	{
+		float X = (T - 1.0f)*InvdT + 1.0f;
+		Result = X*X*X*(1.0f / 6.0f);
+	}
+	return(Result);
+}
+
+//Saw rises from -1 to 1, square starts high, triangle and sine start at 0 going up
+inline float
+OscillatorSample(uint32_t Phase, float dT, float InvdT, oscillator_waveform Waveform)
+{
+	float Result = 0.0f;
+	switch (Waveform)
+	{
+		case Waveform_Sine:
+		{
+			Result = SineOfPhase(Phase);
+		} break;
+
+		case Waveform_Saw:
+		{
+			float T = GetPhaseFraction(Phase);
+			Result = (T + T - 1.0f) - PolyBLEP(T, dT, InvdT);
+		} break;
+
+		case Waveform_Square:
+		{
+			float T = GetPhaseFraction(Phase);
+			float Naive = (T < 0.5f) ? 1.0f : -1.0f;
+			Result = (Naive + PolyBLEP(T, dT, InvdT)) - PolyBLEP(GetPhaseFraction(Phase + 0x80000000), dT, InvdT);
+		} break;
+
+		case Waveform_Triangle:
+		{
+			//Corners at T = 0 (slope goes -4 to +4 per cycle) and T = 0.5 (back again)
+			float T = GetPhaseFraction(Phase + 0x40000000);
+			float Naive = 1.0f - 4.0f*fabsf(T - 0.5f);
+			float Corners = PolyBLAMP(T, dT, InvdT) - PolyBLAMP(GetPhaseFraction(Phase + 0xC0000000), dT, InvdT);
+			Result = Naive + (8.0f*dT)*Corners;
+		} break;
+	}
+	return(Result);
+}
+
+inline float
+GetPhaseStep(uint32_t dPhase)
+{
+	return((float)dPhase*(1.0f / 4294967296.0f));
+}
+
+internal
+OSCILLATOR_SPAN(OscillatorSpanScalar)
+{
+	float dT = GetPhaseStep(dPhase);
+	float InvdT = 1.0f / dT;
+	for (int Index = 0; Index < Count; Index++)
+	{
+		float Sample = OscillatorSample(Phase, dT, InvdT, Waveform);
+		Left[Index] += Sample*LeftGain;
+		Right[Index] += Sample*RightGain;
+		Phase += dPhase;
+	}
+}
+
+//SSE2 has no blendv - Mask picks A, the rest comes from B
+inline __m128
+Select4(__m128 Mask, __m128 A, __m128 B)
+{
+	return(_mm_or_ps(_mm_and_ps(Mask, A), _mm_andnot_ps(Mask, B)));
+}
+
+inline __m128
+GetPhaseFraction4(__m128i Phase)
+{
+	return(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(Phase, 8)), _mm_set1_ps(PHASE_TO_FLOAT)));
+}
+
+inline __m128
+SineOfPhase4(__m128i Phase)
+{
+	__m128 S = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(Phase, 8)), _mm_set1_ps(PHASE_TO_FLOAT));
+	__m128 Quarter = _mm_set1_ps(0.25f);
+	__m128 Half = _mm_set1_ps(0.5f);
+	S = Select4(_mm_cmpgt_ps(S, Quarter), _mm_sub_ps(Half, S),
+		Select4(_mm_cmplt_ps(S, _mm_sub_ps(_mm_setzero_ps(), Quarter)), _mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), Half), S), S));
+	__m128 S2 = _mm_mul_ps(S, S);
+	__m128 Result = _mm_add_ps(_mm_set1_ps(SINE_C9), _mm_mul_ps(S2, _mm_set1_ps(SINE_C11)));
+	Result = _mm_add_ps(_mm_set1_ps(SINE_C7), _mm_mul_ps(S2, Result));
+	Result = _mm_add_ps(_mm_set1_ps(SINE_C5), _mm_mul_ps(S2, Result));
+	Result = _mm_add_ps(_mm_set1_ps(SINE_C3), _mm_mul_ps(S2, Result));
+	Result = _mm_add_ps(_mm_set1_ps(SINE_C1), _mm_mul_ps(S2, Result));
+	return(_mm_mul_ps(S, Result));
+}
+
+//Both sides are computed everywhere and masked - at most one applies, since dT stays under a half
+inline __m128
+PolyBLEP4(__m128 T, __m128 dT, __m128 InvdT)
+{
+	__m128 One = _mm_set1_ps(1.0f);
+	__m128 X = _mm_mul_ps(T, InvdT);
+	__m128 Low = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(X, X), _mm_mul_ps(X, X)), One);
+	X = _mm_mul_ps(_mm_sub_ps(T, One), InvdT);
+	__m128 High = _mm_add_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_add_ps(X, X)), One);
+	return(_mm_or_ps(_mm_and_ps(_mm_cmplt_ps(T, dT), Low), _mm_and_ps(_mm_cmpgt_ps(T, _mm_sub_ps(One, dT)), High)));
+}
+
+inline __m128
+PolyBLAMP4(__m128 T, __m128 dT, __m128 InvdT)
+{
+	__m128 One = _mm_set1_ps(1.0f);
+	__m128 Sixth = _mm_set1_ps(1.0f / 6.0f);
+	__m128 X = _mm_sub_ps(One, _mm_mul_ps(T, InvdT));
+	__m128 Low = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(X, X), X), Sixth);
+	X = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(T, One), InvdT), One);
+	__m128 High = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(X, X), X), Sixth);
+	return(_mm_or_ps(_mm_and_ps(_mm_cmplt_ps(T, dT), Low), _mm_and_ps(_mm_cmpgt_ps(T, _mm_sub_ps(One, dT)), High)));
+}
+
+inline __m128
+OscillatorSample4(__m128i Phase, __m128 dT, __m128 InvdT, oscillator_waveform Waveform)
+{
+	__m128 Result = _mm_setzero_ps();
+	__m128 One = _mm_set1_ps(1.0f);
+	switch (Waveform)
+	{
+		case Waveform_Sine:
+		{
+			Result = SineOfPhase4(Phase);
+		} break;
+
+		case Waveform_Saw:
+		{
+			__m128 T = GetPhaseFraction4(Phase);
+			Result = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(T, T), One), PolyBLEP4(T, dT, InvdT));
+		} break;
+
+		case Waveform_Square:
+		{
+			__m128 T = GetPhaseFraction4(Phase);
+			__m128 Naive = Select4(_mm_cmplt_ps(T, _mm_set1_ps(0.5f)), One, _mm_set1_ps(-1.0f));
+			__m128 Opposite = GetPhaseFraction4(_mm_add_epi32(Phase, _mm_set1_epi32((int)0x80000000)));
+			Result = _mm_sub_ps(_mm_add_ps(Naive, PolyBLEP4(T, dT, InvdT)), PolyBLEP4(Opposite, dT, InvdT));
+		} break;
+
+		case Waveform_Triangle:
+		{
+			__m128 T = GetPhaseFraction4(_mm_add_epi32(Phase, _mm_set1_epi32(0x40000000)));
+			__m128 Distance = _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(T, _mm_set1_ps(0.5f)));
+			__m128 Naive = _mm_sub_ps(One, _mm_mul_ps(_mm_set1_ps(4.0f), Distance));
+			__m128 Opposite = GetPhaseFraction4(_mm_add_epi32(Phase, _mm_set1_epi32((int)0xC0000000)));
+			__m128 Corners = _mm_sub_ps(PolyBLAMP4(T, dT, InvdT), PolyBLAMP4(Opposite, dT, InvdT));
+			Result = _mm_add_ps(Naive, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(8.0f), dT), Corners));
+		} break;
+	}
+	return(Result);
+}
+
+//Lanes are consecutive samples of the one oscillator; the per-lane phases wrap exactly like the scalar ones
+internal
+OSCILLATOR_SPAN(OscillatorSpanSSE2)
+{
+	float ScalardT = GetPhaseStep(dPhase);
+	__m128 dT = _mm_set1_ps(ScalardT);
+	__m128 InvdT = _mm_set1_ps(1.0f / ScalardT);
+	__m128 LeftGain4 = _mm_set1_ps(LeftGain);
+	__m128 RightGain4 = _mm_set1_ps(RightGain);
+	__m128i LanePhase = _mm_setr_epi32((int)Phase, (int)(Phase + dPhase), (int)(Phase + 2*dPhase), (int)(Phase + 3*dPhase));
+	__m128i PhaseStep = _mm_set1_epi32((int)(4*dPhase));
+
+	int Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		__m128 Sample = OscillatorSample4(LanePhase, dT, InvdT, Waveform);
+		_mm_storeu_ps(Left + Index, _mm_add_ps(_mm_loadu_ps(Left + Index), _mm_mul_ps(Sample, LeftGain4)));
+		_mm_storeu_ps(Right + Index, _mm_add_ps(_mm_loadu_ps(Right + Index), _mm_mul_ps(Sample, RightGain4)));
+		LanePhase = _mm_add_epi32(LanePhase, PhaseStep);
+	}
+	OscillatorSpanScalar(Left + Index, Right + Index, Count - Index, Phase + (uint32_t)Index*dPhase, dPhase,
+		LeftGain, RightGain, Waveform);
+}
+
+inline BABL_TARGET_AVX2 __m256
+Select8(__m256 Mask, __m256 A, __m256 B)
+{
+	return(_mm256_blendv_ps(B, A, Mask));
+}
+
+inline BABL_TARGET_AVX2 __m256
+GetPhaseFraction8(__m256i Phase)
+{
+	return(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(Phase, 8)), _mm256_set1_ps(PHASE_TO_FLOAT)));
+}
+
+inline BABL_TARGET_AVX2 __m256
+SineOfPhase8(__m256i Phase)
+{
+	__m256 S = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(Phase, 8)), _mm256_set1_ps(PHASE_TO_FLOAT));
+	__m256 Quarter = _mm256_set1_ps(0.25f);
+	__m256 Half = _mm256_set1_ps(0.5f);
+	__m256 Zero = _mm256_setzero_ps();
+	S = Select8(_mm256_cmp_ps(S, Quarter, _CMP_GT_OQ), _mm256_sub_ps(Half, S),
+		Select8(_mm256_cmp_ps(S, _mm256_sub_ps(Zero, Quarter), _CMP_LT_OQ), _mm256_sub_ps(_mm256_sub_ps(Zero, Half), S), S));
+	__m256 S2 = _mm256_mul_ps(S, S);
+	__m256 Result = _mm256_add_ps(_mm256_set1_ps(SINE_C9), _mm256_mul_ps(S2, _mm256_set1_ps(SINE_C11)));
+	Result = _mm256_add_ps(_mm256_set1_ps(SINE_C7), _mm256_mul_ps(S2, Result));
+	Result = _mm256_add_ps(_mm256_set1_ps(SINE_C5), _mm256_mul_ps(S2, Result));
+	Result = _mm256_add_ps(_mm256_set1_ps(SINE_C3), _mm256_mul_ps(S2, Result));
+	Result = _mm256_add_ps(_mm256_set1_ps(SINE_C1), _mm256_mul_ps(S2, Result));
+	return(_mm256_mul_ps(S, Result));
+}
+
+inline BABL_TARGET_AVX2 __m256
+PolyBLEP8(__m256 T, __m256 dT, __m256 InvdT)
+{
+	__m256 One = _mm256_set1_ps(1.0f);
+	__m256 X = _mm256_mul_ps(T, InvdT);
+	__m256 Low = _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(X, X), _mm256_mul_ps(X, X)), One);
+	X = _mm256_mul_ps(_mm256_sub_ps(T, One), InvdT);
+	__m256 High = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(X, X), _mm256_add_ps(X, X)), One);
+	return(_mm256_or_ps(_mm256_and_ps(_mm256_cmp_ps(T, dT, _CMP_LT_OQ), Low),
+		_mm256_and_ps(_mm256_cmp_ps(T, _mm256_sub_ps(One, dT), _CMP_GT_OQ), High)));
+}
+
+inline BABL_TARGET_AVX2 __m256
+PolyBLAMP8(__m256 T, __m256 dT, __m256 InvdT)
+{
+	__m256 One = _mm256_set1_ps(1.0f);
+	__m256 Sixth = _mm256_set1_ps(1.0f / 6.0f);
+	__m256 X = _mm256_sub_ps(One, _mm256_mul_ps(T, InvdT));
+	__m256 Low = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(X, X), X), Sixth);
+	X = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(T, One), InvdT), One);
+	__m256 High = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(X, X), X), Sixth);
+	return(_mm256_or_ps(_mm256_and_ps(_mm256_cmp_ps(T, dT, _CMP_LT_OQ), Low),
+		_mm256_and_ps(_mm256_cmp_ps(T, _mm256_sub_ps(One, dT), _CMP_GT_OQ), High)));
+}
+
+inline BABL_TARGET_AVX2 __m256
+OscillatorSample8(__m256i Phase, __m256 dT, __m256 InvdT, oscillator_waveform Waveform)
+{
+	__m256 Result = _mm256_setzero_ps();
+	__m256 One = _mm256_set1_ps(1.0f);
+	switch (Waveform)
+	{
+		case Waveform_Sine:
+		{
+			Result = SineOfPhase8(Phase);
+		} break;
+
+		case Waveform_Saw:
+		{
+			__m256 T = GetPhaseFraction8(Phase);
+			Result = _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(T, T), One), PolyBLEP8(T, dT, InvdT));
+		} break;
+
+		case Waveform_Square:
+		{
+			__m256 T = GetPhaseFraction8(Phase);
+			__m256 Naive = Select8(_mm256_cmp_ps(T, _mm256_set1_ps(0.5f), _CMP_LT_OQ), One, _mm256_set1_ps(-1.0f));
+			__m256 Opposite = GetPhaseFraction8(_mm256_add_epi32(Phase, _mm256_set1_epi32((int)0x80000000)));
+			Result = _mm256_sub_ps(_mm256_add_ps(Naive, PolyBLEP8(T, dT, InvdT)), PolyBLEP8(Opposite, dT, InvdT));
+		} break;
+
+		case Waveform_Triangle:
+		{
+			__m256 T = GetPhaseFraction8(_mm256_add_epi32(Phase, _mm256_set1_epi32(0x40000000)));
+			__m256 Distance = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), _mm256_sub_ps(T, _mm256_set1_ps(0.5f)));
+			__m256 Naive = _mm256_sub_ps(One, _mm256_mul_ps(_mm256_set1_ps(4.0f), Distance));
+			__m256 Opposite = GetPhaseFraction8(_mm256_add_epi32(Phase, _mm256_set1_epi32((int)0xC0000000)));
+			__m256 Corners = _mm256_sub_ps(PolyBLAMP8(T, dT, InvdT), PolyBLAMP8(Opposite, dT, InvdT));
+			Result = _mm256_add_ps(Naive, _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(8.0f), dT), Corners));
+		} break;
+	}
+	return(Result);
+}
+
+internal BABL_TARGET_AVX2
+OSCILLATOR_SPAN(OscillatorSpanAVX2)
+{
+	float ScalardT = GetPhaseStep(dPhase);
+	__m256 dT = _mm256_set1_ps(ScalardT);
+	__m256 InvdT = _mm256_set1_ps(1.0f / ScalardT);
+	__m256 LeftGain8 = _mm256_set1_ps(LeftGain);
+	__m256 RightGain8 = _mm256_set1_ps(RightGain);
+	__m256i LanePhase = _mm256_add_epi32(_mm256_set1_epi32((int)Phase),
+		_mm256_mullo_epi32(_mm256_set1_epi32((int)dPhase), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+	__m256i PhaseStep = _mm256_set1_epi32((int)(8*dPhase));
+
+	int Index = 0;
+	for (; Index + 8 <= Count; Index += 8)
+	{
+		__m256 Sample = OscillatorSample8(LanePhase, dT, InvdT, Waveform);
+		_mm256_storeu_ps(Left + Index, _mm256_add_ps(_mm256_loadu_ps(Left + Index), _mm256_mul_ps(Sample, LeftGain8)));
+		_mm256_storeu_ps(Right + Index, _mm256_add_ps(_mm256_loadu_ps(Right + Index), _mm256_mul_ps(Sample, RightGain8)));
+		LanePhase = _mm256_add_epi32(LanePhase, PhaseStep);
+	}
+	OscillatorSpanScalar(Left + Index, Right + Index, Count - Index, Phase + (uint32_t)Index*dPhase, dPhase,
+		LeftGain, RightGain, Waveform);
+}
+
+internal void
+InitAudioKernels(cpu_features Features)
+{
+	AudioKernels.Name = "Scalar";
+	AudioKernels.MixVoiceSpan = MixVoiceSpanScalar;
+	AudioKernels.ResampleSpan = ResampleSpanScalar;
+	AudioKernels.OscillatorSpan = OscillatorSpanScalar;
+	AudioKernels.ConvertBus = ConvertBusScalar;
+
+	if (Features.AVX2)
+	{
+		AudioKernels.Name = "AVX2";
+		AudioKernels.MixVoiceSpan = MixVoiceSpanAVX2;
+		AudioKernels.ResampleSpan = ResampleSpanAVX2;
+		AudioKernels.OscillatorSpan = OscillatorSpanAVX2;
+		AudioKernels.ConvertBus = ConvertBusAVX2;
+	}
+	else if (Features.SSE2)
+	{
+		AudioKernels.Name = "SSE2";
+		AudioKernels.MixVoiceSpan = MixVoiceSpanSSE2;
+		AudioKernels.ResampleSpan = ResampleSpanSSE2;
+		AudioKernels.OscillatorSpan = OscillatorSpanSSE2;
+		AudioKernels.ConvertBus = ConvertBusSSE2;
+	}
+}
+
+//
+// Voices
+//
+
+//Enough room to start every voice and oscillator a few times over between two blocks
+internal bool32
+InitializeAudioState(audio_state* Audio, memory_arena* Arena, uint32_t MaxVoiceCount, uint32_t MaxOscillatorCount,
+	uint32_t MaxStreamCount)
+{
+	*Audio = {};
+	uint32_t CommandCount = 64;
+	while (CommandCount < 4*(MaxVoiceCount + MaxOscillatorCount))
+	{
+		CommandCount *= 2;
+	}
+	audio_command* Commands = PushArray(Arena, CommandCount, audio_command, 64);
+	Audio->Voices = PushArray(Arena, MaxVoiceCount, playing_voice, 64);
+	Audio->Oscillators = PushArray(Arena, MaxOscillatorCount, oscillator, 64);
+	//The source covers a chunk at the steepest step, plus the taps either side of it
+	Audio->ResampleSource = PushArray(Arena, (uint32_t)(RESAMPLER_CHUNK*RESAMPLER_MAX_STEP) + RESAMPLER_MAX_TAPS + 8, float, 32);
+	Audio->ResampleOutput = PushArray(Arena, RESAMPLER_CHUNK, float, 32);
+	if (!Commands || !Audio->Voices || !Audio->Oscillators || !Audio->ResampleSource || !Audio->ResampleOutput ||
+		!InitializeResamplerFilters(Audio->Filters, Arena))
+	{
+		return(false);
+	}
+
+	Audio->Streams = PushArray(Arena, MaxStreamCount, sound_stream, 64);
+	if (MaxStreamCount && !Audio->Streams)
+	{
+		return(false);
+	}
+	for (uint32_t StreamIndex = 0; StreamIndex < MaxStreamCount; StreamIndex++)
+	{
+		sound_stream* Stream = &Audio->Streams[StreamIndex];
+		*Stream = {};
+		void* Chunks = PushArray(Arena, SOUND_STREAM_CHUNK_COUNT, sound_stream_chunk, 64);
+		Stream->ReadBuffer = PushArray(Arena, SOUND_STREAM_CHUNK_SAMPLES*SOUND_STREAM_MAX_BYTES_PER_FRAME, uint8_t, 64);
+		Stream->Window = PushArray(Arena, SOUND_STREAM_WINDOW, float, 32);
+		if (!Chunks || !Stream->ReadBuffer || !Stream->Window)
+		{
+			return(false);
+		}
+		InitializeSPSCRing(&Stream->Chunks, Chunks, sizeof(sound_stream_chunk), SOUND_STREAM_CHUNK_COUNT);
+	}
+	Audio->MaxStreamCount = MaxStreamCount;
+	InitializeSPSCRing(&Audio->Commands, Commands, sizeof(audio_command), CommandCount);
+	Audio->MaxOscillatorCount = MaxOscillatorCount;
+
+	Audio->MaxVoiceCount = MaxVoiceCount;
+	for (uint32_t VoiceIndex = MaxVoiceCount; VoiceIndex > 0; VoiceIndex--)
+	{
+		playing_voice* Voice = &Audio->Voices[VoiceIndex - 1];
+		*Voice = {};
+		Voice->Next = Audio->FirstFree;
+		Audio->FirstFree = Voice;
+	}
+	return(true);
+}
+
+//Equal power: the two gains squared always sum to 1, so a sound doesn't dip as it crosses the middle
+inline float
+GetPanGains(float Pan, float* LeftGain, float* RightGain)
+{
+	Pan = (Pan < -1.0f) ? -1.0f : (Pan > 1.0f) ? 1.0f : Pan;
+	float Angle = (Pan + 1.0f)*0.25f*3.14159265f;
+	*LeftGain = cosf(Angle);
+	*RightGain = sinf(Angle);
+	return(Pan);
+}
+
+//
+// Game side - queues commands and returns straight away
+//
+
+//0 when the ring is full, and the command is dropped
+inline audio_command*
+BeginAudioCommand(audio_state* Audio, audio_command_type Type, uint32_t Handle)
+{
+	audio_command* Result = (audio_command*)BeginRingWrite(&Audio->Commands);
+	if (Result)
+	{
+		*Result = {};
+		Result->Type = Type;
+		Result->Handle = Handle;
+	}
+	else
+	{
+		++Audio->DroppedCommandCount;
+	}
+	return(Result);
+}
+
+inline void
+EndAudioCommand(audio_state* Audio)
+{
+	EndRingWrite(&Audio->Commands);
+}
+
+inline uint32_t
+GetNextAudioHandle(audio_state* Audio)
+{
+	if (++Audio->NextHandle == 0)
+	{
+		++Audio->NextHandle;
+	}
+	return(Audio->NextHandle);
+}
+
+//Returns a zero ID when the command could not be queued; a full pool only shows up as the ID going stale
+internal voice_id
+PlaySound(audio_state* Audio, loaded_sound* Sound, float Volume, float Pan, bool32 IsLooping)
+{
+	voice_id Result = {};
+	if (Sound && (Sound->SampleCount > 0))
+	{
+		audio_command* Command = BeginAudioCommand(Audio, AudioCommand_PlaySound, 0);
+		if (Command)
+		{
+			Result.Value = GetNextAudioHandle(Audio);
+			Command->Handle = Result.Value;
+			Command->Sound = Sound;
+			Command->Volume = Volume;
+			Command->Pan = Pan;
+			Command->IsLooping = IsLooping;
+			EndAudioCommand(Audio);
+		}
+	}
+	return(Result);
+}
+
+//A FadeSeconds of 0 jumps straight there
+internal void
+SetVoiceVolume(audio_state* Audio, voice_id ID, float TargetVolume, float FadeSeconds)
+{
+	audio_command* Command = ID.Value ? BeginAudioCommand(Audio, AudioCommand_SetVoiceVolume, ID.Value) : 0;
+	if (Command)
+	{
+		Command->Volume = TargetVolume;
+		Command->FadeSeconds = FadeSeconds;
+		EndAudioCommand(Audio);
+	}
+}
+
+internal void
+SetVoicePan(audio_state* Audio, voice_id ID, float Pan)
+{
+	audio_command* Command = ID.Value ? BeginAudioCommand(Audio, AudioCommand_SetVoicePan, ID.Value) : 0;
+	if (Command)
+	{
+		Command->Pan = Pan;
+		EndAudioCommand(Audio);
+	}
+}
+
+//1 plays the sound as it is, 2 an octave up; past RESAMPLER_MAX_STEP source samples per output sample it stops rising
+internal void
+SetVoicePitch(audio_state* Audio, voice_id ID, float Pitch)
+{
+	audio_command* Command = ID.Value ? BeginAudioCommand(Audio, AudioCommand_SetVoicePitch, ID.Value) : 0;
+	if (Command)
+	{
+		Command->Pitch = Pitch;
+		EndAudioCommand(Audio);
+	}
+}
+
+internal void
+StopVoice(audio_state* Audio, voice_id ID, float FadeSeconds)
+{
+	audio_command* Command = ID.Value ? BeginAudioCommand(Audio, AudioCommand_StopVoice, ID.Value) : 0;
+	if (Command)
+	{
+		Command->FadeSeconds = FadeSeconds;
+		EndAudioCommand(Audio);
+	}
+}
+
+//Returns a zero ID when the command could not be queued; a full pool only shows up as the ID going stale
+internal oscillator_id
+StartOscillator(audio_state* Audio, oscillator_waveform Waveform, float Hz, float Volume, float Pan)
+{
+	oscillator_id Result = {};
+	audio_command* Command = BeginAudioCommand(Audio, AudioCommand_StartOscillator, 0);
+	if (Command)
+	{
+		Result.Value = GetNextAudioHandle(Audio);
+		Command->Handle = Result.Value;
+		Command->Waveform = Waveform;
+		Command->Hz = Hz;
+		Command->Volume = Volume;
+		Command->Pan = Pan;
+		EndAudioCommand(Audio);
+	}
+	return(Result);
+}
+
+//Takes effect at the next block, continuing from the current phase so there is no click
+internal void
+SetOscillatorFrequency(audio_state* Audio, oscillator_id ID, float Hz)
+{
+	audio_command* Command = ID.Value ? BeginAudioCommand(Audio, AudioCommand_SetOscillatorFrequency, ID.Value) : 0;
+	if (Command)
+	{
+		Command->Hz = Hz;
+		EndAudioCommand(Audio);
+	}
+}
+
+internal void
+SetOscillatorVolume(audio_state* Audio, oscillator_id ID, float Volume, float Pan)
+{
+	audio_command* Command = ID.Value ? BeginAudioCommand(Audio, AudioCommand_SetOscillatorVolume, ID.Value) : 0;
+	if (Command)
+	{
+		Command->Volume = Volume;
+		Command->Pan = Pan;
+		EndAudioCommand(Audio);
+	}
+}
+
+internal void
+StopOscillator(audio_state* Audio, oscillator_id ID)
+{
+	audio_command* Command = ID.Value ? BeginAudioCommand(Audio, AudioCommand_StopOscillator, ID.Value) : 0;
+	if (Command)
+	{
+		EndAudioCommand(Audio);
+	}
+}
+
+//
+// Streams - the game side and the refill worker
+//
+
+//Decodes into every free chunk, or until the sound runs out. A read that fails ends the sound where it got to
+internal
+PLATFORM_WORK_QUEUE_CALLBACK(DoRefillSoundStreamWork)
+{
+	TIMED_FUNCTION();
+	sound_stream* Stream = (sound_stream*)Data;
+	wav_info* Info = &Stream->Info;
+	if (!Stream->File.IsOpen && !Stream->IsFailed)
+	{
+		Stream->File = Stream->OpenFile(Stream->Filename);
+		if (Stream->File.IsOpen)
+		{
+			*Info = ReadWAVInfo(Stream->ReadDataFromFile, &Stream->File);
+		}
+		Stream->IsFailed = !Info->IsValid || (Info->FrameCount == 0) || (Info->BytesPerFrame > SOUND_STREAM_MAX_BYTES_PER_FRAME);
+	}
+
+	sound_stream_chunk* Chunk;
+	while (!Stream->IsFailed && !Stream->IsEndOfFile &&
+		((Chunk = (sound_stream_chunk*)BeginRingWrite(&Stream->Chunks)) != 0))
+	{
+		uint32_t SampleCount = 0;
+		while ((SampleCount < SOUND_STREAM_CHUNK_SAMPLES) && !Stream->IsEndOfFile)
+		{
+			uint64_t FramesLeft = Info->FrameCount - Stream->NextFrame;
+			uint32_t Count = SOUND_STREAM_CHUNK_SAMPLES - SampleCount;
+			Count = (FramesLeft < Count) ? (uint32_t)FramesLeft : Count;
+			uint32_t Bytes = Count*Info->BytesPerFrame;
+			if (!Stream->ReadDataFromFile(&Stream->File, Info->DataOffset + Stream->NextFrame*Info->BytesPerFrame, Bytes, Stream->ReadBuffer))
+			{
+				Stream->IsEndOfFile = true;
+				break;
+			}
+			DecodeWAVFrames(Info, Stream->ReadBuffer, Count, Chunk->Samples + SampleCount);
+			Stream->RefillBytesRead += Bytes;
+			SampleCount += Count;
+
+			Stream->NextFrame += Count;
+			if (Stream->NextFrame == Info->FrameCount)
+			{
+				if (Stream->IsLooping)
+				{
+					Stream->NextFrame = 0;
+				}
+				else
+				{
+					Stream->IsEndOfFile = true;
+				}
+			}
+		}
+		Chunk->SampleCount = SampleCount;
+		Chunk->IsLast = Stream->IsEndOfFile;
+		EndRingWrite(&Stream->Chunks);
+		++Stream->RefillChunkCount;
+	}
+
+	//Everything above has to be visible before the game side is told it can look
+	Stream->RefillDoneTicks = __rdtsc();
+	CompletePreviousWritesBeforeFutureWrites;
+	Stream->IsRefilling = false;
+}
+
+internal void
+StartSoundStreamRefill(sound_stream* Stream, game_memory* Memory)
+{
+	Stream->IsRefilling = true;
+	Stream->RefillChunkCount = 0;
+	Stream->RefillBytesRead = 0;
+	Stream->RefillRequestTicks = __rdtsc();
+	if (Memory->LowPriorityQueue)
+	{
+		Memory->PlatformAddEntry(Memory->LowPriorityQueue, DoRefillSoundStreamWork, Stream);
+	}
+	else
+	{
+		//No background queue (a bare-bones platform) - the refill happens right here
+		DoRefillSoundStreamWork(0, Stream);
+	}
+}
+
+/*
+	Plays a WAV file from disk. Nothing is opened or read here: the first refill does that on the low-priority
+	queue, and the voice is silent until it has. Returns a zero ID when every stream is in use or the command could
+	not be queued; a file that turns out not to be there (or not to be a WAV it can play) just ends the voice.
+*/
+internal voice_id
+PlayStream(audio_state* Audio, game_memory* Memory, char* Filename, float Volume, float Pan, bool32 IsLooping)
+{
+	voice_id Result = {};
+	sound_stream* Stream = 0;
+	for (uint32_t StreamIndex = 0; StreamIndex < Audio->MaxStreamCount; StreamIndex++)
+	{
+		if (!Audio->Streams[StreamIndex].IsActive)
+		{
+			Stream = &Audio->Streams[StreamIndex];
+			break;
+		}
+	}
+
+	audio_command* Command = (Stream && Memory->PlatformOpenFile) ? BeginAudioCommand(Audio, AudioCommand_PlaySound, 0) : 0;
+	if (Command)
+	{
+		Stream->IsActive = true;
+		Stream->OpenFile = Memory->PlatformOpenFile;
+		Stream->ReadDataFromFile = Memory->PlatformReadDataFromFile;
+		uint32_t NameLength = 0;
+		for (; Filename[NameLength] && (NameLength < sizeof(Stream->Filename) - 1); NameLength++)
+		{
+			Stream->Filename[NameLength] = Filename[NameLength];
+		}
+		Stream->Filename[NameLength] = 0;
+		Stream->IsLooping = IsLooping;
+
+		Stream->File = {};
+		Stream->Info = {};
+		Stream->NextFrame = 0;
+		Stream->IsFailed = false;
+		Stream->IsEndOfFile = false;
+		InitializeSPSCRing(&Stream->Chunks, Stream->Chunks.Elements, sizeof(sound_stream_chunk), SOUND_STREAM_CHUNK_COUNT);
+
+		//Silence before the start, for the taps that reach back past it
+		memset(Stream->Window, 0, SOUND_STREAM_HISTORY*sizeof(float));
+		Stream->WindowCount = SOUND_STREAM_HISTORY;
+		Stream->ChunkReadOffset = 0;
+		Stream->HasStarted = false;
+		Stream->IsEnding = false;
+		Stream->EndIndex = 0;
+		Stream->IsStarved = false;
+		Stream->IsFinished = false;
+		StartSoundStreamRefill(Stream, Memory);
+
+		Result.Value = GetNextAudioHandle(Audio);
+		Command->Handle = Result.Value;
+		Command->Stream = Stream;
+		Command->Volume = Volume;
+		Command->Pan = Pan;
+		Command->IsLooping = IsLooping;
+		EndAudioCommand(Audio);
+	}
+	return(Result);
+}
+
+//Once a frame: collects finished refills, starts new ones wherever a chunk is free, and closes streams whose
+//voices are done
+internal void
+UpdateSoundStreams(audio_state* Audio, game_memory* Memory)
+{
+	sound_stream_stats* Stats = &Audio->StreamStats;
+	for (uint32_t StreamIndex = 0; StreamIndex < Audio->MaxStreamCount; StreamIndex++)
+	{
+		sound_stream* Stream = &Audio->Streams[StreamIndex];
+		if (!Stream->IsActive || Stream->IsRefilling)
+		{
+			continue;
+		}
+		CompletePreviousReadsBeforeFutureReads;
+
+		if (Stream->RefillRequestTicks)
+		{
+			uint64_t Latency = Stream->RefillDoneTicks - Stream->RefillRequestTicks;
+			++Stats->Refills;
+			Stats->ChunksDecoded += Stream->RefillChunkCount;
+			Stats->BytesRead += Stream->RefillBytesRead;
+			Stats->LatencyTicksTotal += Latency;
+			Stats->LatencyTicksMax = (Latency > Stats->LatencyTicksMax) ? Latency : Stats->LatencyTicksMax;
+			//Only the refill that opens the file can fail, and nothing is refilled after it
+			Stats->FailedCount += Stream->IsFailed ? 1 : 0;
+			Stream->RefillRequestTicks = 0;
+		}
+
+		if (Stream->IsFinished)
+		{
+			if (Stream->File.IsOpen)
+			{
+				Memory->PlatformCloseFile(&Stream->File);
+			}
+			Stream->IsActive = false;
+		}
+		else if (!Stream->IsFailed && !Stream->IsEndOfFile && (GetRingOccupancy(&Stream->Chunks) < SOUND_STREAM_CHUNK_COUNT))
+		{
+			StartSoundStreamRefill(Stream, Memory);
+		}
+	}
+}
+
+//
+// Mixer side - applies the queued commands
+//
+
+//Handles are never reused, so a plain walk of the playing list is the whole lookup
+inline playing_voice*
+GetVoice(audio_state* Audio, uint32_t Handle)
+{
+	playing_voice* Result = 0;
+	for (playing_voice* Voice = Audio->FirstPlaying; Voice; Voice = Voice->Next)
+	{
+		if (Voice->Handle == Handle)
+		{
+			Result = Voice;
+			break;
+		}
+	}
+	return(Result);
+}
+
+inline oscillator*
+GetOscillator(audio_state* Audio, uint32_t Handle)
+{
+	oscillator* Result = 0;
+	for (uint32_t OscillatorIndex = 0; OscillatorIndex < Audio->OscillatorHighWater; OscillatorIndex++)
+	{
+		oscillator* Oscillator = &Audio->Oscillators[OscillatorIndex];
+		if (Oscillator->IsActive && (Oscillator->Handle == Handle))
+		{
+			Result = Oscillator;
+			break;
+		}
+	}
+	return(Result);
+}
+
+internal void
+ChangeVoiceVolume(playing_voice* Voice, float TargetVolume, float FadeSeconds)
+{
+	Voice->TargetVolume = TargetVolume;
+	if ((FadeSeconds > 0.0f) && (TargetVolume != Voice->Volume))
+	{
+		Voice->dVolumePerSecond = (TargetVolume - Voice->Volume) / FadeSeconds;
+	}
+	else
+	{
+		Voice->Volume = TargetVolume;
+		Voice->dVolumePerSecond = 0.0f;
+	}
+}
+
+internal void
+ChangeOscillatorVolume(oscillator* Oscillator, float Volume, float Pan)
+{
+	Oscillator->Volume = Volume;
+	Oscillator->Pan = GetPanGains(Pan, &Oscillator->LeftGain, &Oscillator->RightGain);
+	Oscillator->LeftGain *= Volume;
+	Oscillator->RightGain *= Volume;
+}
+
+//Gives the stream back to the game side - the mixer has to be done with the ring before it is reused
+inline void
+ReleaseSoundStream(sound_stream* Stream)
+{
+	CompletePreviousReadsBeforeFutureWrites;
+	CompletePreviousWritesBeforeFutureWrites;
+	Stream->IsFinished = true;
+}
+
+internal void
+StartVoice(audio_state* Audio, audio_command* Command)
+{
+	playing_voice* Voice = Audio->FirstFree;
+	if (Voice)
+	{
+		Audio->FirstFree = Voice->Next;
+
+		*Voice = {};
+		Voice->Sound = Command->Sound;
+		Voice->IsLooping = Command->IsLooping;
+		Voice->Pitch = 1.0f;
+		Voice->Handle = Command->Handle;
+		Voice->Next = Audio->FirstPlaying;
+		Audio->FirstPlaying = Voice;
+		++Audio->PlayingCount;
+
+		ChangeVoiceVolume(Voice, Command->Volume, 0.0f);
+		Voice->Pan = GetPanGains(Command->Pan, &Voice->LeftGain, &Voice->RightGain);
+		Voice->Stream = Command->Stream;
+	}
+	else if (Command->Stream)
+	{
+		ReleaseSoundStream(Command->Stream);
+	}
+}
+
+internal void
+StartOscillatorSlot(audio_state* Audio, audio_command* Command)
+{
+	uint32_t SlotIndex = 0;
+	while ((SlotIndex < Audio->OscillatorHighWater) && Audio->Oscillators[SlotIndex].IsActive)
+	{
+		++SlotIndex;
+	}
+	if (SlotIndex < Audio->MaxOscillatorCount)
+	{
+		if (SlotIndex == Audio->OscillatorHighWater)
+		{
+			++Audio->OscillatorHighWater;
+		}
+
+		oscillator* Oscillator = &Audio->Oscillators[SlotIndex];
+		*Oscillator = {};
+		Oscillator->IsActive = true;
+		Oscillator->Waveform = Command->Waveform;
+		Oscillator->Hz = Command->Hz;
+		Oscillator->Handle = Command->Handle;
+		ChangeOscillatorVolume(Oscillator, Command->Volume, Command->Pan);
+	}
+}
+
+//Commands for a voice or oscillator that has already finished (or never got a slot) do nothing
+internal void
+ExecuteAudioCommands(audio_state* Audio)
+{
+	audio_command* Command;
+	while ((Command = (audio_command*)BeginRingRead(&Audio->Commands)) != 0)
+	{
+		switch (Command->Type)
+		{
+			case AudioCommand_PlaySound:
+			{
+				StartVoice(Audio, Command);
+			}break;
+
+			case AudioCommand_SetVoiceVolume:
+			{
+				playing_voice* Voice = GetVoice(Audio, Command->Handle);
+				if (Voice)
+				{
+					ChangeVoiceVolume(Voice, Command->Volume, Command->FadeSeconds);
+				}
+			}break;
+
+			case AudioCommand_SetVoicePan:
+			{
+				playing_voice* Voice = GetVoice(Audio, Command->Handle);
+				if (Voice)
+				{
+					Voice->Pan = GetPanGains(Command->Pan, &Voice->LeftGain, &Voice->RightGain);
+				}
+			}break;
+
+			case AudioCommand_SetVoicePitch:
+			{
+				playing_voice* Voice = GetVoice(Audio, Command->Handle);
+				if (Voice)
+				{
+					Voice->Pitch = Command->Pitch;
+				}
+			}break;
+
+			case AudioCommand_StopVoice:
+			{
+				playing_voice* Voice = GetVoice(Audio, Command->Handle);
+				if (Voice)
+				{
+					ChangeVoiceVolume(Voice, 0.0f, Command->FadeSeconds);
+					Voice->StopWhenSilent = true;
+				}
+			}break;
+
+			case AudioCommand_StartOscillator:
+			{
+				StartOscillatorSlot(Audio, Command);
+			}break;
+
+			case AudioCommand_SetOscillatorFrequency:
+			{
+				oscillator* Oscillator = GetOscillator(Audio, Command->Handle);
+				if (Oscillator)
+				{
+					Oscillator->Hz = Command->Hz;
+				}
+			}break;
+
+			case AudioCommand_SetOscillatorVolume:
+			{
+				oscillator* Oscillator = GetOscillator(Audio, Command->Handle);
+				if (Oscillator)
+				{
+					ChangeOscillatorVolume(Oscillator, Command->Volume, Command->Pan);
+				}
+			}break;
+
+			case AudioCommand_StopOscillator:
+			{
+				oscillator* Oscillator = GetOscillator(Audio, Command->Handle);
+				if (Oscillator)
+				{
+					Oscillator->IsActive = false;
+				}
+			}break;
+		}
+		EndRingRead(&Audio->Commands);
+	}
+}
+
+//Hz rounded to the nearest step the phase accumulator can take, capped just under Nyquist
+inline uint32_t
+GetOscillatorPhaseStep(float Hz, int SamplesPerSecond)
+{
+	double Step = (double)Hz / (double)SamplesPerSecond*4294967296.0 + 0.5;
+	uint32_t Result = (Step <= 0.0) ? 0 : (Step >= 2147483647.0) ? 0x7FFFFFFF : (uint32_t)Step;
+	return(Result);
+}
+
+//
+// Mixing
+//
+
+//Zeroed, so voices can all just accumulate; both channels are 0 if the arena is out of room
+internal sound_bus
+BeginSoundBus(memory_arena* Arena, int SampleCount)
+{
+	sound_bus Result = {};
+	int PaddedCount = (SampleCount + AUDIO_BUS_LANES - 1) & ~(AUDIO_BUS_LANES - 1);
+	float* Memory = PushArray(Arena, 2*PaddedCount, float, 32);
+	if (Memory)
+	{
+		memset(Memory, 0, 2*PaddedCount*sizeof(float));
+		Result.SampleCount = SampleCount;
+		Result.Left = Memory;
+		Result.Right = Memory + PaddedCount;
+	}
+	return(Result);
+}
+
+//Source samples per output sample in 32.32, from the two rates and the pitch, clamped to what the filters cover
+inline uint64_t
+GetVoiceStep(playing_voice* Voice, int SamplesPerSecond)
+{
+	uint32_t SourceRate = Voice->Stream ? Voice->Stream->Info.SamplesPerSecond : Voice->Sound->SamplesPerSecond;
+	SourceRate = SourceRate ? SourceRate : (uint32_t)SamplesPerSecond;
+	double Step = (double)SourceRate / (double)SamplesPerSecond*(double)Voice->Pitch*(double)RESAMPLER_UNIT_STEP + 0.5;
+	uint64_t Result = (Step < 1.0) ? 1 :
+		(Step > RESAMPLER_MAX_STEP*(double)RESAMPLER_UNIT_STEP) ? (uint64_t)(RESAMPLER_MAX_STEP*(double)RESAMPLER_UNIT_STEP) : (uint64_t)Step;
+	return(Result);
+}
+
+//The narrowest filter whose cutoff is low enough for the step
+inline resampler_filter*
+GetResamplerFilter(audio_state* Audio, uint64_t Step)
+{
+	resampler_filter* Result = &Audio->Filters[RESAMPLER_FILTER_COUNT - 1];
+	for (int FilterIndex = 0; FilterIndex < RESAMPLER_FILTER_COUNT; FilterIndex++)
+	{
+		if ((double)Step <= Audio->Filters[FilterIndex].MaxStep*(double)RESAMPLER_UNIT_STEP)
+		{
+			Result = &Audio->Filters[FilterIndex];
+			break;
+		}
+	}
+	return(Result);
+}
+
+//How many more output samples a sound that does not loop has in it at this step
+inline uint32_t
+GetResampledSamplesRemaining(playing_voice* Voice, uint64_t Step)
+{
+	uint64_t Position = ((uint64_t)Voice->SamplesPlayed << 32) | Voice->PositionFraction;
+	uint64_t End = (uint64_t)Voice->Sound->SampleCount << 32;
+	uint64_t Result = (Position < End) ? (End - Position + Step - 1) / Step : 0;
+	return((Result > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t)Result);
+}
+
+/*
+	Resamples Count output samples from where the voice is into ResampleOutput. The source samples under the filter
+	are staged into ResampleSource first, so the kernel never has to check for either end of the sound: a looping
+	sound wraps around, one that does not is silent past its ends. A stream's window already holds them. The voice's
+	position is all the state it needs from one block to the next. Count is at most RESAMPLER_CHUNK.
+*/
+internal void
+ResampleVoice(audio_state* Audio, playing_voice* Voice, uint64_t Step, int Count)
+{
+	resampler_filter* Filter = GetResamplerFilter(Audio, Step);
+	if (Voice->Stream)
+	{
+		float* Source = Voice->Stream->Window + SOUND_STREAM_HISTORY - (Filter->TapCount / 2 - 1);
+		AudioKernels.ResampleSpan(Audio->ResampleOutput, Source, Count, Voice->PositionFraction, Step, Filter);
+		Audio->VoiceSamplesResampled += Count;
+		return;
+	}
+
+	loaded_sound* Sound = Voice->Sound;
+	int64_t First = (int64_t)Voice->SamplesPlayed - (Filter->TapCount / 2 - 1);
+	uint32_t StagedCount = (uint32_t)(((uint64_t)Voice->PositionFraction + (uint64_t)(Count - 1)*Step) >> 32) + Filter->TapCount;
+	for (uint32_t StagedIndex = 0; StagedIndex < StagedCount; StagedIndex++)
+	{
+		int64_t SourceIndex = First + StagedIndex;
+		if (Voice->IsLooping)
+		{
+			SourceIndex %= (int64_t)Sound->SampleCount;
+			SourceIndex += (SourceIndex < 0) ? (int64_t)Sound->SampleCount : 0;
+			Audio->ResampleSource[StagedIndex] = Sound->Samples[SourceIndex];
+		}
+		else
+		{
+			Audio->ResampleSource[StagedIndex] = ((SourceIndex >= 0) && (SourceIndex < (int64_t)Sound->SampleCount)) ?
+				Sound->Samples[SourceIndex] : 0.0f;
+		}
+	}
+
+	AudioKernels.ResampleSpan(Audio->ResampleOutput, Audio->ResampleSource, Count, Voice->PositionFraction, Step, Filter);
+	Audio->VoiceSamplesResampled += Count;
+}
+
+//Returns false once a sound that does not loop has run off its end
+internal bool32
+AdvanceResampledVoice(playing_voice* Voice, uint64_t Step, int Count)
+{
+	bool32 Result = true;
+	uint64_t Position = (((uint64_t)Voice->SamplesPlayed << 32) | Voice->PositionFraction) + (uint64_t)Count*Step;
+	uint64_t SampleCount = Voice->Sound->SampleCount;
+	if ((Position >> 32) >= SampleCount)
+	{
+		if (Voice->IsLooping)
+		{
+			Position = (((Position >> 32) % SampleCount) << 32) | (Position & 0xFFFFFFFF);
+		}
+		else
+		{
+			Position = SampleCount << 32;
+			Result = false;
+		}
+	}
+	Voice->SamplesPlayed = (uint32_t)(Position >> 32);
+	Voice->PositionFraction = (uint32_t)Position;
+	return(Result);
+}
+
+//Tops the window up to Count samples out of the chunks the worker has decoded. Past the end of the sound it is
+//silence, and so is anything the worker has not got to yet - which is an underrun
+internal void
+FillSoundStreamWindow(audio_state* Audio, sound_stream* Stream, uint32_t Count)
+{
+	Assert(Count <= SOUND_STREAM_WINDOW);
+	uint32_t StarvedCount = 0;
+	while (Stream->WindowCount < Count)
+	{
+		sound_stream_chunk* Chunk = Stream->IsEnding ? 0 : (sound_stream_chunk*)BeginRingRead(&Stream->Chunks);
+		if (!Chunk)
+		{
+			uint32_t SilenceCount = Count - Stream->WindowCount;
+			memset(Stream->Window + Stream->WindowCount, 0, SilenceCount*sizeof(float));
+			Stream->WindowCount = Count;
+			StarvedCount = Stream->IsEnding ? 0 : SilenceCount;
+			break;
+		}
+
+		uint32_t CopyCount = Chunk->SampleCount - Stream->ChunkReadOffset;
+		CopyCount = (CopyCount < Count - Stream->WindowCount) ? CopyCount : Count - Stream->WindowCount;
+		memcpy(Stream->Window + Stream->WindowCount, Chunk->Samples + Stream->ChunkReadOffset, CopyCount*sizeof(float));
+		Stream->WindowCount += CopyCount;
+		Stream->ChunkReadOffset += CopyCount;
+		if (Stream->ChunkReadOffset == Chunk->SampleCount)
+		{
+			if (Chunk->IsLast)
+			{
+				Stream->IsEnding = true;
+				Stream->EndIndex = (int32_t)Stream->WindowCount;
+			}
+			Stream->ChunkReadOffset = 0;
+			EndRingRead(&Stream->Chunks);
+		}
+	}
+
+	if (StarvedCount)
+	{
+		Audio->StreamUnderrunCount += Stream->IsStarved ? 0 : 1;
+		Audio->StreamUnderrunSamples += StarvedCount;
+	}
+	Stream->IsStarved = (StarvedCount > 0);
+}
+
+//The window has to reach from the history the taps look back into, to the last tap of the last output sample
+inline uint32_t
+GetSoundStreamWindowCount(playing_voice* Voice, uint64_t Step, int Count)
+{
+	uint32_t Result = SOUND_STREAM_HISTORY + (uint32_t)(((uint64_t)Voice->PositionFraction + (uint64_t)(Count - 1)*Step) >> 32) +
+		RESAMPLER_MAX_TAPS / 2 + 1;
+	return(Result);
+}
+
+//Slides the window along so it starts SOUND_STREAM_HISTORY behind the new position. Returns false once it is past
+//the end of a sound that doesn't loop
+internal bool32
+AdvanceSoundStreamVoice(playing_voice* Voice, uint64_t Step, int Count)
+{
+	sound_stream* Stream = Voice->Stream;
+	uint64_t Position = (uint64_t)Voice->PositionFraction + (uint64_t)Count*Step;
+	uint32_t WholeCount = (uint32_t)(Position >> 32);
+	Assert(WholeCount <= Stream->WindowCount - SOUND_STREAM_HISTORY);
+	memmove(Stream->Window, Stream->Window + WholeCount, (Stream->WindowCount - WholeCount)*sizeof(float));
+	Stream->WindowCount -= WholeCount;
+	Voice->PositionFraction = (uint32_t)Position;
+
+	bool32 Result = true;
+	if (Stream->IsEnding)
+	{
+		Stream->EndIndex -= (int32_t)WholeCount;
+		Result = (Stream->EndIndex > SOUND_STREAM_HISTORY);
+	}
+	return(Result);
+}
+
+//Returns false once the voice has nothing left to play. A voice moving through its sound one sample per output sample
+//is mixed straight from it; anything else goes through the resampler, a chunk at a time. A stream is always taken a
+//chunk at a time through its window, whichever way it is mixed
+internal bool32
+MixVoice(audio_state* Audio, playing_voice* Voice, sound_bus* Bus, int SamplesPerSecond, float SecondsPerSample)
+{
+	loaded_sound* Sound = Voice->Sound;
+	sound_stream* Stream = Voice->Stream;
+	if (Stream && !Stream->HasStarted)
+	{
+		//Silent, and going nowhere, until the first chunk is in - and stopping it before then ends it there
+		if (!GetRingOccupancy(&Stream->Chunks))
+		{
+			return(!Stream->IsFailed && !Voice->StopWhenSilent);
+		}
+		CompletePreviousReadsBeforeFutureReads;
+		Stream->HasStarted = true;
+	}
+
+	bool32 IsPlaying = Stream ? true : (Sound->SampleCount > 0);
+	float dVolume = Voice->dVolumePerSecond*SecondsPerSample;
+	uint64_t Step = GetVoiceStep(Voice, SamplesPerSecond);
+	bool32 IsDirect = ((Step == RESAMPLER_UNIT_STEP) && (Voice->PositionFraction == 0));
+
+	int OutputIndex = 0;
+	while (IsPlaying && (OutputIndex < Bus->SampleCount))
+	{
+		int Count = Bus->SampleCount - OutputIndex;
+		if (Stream)
+		{
+			Count = (Count < RESAMPLER_CHUNK) ? Count : RESAMPLER_CHUNK;
+		}
+		else if (IsDirect)
+		{
+			uint32_t SourceRemaining = Sound->SampleCount - Voice->SamplesPlayed;
+			if ((uint32_t)Count > SourceRemaining)
+			{
+				Count = (int)SourceRemaining;
+			}
+		}
+		else
+		{
+			Count = (Count < RESAMPLER_CHUNK) ? Count : RESAMPLER_CHUNK;
+			uint32_t OutputRemaining = Voice->IsLooping ? 0xFFFFFFFF : GetResampledSamplesRemaining(Voice, Step);
+			if ((uint32_t)Count > OutputRemaining)
+			{
+				Count = (int)OutputRemaining;
+			}
+		}
+
+		//A fade gets a span of its own, so the kernel never has to clamp mid-ramp
+		bool32 IsFading = (dVolume != 0.0f);
+		bool32 FadeEnds = false;
+		if (IsFading)
+		{
+			float FadeSamples = ceilf((Voice->TargetVolume - Voice->Volume) / dVolume);
+			if (FadeSamples <= (float)Count)
+			{
+				Count = (FadeSamples < 1.0f) ? 1 : (int)FadeSamples;
+				FadeEnds = true;
+			}
+		}
+
+		//A stream is read through even when it can't be heard, so it keeps time
+		if (Stream)
+		{
+			FillSoundStreamWindow(Audio, Stream, GetSoundStreamWindowCount(Voice, Step, Count));
+		}
+
+		if (IsFading || (Voice->Volume != 0.0f))
+		{
+			float* Source = Stream ? Stream->Window + SOUND_STREAM_HISTORY : Sound->Samples + Voice->SamplesPlayed;
+			if (!IsDirect)
+			{
+				ResampleVoice(Audio, Voice, Step, Count);
+				Source = Audio->ResampleOutput;
+			}
+			float dSpanVolume = IsFading ? dVolume : 0.0f;
+			AudioKernels.MixVoiceSpan(Bus->Left + OutputIndex, Bus->Right + OutputIndex, Source, Count,
+				Voice->Volume*Voice->LeftGain, Voice->Volume*Voice->RightGain,
+				dSpanVolume*Voice->LeftGain, dSpanVolume*Voice->RightGain);
+			Audio->VoiceSamplesMixed += Count;
+		}
+
+		if (FadeEnds)
+		{
+			Voice->Volume = Voice->TargetVolume;
+			Voice->dVolumePerSecond = 0.0f;
+			dVolume = 0.0f;
+			if (Voice->StopWhenSilent && (Voice->Volume == 0.0f))
+			{
+				IsPlaying = false;
+			}
+		}
+		else if (IsFading)
+		{
+			Voice->Volume += dVolume*(float)Count;
+		}
+
+		OutputIndex += Count;
+		if (Stream)
+		{
+			if (!AdvanceSoundStreamVoice(Voice, Step, Count))
+			{
+				IsPlaying = false;
+			}
+		}
+		else if (!IsDirect)
+		{
+			if (!AdvanceResampledVoice(Voice, Step, Count))
+			{
+				IsPlaying = false;
+			}
+		}
+		else
+		{
+			Voice->SamplesPlayed += Count;
+			if (Voice->SamplesPlayed == Sound->SampleCount)
+			{
+				if (Voice->IsLooping)
+				{
+					Voice->SamplesPlayed = 0;
+				}
+				else
+				{
+					IsPlaying = false;
+				}
+			}
+		}
+	}
+
+	//A voice stopped at no volume has nothing to fade out
+	if (Voice->StopWhenSilent && (Voice->Volume == 0.0f) && (Voice->dVolumePerSecond == 0.0f))
+	{
+		IsPlaying = false;
+	}
+	return(IsPlaying);
+}
+
+//Everything the game queued since the last block lands first; finished voices go back on the free list as they are found
+internal void
+MixPlayingSounds(audio_state* Audio, sound_bus* Bus, int SamplesPerSecond)
+{
+	TIMED_FUNCTION();
+	ExecuteAudioCommands(Audio);
+
+	for (uint32_t OscillatorIndex = 0; OscillatorIndex < Audio->OscillatorHighWater; OscillatorIndex++)
+	{
+		oscillator* Oscillator = &Audio->Oscillators[OscillatorIndex];
+		if (Oscillator->IsActive)
+		{
+			uint32_t dPhase = GetOscillatorPhaseStep(Oscillator->Hz, SamplesPerSecond);
+			AudioKernels.OscillatorSpan(Bus->Left, Bus->Right, Bus->SampleCount, Oscillator->Phase, dPhase,
+				Oscillator->LeftGain, Oscillator->RightGain, Oscillator->Waveform);
+			Oscillator->Phase += (uint32_t)Bus->SampleCount*dPhase;
+		}
+	}
+
+	float SecondsPerSample = 1.0f / (float)SamplesPerSecond;
+	for (playing_voice** VoicePtr = &Audio->FirstPlaying; *VoicePtr;)
+	{
+		playing_voice* Voice = *VoicePtr;
+		if (MixVoice(Audio, Voice, Bus, SamplesPerSecond, SecondsPerSample))
+		{
+			VoicePtr = &Voice->Next;
+		}
+		else
+		{
+			*VoicePtr = Voice->Next;
+			if (Voice->Stream)
+			{
+				ReleaseSoundStream(Voice->Stream);
+				Voice->Stream = 0;
+			}
+			Voice->Sound = 0;
+			Voice->Next = Audio->FirstFree;
+			Audio->FirstFree = Voice;
+			--Audio->PlayingCount;
+		}
+	}
+}
+
+internal void
+OutputSoundBus(sound_bus* Bus, game_sound_buffer* SoundBuffer)
+{
+	Assert(Bus->SampleCount == SoundBuffer->SampleCount);
+	AudioKernels.ConvertBus(SoundBuffer->Samples, Bus->Left, Bus->Right, Bus->SampleCount);
+}
@@ -0,0 +1,308 @@
+#if !defined(BABL_AUDIO_H)
+#define BABL_AUDIO_H
+
+//Mono float samples in [-1, 1], at SamplesPerSecond - 0 for sounds made at whatever rate the platform asks for.
+//A sound at any other rate goes through the resampler, as does any voice pitched away from 1
+struct loaded_sound
+{
+	uint32_t SampleCount;
+	uint32_t SamplesPerSecond;
+	float* Samples;
+};
+
+/*
+	Polyphase resampling. A voice's position in its sound is 32.32 fixed point, and every output sample is a windowed
+	sinc over the TapCount source samples around it. The kernel is tabulated at RESAMPLER_PHASES fractions of a
+	sample, and linearly interpolated between the two nearest, so the position is never rounded to a phase.
+	Stepping through the source faster than one sample per output sample would alias, so each filter covers steps up
+	to MaxStep with its cutoff lowered to match and its taps spread over that many more source samples. Steps past
+	RESAMPLER_MAX_STEP (two octaves up at the output rate) are clamped to it.
+*/
+#define RESAMPLER_PHASE_BITS 6
+#define RESAMPLER_PHASES (1 << RESAMPLER_PHASE_BITS)
+#define RESAMPLER_BASE_TAPS 32
+#define RESAMPLER_FILTER_COUNT 5
+#define RESAMPLER_MAX_STEP 4.0f
+#define RESAMPLER_MAX_TAPS (RESAMPLER_BASE_TAPS*4)
+#define RESAMPLER_UNIT_STEP (1ULL << 32)
+
+//Output samples a voice is resampled in at a time
+#define RESAMPLER_CHUNK 512
+
+struct resampler_filter
+{
+	float MaxStep;
+	int TapCount;
+
+	//RESAMPLER_PHASES rows of TapCount each. Row p is the kernel for a position p/RESAMPLER_PHASES of the way past a
+	//sample, and the same row of Deltas is how far it is from there to row p + 1
+	float* Coefficients;
+	float* Deltas;
+};
+
+//Mix kernels - every voice goes through MixVoiceSpan, and the finished bus through ConvertBus
+//Volumes ramp linearly, sample i gets Volume + dVolume*i; the scalar versions are the reference and the wide ones match them bit for bit
+#define MIX_VOICE_SPAN(name) void name(float* Left, float* Right, float* Source, int Count, float LeftVolume, float RightVolume, float dLeftVolume, float dRightVolume)
+typedef MIX_VOICE_SPAN(mix_voice_span);
+
+//Clamps to [-1, 1], scales to int16 and interleaves the two channels into Dest
+#define CONVERT_BUS(name) void name(int16_t* Dest, float* Left, float* Right, int Count)
+typedef CONVERT_BUS(convert_bus);
+
+//Dest[i] is Source filtered at Position + i*Step, both 32.32; the taps for it start at Source[Position >> 32].
+//Same rounding everywhere: each lane of eight sums every eighth tap, and the lanes are added up in one fixed order
+#define RESAMPLE_SPAN(name) void name(float* Dest, float* Source, int Count, uint64_t Position, uint64_t Step, resampler_filter* Filter)
+typedef RESAMPLE_SPAN(resample_span);
+
+enum oscillator_waveform
+{
+	Waveform_Sine,
+	Waveform_Square,
+	Waveform_Saw,
+	Waveform_Triangle,
+};
+
+//Adds Count samples of one oscillator into the bus. Phase is a whole cycle per 2^32 and advances dPhase per sample;
+//dPhase has to stay below 2^31 (Nyquist). Square and saw are band-limited with polyBLEP, triangle with polyBLAMP
+#define OSCILLATOR_SPAN(name) void name(float* Left, float* Right, int Count, uint32_t Phase, uint32_t dPhase, float LeftGain, float RightGain, oscillator_waveform Waveform)
+typedef OSCILLATOR_SPAN(oscillator_span);
+
+struct audio_kernels
+{
+	char* Name;
+	mix_voice_span* MixVoiceSpan;
+	resample_span* ResampleSpan;
+	oscillator_span* OscillatorSpan;
+	convert_bus* ConvertBus;
+};
+
+/*
+	Sounds played straight off disk. Each stream has a ring of decoded chunks between a refill on the platform's
+	low-priority queue (the producer) and the mixer (the consumer). The game side tops the ring up whenever a chunk
+	of it is free, so the file is read well ahead of the voice and no thread but the worker ever waits on it - the
+	file is even opened there. The mixer copies out of the ring into a window around the voice's position, which
+	keeps enough history for the resampler's taps and is all it needs from one block to the next.
+
+	Ownership: the game side owns IsActive and the refill bookkeeping, and hands the worker the rest of the top
+	block while IsRefilling is set. The mixer owns everything under the ring, and gives the stream back by setting
+	IsFinished once its voice is done with it. If the worker falls behind, the voice plays silence and carries on
+	where it left off once the chunks catch up.
+*/
+#define SOUND_STREAM_CHUNK_SAMPLES 4096
+#define SOUND_STREAM_CHUNK_COUNT 4
+#define SOUND_STREAM_HISTORY (RESAMPLER_MAX_TAPS / 2)
+#define SOUND_STREAM_WINDOW (SOUND_STREAM_HISTORY + (uint32_t)(RESAMPLER_CHUNK*RESAMPLER_MAX_STEP) + RESAMPLER_MAX_TAPS + 8)
+#define SOUND_STREAM_MAX_BYTES_PER_FRAME 8
+
+//Mono float, however many channels the file has. IsLast is only set on the chunk that ends a sound that doesn't loop
+struct sound_stream_chunk
+{
+	uint32_t SampleCount;
+	bool32 IsLast;
+	float Samples[SOUND_STREAM_CHUNK_SAMPLES];
+};
+
+struct sound_stream
+{
+	//Game side
+	bool32 IsActive;
+	uint32_t volatile IsRefilling;
+	uint64_t RefillRequestTicks;
+	platform_open_file* OpenFile;
+	platform_read_data_from_file* ReadDataFromFile;
+	char Filename[256];
+	bool32 IsLooping;
+
+	//Refill worker. Info is written before the first chunk is published, so the mixer can read it from then on;
+	//the rest is for the game side once IsRefilling is clear
+	platform_file_handle File;
+	wav_info Info;
+	uint64_t NextFrame;
+	uint8_t* ReadBuffer;
+	uint32_t volatile IsFailed;
+	uint32_t volatile IsEndOfFile;
+	uint64_t RefillDoneTicks;
+	uint32_t RefillChunkCount;
+	uint64_t RefillBytesRead;
+
+	spsc_ring Chunks;
+
+	//Mixer. Window[SOUND_STREAM_HISTORY] is the voice's position, less its fraction, and the sound ends at EndIndex
+	//once the last chunk is in
+	float* Window;
+	uint32_t WindowCount;
+	uint32_t ChunkReadOffset;
+	bool32 HasStarted;
+	bool32 IsEnding;
+	int32_t EndIndex;
+	bool32 IsStarved;
+	uint32_t volatile IsFinished;
+};
+
+//Everything one stream holds on to, whether or not it is playing
+inline uint64_t
+GetSoundStreamMemorySize()
+{
+	uint64_t Result = sizeof(sound_stream) + SOUND_STREAM_CHUNK_COUNT*sizeof(sound_stream_chunk) +
+		SOUND_STREAM_CHUNK_SAMPLES*SOUND_STREAM_MAX_BYTES_PER_FRAME + SOUND_STREAM_WINDOW*sizeof(float);
+	return(Result);
+}
+
+//Refills as the game side sees them finish; latency is from queueing a refill to the worker finishing it
+struct sound_stream_stats
+{
+	uint64_t Refills;
+	uint64_t ChunksDecoded;
+	uint64_t BytesRead;
+	uint64_t LatencyTicksTotal;
+	uint64_t LatencyTicksMax;
+	uint32_t FailedCount;
+};
+
+//Handed out by the game side when the command is queued, before the mixer has even seen it, so it is just a number
+//that is never reused (0 is never a voice) - it goes stale once the voice finishes, or if the pool was full when it started
+struct voice_id
+{
+	uint32_t Value;
+};
+
+//Plays either Sound or Stream
+struct playing_voice
+{
+	loaded_sound* Sound;
+	sound_stream* Stream;
+	bool32 IsLooping;
+
+	//Where it is in the sound, SamplesPlayed.PositionFraction in 32.32 (a stream keeps the whole samples in its window).
+	//Pitch scales the rate it moves through the sound
+	uint32_t SamplesPlayed;
+	uint32_t PositionFraction;
+	float Pitch;
+
+	//Volume walks toward TargetVolume at dVolumePerSecond (signed, 0 when not fading)
+	float Volume;
+	float TargetVolume;
+	float dVolumePerSecond;
+	bool32 StopWhenSilent;
+
+	//-1 is hard left, 1 hard right; the gains are the equal-power split of it
+	float Pan;
+	float LeftGain;
+	float RightGain;
+
+	uint32_t Handle;
+	playing_voice* Next;
+};
+
+//Same as voice_id, out of the same numbers
+struct oscillator_id
+{
+	uint32_t Value;
+};
+
+//The phase is an integer, so it wraps exactly and never loses precision however long the oscillator runs -
+//the only frequency error is the rounding of Hz to a 2^32nd of the sample rate (under 0.00002Hz at 48kHz)
+struct oscillator
+{
+	bool32 IsActive;
+	oscillator_waveform Waveform;
+	uint32_t Phase;
+	float Hz;
+
+	//The gains are the equal-power split of Pan with Volume folded in
+	float Volume;
+	float Pan;
+	float LeftGain;
+	float RightGain;
+
+	uint32_t Handle;
+};
+
+enum audio_command_type
+{
+	AudioCommand_PlaySound,
+	AudioCommand_SetVoiceVolume,
+	AudioCommand_SetVoicePan,
+	AudioCommand_SetVoicePitch,
+	AudioCommand_StopVoice,
+	AudioCommand_StartOscillator,
+	AudioCommand_SetOscillatorFrequency,
+	AudioCommand_SetOscillatorVolume,
+	AudioCommand_StopOscillator,
+};
+
+//Each command only reads the fields its call took
+struct audio_command
+{
+	audio_command_type Type;
+	uint32_t Handle;
+
+	loaded_sound* Sound;
+	sound_stream* Stream;
+	bool32 IsLooping;
+	oscillator_waveform Waveform;
+
+	float Volume;
+	float Pan;
+	float Pitch;
+	float Hz;
+	float FadeSeconds;
+};
+
+/*
+	A fixed pool of voices - playing a sound never allocates, and when the pool is empty the sound just doesn't start.
+	Each output block is mixed into a planar float bus (sound_bus) pushed from the mixer's own arena, and the bus is
+	converted to the interleaved int16 game_sound_buffer in one pass at the end, so the output is walked once however
+	many voices there are.
+
+	The game and the mixer can be on different threads. The game never touches the voices: PlaySound and the rest
+	only queue an audio_command on Commands, which never blocks (a full ring drops the command and counts it), and
+	the mixer applies everything queued at the start of its next block. Everything below Commands is the mixer's.
+*/
+struct audio_state
+{
+	//Game side: the ring's producer, and the only one to hand out handles
+	spsc_ring Commands;
+	uint32_t NextHandle;
+	uint32_t DroppedCommandCount;
+
+	//Also game side, apart from what each stream hands over to the worker and the mixer
+	uint32_t MaxStreamCount;
+	sound_stream* Streams;
+	sound_stream_stats StreamStats;
+
+	uint32_t MaxVoiceCount;
+	playing_voice* Voices;
+
+	playing_voice* FirstPlaying;
+	playing_voice* FirstFree;
+	uint32_t PlayingCount;
+
+	//Oscillators run until they are stopped; slots past OscillatorHighWater have never been used
+	uint32_t MaxOscillatorCount;
+	uint32_t OscillatorHighWater;
+	oscillator* Oscillators;
+
+	//Shared by every voice that needs resampling: the source around the chunk, and the chunk resampled
+	resampler_filter Filters[RESAMPLER_FILTER_COUNT];
+	float* ResampleSource;
+	float* ResampleOutput;
+
+	//Voice-samples that went through MixVoiceSpan, for the bench and the debug readouts
+	uint64_t VoiceSamplesMixed;
+	uint64_t VoiceSamplesResampled;
+
+	//Streams that ran dry: how often, and the silence played while they did
+	uint32_t StreamUnderrunCount;
+	uint64_t StreamUnderrunSamples;
+};
+
+//Both channels padded to a whole number of AVX lanes, 32-byte aligned
+struct sound_bus
+{
+	int SampleCount;
+	float* Left;
+	float* Right;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#if !defined(BABL_AUDIO_STREAM_H)
+#define BABL_AUDIO_STREAM_H
+
+/*
+	The platform's half of audio, on two threads of its own. The mixer thread keeps a ring of mixed blocks topped
+	up to TargetBlocks, asking the game for one block at a time; the device thread copies out of the ring at
+	whatever pace the sound device takes samples. The main thread is in neither, so a long frame only matters if
+	it holds the mixer off for longer than the ring lasts.
+	When the ring runs dry the device gets silence for the rest of what it asked for, and that is an underrun.
+	TargetBlocks is the latency: more blocks ride out longer stalls of the mixer, but the game is heard later.
+	Needs babl_intrinsics.h and babl_spsc_ring.h.
+*/
+#define AUDIO_STREAM_BLOCK_SAMPLES 256
+
+//Interleaved 16-bit stereo, the same as game_sound_buffer
+struct audio_stream_block
+{
+	int16_t Samples[2*AUDIO_STREAM_BLOCK_SAMPLES];
+};
+
+struct audio_stream
+{
+	spsc_ring Blocks;
+	uint32_t TargetBlocks;
+	int SamplesPerSecond;
+
+	//Mixer side
+	uint64_t BlocksMixed;
+
+	//Device side: how far into the oldest block it has got, and what it has seen
+	uint32_t ReadOffset;
+	uint64_t SamplesPlayed;
+	uint32_t UnderrunCount;
+	uint64_t UnderrunSamples;
+
+	//Samples queued ahead of the device, taken every time it asks for more
+	uint32_t MinOccupancy;
+	uint32_t MaxOccupancy;
+	uint64_t OccupancyTotal;
+	uint64_t OccupancyReadings;
+};
+
+//BlockMemory holds BlockCount blocks, a power of two; TargetBlocks has to leave at least one free
+inline void
+InitializeAudioStream(audio_stream* Stream, audio_stream_block* BlockMemory, uint32_t BlockCount, uint32_t TargetBlocks,
+	int SamplesPerSecond)
+{
+	Assert((TargetBlocks > 0) && (TargetBlocks < BlockCount));
+	*Stream = {};
+	InitializeSPSCRing(&Stream->Blocks, BlockMemory, sizeof(audio_stream_block), BlockCount);
+	Stream->TargetBlocks = TargetBlocks;
+	Stream->SamplesPerSecond = SamplesPerSecond;
+	Stream->MinOccupancy = 0xFFFFFFFF;
+}
+
+//
+// Mixer thread
+//
+
+//Returns how many blocks were mixed. The caller makes sure the game code stays loaded for the duration
+internal uint32_t
+MixAudioStream(audio_stream* Stream, game_get_sound_samples* GetSoundSamples, game_memory* Memory)
+{
+	uint32_t Result = 0;
+	while (GetRingOccupancy(&Stream->Blocks) < Stream->TargetBlocks)
+	{
+		audio_stream_block* Block = (audio_stream_block*)BeginRingWrite(&Stream->Blocks);
+		if (!Block)
+		{
+			break;
+		}
+
+		game_sound_buffer SoundBuffer = {};
+		SoundBuffer.SamplesPerSecond = Stream->SamplesPerSecond;
+		SoundBuffer.SampleCount = AUDIO_STREAM_BLOCK_SAMPLES;
+		SoundBuffer.Samples = Block->Samples;
+		if (GetSoundSamples)
+		{
+			GetSoundSamples(Memory, &SoundBuffer);
+		}
+		else
+		{
+			memset(Block->Samples, 0, sizeof(Block->Samples));
+		}
+
+		EndRingWrite(&Stream->Blocks);
+		++Stream->BlocksMixed;
+		++Result;
+	}
+	return(Result);
+}
+
+//
+// Device thread
+//
+
+//Samples ready for the device right now
+inline uint32_t
+GetAudioStreamQueuedSamples(audio_stream* Stream)
+{
+	uint32_t Blocks = GetRingOccupancy(&Stream->Blocks);
+	uint32_t Result = Blocks ? Blocks*AUDIO_STREAM_BLOCK_SAMPLES - Stream->ReadOffset : 0;
+	return(Result);
+}
+
+//Always fills all of Dest, with silence past whatever the mixer had ready. Nothing counts as an underrun until
+//the first mixed sample has been played - the mixer has to get going first
+internal void
+PlayAudioStream(audio_stream* Stream, int16_t* Dest, int SampleCount)
+{
+	uint32_t Occupancy = GetAudioStreamQueuedSamples(Stream);
+	Stream->MinOccupancy = (Occupancy < Stream->MinOccupancy) ? Occupancy : Stream->MinOccupancy;
+	Stream->MaxOccupancy = (Occupancy > Stream->MaxOccupancy) ? Occupancy : Stream->MaxOccupancy;
+	Stream->OccupancyTotal += Occupancy;
+	++Stream->OccupancyReadings;
+
+	int SamplesCopied = 0;
+	while (SamplesCopied < SampleCount)
+	{
+		audio_stream_block* Block = (audio_stream_block*)BeginRingRead(&Stream->Blocks);
+		if (!Block)
+		{
+			break;
+		}
+
+		int Count = AUDIO_STREAM_BLOCK_SAMPLES - (int)Stream->ReadOffset;
+		Count = (Count < SampleCount - SamplesCopied) ? Count : SampleCount - SamplesCopied;
+		memcpy(Dest + 2*SamplesCopied, Block->Samples + 2*Stream->ReadOffset, Count*2*sizeof(int16_t));
+		SamplesCopied += Count;
+
+		Stream->ReadOffset += Count;
+		if (Stream->ReadOffset == AUDIO_STREAM_BLOCK_SAMPLES)
+		{
+			Stream->ReadOffset = 0;
+			EndRingRead(&Stream->Blocks);
+		}
+	}
+
+	if (SamplesCopied < SampleCount)
+	{
+		memset(Dest + 2*SamplesCopied, 0, (SampleCount - SamplesCopied)*2*sizeof(int16_t));
+		if (Stream->SamplesPlayed > 0)
+		{
+			++Stream->UnderrunCount;
+			Stream->UnderrunSamples += SampleCount - SamplesCopied;
+		}
+	}
+	Stream->SamplesPlayed += SamplesCopied;
+}
+
+#endif
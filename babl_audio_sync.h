@@ -0,0 +1,269 @@
+#if !defined(BABL_AUDIO_SYNC_H)
+#define BABL_AUDIO_SYNC_H
+
+/*
+	Decides how much to write into a looping sound buffer, DirectSound style. The device reports a play cursor and a
+	write cursor: it has already taken everything up to the write cursor, so that is the first byte still worth
+	writing, and whatever sits past it when it gets there is what plays. Write too little and the device plays stale
+	data; write too much and everything the game does is heard that much later.
+
+	Every update notes the cursors and the time. From the last AUDIO_SYNC_HISTORY updates it estimates the device's
+	write lead, how far off the reported cursor can be from where the device really is (the granule it moves in, plus
+	however late the reports run), and how long the caller goes between updates. It then keeps the buffer written
+	just far enough past the write cursor to cover both until the next update.
+	Both are planned at their worst: the cursor error at the widest it has been, the gap at the longest, held for
+	AUDIO_SYNC_PEAK_HOLD_SECONDS after they last came close and then eased back, so a stall that keeps coming is
+	planned for every time. On top of that is a margin that grows whenever the write cursor overtakes the written end
+	anyway, or the cursor turns out further off than estimated, and eases back over AUDIO_SYNC_MARGIN_SECONDS.
+
+	Positions are bytes. The cursors wrap at BufferSize; everything kept here is unwrapped. Times are nanoseconds
+	on any clock that only goes forward.
+*/
+#define AUDIO_SYNC_HISTORY 256
+#define AUDIO_SYNC_PEAK_HOLD_SECONDS 5.0f
+#define AUDIO_SYNC_PEAK_SECONDS 2.0f
+#define AUDIO_SYNC_MARGIN_SECONDS 10.0f
+#define AUDIO_SYNC_MAX_MARGIN 2.0f
+
+struct audio_sync_observation
+{
+	uint64_t Time;
+	uint64_t PlayPosition;
+	uint32_t WriteLead;
+
+	//Since the previous observation: how far the play cursor moved, and how much playback time went by
+	uint32_t PlayStep;
+	float GapBytes;
+};
+
+//Write BytesToWrite at ByteToLock (either may wrap past the end of the buffer), all of it
+struct audio_sync_write
+{
+	uint32_t ByteToLock;
+	uint32_t BytesToWrite;
+};
+
+struct audio_sync
+{
+	uint32_t BufferSize;
+	uint32_t BytesPerSample;
+	uint32_t BytesPerSecond;
+
+	bool32 IsValid;
+	bool32 IsWriting;
+	uint32_t LastPlayCursor;
+	uint64_t PlayPosition;
+	uint64_t WrittenPosition;
+
+	//Indexed by ObservationCount, which only ever goes up
+	audio_sync_observation History[AUDIO_SYNC_HISTORY];
+	uint32_t ObservationCount;
+
+	//The estimates as of the last update, in bytes. GapJitter is the standard deviation of the gaps in the history;
+	//CursorError and PeakGap are the held worst cases, with the times they were last refreshed
+	uint32_t WriteLead;
+	uint32_t Granule;
+	uint32_t WindowCursorError;
+	uint32_t CursorError;
+	uint64_t CursorErrorTime;
+	float MeanGap;
+	float GapJitter;
+	float PeakGap;
+	uint64_t PeakTime;
+	float Margin;
+	uint32_t SafetyBytes;
+
+	//Times the write cursor was found past the written end - the device played whatever was left in the buffer
+	uint32_t UnderrunCount;
+
+	//Written end minus play cursor after each update, which is how late anything mixed now is heard
+	uint64_t LatencyTotal;
+	uint64_t LatencyReadings;
+	uint32_t MaxLatency;
+};
+
+inline void
+InitializeAudioSync(audio_sync* Sync, uint32_t BufferSize, uint32_t BytesPerSample, uint32_t SamplesPerSecond)
+{
+	*Sync = {};
+	Sync->BufferSize = BufferSize;
+	Sync->BytesPerSample = BytesPerSample;
+	Sync->BytesPerSecond = BytesPerSample*SamplesPerSecond;
+	Sync->Margin = 1.0f;
+}
+
+//Forget the cursors, as when the device was lost - the next update starts over from its write cursor
+inline void
+ResetAudioSync(audio_sync* Sync)
+{
+	Sync->IsValid = false;
+}
+
+inline void
+GrowAudioSyncMargin(audio_sync* Sync)
+{
+	Sync->Margin = (Sync->Margin*1.25f < AUDIO_SYNC_MAX_MARGIN) ? Sync->Margin*1.25f : AUDIO_SYNC_MAX_MARGIN;
+}
+
+internal void
+UpdateAudioSyncEstimates(audio_sync* Sync)
+{
+	uint32_t Count = (Sync->ObservationCount < AUDIO_SYNC_HISTORY) ? Sync->ObservationCount : AUDIO_SYNC_HISTORY;
+	uint32_t WriteLead = 0;
+	uint32_t Granule = 0xFFFFFFFF;
+	uint32_t MaxStep = 0;
+	int64_t MinError = 0;
+	int64_t MaxError = 0;
+	uint32_t GapCount = 0;
+	float GapTotal = 0.0f;
+	float GapSquaredTotal = 0.0f;
+	audio_sync_observation* Oldest = &Sync->History[(Sync->ObservationCount - Count) % AUDIO_SYNC_HISTORY];
+	for (uint32_t Index = 0; Index < Count; Index++)
+	{
+		audio_sync_observation* Observation = &Sync->History[Index];
+		WriteLead = (Observation->WriteLead > WriteLead) ? Observation->WriteLead : WriteLead;
+
+		//The smallest step the play cursor is ever seen to take - a cursor that moves continuously steps by whatever
+		//a gap was, one that moves in chunks only ever steps by whole chunks
+		if ((Observation->PlayStep > 0) && (Observation->PlayStep < Granule))
+		{
+			Granule = Observation->PlayStep;
+		}
+		MaxStep = (Observation->PlayStep > MaxStep) ? Observation->PlayStep : MaxStep;
+
+		//Where the cursor was reported against where a device playing at exactly BytesPerSecond would be. The
+		//spread covers the granule and however late the reports run, which the steps alone can't show
+		int64_t Expected = (int64_t)((double)(Observation->Time - Oldest->Time)*Sync->BytesPerSecond / 1e9);
+		int64_t Error = Expected - (int64_t)(Observation->PlayPosition - Oldest->PlayPosition);
+		MinError = (Error < MinError) ? Error : MinError;
+		MaxError = (Error > MaxError) ? Error : MaxError;
+
+		//The first observation after a reset has no gap before it
+		if (Observation->GapBytes > 0.0f)
+		{
+			GapTotal += Observation->GapBytes;
+			GapSquaredTotal += Observation->GapBytes*Observation->GapBytes;
+			++GapCount;
+		}
+	}
+
+	Sync->WriteLead = WriteLead;
+	Sync->Granule = (Granule == 0xFFFFFFFF) ? 0 : Granule;
+	Sync->WindowCursorError = (uint32_t)(MaxError - MinError);
+
+	//Until the history fills there may not have been enough steps to see the whole spread, so nothing less than
+	//the biggest step so far
+	if ((Count < AUDIO_SYNC_HISTORY) && (Sync->WindowCursorError < MaxStep))
+	{
+		Sync->WindowCursorError = MaxStep;
+	}
+	Sync->MeanGap = GapCount ? GapTotal / (float)GapCount : 0.0f;
+	float Variance = GapCount ? GapSquaredTotal / (float)GapCount - Sync->MeanGap*Sync->MeanGap : 0.0f;
+	Sync->GapJitter = (Variance > 0.0f) ? sqrtf(Variance) : 0.0f;
+}
+
+internal audio_sync_write
+UpdateAudioSync(audio_sync* Sync, uint64_t Time, uint32_t PlayCursor, uint32_t WriteCursor)
+{
+	audio_sync_write Result = {};
+	uint32_t BufferSize = Sync->BufferSize;
+	uint32_t WriteLead = (WriteCursor + BufferSize - PlayCursor) % BufferSize;
+
+	audio_sync_observation Observation = {};
+	if (!Sync->IsValid)
+	{
+		Sync->IsValid = true;
+		Sync->IsWriting = false;
+		Sync->LastPlayCursor = PlayCursor;
+		Sync->PlayPosition = PlayCursor;
+		Sync->WrittenPosition = Sync->PlayPosition + WriteLead;
+		Sync->ObservationCount = 0;
+	}
+	else
+	{
+		//Fine as long as updates come more often than the buffer loops
+		Observation.PlayStep = (PlayCursor + BufferSize - Sync->LastPlayCursor) % BufferSize;
+		Sync->LastPlayCursor = PlayCursor;
+		Sync->PlayPosition += Observation.PlayStep;
+
+		audio_sync_observation* Previous = &Sync->History[(Sync->ObservationCount - 1) % AUDIO_SYNC_HISTORY];
+		float GapSeconds = (float)(Time - Previous->Time) / 1e9f;
+		Observation.GapBytes = GapSeconds*(float)Sync->BytesPerSecond;
+
+		//Anything close to the peak counts as it happening again and holds it for longer
+		if (Observation.GapBytes >= 0.75f*Sync->PeakGap)
+		{
+			Sync->PeakGap = (Observation.GapBytes > Sync->PeakGap) ? Observation.GapBytes : Sync->PeakGap;
+			Sync->PeakTime = Time;
+		}
+		else if ((float)(Time - Sync->PeakTime) / 1e9f > AUDIO_SYNC_PEAK_HOLD_SECONDS)
+		{
+			float PeakDecay = 1.0f - GapSeconds / AUDIO_SYNC_PEAK_SECONDS;
+			Sync->PeakGap *= (PeakDecay > 0.0f) ? PeakDecay : 0.0f;
+		}
+
+		float MarginDecay = 1.0f - GapSeconds / AUDIO_SYNC_MARGIN_SECONDS;
+		Sync->Margin = 1.0f + (Sync->Margin - 1.0f)*((MarginDecay > 0.0f) ? MarginDecay : 0.0f);
+	}
+	Observation.Time = Time;
+	Observation.PlayPosition = Sync->PlayPosition;
+	Observation.WriteLead = WriteLead;
+	Sync->History[Sync->ObservationCount++ % AUDIO_SYNC_HISTORY] = Observation;
+	UpdateAudioSyncEstimates(Sync);
+	if (4*Sync->WindowCursorError >= 3*Sync->CursorError)
+	{
+		//The cursor landed further off than it ever has, so the estimate was short and may be still
+		if (Sync->CursorError && (Sync->WindowCursorError > Sync->CursorError + Sync->CursorError / 8))
+		{
+			GrowAudioSyncMargin(Sync);
+		}
+		Sync->CursorError = (Sync->WindowCursorError > Sync->CursorError) ? Sync->WindowCursorError : Sync->CursorError;
+		Sync->CursorErrorTime = Time;
+	}
+	else if ((float)(Time - Sync->CursorErrorTime) / 1e9f > AUDIO_SYNC_PEAK_HOLD_SECONDS)
+	{
+		Sync->CursorError = (Sync->CursorError + Sync->WindowCursorError) / 2;
+	}
+
+	uint64_t WritePosition = Sync->PlayPosition + WriteLead;
+	if (!Sync->IsWriting)
+	{
+		//Until the play cursor has been seen to move there is no telling how far it jumps at a time, so nothing is
+		//written yet - the device is still playing whatever silence it started with
+		Sync->WrittenPosition = WritePosition;
+		Sync->IsWriting = (Sync->Granule > 0);
+	}
+	else if (Sync->WrittenPosition < WritePosition)
+	{
+		++Sync->UnderrunCount;
+		GrowAudioSyncMargin(Sync);
+		Sync->WrittenPosition = WritePosition;
+	}
+
+	float ExpectedGap = Sync->MeanGap + 3.0f*Sync->GapJitter;
+	ExpectedGap = (Sync->PeakGap > ExpectedGap) ? Sync->PeakGap : ExpectedGap;
+	uint32_t SafetyBytes = (uint32_t)(((float)Sync->CursorError + ExpectedGap)*Sync->Margin);
+	SafetyBytes = (SafetyBytes + Sync->BytesPerSample - 1) / Sync->BytesPerSample*Sync->BytesPerSample;
+	Sync->SafetyBytes = SafetyBytes;
+
+	//Never so far ahead that it would write over what the device has not played yet
+	uint64_t TargetPosition = WritePosition + SafetyBytes;
+	uint64_t MaxPosition = Sync->PlayPosition + BufferSize - Sync->BytesPerSample;
+	TargetPosition = (TargetPosition < MaxPosition) ? TargetPosition : MaxPosition;
+	if (Sync->IsWriting && (TargetPosition > Sync->WrittenPosition))
+	{
+		uint32_t BytesToWrite = (uint32_t)(TargetPosition - Sync->WrittenPosition);
+		Result.ByteToLock = (uint32_t)(Sync->WrittenPosition % BufferSize);
+		Result.BytesToWrite = BytesToWrite / Sync->BytesPerSample*Sync->BytesPerSample;
+		Sync->WrittenPosition += Result.BytesToWrite;
+	}
+
+	uint32_t Latency = (uint32_t)(Sync->WrittenPosition - Sync->PlayPosition);
+	Sync->LatencyTotal += Latency;
+	++Sync->LatencyReadings;
+	Sync->MaxLatency = (Latency > Sync->MaxLatency) ? Latency : Sync->MaxLatency;
+
+	return(Result);
+}
+
+#endif
@@ -0,0 +1,3651 @@
+/*
+	Standalone micro-benchmarks for the game's low-level pieces - not linked into the game.
+	Usage: babl_bench [frames]
+	Every benchmark replays the same pseudo-random workload against each implementation and prints cycles per frame.
+	Alongside the timings each one checks its results (round trips, kernels against the scalar reference, and so on);
+	the run exits with 1 if any check failed, so it can gate a build.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include "babl.h"
+#include "babl_intrinsics.h"
+#include "babl_debug.h"
+#include "babl_debug_trace.h"
+#include "babl_input_stream.h"
+#include "babl_platform_memory.h"
+#include "babl_state_ring.h"
+#include "babl_audio_sync.h"
+#include "babl_simulated_sound_card.h"
+#include "babl_frame_pacer.h"
+
+#include "babl_meta.cpp"
+#include "babl_audio.cpp"
+#include "babl_render.cpp"
+#include "babl_png.cpp"
+#include "babl_asset.cpp"
+
+struct bench_random
+{
+	uint32_t State;
+};
+
+inline uint32_t
+NextRandom(bench_random* Random)
+{
+	uint32_t X = Random->State;
+	X ^= X << 13;
+	X ^= X >> 17;
+	X ^= X << 5;
+	Random->State = X;
+	return(X);
+}
+
+//Every check in the bench goes through here; main turns any failure into the exit code
+global_variable uint32_t FailedCheckCount;
+
+inline bool32
+BenchCheck(bool32 IsRight)
+{
+	if (!IsRight)
+	{
+		++FailedCheckCount;
+	}
+	return(IsRight);
+}
+
+inline double
+GetBenchMilliseconds()
+{
+	struct timespec Time;
+	timespec_get(&Time, TIME_UTC);
+	return((double)Time.tv_sec*1000.0 + (double)Time.tv_nsec / 1e6);
+}
+
+//
+// Arena vs malloc
+//
+
+//Roughly one frame of scratch: lots of small command-sized blocks, a few arrays, the odd big buffer
+#define BENCH_ALLOCATIONS_PER_FRAME 2048
+
+inline uint64_t
+GetFrameAllocationSize(bench_random* Random)
+{
+	uint32_t Roll = NextRandom(Random) % 100;
+	uint64_t Result;
+	if (Roll < 85)
+	{
+		Result = 16 + NextRandom(Random) % 112;
+	}
+	else if (Roll < 99)
+	{
+		Result = 1024 + NextRandom(Random) % (63*1024);
+	}
+	else
+	{
+		Result = Kilobytes(256) + NextRandom(Random) % Megabytes(1);
+	}
+	return(Result);
+}
+
+internal void
+BenchArenaVersusMalloc(int FrameCount)
+{
+	uint64_t ArenaSize = Megabytes(256);
+	void* ArenaMemory = malloc(ArenaSize);
+	memory_arena Arena;
+	InitializeArena(&Arena, ArenaSize, ArenaMemory);
+
+	static void* Blocks[BENCH_ALLOCATIONS_PER_FRAME];
+	uint64_t Checksum = 0;
+
+	bench_random Random = {0x1234567};
+	uint64_t MallocStart = __rdtsc();
+	for (int FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		for (int Index = 0; Index < BENCH_ALLOCATIONS_PER_FRAME; Index++)
+		{
+			Blocks[Index] = malloc(GetFrameAllocationSize(&Random));
+			*(uint8_t*)Blocks[Index] = (uint8_t)Index;
+		}
+		for (int Index = 0; Index < BENCH_ALLOCATIONS_PER_FRAME; Index++)
+		{
+			Checksum += *(uint8_t*)Blocks[Index];
+			free(Blocks[Index]);
+		}
+	}
+	uint64_t MallocCycles = __rdtsc() - MallocStart;
+
+	Random.State = 0x1234567;
+	uint64_t ArenaStart = __rdtsc();
+	for (int FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		temporary_memory FrameMemory = BeginTemporaryMemory(&Arena);
+		for (int Index = 0; Index < BENCH_ALLOCATIONS_PER_FRAME; Index++)
+		{
+			Blocks[Index] = PushSize(&Arena, GetFrameAllocationSize(&Random));
+			*(uint8_t*)Blocks[Index] = (uint8_t)Index;
+		}
+		for (int Index = 0; Index < BENCH_ALLOCATIONS_PER_FRAME; Index++)
+		{
+			Checksum += *(uint8_t*)Blocks[Index];
+		}
+		EndTemporaryMemory(FrameMemory);
+	}
+	uint64_t ArenaCycles = __rdtsc() - ArenaStart;
+	CheckArena(&Arena);
+
+	printf("arena vs malloc: %d allocations/frame, %d frames (checksum %llu)\n",
+		BENCH_ALLOCATIONS_PER_FRAME, FrameCount, (unsigned long long)Checksum);
+	printf("  malloc/free   %12llu cycles/frame\n", (unsigned long long)(MallocCycles / FrameCount));
+	printf("  arena scope   %12llu cycles/frame  (%.1fx)\n", (unsigned long long)(ArenaCycles / FrameCount),
+		ArenaCycles ? (double)MallocCycles / (double)ArenaCycles : 0.0);
+	printf("  arena high-water mark %llu KB\n", (unsigned long long)(Arena.HighWaterMark / 1024));
+
+	free(ArenaMemory);
+}
+
+//
+// Input stream - round trip, size and speed against the raw one-struct-per-frame format
+//
+
+//Ten minutes at 30Hz of someone mostly holding a direction, tapping buttons and nudging the mouse
+internal void
+SimulateInputFrame(bench_random* Random, game_input_buffer* Input)
+{
+	for (int ButtonIndex = 0; ButtonIndex < ArrayCount(Input->MouseButtons); ButtonIndex++)
+	{
+		Input->MouseButtons[ButtonIndex].HalfTransitionCount = 0;
+	}
+	if ((NextRandom(Random) % 8) == 0)
+	{
+		Input->MouseX += (int)(NextRandom(Random) % 9) - 4;
+		Input->MouseY += (int)(NextRandom(Random) % 9) - 4;
+	}
+
+	for (int ControllerIndex = 0; ControllerIndex < 2; ControllerIndex++)
+	{
+		game_controller_input* Controller = &Input->Controllers[ControllerIndex];
+		Controller->IsAnalog = (ControllerIndex == 1);
+		for (int ButtonIndex = 0; ButtonIndex < ArrayCount(Controller->Buttons); ButtonIndex++)
+		{
+			game_button_state* Button = &Controller->Buttons[ButtonIndex];
+			Button->HalfTransitionCount = 0;
+			if ((NextRandom(Random) % 40) == 0)
+			{
+				Button->EndedDown = !Button->EndedDown;
+				Button->HalfTransitionCount = 1;
+			}
+		}
+		if (Controller->IsAnalog && ((NextRandom(Random) % 4) == 0))
+		{
+			Controller->StickX = (float)((int)(NextRandom(Random) % 2001) - 1000) / 1000.0f;
+			Controller->StickY = (float)((int)(NextRandom(Random) % 2001) - 1000) / 1000.0f;
+		}
+	}
+}
+
+internal void
+BenchInputStream(int FrameCount)
+{
+	game_input_buffer* Frames = (game_input_buffer*)calloc(FrameCount, sizeof(game_input_buffer));
+	bench_random Random = {0xBAB1};
+	game_input_buffer Input = {};
+	for (int FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		SimulateInputFrame(&Random, &Input);
+		Frames[FrameIndex] = Input;
+	}
+
+	static input_stream_writer Writer;
+	uint64_t StreamCapacity = sizeof(input_stream_header) + (uint64_t)FrameCount*INPUT_STREAM_MAX_FRAME_SIZE + sizeof(Writer.Index);
+	uint8_t* Stream = (uint8_t*)malloc(StreamCapacity);
+
+	uint64_t EncodeStart = __rdtsc();
+	input_stream_header Header = BeginInputStream(&Writer);
+	uint64_t StreamSize = sizeof(Header);
+	for (int FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		StreamSize += EncodeInputFrame(&Writer, &Frames[FrameIndex], Stream + StreamSize);
+	}
+	Header = EndInputStream(&Writer);
+	memcpy(Stream + StreamSize, Writer.Index, Header.IndexCount*sizeof(input_stream_index_entry));
+	StreamSize += Header.IndexCount*sizeof(input_stream_index_entry);
+	memcpy(Stream, &Header, sizeof(Header));
+	uint64_t EncodeCycles = __rdtsc() - EncodeStart;
+
+	input_stream_reader Reader;
+	bool32 RoundTrip = OpenInputStream(&Reader, Stream, StreamSize);
+	uint64_t DecodeStart = __rdtsc();
+	for (int FrameIndex = 0; RoundTrip && (FrameIndex < FrameCount); FrameIndex++)
+	{
+		game_input_buffer Decoded;
+		RoundTrip = DecodeNextInputFrame(&Reader, &Decoded) && (memcmp(&Decoded, &Frames[FrameIndex], sizeof(Decoded)) == 0);
+	}
+	game_input_buffer Extra;
+	RoundTrip = RoundTrip && !DecodeNextInputFrame(&Reader, &Extra);
+	uint64_t DecodeCycles = __rdtsc() - DecodeStart;
+
+	int SeekCount = 1000;
+	bool32 SeeksMatch = RoundTrip;
+	uint64_t SeekStart = __rdtsc();
+	for (int SeekIndex = 0; SeeksMatch && (SeekIndex < SeekCount); SeekIndex++)
+	{
+		uint32_t Target = NextRandom(&Random) % FrameCount;
+		game_input_buffer Decoded;
+		SeeksMatch = SeekInputStream(&Reader, Target) && DecodeNextInputFrame(&Reader, &Decoded) &&
+			(memcmp(&Decoded, &Frames[Target], sizeof(Decoded)) == 0);
+	}
+	uint64_t SeekCycles = __rdtsc() - SeekStart;
+
+	uint64_t RawSize = (uint64_t)FrameCount*sizeof(game_input_buffer);
+	printf("input stream: %d frames, %u index entries\n", FrameCount, Header.IndexCount);
+	printf("  round trip    %s, seeks %s\n", BenchCheck(RoundTrip) ? "bit-exact" : "MISMATCH", BenchCheck(SeeksMatch) ? "match" : "MISMATCH");
+	printf("  raw           %10llu bytes (%llu/frame)\n", (unsigned long long)RawSize, (unsigned long long)sizeof(game_input_buffer));
+	printf("  delta         %10llu bytes (%.2f/frame, %.1fx smaller)\n", (unsigned long long)StreamSize,
+		(double)StreamSize / FrameCount, (double)RawSize / (double)StreamSize);
+	printf("  encode        %10llu cycles/frame\n", (unsigned long long)(EncodeCycles / FrameCount));
+	printf("  decode        %10llu cycles/frame\n", (unsigned long long)(DecodeCycles / FrameCount));
+	printf("  seek + decode %10llu cycles/seek\n", (unsigned long long)(SeekCycles / SeekCount));
+
+	free(Stream);
+	free(Frames);
+}
+
+//
+// State ring - seeking through keyframes has to land on exactly the state linear playback reaches
+//
+
+//Stands in for the game: a deterministic function of memory and input that writes a few pages a frame
+//and now and then grows into fresh chunks
+struct bench_sim_state
+{
+	bench_random Random;
+	uint64_t Used;
+};
+
+#define BENCH_SIM_MAX_SIZE Megabytes(16)
+
+internal void
+StepBenchSim(platform_memory_block* Block, game_input_buffer* Input)
+{
+	bench_sim_state* State = (bench_sim_state*)Block->Base;
+	uint32_t* InputWords = (uint32_t*)Input;
+	for (uint32_t WordIndex = 0; WordIndex < sizeof(*Input) / 4; WordIndex++)
+	{
+		State->Random.State ^= InputWords[WordIndex]*2654435761u;
+	}
+	State->Random.State |= 1;
+
+	if (((NextRandom(&State->Random) % 64) == 0) && (State->Used + PLATFORM_MEMORY_CHUNK_SIZE <= BENCH_SIM_MAX_SIZE))
+	{
+		CommitPlatformMemory(Block, Block->Base + State->Used, PLATFORM_MEMORY_CHUNK_SIZE);
+		State->Used += PLATFORM_MEMORY_CHUNK_SIZE;
+	}
+
+	//Like the game, most writes land in a small hot region and the odd one anywhere it has grown into
+	uint32_t WriteCount = 4 + NextRandom(&State->Random) % 16;
+	for (uint32_t WriteIndex = 0; WriteIndex < WriteCount; WriteIndex++)
+	{
+		uint64_t Range = ((NextRandom(&State->Random) % 16) == 0) ? State->Used : PLATFORM_MEMORY_CHUNK_SIZE;
+		uint64_t Offset = sizeof(bench_sim_state) + (NextRandom(&State->Random) % (Range - sizeof(bench_sim_state) - 8));
+		*(uint32_t*)(Block->Base + (Offset & ~(uint64_t)3)) = NextRandom(&State->Random);
+	}
+}
+
+internal uint64_t
+HashBlock(platform_memory_block* Block)
+{
+	uint64_t Hash = 14695981039346656037ULL;
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Block->ChunkCount; ChunkIndex++)
+	{
+		if (IsChunkCommitted(Block->CommittedChunks, ChunkIndex))
+		{
+			uint64_t* Words = (uint64_t*)GetChunkMemory(Block, ChunkIndex);
+			Hash = (Hash ^ ChunkIndex)*1099511628211ULL;
+			for (uint32_t WordIndex = 0; WordIndex < PLATFORM_MEMORY_CHUNK_SIZE / 8; WordIndex++)
+			{
+				Hash = (Hash ^ Words[WordIndex])*1099511628211ULL;
+			}
+		}
+	}
+	return(Hash);
+}
+
+internal void
+BenchStateRing(int FrameCount, uint32_t KeyframeInterval, uint64_t Budget)
+{
+	static platform_memory_block Block;
+	static state_ring Ring;
+	if (!ReservePlatformMemory(&Block, 0, BENCH_SIM_MAX_SIZE, BENCH_SIM_MAX_SIZE) ||
+		!InitializeStateRing(&Ring, &Block, Budget, KeyframeInterval))
+	{
+		printf("state ring: could not reserve memory\n");
+		BenchCheck(false);
+		return;
+	}
+	CommitPlatformMemory(&Block, Block.Base, PLATFORM_MEMORY_CHUNK_SIZE);
+	bench_sim_state* State = (bench_sim_state*)Block.Base;
+	State->Random.State = 0xC0FFEE;
+	State->Used = PLATFORM_MEMORY_CHUNK_SIZE;
+
+	//Record: keyframe, then step, hashing the state at the frames we will seek to later
+	static input_stream_writer Writer;
+	uint8_t* Stream = (uint8_t*)malloc(sizeof(input_stream_header) + (uint64_t)FrameCount*INPUT_STREAM_MAX_FRAME_SIZE + sizeof(Writer.Index));
+	uint64_t StreamSize = sizeof(input_stream_header);
+	BeginInputStream(&Writer);
+
+	int SeekCount = 200;
+	uint32_t* Targets = (uint32_t*)malloc(SeekCount*sizeof(uint32_t));
+	uint64_t* ExpectedHashes = (uint64_t*)malloc(SeekCount*sizeof(uint64_t));
+	bool32* IsTarget = (bool32*)calloc(FrameCount, sizeof(bool32));
+	bench_random Random = {0x5EEC};
+	for (int SeekIndex = 0; SeekIndex < SeekCount; SeekIndex++)
+	{
+		Targets[SeekIndex] = NextRandom(&Random) % FrameCount;
+		IsTarget[Targets[SeekIndex]] = true;
+	}
+
+	game_input_buffer Input = {};
+	uint64_t CaptureCycles = 0;
+	uint64_t PagesCaptured = 0;
+	for (int FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		if ((FrameIndex % KeyframeInterval) == 0)
+		{
+			uint64_t StartCycles = __rdtsc();
+			platform_snapshot_stats Stats;
+			CaptureStateKeyframe(&Ring, FrameIndex, &Stats);
+			CaptureCycles += __rdtsc() - StartCycles;
+			PagesCaptured += Stats.PagesCopied;
+		}
+		if (IsTarget[FrameIndex])
+		{
+			uint64_t Hash = HashBlock(&Block);
+			for (int SeekIndex = 0; SeekIndex < SeekCount; SeekIndex++)
+			{
+				if (Targets[SeekIndex] == (uint32_t)FrameIndex)
+				{
+					ExpectedHashes[SeekIndex] = Hash;
+				}
+			}
+		}
+		SimulateInputFrame(&Random, &Input);
+		StreamSize += EncodeInputFrame(&Writer, &Input, Stream + StreamSize);
+		StepBenchSim(&Block, &Input);
+	}
+	input_stream_header Header = EndInputStream(&Writer);
+	memcpy(Stream + StreamSize, Writer.Index, Header.IndexCount*sizeof(input_stream_index_entry));
+	StreamSize += Header.IndexCount*sizeof(input_stream_index_entry);
+	memcpy(Stream, &Header, sizeof(Header));
+	state_ring_stats RingStats = GetStateRingStats(&Ring);
+
+	//Seek around in random order - each restores the nearest keyframe and replays forward
+	input_stream_reader Reader;
+	OpenInputStream(&Reader, Stream, StreamSize);
+	int Matches = 0;
+	int Skipped = 0;
+	uint64_t RestoreCycles = 0;
+	uint64_t ReplayCycles = 0;
+	uint64_t FramesReplayed = 0;
+	uint64_t PagesRestored = 0;
+	uint64_t WorstSeekCycles = 0;
+	for (int SeekIndex = 0; SeekIndex < SeekCount; SeekIndex++)
+	{
+		int32_t KeyframeIndex = FindKeyframe(&Ring, Targets[SeekIndex]);
+		if (KeyframeIndex < 0)
+		{
+			//Fell out of the budget
+			++Skipped;
+			continue;
+		}
+
+		uint64_t StartCycles = __rdtsc();
+		platform_snapshot_stats Stats = RestoreStateKeyframe(&Ring, KeyframeIndex);
+		uint64_t RestoredCycles = __rdtsc();
+		SeekInputStream(&Reader, GetKeyframe(&Ring, KeyframeIndex)->FrameIndex);
+		while (Reader.FrameIndex < Targets[SeekIndex])
+		{
+			DecodeNextInputFrame(&Reader, &Input);
+			StepBenchSim(&Block, &Input);
+			++FramesReplayed;
+		}
+		uint64_t EndCycles = __rdtsc();
+		RestoreCycles += RestoredCycles - StartCycles;
+		ReplayCycles += EndCycles - RestoredCycles;
+		WorstSeekCycles = (EndCycles - StartCycles > WorstSeekCycles) ? EndCycles - StartCycles : WorstSeekCycles;
+		PagesRestored += Stats.PagesCopied;
+
+		Matches += (HashBlock(&Block) == ExpectedHashes[SeekIndex]) ? 1 : 0;
+	}
+	int SeeksRun = SeekCount - Skipped;
+
+	printf("state ring: %d frames, keyframe every %u, %lluMB budget\n", FrameCount, KeyframeInterval, (unsigned long long)(Budget / Megabytes(1)));
+	printf("  keyframes     %u kept (frames %u-%u), %u dropped, %u/%u page slots, %.1f pages copied per keyframe\n",
+		RingStats.KeyframeCount, RingStats.OldestFrame, RingStats.NewestFrame, RingStats.DroppedKeyframes,
+		RingStats.SlotsUsed, RingStats.SlotCount, (double)PagesCaptured / (double)((FrameCount + KeyframeInterval - 1) / KeyframeInterval));
+	printf("  without dedup %llu pages\n", (unsigned long long)(RingStats.KeyframeCount*(uint64_t)(State->Used / Block.PageSize)));
+	printf("  seeks         %d/%d match linear playback (%d outside the ring)%s\n", Matches, SeeksRun, Skipped,
+		BenchCheck(SeeksRun && (Matches == SeeksRun)) ? "" : " - MISMATCH");
+	if (SeeksRun)
+	{
+		printf("  capture       %10llu cycles/keyframe\n", (unsigned long long)(CaptureCycles / ((FrameCount + KeyframeInterval - 1) / KeyframeInterval)));
+		printf("  restore       %10llu cycles/seek (%.1f pages)\n", (unsigned long long)(RestoreCycles / SeeksRun), (double)PagesRestored / SeeksRun);
+		printf("  replay        %10llu cycles/seek (%.1f frames)\n", (unsigned long long)(ReplayCycles / SeeksRun), (double)FramesReplayed / SeeksRun);
+		printf("  worst seek    %10llu cycles\n", (unsigned long long)WorstSeekCycles);
+	}
+
+	free(IsTarget);
+	free(ExpectedHashes);
+	free(Targets);
+	free(Stream);
+	ReleasePlatformMemory(&Block);
+}
+
+//
+// Snapshot sweep - save and restore cost against pages written since, at two very different reservation sizes
+//
+
+//Pages spread over the whole committed range, distinct as long as Count <= PageCount (the stride is odd)
+internal void
+TouchBenchPages(platform_memory_block* Block, uint32_t PageCount, uint32_t Count, uint32_t Value)
+{
+	for (uint32_t Index = 0; Index < Count; Index++)
+	{
+		uint32_t PageIndex = (uint32_t)(((uint64_t)Index*40503u + Value) % PageCount);
+		*(uint32_t*)(Block->Base + (uint64_t)PageIndex*Block->PageSize + (Index % 64)*8) = Value + Index;
+	}
+}
+
+internal void
+BenchSnapshotSweep(uint32_t RepeatCount)
+{
+	uint64_t const CommittedSize = Megabytes(32);
+	uint64_t Reservations[] = {Megabytes(64), Gigabytes(1)};
+	uint32_t TouchCounts[] = {1, 16, 256, 1024, 4096, 8192};
+	printf("snapshot sweep: %lluMB committed, best of %u, ms to save / restore against pages written since the last save\n",
+		(unsigned long long)(CommittedSize / Megabytes(1)), RepeatCount);
+
+	static platform_memory_block Block;
+	for (int ReservationIndex = 0; ReservationIndex < ArrayCount(Reservations); ReservationIndex++)
+	{
+		uint64_t Reserved = Reservations[ReservationIndex];
+		platform_memory_snapshot Snapshot;
+		if (!ReservePlatformMemory(&Block, 0, Reserved, CommittedSize) ||
+			!CommitPlatformMemory(&Block, Block.Base, CommittedSize) ||
+			!AddPlatformMemorySnapshot(&Block, &Snapshot, AllocatePlatformPages(Reserved)))
+		{
+			printf("  %5lluMB reserved: could not reserve memory\n", (unsigned long long)(Reserved / Megabytes(1)));
+			BenchCheck(false);
+			continue;
+		}
+		uint32_t PageCount = (uint32_t)(CommittedSize / Block.PageSize);
+
+		//The first save has every committed page to copy - all a snapshot cost before write tracking
+		double Start = GetBenchMilliseconds();
+		platform_snapshot_stats FullStats = SavePlatformMemory(&Block, &Snapshot);
+		printf("  %5lluMB reserved  first save %6u pages %8.3f ms\n", (unsigned long long)(Reserved / Megabytes(1)),
+			FullStats.PagesCopied, GetBenchMilliseconds() - Start);
+
+		bool32 CopiedWhatWasTouched = (FullStats.PagesCopied == PageCount);
+		bool32 RestoredExactly = true;
+		uint32_t Value = 1;
+		for (int TouchIndex = 0; TouchIndex < ArrayCount(TouchCounts); TouchIndex++)
+		{
+			uint32_t TouchCount = TouchCounts[TouchIndex];
+			double BestWrite = 0.0;
+			double BestSave = 0.0;
+			double BestRestore = 0.0;
+			for (uint32_t Repeat = 0; Repeat < RepeatCount; Repeat++)
+			{
+				//The first write to each page since the last save is what the tracking costs the game
+				Start = GetBenchMilliseconds();
+				TouchBenchPages(&Block, PageCount, TouchCount, Value++);
+				double Write = GetBenchMilliseconds() - Start;
+
+				Start = GetBenchMilliseconds();
+				platform_snapshot_stats SaveStats = SavePlatformMemory(&Block, &Snapshot);
+				double Save = GetBenchMilliseconds() - Start;
+				uint64_t SavedHash = HashBlock(&Block);
+
+				TouchBenchPages(&Block, PageCount, TouchCount, Value++);
+				Start = GetBenchMilliseconds();
+				platform_snapshot_stats RestoreStats = RestorePlatformMemory(&Block, &Snapshot);
+				double Restore = GetBenchMilliseconds() - Start;
+
+				CopiedWhatWasTouched &= ((SaveStats.PagesCopied == TouchCount) && (RestoreStats.PagesCopied >= TouchCount));
+				RestoredExactly &= (HashBlock(&Block) == SavedHash);
+				BestWrite = (!Repeat || (Write < BestWrite)) ? Write : BestWrite;
+				BestSave = (!Repeat || (Save < BestSave)) ? Save : BestSave;
+				BestRestore = (!Repeat || (Restore < BestRestore)) ? Restore : BestRestore;
+			}
+			printf("    %5u touched  first writes %8.3f ms  save %8.3f ms (%5.0f ns/page)  restore %8.3f ms\n", TouchCount,
+				BestWrite, BestSave, BestSave*1.0e6 / TouchCount, BestRestore);
+		}
+		printf("%s%s", BenchCheck(CopiedWhatWasTouched) ? "" : "    COPIED MORE OR LESS THAN WAS TOUCHED\n",
+			BenchCheck(RestoredExactly) ? "" : "    RESTORE DIFFERS FROM THE SAVE\n");
+
+#if defined(_WIN32)
+		VirtualFree(Snapshot.Memory, 0, MEM_RELEASE);
+#else
+		munmap(Snapshot.Memory, Reserved);
+#endif
+		ReleasePlatformMemory(&Block);
+	}
+}
+
+//
+// State migration - one state across a change of build that adds, removes, reorders and retypes members
+//
+
+#define BENCH_STATE_BEFORE_MEMBERS(Member) \
+	Member(bench_state_before, int32_t, Score) \
+	Member(bench_state_before, float, Speed) \
+	Member(bench_state_before, uint32_t, Removed) \
+	Member(bench_state_before, int32_t, Retyped) \
+	Member(bench_state_before, float, Truncated) \
+	Member(bench_state_before, float, Clamped) \
+	Member(bench_state_before, uint32_t, Widened) \
+	Member(bench_state_before, float*, Pointer) \
+	Member(bench_state_before, uint64_t, NowPointer) \
+	Member(bench_state_before, memory_arena, Arena)
+
+struct bench_state_before
+{
+	BENCH_STATE_BEFORE_MEMBERS(META_DECLARE_MEMBER)
+};
+
+//Everything moved, Removed gone, Added new, Retyped/Truncated/Clamped/Widened converted, NowPointer not convertible
+#define BENCH_STATE_AFTER_MEMBERS(Member) \
+	Member(bench_state_after, memory_arena, Arena) \
+	Member(bench_state_after, float, Added) \
+	Member(bench_state_after, float, Retyped) \
+	Member(bench_state_after, int32_t, Score) \
+	Member(bench_state_after, uint64_t, Widened) \
+	Member(bench_state_after, int32_t, Truncated) \
+	Member(bench_state_after, uint32_t, Clamped) \
+	Member(bench_state_after, float*, Pointer) \
+	Member(bench_state_after, float, Speed) \
+	Member(bench_state_after, float*, NowPointer)
+
+struct bench_state_after
+{
+	BENCH_STATE_AFTER_MEMBERS(META_DECLARE_MEMBER)
+};
+
+global_variable member_definition MembersOf_bench_state_before[] = {BENCH_STATE_BEFORE_MEMBERS(META_MEMBER_DEFINITION)};
+global_variable member_definition MembersOf_bench_state_after[] = {BENCH_STATE_AFTER_MEMBERS(META_MEMBER_DEFINITION)};
+global_variable member_definition MembersOf_bench_game_state[] = {GAME_STATE_MEMBERS(META_MEMBER_DEFINITION)};
+
+internal void
+BenchStateMigration(int MigrationCount)
+{
+	static meta_layout Before;
+	static meta_layout After;
+	static meta_layout AfterAgain;
+	BuildMetaLayout(&Before, MembersOf_bench_state_before, (uint32_t)ArrayCount(MembersOf_bench_state_before), sizeof(bench_state_before));
+	BuildMetaLayout(&After, MembersOf_bench_state_after, (uint32_t)ArrayCount(MembersOf_bench_state_after), sizeof(bench_state_after));
+	BuildMetaLayout(&AfterAgain, MembersOf_bench_state_after, (uint32_t)ArrayCount(MembersOf_bench_state_after), sizeof(bench_state_after));
+
+	float Target = 0.0f;
+	bench_state_before Old = {};
+	Old.Score = -1234;
+	Old.Speed = 3.5f;
+	Old.Removed = 77;
+	Old.Retyped = 7;
+	Old.Truncated = -2.75f;
+	Old.Clamped = -3.5f;
+	Old.Widened = 0xFFFFFFF0;
+	Old.Pointer = &Target;
+	Old.NowPointer = 0x1234;
+	InitializeArena(&Old.Arena, 4096, &Target);
+	Old.Arena.Used = 100;
+	Old.Arena.HighWaterMark = 200;
+	Old.Arena.TempCount = 1;
+
+	bench_state_after New = {};
+	New.Added = 1.5f;
+	meta_migration Migration = MigrateMembers(&Before, &Old, &After, &New);
+
+	//Every member of the new state, checked - the first one wrong is reported
+	struct bench_migration_check
+	{
+		char* Name;
+		bool32 IsRight;
+	};
+	bench_migration_check Checks[] = {
+		{"Score", New.Score == -1234},
+		{"Speed", New.Speed == 3.5f},
+		{"Added", New.Added == 1.5f},
+		{"Retyped", New.Retyped == 7.0f},
+		{"Truncated", New.Truncated == -2},
+		{"Clamped", New.Clamped == 0},
+		{"Widened", New.Widened == 0xFFFFFFF0},
+		{"Pointer", New.Pointer == &Target},
+		{"NowPointer", New.NowPointer == 0},
+		{"Arena", (New.Arena.Size == Old.Arena.Size) && (New.Arena.Base == Old.Arena.Base) && (New.Arena.Used == Old.Arena.Used) &&
+			(New.Arena.CommittedSize == Old.Arena.CommittedSize) && (New.Arena.HighWaterMark == Old.Arena.HighWaterMark) &&
+			(New.Arena.TempCount == Old.Arena.TempCount)},
+		{"counts", (Migration.CopiedCount == 9) && (Migration.ConvertedCount == 4) &&
+			(Migration.DefaultedCount == 2) && (Migration.DroppedCount == 2)},
+		{"Version", (Before.Version != After.Version) && (After.Version == AfterAgain.Version)},
+	};
+	char* Wrong = 0;
+	for (int CheckIndex = ArrayCount(Checks) - 1; CheckIndex >= 0; CheckIndex--)
+	{
+		Wrong = Checks[CheckIndex].IsRight ? Wrong : Checks[CheckIndex].Name;
+	}
+
+	//Same layout both sides has to come through untouched
+	static meta_layout GameLayout;
+	BuildMetaLayout(&GameLayout, MembersOf_bench_game_state, (uint32_t)ArrayCount(MembersOf_bench_game_state), sizeof(game_state));
+	game_state OldGame;
+	game_state NewGame;
+	memset(&OldGame, 0x5A, sizeof(OldGame));
+	memset(&NewGame, 0, sizeof(NewGame));
+	InitializeArena(&OldGame.PermanentArena, Megabytes(1), &OldGame);
+	MigrateMembers(&GameLayout, &OldGame, &GameLayout, &NewGame);
+	bool32 SameLayoutMatches = true;
+	for (uint32_t MemberIndex = 0; MemberIndex < GameLayout.MemberCount; MemberIndex++)
+	{
+		meta_layout_member* Member = &GameLayout.Members[MemberIndex];
+		SameLayoutMatches &= (memcmp((uint8_t*)&OldGame + Member->Offset, (uint8_t*)&NewGame + Member->Offset, Member->Size) == 0);
+	}
+
+	double Start = GetBenchMilliseconds();
+	uint64_t Check = 0;
+	for (int Index = 0; Index < MigrationCount; Index++)
+	{
+		Old.Score = Index;
+		meta_migration Timed = MigrateMembers(&Before, &Old, &After, &New);
+		Check += (uint64_t)New.Score + Timed.CopiedCount;
+	}
+	double MigrateMicroseconds = (GetBenchMilliseconds() - Start)*1000.0 / MigrationCount;
+
+	Start = GetBenchMilliseconds();
+	for (int Index = 0; Index < MigrationCount; Index++)
+	{
+		BuildMetaLayout(&GameLayout, MembersOf_bench_game_state, (uint32_t)ArrayCount(MembersOf_bench_game_state), sizeof(game_state));
+		Check += GameLayout.Version;
+	}
+	double BuildMicroseconds = (GetBenchMilliseconds() - Start)*1000.0 / MigrationCount;
+
+	printf("state migration: %u members to %u, reordered with one added, one removed, four retyped and one not convertible\n",
+		Before.MemberCount, After.MemberCount);
+	printf("  migrated      %u copied, %u converted, %u defaulted, %u dropped: %s; same layout %s\n",
+		Migration.CopiedCount, Migration.ConvertedCount, Migration.DefaultedCount, Migration.DroppedCount,
+		BenchCheck(!Wrong) ? "as expected" : "WRONG", BenchCheck(SameLayoutMatches) ? "untouched" : "CHANGED");
+	if (Wrong)
+	{
+		printf("  first wrong   %s\n", Wrong);
+	}
+	//Check only keeps the timed loops from being optimized away - it is the same every run
+	printf("  time          %.2f us to migrate, %.2f us to build game_state's %u-member layout (check %llx)\n",
+		MigrateMicroseconds, BuildMicroseconds, GameLayout.MemberCount, (unsigned long long)(Check & 0xFFFF));
+}
+
+//
+// Audio mixer - how many voices one core can keep mixed in real time, per kernel
+//
+
+#define BENCH_SAMPLES_PER_SECOND 48000
+#define BENCH_SAMPLES_PER_BLOCK (BENCH_SAMPLES_PER_SECOND / 30)
+
+internal uint64_t
+HashSamples(uint64_t Hash, int16_t* Samples, int Count)
+{
+	uint8_t* At = (uint8_t*)Samples;
+	for (int Index = 0; Index < Count*(int)sizeof(int16_t); Index++)
+	{
+		Hash = (Hash ^ At[Index])*0x100000001B3ULL;
+	}
+	return(Hash);
+}
+
+//Every voice loops one of a few noise sounds at its own volume and pan, and every block a sixteenth of them start a fade
+//Returns the hash of everything that came out, so the kernels can be checked against each other
+internal uint64_t
+RunMixerWorkload(memory_arena* Arena, loaded_sound* Sounds, int SoundCount, uint32_t VoiceCount, int BlockCount,
+	double* Milliseconds, uint64_t* VoiceSamplesMixed)
+{
+	temporary_memory WorkloadMemory = BeginTemporaryMemory(Arena);
+	audio_state Audio;
+	InitializeAudioState(&Audio, Arena, VoiceCount, 0, 0);
+	static int16_t Output[2*BENCH_SAMPLES_PER_BLOCK];
+	game_sound_buffer SoundBuffer = {BENCH_SAMPLES_PER_SECOND, BENCH_SAMPLES_PER_BLOCK, Output};
+
+	bench_random Random = {0xA0D10};
+	voice_id* IDs = PushArray(Arena, VoiceCount, voice_id);
+	for (uint32_t VoiceIndex = 0; VoiceIndex < VoiceCount; VoiceIndex++)
+	{
+		float Volume = (float)(NextRandom(&Random) % 1000) / 1000.0f / (float)VoiceCount;
+		float Pan = (float)((int)(NextRandom(&Random) % 2001) - 1000) / 1000.0f;
+		IDs[VoiceIndex] = PlaySound(&Audio, &Sounds[NextRandom(&Random) % SoundCount], Volume, Pan, true);
+	}
+
+	uint64_t Hash = 0xCBF29CE484222325ULL;
+	double Start = GetBenchMilliseconds();
+	for (int BlockIndex = 0; BlockIndex < BlockCount; BlockIndex++)
+	{
+		for (uint32_t FadeIndex = 0; FadeIndex < (VoiceCount + 15) / 16; FadeIndex++)
+		{
+			voice_id ID = IDs[NextRandom(&Random) % VoiceCount];
+			float Volume = (float)(NextRandom(&Random) % 1000) / 1000.0f / (float)VoiceCount;
+			float FadeSeconds = (float)(50 + NextRandom(&Random) % 450) / 1000.0f;
+			SetVoiceVolume(&Audio, ID, Volume, FadeSeconds);
+		}
+
+		temporary_memory MixMemory = BeginTemporaryMemory(Arena);
+		sound_bus Bus = BeginSoundBus(Arena, SoundBuffer.SampleCount);
+		MixPlayingSounds(&Audio, &Bus, SoundBuffer.SamplesPerSecond);
+		OutputSoundBus(&Bus, &SoundBuffer);
+		EndTemporaryMemory(MixMemory);
+
+		Hash = HashSamples(Hash, Output, 2*SoundBuffer.SampleCount);
+	}
+	*Milliseconds = GetBenchMilliseconds() - Start;
+	*VoiceSamplesMixed = Audio.VoiceSamplesMixed;
+
+	EndTemporaryMemory(WorkloadMemory);
+	return(Hash);
+}
+
+internal void
+BenchAudioMixer(int BlockCount)
+{
+	uint64_t ArenaSize = Megabytes(64);
+	void* ArenaMemory = malloc(ArenaSize);
+	memory_arena Arena;
+	InitializeArena(&Arena, ArenaSize, ArenaMemory);
+
+	//Lengths that don't divide the block size, so the loop points land all over the place
+	loaded_sound Sounds[4];
+	bench_random Random = {0x5011D};
+	for (int SoundIndex = 0; SoundIndex < ArrayCount(Sounds); SoundIndex++)
+	{
+		loaded_sound* Sound = &Sounds[SoundIndex];
+		Sound->SampleCount = 7919 + SoundIndex*20011;
+		Sound->SamplesPerSecond = BENCH_SAMPLES_PER_SECOND;
+		Sound->Samples = PushArray(&Arena, Sound->SampleCount, float, 32);
+		for (uint32_t SampleIndex = 0; SampleIndex < Sound->SampleCount; SampleIndex++)
+		{
+			Sound->Samples[SampleIndex] = (float)((int)(NextRandom(&Random) % 2001) - 1000) / 1000.0f;
+		}
+	}
+
+	cpu_features Features = DetectCPUFeatures();
+	cpu_features KernelFeatures[3] = {{}, {Features.SSE2, false}, {Features.SSE2, Features.AVX2}};
+	uint32_t VoiceCounts[] = {1, 16, 64, 256, 1024};
+	double AudioMilliseconds = 1000.0*BlockCount*BENCH_SAMPLES_PER_BLOCK / BENCH_SAMPLES_PER_SECOND;
+
+	printf("audio mixer: %d blocks of %d samples at %dHz, looping voices with fades\n",
+		BlockCount, BENCH_SAMPLES_PER_BLOCK, BENCH_SAMPLES_PER_SECOND);
+	for (int VoiceCountIndex = 0; VoiceCountIndex < ArrayCount(VoiceCounts); VoiceCountIndex++)
+	{
+		uint32_t VoiceCount = VoiceCounts[VoiceCountIndex];
+		uint64_t ReferenceHash = 0;
+		for (int KernelIndex = 0; KernelIndex < ArrayCount(KernelFeatures); KernelIndex++)
+		{
+			InitAudioKernels(KernelFeatures[KernelIndex]);
+			if ((KernelIndex > 0) && (AudioKernels.MixVoiceSpan == MixVoiceSpanScalar))
+			{
+				continue;
+			}
+
+			double Milliseconds;
+			uint64_t VoiceSamplesMixed;
+			uint64_t Hash = RunMixerWorkload(&Arena, Sounds, ArrayCount(Sounds), VoiceCount, BlockCount, &Milliseconds, &VoiceSamplesMixed);
+			if (KernelIndex == 0)
+			{
+				ReferenceHash = Hash;
+			}
+
+			//Voice-milliseconds of 48kHz audio mixed per millisecond of CPU - how many voices one core could keep up with
+			double VoicesPerMillisecond = (double)VoiceSamplesMixed / (BENCH_SAMPLES_PER_SECOND / 1000.0) / Milliseconds;
+			printf("  %4u voices  %-6s %8.2f ms for %.0f ms of audio, %9.0f voices mixed per ms%s\n",
+				VoiceCount, AudioKernels.Name, Milliseconds, AudioMilliseconds, VoicesPerMillisecond,
+				BenchCheck(Hash == ReferenceHash) ? "" : "  OUTPUT DIFFERS FROM SCALAR");
+		}
+	}
+	CheckArena(&Arena);
+
+	free(ArenaMemory);
+}
+
+//
+// Oscillators - against the old sinf-per-sample tone, for speed, long-run pitch and aliasing
+//
+
+//What OutputGameSound used to do, minus the game_state
+internal void
+OldToneSamples(int16_t* Samples, int SampleCount, float* tSin, int ToneHz, int SamplesPerSecond)
+{
+	int16_t ToneVolume = 3000;
+	int WavePeriod = SamplesPerSecond / ToneHz;
+	for (int SampleIndex = 0; SampleIndex < SampleCount; SampleIndex++)
+	{
+		*tSin += 2.0f * 3.14f * (1.0f / (float)WavePeriod);
+		int16_t SampleValue = (int16_t)(sinf(*tSin) * ToneVolume);
+		*Samples++ = SampleValue;
+		*Samples++ = SampleValue;
+	}
+}
+
+//Rising zero crossings of a sine oscillator run for Seconds, straight through the kernel
+internal uint64_t
+CountOscillatorCycles(float Hz, double Seconds, float* Bus)
+{
+	int BlockSize = BENCH_SAMPLES_PER_BLOCK;
+	uint64_t BlockCount = (uint64_t)(Seconds*BENCH_SAMPLES_PER_SECOND) / BlockSize;
+	uint32_t dPhase = GetOscillatorPhaseStep(Hz, BENCH_SAMPLES_PER_SECOND);
+	uint32_t Phase = 0;
+	uint64_t Crossings = 0;
+	float Previous = 0.0f;
+	for (uint64_t BlockIndex = 0; BlockIndex < BlockCount; BlockIndex++)
+	{
+		memset(Bus, 0, 2*BlockSize*sizeof(float));
+		AudioKernels.OscillatorSpan(Bus, Bus + BlockSize, BlockSize, Phase, dPhase, 1.0f, 0.0f, Waveform_Sine);
+		Phase += (uint32_t)BlockSize*dPhase;
+		for (int Index = 0; Index < BlockSize; Index++)
+		{
+			Crossings += ((Previous < 0.0f) && (Bus[Index] >= 0.0f));
+			Previous = Bus[Index];
+		}
+	}
+	return(Crossings);
+}
+
+//In-place radix-2, Count a power of two
+internal void
+FFT(double* Real, double* Imaginary, int Count)
+{
+	for (int Index = 1, Reversed = 0; Index < Count; Index++)
+	{
+		int Bit = Count >> 1;
+		for (; Reversed & Bit; Bit >>= 1)
+		{
+			Reversed ^= Bit;
+		}
+		Reversed ^= Bit;
+		if (Index < Reversed)
+		{
+			double Swap = Real[Index]; Real[Index] = Real[Reversed]; Real[Reversed] = Swap;
+			Swap = Imaginary[Index]; Imaginary[Index] = Imaginary[Reversed]; Imaginary[Reversed] = Swap;
+		}
+	}
+	for (int Length = 2; Length <= Count; Length <<= 1)
+	{
+		double Angle = -2.0*3.14159265358979 / Length;
+		for (int Start = 0; Start < Count; Start += Length)
+		{
+			for (int Index = 0; Index < Length / 2; Index++)
+			{
+				double TwiddleReal = cos(Angle*Index);
+				double TwiddleImaginary = sin(Angle*Index);
+				double* AReal = &Real[Start + Index];
+				double* AImaginary = &Imaginary[Start + Index];
+				double* BReal = &Real[Start + Index + Length / 2];
+				double* BImaginary = &Imaginary[Start + Index + Length / 2];
+				double TReal = *BReal*TwiddleReal - *BImaginary*TwiddleImaginary;
+				double TImaginary = *BReal*TwiddleImaginary + *BImaginary*TwiddleReal;
+				*BReal = *AReal - TReal;
+				*BImaginary = *AImaginary - TImaginary;
+				*AReal += TReal;
+				*AImaginary += TImaginary;
+			}
+		}
+	}
+}
+
+//Wave holds exactly HarmonicBin cycles; returns the power on every other bin over the power on the harmonics, in dB
+internal double
+GetAliasingDecibels(float* Wave, int Count, uint32_t HarmonicBin, double* Real, double* Imaginary)
+{
+	for (int Index = 0; Index < Count; Index++)
+	{
+		Real[Index] = Wave[Index];
+		Imaginary[Index] = 0.0;
+	}
+	FFT(Real, Imaginary, Count);
+
+	double HarmonicPower = 0.0;
+	double AliasPower = 0.0;
+	for (int Bin = 1; Bin < Count / 2; Bin++)
+	{
+		double Power = Real[Bin]*Real[Bin] + Imaginary[Bin]*Imaginary[Bin];
+		if ((Bin % HarmonicBin) == 0)
+		{
+			HarmonicPower += Power;
+		}
+		else
+		{
+			AliasPower += Power;
+		}
+	}
+	return(10.0*log10((AliasPower > 0.0 ? AliasPower : 1e-300) / HarmonicPower));
+}
+
+//Same phase, no band-limiting - what the wave would sound like without the polyBLEP/BLAMP corrections
+inline double
+NaiveWave(oscillator_waveform Waveform, double T)
+{
+	double Result = sin(2.0*3.14159265358979*T);
+	switch (Waveform)
+	{
+		case Waveform_Saw: Result = 2.0*T - 1.0; break;
+		case Waveform_Square: Result = (T < 0.5) ? 1.0 : -1.0; break;
+		case Waveform_Triangle: Result = 1.0 - 4.0*fabs(fmod(T + 0.25, 1.0) - 0.5); break;
+		default: break;
+	}
+	return(Result);
+}
+
+internal void
+BenchOscillators(int BlockCount)
+{
+	char* WaveformNames[] = {"sine", "square", "saw", "triangle"};
+	uint32_t OscillatorCount = 64;
+	int BlockSize = BENCH_SAMPLES_PER_BLOCK;
+	float* Bus = (float*)malloc(2*BENCH_SAMPLES_PER_SECOND*sizeof(float));
+	static int16_t Output[2*BENCH_SAMPLES_PER_BLOCK];
+
+	printf("oscillators: %d blocks of %d samples at %dHz\n", BlockCount, BlockSize, BENCH_SAMPLES_PER_SECOND);
+
+	float tSin = 0.0f;
+	double Start = GetBenchMilliseconds();
+	for (uint32_t OscillatorIndex = 0; OscillatorIndex < OscillatorCount; OscillatorIndex++)
+	{
+		for (int BlockIndex = 0; BlockIndex < BlockCount; BlockIndex++)
+		{
+			OldToneSamples(Output, BlockSize, &tSin, 256 + OscillatorIndex, BENCH_SAMPLES_PER_SECOND);
+		}
+	}
+	double OldMilliseconds = GetBenchMilliseconds() - Start;
+	double SampleCount = (double)OscillatorCount*BlockCount*BlockSize;
+	printf("  old tone (sinf)     %8.1f M samples/s\n", SampleCount / OldMilliseconds / 1000.0);
+
+	cpu_features Features = DetectCPUFeatures();
+	cpu_features KernelFeatures[3] = {{}, {Features.SSE2, false}, {Features.SSE2, Features.AVX2}};
+	for (int Waveform = Waveform_Sine; Waveform <= Waveform_Triangle; Waveform++)
+	{
+		uint64_t ReferenceHash = 0;
+		for (int KernelIndex = 0; KernelIndex < ArrayCount(KernelFeatures); KernelIndex++)
+		{
+			InitAudioKernels(KernelFeatures[KernelIndex]);
+			if ((KernelIndex > 0) && (AudioKernels.OscillatorSpan == OscillatorSpanScalar))
+			{
+				continue;
+			}
+
+			//All the oscillators into one bus, block by block, the way MixPlayingSounds runs them
+			uint64_t Hash = 0xCBF29CE484222325ULL;
+			double Milliseconds = 0.0;
+			for (int BlockIndex = 0; BlockIndex < BlockCount; BlockIndex++)
+			{
+				memset(Bus, 0, 2*BlockSize*sizeof(float));
+				Start = GetBenchMilliseconds();
+				for (uint32_t OscillatorIndex = 0; OscillatorIndex < OscillatorCount; OscillatorIndex++)
+				{
+					uint32_t dPhase = GetOscillatorPhaseStep(55.0f*(float)(OscillatorIndex + 1), BENCH_SAMPLES_PER_SECOND);
+					uint32_t Phase = (uint32_t)(BlockIndex*BlockSize)*dPhase;
+					AudioKernels.OscillatorSpan(Bus, Bus + BlockSize, BlockSize, Phase, dPhase, 0.01f, 0.005f, (oscillator_waveform)Waveform);
+				}
+				Milliseconds += GetBenchMilliseconds() - Start;
+				Hash = HashSamples(Hash, (int16_t*)Bus, 4*BlockSize);
+			}
+			if (KernelIndex == 0)
+			{
+				ReferenceHash = Hash;
+			}
+			printf("  %-8s %-6s     %8.1f M samples/s%s\n", WaveformNames[Waveform], AudioKernels.Name,
+				SampleCount / Milliseconds / 1000.0, BenchCheck(Hash == ReferenceHash) ? "" : "  OUTPUT DIFFERS FROM SCALAR");
+		}
+	}
+	InitAudioKernels(Features);
+
+	//The old tone: the period is truncated to whole samples, and tSin loses precision as it grows
+	printf("  long-run pitch, old tone at 256Hz (period truncated to %d samples = %.3fHz):\n",
+		BENCH_SAMPLES_PER_SECOND / 256, (double)BENCH_SAMPLES_PER_SECOND / (BENCH_SAMPLES_PER_SECOND / 256));
+	tSin = 0.0f;
+	int CheckpointSeconds[] = {1, 60, 600, 3600};
+	int SecondsRun = 0;
+	for (int CheckpointIndex = 0; CheckpointIndex < ArrayCount(CheckpointSeconds); CheckpointIndex++)
+	{
+		for (; SecondsRun < CheckpointSeconds[CheckpointIndex] - 1; SecondsRun++)
+		{
+			for (int BlockIndex = 0; BlockIndex < 30; BlockIndex++)
+			{
+				OldToneSamples(Output, BlockSize, &tSin, 256, BENCH_SAMPLES_PER_SECOND);
+			}
+		}
+		float Before = tSin;
+		for (int BlockIndex = 0; BlockIndex < 30; BlockIndex++)
+		{
+			OldToneSamples(Output, BlockSize, &tSin, 256, BENCH_SAMPLES_PER_SECOND);
+		}
+		++SecondsRun;
+		double Hz = (double)(tSin - Before) / (2.0*3.14);
+		printf("    during second %5d  %10.3fHz (%+.1f cents)\n", SecondsRun, Hz, 1200.0*log2(Hz / 256.0));
+	}
+
+	float RequestedHz[] = {256.0f, 261.6256f};
+	for (int RequestIndex = 0; RequestIndex < ArrayCount(RequestedHz); RequestIndex++)
+	{
+		double Seconds = 3600.0;
+		uint64_t Cycles = CountOscillatorCycles(RequestedHz[RequestIndex], Seconds, Bus);
+		double MeasuredHz = (double)Cycles / Seconds;
+		printf("  long-run pitch, oscillator at %.4fHz: %llu cycles in an hour = %.4fHz (%+.4f cents)\n",
+			RequestedHz[RequestIndex], (unsigned long long)Cycles, MeasuredHz, 1200.0*log2(MeasuredHz / RequestedHz[RequestIndex]));
+	}
+
+	//A high note, where the naive waves alias the most. 3516.4Hz is exactly 4801 cycles in 2^16 samples, so every
+	//harmonic and every alias lands on its own FFT bin: whatever is not on a harmonic bin is aliasing
+	int FFTSize = 1 << 16;
+	uint32_t HarmonicBin = 4801;
+	uint32_t dPhase = HarmonicBin*(uint32_t)(4294967296ULL / FFTSize);
+	double* Real = (double*)malloc(FFTSize*sizeof(double));
+	double* Imaginary = (double*)malloc(FFTSize*sizeof(double));
+	float* Wave = (float*)malloc(2*FFTSize*sizeof(float));
+	printf("  aliasing at %.1fHz, power off the harmonics relative to on them:\n", (double)HarmonicBin*BENCH_SAMPLES_PER_SECOND / FFTSize);
+	for (int Waveform = Waveform_Sine; Waveform <= Waveform_Triangle; Waveform++)
+	{
+		memset(Wave, 0, 2*FFTSize*sizeof(float));
+		AudioKernels.OscillatorSpan(Wave, Wave + FFTSize, FFTSize, 0, dPhase, 1.0f, 0.0f, (oscillator_waveform)Waveform);
+
+		double BandLimited = GetAliasingDecibels(Wave, FFTSize, HarmonicBin, Real, Imaginary);
+		uint32_t Phase = 0;
+		for (int Index = 0; Index < FFTSize; Index++)
+		{
+			Wave[Index] = (float)NaiveWave((oscillator_waveform)Waveform, (double)Phase / 4294967296.0);
+			Phase += dPhase;
+		}
+		double Naive = GetAliasingDecibels(Wave, FFTSize, HarmonicBin, Real, Imaginary);
+		printf("    %-8s  %7.1f dB  (naive %7.1f dB)\n", WaveformNames[Waveform], BandLimited, Naive);
+	}
+	free(Wave);
+	free(Imaginary);
+	free(Real);
+
+	free(Bus);
+}
+
+//
+// Resampler - throughput of the kernels, and how clean the voices come out of it
+//
+
+//Wave holds a whole number of cycles of one tone; returns the power on every other bin over the power on it, in dB
+internal double
+GetToneNoiseDecibels(float* Wave, int Count, uint32_t ToneBin, double* Real, double* Imaginary)
+{
+	for (int Index = 0; Index < Count; Index++)
+	{
+		Real[Index] = Wave[Index];
+		Imaginary[Index] = 0.0;
+	}
+	FFT(Real, Imaginary, Count);
+
+	double TonePower = 0.0;
+	double NoisePower = 0.0;
+	for (int Bin = 1; Bin < Count / 2; Bin++)
+	{
+		double Power = Real[Bin]*Real[Bin] + Imaginary[Bin]*Imaginary[Bin];
+		if ((uint32_t)Bin == ToneBin)
+		{
+			TonePower += Power;
+		}
+		else
+		{
+			NoisePower += Power;
+		}
+	}
+	return(10.0*log10((NoisePower > 0.0 ? NoisePower : 1e-300) / TonePower));
+}
+
+//Plays Sound through a real audio_state at the bench rate, block by block the way the game would, at full volume in
+//the middle. Keeps the left channel, from SkipCount samples in, undoing the pan gain
+internal void
+RenderResampledVoice(memory_arena* Arena, loaded_sound* Sound, float Pitch, float* Dest, int SkipCount, int DestCount)
+{
+	temporary_memory RenderMemory = BeginTemporaryMemory(Arena);
+	audio_state Audio;
+	InitializeAudioState(&Audio, Arena, 1, 0, 0);
+	voice_id ID = PlaySound(&Audio, Sound, 1.0f, 0.0f, true);
+	SetVoicePitch(&Audio, ID, Pitch);
+
+	int OutputIndex = 0;
+	while (OutputIndex < SkipCount + DestCount)
+	{
+		temporary_memory MixMemory = BeginTemporaryMemory(Arena);
+		sound_bus Bus = BeginSoundBus(Arena, BENCH_SAMPLES_PER_BLOCK);
+		MixPlayingSounds(&Audio, &Bus, BENCH_SAMPLES_PER_SECOND);
+		for (int Index = 0; Index < Bus.SampleCount; Index++, OutputIndex++)
+		{
+			if ((OutputIndex >= SkipCount) && (OutputIndex < SkipCount + DestCount))
+			{
+				Dest[OutputIndex - SkipCount] = Bus.Left[Index] / Audio.FirstPlaying->LeftGain;
+			}
+		}
+		EndTemporaryMemory(MixMemory);
+	}
+	EndTemporaryMemory(RenderMemory);
+}
+
+//A looping sound of one cosine at Hz, or a linear sweep from 0 to the Nyquist rate and back when Hz is 0. The tones
+//are made long enough that the voice never gets round to the loop point, where they would not join up
+internal loaded_sound
+MakeBenchSound(memory_arena* Arena, uint32_t SamplesPerSecond, double Hz, uint32_t SampleCount)
+{
+	loaded_sound Result = {};
+	Result.SampleCount = SampleCount;
+	Result.SamplesPerSecond = SamplesPerSecond;
+	Result.Samples = PushArray(Arena, SampleCount, float, 32);
+	double Phase = 0.0;
+	for (uint32_t Index = 0; Index < SampleCount; Index++)
+	{
+		double SweepHz = 0.5*SamplesPerSecond*(1.0 - fabs(2.0*Index / SampleCount - 1.0));
+		Result.Samples[Index] = (float)(0.5*cos(Phase));
+		Phase = Hz ? 2.0*3.14159265358979*Hz*(Index + 1) / SamplesPerSecond : Phase + 2.0*3.14159265358979*SweepHz / SamplesPerSecond;
+	}
+	return(Result);
+}
+
+internal void
+BenchResampler(int BlockCount)
+{
+	uint64_t ArenaSize = Megabytes(64);
+	void* ArenaMemory = malloc(ArenaSize);
+	memory_arena Arena;
+	InitializeArena(&Arena, ArenaSize, ArenaMemory);
+	audio_state Audio;
+	InitializeAudioState(&Audio, &Arena, 1, 0, 0);
+
+	//Noise, and the kernels straight over it a chunk at a time, one filter after another
+	uint32_t NoiseCount = (uint32_t)(RESAMPLER_CHUNK*RESAMPLER_MAX_STEP) + RESAMPLER_MAX_TAPS + 8;
+	float* Noise = PushArray(&Arena, NoiseCount, float, 32);
+	float* Output = PushArray(&Arena, RESAMPLER_CHUNK, float, 32);
+	bench_random Random = {0x2E5A};
+	for (uint32_t Index = 0; Index < NoiseCount; Index++)
+	{
+		Noise[Index] = (float)((int)(NextRandom(&Random) % 2001) - 1000) / 1000.0f;
+	}
+
+	printf("resampler: %d taps over %d phases, %d chunks of %d samples per filter\n",
+		RESAMPLER_BASE_TAPS, RESAMPLER_PHASES, BlockCount, RESAMPLER_CHUNK);
+	cpu_features Features = DetectCPUFeatures();
+	cpu_features KernelFeatures[3] = {{}, {Features.SSE2, false}, {Features.SSE2, Features.AVX2}};
+	for (int FilterIndex = 0; FilterIndex < RESAMPLER_FILTER_COUNT; FilterIndex++)
+	{
+		resampler_filter* Filter = &Audio.Filters[FilterIndex];
+		uint64_t Step = (uint64_t)(Filter->MaxStep*0.97*(double)RESAMPLER_UNIT_STEP);
+		uint64_t ReferenceHash = 0;
+		for (int KernelIndex = 0; KernelIndex < ArrayCount(KernelFeatures); KernelIndex++)
+		{
+			InitAudioKernels(KernelFeatures[KernelIndex]);
+			if ((KernelIndex > 0) && (AudioKernels.ResampleSpan == ResampleSpanScalar))
+			{
+				continue;
+			}
+
+			uint64_t Hash = 0xCBF29CE484222325ULL;
+			double Start = GetBenchMilliseconds();
+			for (int ChunkIndex = 0; ChunkIndex < BlockCount; ChunkIndex++)
+			{
+				AudioKernels.ResampleSpan(Output, Noise, RESAMPLER_CHUNK, (uint64_t)ChunkIndex*0x9E3779B9ULL & 0xFFFFFFFF, Step, Filter);
+				Hash = HashSamples(Hash, (int16_t*)Output, 2*RESAMPLER_CHUNK);
+			}
+			double Milliseconds = GetBenchMilliseconds() - Start;
+			if (KernelIndex == 0)
+			{
+				ReferenceHash = Hash;
+			}
+
+			//One channel, so samples are channel-samples
+			printf("  step %.2f %3d taps  %-6s %8.1f M samples/s%s\n", (double)Step / RESAMPLER_UNIT_STEP, Filter->TapCount,
+				AudioKernels.Name, (double)BlockCount*RESAMPLER_CHUNK / Milliseconds / 1000.0,
+				BenchCheck(Hash == ReferenceHash) ? "" : "  OUTPUT DIFFERS FROM SCALAR");
+		}
+	}
+	InitAudioKernels(Features);
+
+	//Tones that land exactly on a bin of the output FFT, so everything off that bin is error: aliases, images, and
+	//the kernel's own noise. The first few thousand samples are skipped while the filter fills
+	int FFTSize = 1 << 16;
+	int SkipCount = 4096;
+	uint32_t MaxToneCount = (uint32_t)((SkipCount + FFTSize)*RESAMPLER_MAX_STEP) + RESAMPLER_MAX_TAPS;
+	double* Real = (double*)malloc(FFTSize*sizeof(double));
+	double* Imaginary = (double*)malloc(FFTSize*sizeof(double));
+	float* Wave = (float*)malloc(FFTSize*sizeof(float));
+	struct resample_case
+	{
+		char* Name;
+		uint32_t SamplesPerSecond;
+		float Pitch;
+	};
+	resample_case Cases[] = {
+		{"44.1kHz -> 48kHz", 44100, 1.0f},
+		{"22.05kHz -> 48kHz", 22050, 1.0f},
+		{"96kHz -> 48kHz", 96000, 1.0f},
+		{"48kHz, pitch 1.5", 48000, 1.5f},
+		{"48kHz, pitch 0.75", 48000, 0.75f},
+	};
+	double OutputNyquist = 0.5*BENCH_SAMPLES_PER_SECOND;
+	printf("  tones through a voice, everything off the tone relative to it (worst of tones up to 0.7 of the lower Nyquist rate):\n");
+	for (int CaseIndex = 0; CaseIndex < ArrayCount(Cases); CaseIndex++)
+	{
+		resample_case* Case = &Cases[CaseIndex];
+		double SourceNyquist = 0.5*Case->SamplesPerSecond*Case->Pitch;
+		double BandHz = 0.7*((SourceNyquist < OutputNyquist) ? SourceNyquist : OutputNyquist);
+		double WorstDecibels = -1000.0;
+		double WorstHz = 0.0;
+		for (int ToneIndex = 1; ToneIndex <= 8; ToneIndex++)
+		{
+			uint32_t ToneBin = (uint32_t)(BandHz*ToneIndex / 8.0 / BENCH_SAMPLES_PER_SECOND*FFTSize);
+			double OutputHz = (double)ToneBin*BENCH_SAMPLES_PER_SECOND / FFTSize;
+			temporary_memory ToneMemory = BeginTemporaryMemory(&Arena);
+			loaded_sound Sound = MakeBenchSound(&Arena, Case->SamplesPerSecond, OutputHz / Case->Pitch, MaxToneCount);
+			RenderResampledVoice(&Arena, &Sound, Case->Pitch, Wave, SkipCount, FFTSize);
+			EndTemporaryMemory(ToneMemory);
+
+			double Decibels = GetToneNoiseDecibels(Wave, FFTSize, ToneBin, Real, Imaginary);
+			if (Decibels > WorstDecibels)
+			{
+				WorstDecibels = Decibels;
+				WorstHz = OutputHz;
+			}
+		}
+		printf("    %-20s %7.1f dB at %.0fHz\n", Case->Name, WorstDecibels, WorstHz);
+	}
+
+	//Tones the output rate cannot hold should not come out at all, and a sweep should go quiet while it is above
+	//the output's Nyquist rate instead of folding back down
+	printf("  aliasing going down to 48kHz, what comes out relative to what went in:\n");
+	uint32_t AliasRates[] = {96000, 192000};
+	for (int RateIndex = 0; RateIndex < ArrayCount(AliasRates); RateIndex++)
+	{
+		uint32_t SourceRate = AliasRates[RateIndex];
+		double ToneHz[] = {0.6*OutputNyquist, 1.2*OutputNyquist, 1.5*OutputNyquist};
+		for (int ToneIndex = 0; ToneIndex < ArrayCount(ToneHz); ToneIndex++)
+		{
+			temporary_memory ToneMemory = BeginTemporaryMemory(&Arena);
+			loaded_sound Sound = MakeBenchSound(&Arena, SourceRate, ToneHz[ToneIndex], MaxToneCount);
+			RenderResampledVoice(&Arena, &Sound, 1.0f, Wave, SkipCount, FFTSize);
+			EndTemporaryMemory(ToneMemory);
+
+			double Power = 0.0;
+			for (int Index = 0; Index < FFTSize; Index++)
+			{
+				Power += (double)Wave[Index]*Wave[Index];
+			}
+			printf("    %6.0fHz tone at %6uHz  %7.1f dB\n", ToneHz[ToneIndex], SourceRate, 10.0*log10(Power / FFTSize / 0.125 + 1e-300));
+		}
+
+		//Sorted by where the sweep was when it made each output sample - the sweep goes up and back down over the sound
+		uint32_t SweepCount = SourceRate*2;
+		temporary_memory SweepMemory = BeginTemporaryMemory(&Arena);
+		loaded_sound Sweep = MakeBenchSound(&Arena, SourceRate, 0.0, SweepCount);
+		int SweepOutputCount = (int)((uint64_t)SweepCount*BENCH_SAMPLES_PER_SECOND / SourceRate);
+		float* SweepOutput = PushArray(&Arena, SweepOutputCount, float, 32);
+		RenderResampledVoice(&Arena, &Sweep, 1.0f, SweepOutput, 0, SweepOutputCount);
+		double InBand = 0.0;
+		double OutOfBand = 0.0;
+		int InBandCount = 0;
+		int OutOfBandCount = 0;
+		for (int Index = 0; Index < SweepOutputCount; Index++)
+		{
+			double SweepHz = 0.5*SourceRate*(1.0 - fabs(2.0*Index / SweepOutputCount - 1.0));
+			double Power = (double)SweepOutput[Index]*SweepOutput[Index];
+			if (SweepHz < 0.6*OutputNyquist)
+			{
+				InBand += Power;
+				++InBandCount;
+			}
+			else if (SweepHz > 1.1*OutputNyquist)
+			{
+				OutOfBand += Power;
+				++OutOfBandCount;
+			}
+		}
+		EndTemporaryMemory(SweepMemory);
+		printf("    sweep to %6uHz        %7.1f dB above %.0fHz against below %.0fHz\n", SourceRate / 2,
+			10.0*log10((OutOfBand / OutOfBandCount) / (InBand / InBandCount) + 1e-300), 1.1*OutputNyquist, 0.6*OutputNyquist);
+	}
+	CheckArena(&Arena);
+
+	free(Wave);
+	free(Imaginary);
+	free(Real);
+	free(ArenaMemory);
+}
+
+//
+// Render kernels - pixels per nanosecond through each row kernel, and their output against the scalar reference
+//
+
+#define BENCH_RENDER_ROW_PIXELS 1920
+
+//Every kernel set the CPU can run, scalar first; a set it lacks falls back to one already listed and is left out
+internal uint32_t
+GetBenchRenderKernels(render_kernels* Kernels)
+{
+	cpu_features Features = DetectCPUFeatures();
+	cpu_features KernelFeatures[3] = {{}, {Features.SSE2, false}, {Features.SSE2, Features.AVX2}};
+	uint32_t KernelCount = 0;
+	for (int KernelIndex = 0; KernelIndex < ArrayCount(KernelFeatures); KernelIndex++)
+	{
+		InitRenderKernels(KernelFeatures[KernelIndex]);
+		if (!KernelCount || (RenderKernels.FillRow != Kernels[KernelCount - 1].FillRow))
+		{
+			Kernels[KernelCount++] = RenderKernels;
+		}
+	}
+	return(KernelCount);
+}
+
+internal void
+BenchRenderKernels(uint64_t PixelCount)
+{
+	render_kernels Kernels[3];
+	uint32_t KernelCount = GetBenchRenderKernels(Kernels);
+
+	//Rows start one pixel past a 32-byte boundary, so every kernel has a misaligned head and a ragged tail to deal with
+	uint32_t* ReferenceMemory = (uint32_t*)malloc((BENCH_RENDER_ROW_PIXELS + 16)*sizeof(uint32_t));
+	uint32_t* RowMemory = (uint32_t*)malloc((BENCH_RENDER_ROW_PIXELS + 16)*sizeof(uint32_t));
+	uint32_t* Reference = (uint32_t*)(((uintptr_t)ReferenceMemory + 31) & ~(uintptr_t)31) + 1;
+	uint32_t* Row = (uint32_t*)(((uintptr_t)RowMemory + 31) & ~(uintptr_t)31) + 1;
+
+	int Widths[] = {5, 37, 256, BENCH_RENDER_ROW_PIXELS};
+	printf("render kernels: %llu pixels per run, rows starting one pixel past a 32-byte boundary\n", (unsigned long long)PixelCount);
+	for (int WidthIndex = 0; WidthIndex < ArrayCount(Widths); WidthIndex++)
+	{
+		int Width = Widths[WidthIndex];
+		uint64_t RowCount = PixelCount / Width;
+		for (uint32_t KernelIndex = 0; KernelIndex < KernelCount; KernelIndex++)
+		{
+			render_kernels* Kernel = Kernels + KernelIndex;
+
+			double Start = GetBenchMilliseconds();
+			for (uint64_t RowIndex = 0; RowIndex < RowCount; RowIndex++)
+			{
+				Kernel->FillRow(Row, Width, 0xFF000000 | (uint32_t)RowIndex);
+			}
+			double FillMilliseconds = GetBenchMilliseconds() - Start;
+
+			Start = GetBenchMilliseconds();
+			for (uint64_t RowIndex = 0; RowIndex < RowCount; RowIndex++)
+			{
+				Kernel->GradientRow(Row, Width, (uint32_t)RowIndex & 0xFF, (int)RowIndex);
+			}
+			double GradientMilliseconds = GetBenchMilliseconds() - Start;
+
+			//Bit for bit, including every pixel either side of the row the kernel was given
+			bool32 Identical = true;
+			for (int Pass = 0; Pass < 4; Pass++)
+			{
+				memset(ReferenceMemory, 0xAB, (BENCH_RENDER_ROW_PIXELS + 16)*sizeof(uint32_t));
+				memset(RowMemory, 0xAB, (BENCH_RENDER_ROW_PIXELS + 16)*sizeof(uint32_t));
+				if (Pass & 1)
+				{
+					FillRowScalar(Reference, Width, 0x12345678u*(Pass + 1));
+					Kernel->FillRow(Row, Width, 0x12345678u*(Pass + 1));
+				}
+				else
+				{
+					GradientRowScalar(Reference, Width, 0x5Au*Pass, 250 - Pass);
+					Kernel->GradientRow(Row, Width, 0x5Au*Pass, 250 - Pass);
+				}
+				Identical &= (memcmp(Reference - 1, Row - 1, (BENCH_RENDER_ROW_PIXELS + 8)*sizeof(uint32_t)) == 0);
+			}
+
+			printf("  %4d px rows  %-6s fill %6.2f px/ns  gradient %6.2f px/ns%s\n",
+				Width, Kernel->Name, RowCount*Width / (FillMilliseconds*1000000.0),
+				RowCount*Width / (GradientMilliseconds*1000000.0),
+				BenchCheck(Identical) ? "" : "  OUTPUT DIFFERS FROM SCALAR");
+		}
+	}
+
+	InitRenderKernels(DetectCPUFeatures());
+	free(ReferenceMemory);
+	free(RowMemory);
+}
+
+//Random starting pixels, lengths and colors, each run fenced by guard pixels that no kernel may touch
+internal void
+FuzzRenderKernels(uint32_t CaseCount)
+{
+	render_kernels Kernels[3];
+	uint32_t KernelCount = GetBenchRenderKernels(Kernels);
+
+	uint32_t PixelCount = 64 + 512 + 64;
+	uint32_t* ReferenceMemory = (uint32_t*)malloc((PixelCount + 8)*sizeof(uint32_t));
+	uint32_t* RowMemory = (uint32_t*)malloc((PixelCount + 8)*sizeof(uint32_t));
+	uint32_t* Reference = (uint32_t*)(((uintptr_t)ReferenceMemory + 31) & ~(uintptr_t)31);
+	uint32_t* Row = (uint32_t*)(((uintptr_t)RowMemory + 31) & ~(uintptr_t)31);
+
+	bench_random Random = {0x9E3779B9};
+	for (uint32_t KernelIndex = 1; KernelIndex < KernelCount; KernelIndex++)
+	{
+		render_kernels* Kernel = Kernels + KernelIndex;
+		uint32_t FailedCount = 0;
+		for (uint32_t CaseIndex = 0; CaseIndex < CaseCount; CaseIndex++)
+		{
+			//Every misalignment against both vector widths, and lengths from nothing to well past a block
+			int Start = 64 + (int)(NextRandom(&Random) % 16);
+			int Count = (int)(NextRandom(&Random) % ((CaseIndex & 1) ? 24 : 512 - 16));
+			uint32_t Guard = NextRandom(&Random);
+			for (uint32_t Index = 0; Index < PixelCount; Index++)
+			{
+				Reference[Index] = Row[Index] = Guard ^ Index;
+			}
+
+			if (CaseIndex & 2)
+			{
+				uint32_t Color = NextRandom(&Random);
+				FillRowScalar(Reference + Start, Count, Color);
+				Kernel->FillRow(Row + Start, Count, Color);
+			}
+			else
+			{
+				uint32_t R = NextRandom(&Random) & 0xFF;
+				int GStart = (int)(NextRandom(&Random) % 1024) - 512;
+				GradientRowScalar(Reference + Start, Count, R, GStart);
+				Kernel->GradientRow(Row + Start, Count, R, GStart);
+			}
+
+			if (memcmp(Reference, Row, PixelCount*sizeof(uint32_t)) != 0)
+			{
+				++FailedCount;
+			}
+		}
+		printf("  fuzz %-6s %u random rows against scalar, guard pixels either side: %s\n",
+			Kernel->Name, CaseCount, BenchCheck(!FailedCount) ? "ok" : "WRONG");
+	}
+
+	free(ReferenceMemory);
+	free(RowMemory);
+}
+
+//DrawRectangle at random spots on a 1920x1080 buffer, from a few pixels across up to the whole screen
+internal void
+BenchRectangleSizes(uint64_t PixelCount)
+{
+	render_kernels Kernels[3];
+	uint32_t KernelCount = GetBenchRenderKernels(Kernels);
+
+	game_offscreen_buffer Buffer = {};
+	Buffer.Width = 1920;
+	Buffer.Height = 1080;
+	Buffer.BytesPerPixel = 4;
+	Buffer.Pitch = Buffer.Width*Buffer.BytesPerPixel;
+	Buffer.Memory = malloc(Buffer.Height*Buffer.Pitch);
+	rectangle2i ClipRect = BufferBounds(&Buffer);
+
+	int Sizes[] = {4, 16, 64, 256, 1024, 0};
+	for (int SizeIndex = 0; SizeIndex < ArrayCount(Sizes); SizeIndex++)
+	{
+		int Width = Sizes[SizeIndex] ? Sizes[SizeIndex] : Buffer.Width;
+		int Height = Sizes[SizeIndex] ? Sizes[SizeIndex] : Buffer.Height;
+		if (Height > Buffer.Height)
+		{
+			Height = Buffer.Height;
+		}
+		uint64_t RectCount = PixelCount / ((uint64_t)Width*Height) + 1;
+
+		printf("  %4dx%-4d rects", Width, Height);
+		for (uint32_t KernelIndex = 0; KernelIndex < KernelCount; KernelIndex++)
+		{
+			RenderKernels = Kernels[KernelIndex];
+			bench_random Random = {0x2545F491};
+			double Start = GetBenchMilliseconds();
+			for (uint64_t RectIndex = 0; RectIndex < RectCount; RectIndex++)
+			{
+				int X = (int)(NextRandom(&Random) % (uint32_t)(Buffer.Width - Width + 1));
+				int Y = (int)(NextRandom(&Random) % (uint32_t)(Buffer.Height - Height + 1));
+				rectangle2i Rect = {X, Y, X + Width, Y + Height};
+				DrawRectangle(&Buffer, Rect, 0xFF000000 | (uint32_t)RectIndex, ClipRect);
+			}
+			double Milliseconds = GetBenchMilliseconds() - Start;
+			printf("  %-6s %6.2f px/ns", Kernels[KernelIndex].Name, RectCount*Width*Height / (Milliseconds*1000000.0));
+		}
+		printf("\n");
+	}
+
+	InitRenderKernels(DetectCPUFeatures());
+	free(Buffer.Memory);
+}
+
+//
+// Tiled rendering - one frame drawn on a queue of 1 to 16 threads has to match the single-threaded path exactly
+//
+
+//The platform layers' queue, plus a way to stop its threads so every thread count gets a fresh one
+struct platform_work_queue
+{
+	uint32_t volatile CompletionGoal;
+	uint32_t volatile CompletionCount;
+
+	uint32_t volatile NextEntryToWrite;
+	uint32_t volatile NextEntryToRead;
+	bool32 volatile IsQuitting;
+
+	uint32_t ThreadCount;
+#if defined(_WIN32)
+	HANDLE SemaphoreHandle;
+	HANDLE Threads[16];
+#else
+	sem_t Semaphore;
+	pthread_t Threads[16];
+#endif
+
+	platform_work_queue_callback* Callbacks[1024];
+	void* Data[1024];
+};
+
+inline void
+SignalBenchQueue(platform_work_queue* Queue)
+{
+#if defined(_WIN32)
+	ReleaseSemaphore(Queue->SemaphoreHandle, 1, 0);
+#else
+	sem_post(&Queue->Semaphore);
+#endif
+}
+
+internal
+PLATFORM_ADD_ENTRY(BenchAddEntry)
+{
+	uint32_t NewNextEntryToWrite = (Queue->NextEntryToWrite + 1) % ArrayCount(Queue->Callbacks);
+	Assert(NewNextEntryToWrite != Queue->NextEntryToRead);
+	Queue->Callbacks[Queue->NextEntryToWrite] = Callback;
+	Queue->Data[Queue->NextEntryToWrite] = Data;
+	AtomicAddUInt32(&Queue->CompletionGoal, 1);
+
+	//The entry has to be visible before the index that publishes it
+	CompletePreviousWritesBeforeFutureWrites;
+	Queue->NextEntryToWrite = NewNextEntryToWrite;
+	SignalBenchQueue(Queue);
+}
+
+//Returns true when the queue was empty and the caller can go to sleep
+internal bool32
+BenchDoNextWorkQueueEntry(platform_work_queue* Queue)
+{
+	bool32 ShouldSleep = false;
+
+	uint32_t OriginalNextEntryToRead = Queue->NextEntryToRead;
+	uint32_t NewNextEntryToRead = (OriginalNextEntryToRead + 1) % ArrayCount(Queue->Callbacks);
+	if (OriginalNextEntryToRead != Queue->NextEntryToWrite)
+	{
+		CompletePreviousReadsBeforeFutureReads;
+		if (AtomicCompareExchangeUInt32(&Queue->NextEntryToRead, NewNextEntryToRead, OriginalNextEntryToRead) == OriginalNextEntryToRead)
+		{
+			Queue->Callbacks[OriginalNextEntryToRead](Queue, Queue->Data[OriginalNextEntryToRead]);
+			AtomicAddUInt32(&Queue->CompletionCount, 1);
+		}
+	}
+	else
+	{
+		ShouldSleep = true;
+	}
+
+	return(ShouldSleep);
+}
+
+internal
+PLATFORM_COMPLETE_ALL_WORK(BenchCompleteAllWork)
+{
+	while (Queue->CompletionGoal != Queue->CompletionCount)
+	{
+		BenchDoNextWorkQueueEntry(Queue);
+	}
+
+	Queue->CompletionGoal = 0;
+	Queue->CompletionCount = 0;
+}
+
+#if defined(_WIN32)
+DWORD WINAPI
+BenchWorkerThreadProc(LPVOID Parameter)
+#else
+internal void*
+BenchWorkerThreadProc(void* Parameter)
+#endif
+{
+	platform_work_queue* Queue = (platform_work_queue*)Parameter;
+	while (!Queue->IsQuitting)
+	{
+		if (BenchDoNextWorkQueueEntry(Queue))
+		{
+#if defined(_WIN32)
+			WaitForSingleObjectEx(Queue->SemaphoreHandle, INFINITE, FALSE);
+#else
+			sem_wait(&Queue->Semaphore);
+#endif
+		}
+	}
+	return(0);
+}
+
+//WorkerCount threads besides the caller, which works the queue too while it waits in CompleteAllWork
+internal void
+MakeBenchQueue(platform_work_queue* Queue, uint32_t WorkerCount)
+{
+	Assert(WorkerCount <= ArrayCount(Queue->Threads));
+	Queue->CompletionGoal = 0;
+	Queue->CompletionCount = 0;
+	Queue->NextEntryToWrite = 0;
+	Queue->NextEntryToRead = 0;
+	Queue->IsQuitting = false;
+	Queue->ThreadCount = WorkerCount;
+#if defined(_WIN32)
+	Queue->SemaphoreHandle = CreateSemaphoreEx(0, 0, WorkerCount ? WorkerCount : 1, 0, 0, SEMAPHORE_ALL_ACCESS);
+#else
+	sem_init(&Queue->Semaphore, 0, 0);
+#endif
+
+	for (uint32_t ThreadIndex = 0; ThreadIndex < WorkerCount; ThreadIndex++)
+	{
+#if defined(_WIN32)
+		Queue->Threads[ThreadIndex] = CreateThread(0, 0, BenchWorkerThreadProc, Queue, 0, 0);
+#else
+		pthread_create(&Queue->Threads[ThreadIndex], 0, BenchWorkerThreadProc, Queue);
+#endif
+	}
+}
+
+//Every worker gets a wake-up after IsQuitting is set, so none can go back to sleep without seeing it
+internal void
+FreeBenchQueue(platform_work_queue* Queue)
+{
+	Queue->IsQuitting = true;
+	for (uint32_t ThreadIndex = 0; ThreadIndex < Queue->ThreadCount; ThreadIndex++)
+	{
+		SignalBenchQueue(Queue);
+	}
+	for (uint32_t ThreadIndex = 0; ThreadIndex < Queue->ThreadCount; ThreadIndex++)
+	{
+#if defined(_WIN32)
+		WaitForSingleObject(Queue->Threads[ThreadIndex], INFINITE);
+		CloseHandle(Queue->Threads[ThreadIndex]);
+#else
+		pthread_join(Queue->Threads[ThreadIndex], 0);
+#endif
+	}
+#if defined(_WIN32)
+	CloseHandle(Queue->SemaphoreHandle);
+#else
+	sem_destroy(&Queue->Semaphore);
+#endif
+}
+
+//Premultiplied, with alpha running 0 to 255 across it, so blending has something to do
+internal loaded_bitmap
+MakeBenchSprite()
+{
+	loaded_bitmap Sprite = {96, 96, 96*sizeof(uint32_t)};
+	Sprite.Memory = malloc(Sprite.Height*Sprite.Pitch);
+	for (int Y = 0; Y < Sprite.Height; Y++)
+	{
+		for (int X = 0; X < Sprite.Width; X++)
+		{
+			uint32_t Alpha = (uint32_t)(X*255 / (Sprite.Width - 1));
+			uint32_t Value = Alpha*(uint32_t)Y / (Sprite.Height - 1);
+			((uint32_t*)Sprite.Memory)[Y*Sprite.Width + X] = (Alpha << 24) | (Value << 16) | ((Alpha - Value) << 8) | (Value / 2);
+		}
+	}
+	return(Sprite);
+}
+
+//A frame shaped like the game's - background gradient, a crowd of rectangles, some alpha-blended sprites - that
+//moves every frame so no two frames hash the same
+internal void
+PushBenchScene(render_group* Group, loaded_bitmap* Sprite, int Width, int Height, uint32_t FrameIndex)
+{
+	bench_random Random = {0x2545F491};
+	PushGradient(Group, 0, (int)FrameIndex*3, (int)FrameIndex);
+	for (int RectIndex = 0; RectIndex < 256; RectIndex++)
+	{
+		int X = (int)(NextRandom(&Random) % (uint32_t)Width) - 32 + (int)(FrameIndex % 64);
+		int Y = (int)(NextRandom(&Random) % (uint32_t)Height) - 32;
+		int Size = 8 + (int)(NextRandom(&Random) % 120);
+		rectangle2i Rect = {X, Y, X + Size, Y + Size/2};
+		PushRect(Group, 1, Rect, 0xFF000000 | NextRandom(&Random));
+	}
+	for (int SpriteIndex = 0; SpriteIndex < 32; SpriteIndex++)
+	{
+		int X = (int)(NextRandom(&Random) % (uint32_t)Width) - Sprite->Width/2 - (int)(FrameIndex % 32);
+		int Y = (int)(NextRandom(&Random) % (uint32_t)Height) - Sprite->Height/2;
+		PushBitmap(Group, 2, Sprite, X, Y);
+	}
+}
+
+inline uint64_t
+HashBenchPixels(game_offscreen_buffer* Buffer)
+{
+	uint64_t Hash = 14695981039346656037ULL;
+	uint64_t* Words = (uint64_t*)Buffer->Memory;
+	for (int WordIndex = 0; WordIndex < Buffer->Height*Buffer->Pitch/8; WordIndex++)
+	{
+		Hash = (Hash ^ Words[WordIndex])*1099511628211ULL;
+	}
+	return(Hash);
+}
+
+//Every frame is a full repaint (the history is forgotten each time) so the timings are the worst case
+internal double
+RenderBenchFrames(game_memory* Memory, void* GroupMemory, uint32_t GroupMemorySize, loaded_bitmap* Sprite,
+	game_offscreen_buffer* Buffer, uint32_t FrameCount, uint64_t* FrameHashes, bool32 RecordHashes)
+{
+	render_frame_history* History = (render_frame_history*)malloc(sizeof(render_frame_history));
+	double Milliseconds = 0.0;
+	for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		History->IsValid = false;
+		double Start = GetBenchMilliseconds();
+		render_group* Group = AllocateRenderGroup(GroupMemory, GroupMemorySize);
+		PushBenchScene(Group, Sprite, Buffer->Width, Buffer->Height, FrameIndex);
+		TiledRenderGroupToOutput(Memory, Group, History, Buffer);
+		Milliseconds += GetBenchMilliseconds() - Start;
+
+		uint64_t Hash = HashBenchPixels(Buffer);
+		if (RecordHashes)
+		{
+			FrameHashes[FrameIndex] = Hash;
+		}
+		else if (Hash != FrameHashes[FrameIndex])
+		{
+			FrameHashes[FrameIndex] = 0;
+		}
+	}
+	free(History);
+	return(Milliseconds / FrameCount);
+}
+
+internal void
+BenchTiledRendering(uint64_t PixelCount)
+{
+	uint32_t GroupMemorySize = Megabytes(1);
+	void* GroupMemory = malloc(GroupMemorySize);
+
+	loaded_bitmap Sprite = MakeBenchSprite();
+
+	struct bench_resolution
+	{
+		int Width;
+		int Height;
+	};
+	bench_resolution Resolutions[] = {{640, 360}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+	uint32_t ThreadCounts[] = {1, 2, 4, 8, 16};
+
+	printf("tiled rendering: full repaints, ms per frame single-threaded and across N threads (caller included), "
+		"every frame checked against the single-threaded one\n");
+	for (int ResolutionIndex = 0; ResolutionIndex < ArrayCount(Resolutions); ResolutionIndex++)
+	{
+		game_offscreen_buffer Buffer = {};
+		Buffer.Width = Resolutions[ResolutionIndex].Width;
+		Buffer.Height = Resolutions[ResolutionIndex].Height;
+		Buffer.BytesPerPixel = 4;
+		Buffer.Pitch = Buffer.Width*Buffer.BytesPerPixel;
+		Buffer.Memory = malloc(Buffer.Height*Buffer.Pitch);
+
+		uint32_t FrameCount = (uint32_t)(PixelCount / ((uint64_t)Buffer.Width*Buffer.Height));
+		if (FrameCount < 4)
+		{
+			FrameCount = 4;
+		}
+		uint64_t* FrameHashes = (uint64_t*)malloc(FrameCount*sizeof(uint64_t));
+
+		game_memory Memory = {};
+		double SingleMilliseconds = RenderBenchFrames(&Memory, GroupMemory, GroupMemorySize, &Sprite, &Buffer,
+			FrameCount, FrameHashes, true);
+		printf("  %4dx%-4d %4u frames  single %7.3f", Buffer.Width, Buffer.Height, FrameCount, SingleMilliseconds);
+
+		platform_work_queue* Queue = (platform_work_queue*)malloc(sizeof(platform_work_queue));
+		Memory.RenderQueue = Queue;
+		Memory.PlatformAddEntry = BenchAddEntry;
+		Memory.PlatformCompleteAllWork = BenchCompleteAllWork;
+		bool32 Identical = true;
+		for (int ThreadCountIndex = 0; ThreadCountIndex < ArrayCount(ThreadCounts); ThreadCountIndex++)
+		{
+			MakeBenchQueue(Queue, ThreadCounts[ThreadCountIndex] - 1);
+			memset(Buffer.Memory, 0, Buffer.Height*Buffer.Pitch);
+			double Milliseconds = RenderBenchFrames(&Memory, GroupMemory, GroupMemorySize, &Sprite, &Buffer,
+				FrameCount, FrameHashes, false);
+			FreeBenchQueue(Queue);
+			printf("  %2u: %7.3f", ThreadCounts[ThreadCountIndex], Milliseconds);
+		}
+		for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+		{
+			Identical &= (FrameHashes[FrameIndex] != 0);
+		}
+		printf("%s\n", BenchCheck(Identical) ? "" : "  TILED OUTPUT DIFFERS");
+
+		free(Queue);
+		free(FrameHashes);
+		free(Buffer.Memory);
+	}
+
+	free(Sprite.Memory);
+	free(GroupMemory);
+}
+
+//
+// Damage tracking - what reaches the screen through the dirty rects has to match a full repaint, restores included
+//
+
+//Stands in for the window: PresentDirtyRegions copies rects from the backbuffer into Pixels
+struct bench_screen
+{
+	game_offscreen_buffer* Backbuffer;
+	uint32_t* Pixels;
+};
+
+internal
+PRESENT_RECT(BenchPresentRect)
+{
+	bench_screen* Screen = (bench_screen*)Context;
+	game_offscreen_buffer* Backbuffer = Screen->Backbuffer;
+	for (int Y = Rect.MinY; Y < Rect.MaxY; Y++)
+	{
+		memcpy(Screen->Pixels + Y*Backbuffer->Width + Rect.MinX, PixelAt(Backbuffer, Rect.MinX, Y),
+			(Rect.MaxX - Rect.MinX)*sizeof(uint32_t));
+	}
+}
+
+//Mostly still, like the game's frames: a fixed backdrop, with a few rectangles and a sprite moving as the state advances
+internal void
+PushDamageScene(render_group* Group, loaded_bitmap* Sprite, int Width, int Height, uint32_t StateFrame)
+{
+	bench_random Random = {0x51ED2701};
+	PushGradient(Group, 0, 0, 0);
+	for (int RectIndex = 0; RectIndex < 16; RectIndex++)
+	{
+		int X = (int)(NextRandom(&Random) % (uint32_t)Width);
+		int Y = (int)(NextRandom(&Random) % (uint32_t)Height);
+		rectangle2i Rect = {X, Y, X + 40, Y + 24};
+		PushRect(Group, 1, Rect, 0xFF000000 | NextRandom(&Random));
+	}
+	for (int MoverIndex = 0; MoverIndex < 4; MoverIndex++)
+	{
+		int X = (int)((StateFrame*(MoverIndex + 1)*3) % (uint32_t)Width) - 16;
+		int Y = (MoverIndex + 1)*Height / 6;
+		rectangle2i Rect = {X, Y, X + 32, Y + 32};
+		PushRect(Group, 2, Rect, 0xFFFF0000 >> (MoverIndex*4));
+	}
+	PushBitmap(Group, 3, Sprite, (int)((StateFrame*5) % (uint32_t)Width) - Sprite->Width/2, Height / 3);
+}
+
+/*
+	Plays the game's side of a run: the history sits in "transient storage", which a snapshot copies and a
+	restore puts back, while the backbuffer and the screen carry on. Every frame the screen is compared against a
+	full repaint of the same state. Returns the number of frames where the screen was wrong.
+*/
+internal uint32_t
+RunDamageTracking(uint32_t FrameCount, bool32 RequestRepaintOnRestore, platform_work_queue* Queue)
+{
+	int Width = 640;
+	int Height = 360;
+	uint32_t GroupMemorySize = Megabytes(1);
+	void* GroupMemory = malloc(GroupMemorySize);
+	loaded_bitmap Sprite = MakeBenchSprite();
+
+	game_offscreen_buffer Buffers[2] = {};
+	for (int BufferIndex = 0; BufferIndex < ArrayCount(Buffers); BufferIndex++)
+	{
+		Buffers[BufferIndex].Width = Width;
+		Buffers[BufferIndex].Height = Height;
+		Buffers[BufferIndex].BytesPerPixel = 4;
+		Buffers[BufferIndex].Pitch = Width*4;
+		Buffers[BufferIndex].Memory = calloc(Width*Height, sizeof(uint32_t));
+	}
+	game_offscreen_buffer* Backbuffer = &Buffers[0];
+	game_offscreen_buffer* Reference = &Buffers[1];
+	bench_screen Screen = {Backbuffer, (uint32_t*)calloc(Width*Height, sizeof(uint32_t))};
+
+	//Tiled, so untouched tiles really are left alone; the reference always draws everything
+	game_memory Memory = {};
+	Memory.RenderQueue = Queue;
+	Memory.PlatformAddEntry = BenchAddEntry;
+	Memory.PlatformCompleteAllWork = BenchCompleteAllWork;
+	game_memory ReferenceMemory = {};
+
+	render_frame_history* History = (render_frame_history*)calloc(1, sizeof(render_frame_history));
+	render_frame_history* SnapshotHistory = (render_frame_history*)calloc(1, sizeof(render_frame_history));
+	render_frame_history* ReferenceHistory = (render_frame_history*)calloc(1, sizeof(render_frame_history));
+	uint32_t SnapshotState = 0;
+
+	uint32_t StateFrame = 0;
+	uint32_t WrongFrameCount = 0;
+	for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		//Snapshot at the start of a frame, back to it thirty frames on - what looping playback or a seek does
+		bool32 Restored = false;
+		if ((FrameIndex % 60) == 10)
+		{
+			*SnapshotHistory = *History;
+			SnapshotState = StateFrame;
+		}
+		else if ((FrameIndex % 60) == 40)
+		{
+			*History = *SnapshotHistory;
+			StateFrame = SnapshotState;
+			Restored = true;
+		}
+
+		Backbuffer->Dirty = {};
+		Backbuffer->Dirty.FullFrame = (FrameIndex == 0) || (Restored && RequestRepaintOnRestore);
+		render_group* Group = AllocateRenderGroup(GroupMemory, GroupMemorySize);
+		PushDamageScene(Group, &Sprite, Width, Height, StateFrame);
+		TiledRenderGroupToOutput(&Memory, Group, History, Backbuffer);
+		PresentDirtyRegions(&Backbuffer->Dirty, Width, Height, 4, 0.5f, BenchPresentRect, &Screen);
+
+		ReferenceHistory->IsValid = false;
+		Group = AllocateRenderGroup(GroupMemory, GroupMemorySize);
+		PushDamageScene(Group, &Sprite, Width, Height, StateFrame);
+		TiledRenderGroupToOutput(&ReferenceMemory, Group, ReferenceHistory, Reference);
+		if (memcmp(Screen.Pixels, Reference->Memory, Width*Height*sizeof(uint32_t)) != 0)
+		{
+			++WrongFrameCount;
+		}
+
+		++StateFrame;
+	}
+
+	free(ReferenceHistory);
+	free(SnapshotHistory);
+	free(History);
+	free(Screen.Pixels);
+	free(Buffers[0].Memory);
+	free(Buffers[1].Memory);
+	free(Sprite.Memory);
+	free(GroupMemory);
+	return(WrongFrameCount);
+}
+
+internal void
+BenchDamageTracking(uint32_t FrameCount)
+{
+	platform_work_queue* Queue = (platform_work_queue*)malloc(sizeof(platform_work_queue));
+	MakeBenchQueue(Queue, 0);
+
+	//Restores land on frame 40 of every 60, so a short run has to be stretched to see at least a couple of them
+	FrameCount = (FrameCount < 120) ? 120 : FrameCount;
+	uint32_t WrongFrames = RunDamageTracking(FrameCount, true, Queue);
+	uint32_t WrongFramesUnrequested = RunDamageTracking(FrameCount, false, Queue);
+	printf("damage tracking: %u frames presented through dirty rects, history restored every 60\n", FrameCount);
+	printf("  repaint asked for after a restore  %u frames wrong on screen%s\n", WrongFrames,
+		BenchCheck(!WrongFrames) ? "" : "  STALE PIXELS PRESENTED");
+	printf("  repaint not asked for              %u frames wrong on screen%s\n", WrongFramesUnrequested,
+		BenchCheck(WrongFramesUnrequested > 0) ? "" : "  - WRONG, the restores should show up without the request");
+
+	FreeBenchQueue(Queue);
+	free(Queue);
+}
+
+//
+// PNG decode - unfilter kernels against scalar, and whole-file decode speed on l_fern.png and large synthetic images
+//
+
+//Synthetic images go through a small encoder of our own: per-row filter picked the way libpng does, then one
+//fixed-Huffman deflate block with greedy LZ77 matches - enough that inflate has real codes and matches to chew on
+struct bench_bit_writer
+{
+	uint8_t* At;
+	uint64_t Bits;
+	uint32_t BitCount;
+};
+
+inline void
+WriteBenchBits(bench_bit_writer* Writer, uint32_t Value, uint32_t Count)
+{
+	Writer->Bits |= (uint64_t)Value << Writer->BitCount;
+	Writer->BitCount += Count;
+	while (Writer->BitCount >= 8)
+	{
+		*Writer->At++ = (uint8_t)Writer->Bits;
+		Writer->Bits >>= 8;
+		Writer->BitCount -= 8;
+	}
+}
+
+//Huffman codes go out most significant bit first
+inline void
+WriteBenchCode(bench_bit_writer* Writer, uint32_t Code, uint32_t Length)
+{
+	uint32_t Reversed = 0;
+	for (uint32_t Bit = 0; Bit < Length; Bit++)
+	{
+		Reversed |= ((Code >> Bit) & 1) << (Length - 1 - Bit);
+	}
+	WriteBenchBits(Writer, Reversed, Length);
+}
+
+inline void
+WriteFixedLiteralLength(bench_bit_writer* Writer, uint32_t Symbol)
+{
+	if (Symbol < 144)
+	{
+		WriteBenchCode(Writer, 0x30 + Symbol, 8);
+	}
+	else if (Symbol < 256)
+	{
+		WriteBenchCode(Writer, 0x190 + Symbol - 144, 9);
+	}
+	else if (Symbol < 280)
+	{
+		WriteBenchCode(Writer, Symbol - 256, 7);
+	}
+	else
+	{
+		WriteBenchCode(Writer, 0xC0 + Symbol - 280, 8);
+	}
+}
+
+global_variable uint16_t BenchLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+	67, 83, 99, 115, 131, 163, 195, 227, 258};
+global_variable uint8_t BenchLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+global_variable uint16_t BenchDistanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+	1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+global_variable uint8_t BenchDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+	11, 11, 12, 12, 13, 13};
+
+//A zlib stream holding one fixed-Huffman block; Dest needs Size + Size/8 + 64 bytes at worst. Returns the bytes written
+internal uint32_t
+BenchZlibCompress(uint8_t* Source, uint32_t Size, uint8_t* Dest, int32_t* HashHeads)
+{
+	uint32_t const HashCount = 1 << 15;
+	for (uint32_t Index = 0; Index < HashCount; Index++)
+	{
+		HashHeads[Index] = -1;
+	}
+
+	bench_bit_writer Writer = {Dest};
+	WriteBenchBits(&Writer, 0x78, 8);
+	WriteBenchBits(&Writer, 0x01, 8);
+	WriteBenchBits(&Writer, 1, 1);
+	WriteBenchBits(&Writer, 1, 2);
+
+	uint32_t At = 0;
+	while (At < Size)
+	{
+		uint32_t MatchLength = 0;
+		uint32_t MatchDistance = 0;
+		if (At + 3 <= Size)
+		{
+			uint32_t Hash = ((Source[At] << 16) ^ (Source[At + 1] << 8) ^ Source[At + 2])*2654435761u >> 17;
+			int32_t Candidate = HashHeads[Hash];
+			HashHeads[Hash] = (int32_t)At;
+			if ((Candidate >= 0) && (At - (uint32_t)Candidate <= 32768))
+			{
+				uint32_t MaxLength = (Size - At < 258) ? Size - At : 258;
+				while ((MatchLength < MaxLength) && (Source[Candidate + MatchLength] == Source[At + MatchLength]))
+				{
+					++MatchLength;
+				}
+				MatchDistance = At - (uint32_t)Candidate;
+			}
+		}
+
+		if (MatchLength >= 3)
+		{
+			uint32_t LengthCode = 28;
+			while (BenchLengthBase[LengthCode] > MatchLength)
+			{
+				--LengthCode;
+			}
+			WriteFixedLiteralLength(&Writer, 257 + LengthCode);
+			WriteBenchBits(&Writer, MatchLength - BenchLengthBase[LengthCode], BenchLengthExtra[LengthCode]);
+
+			uint32_t DistanceCode = 29;
+			while (BenchDistanceBase[DistanceCode] > MatchDistance)
+			{
+				--DistanceCode;
+			}
+			WriteBenchCode(&Writer, DistanceCode, 5);
+			WriteBenchBits(&Writer, MatchDistance - BenchDistanceBase[DistanceCode], BenchDistanceExtra[DistanceCode]);
+			At += MatchLength;
+		}
+		else
+		{
+			WriteFixedLiteralLength(&Writer, Source[At++]);
+		}
+	}
+	WriteFixedLiteralLength(&Writer, 256);
+	WriteBenchBits(&Writer, 0, 7);
+
+	uint32_t A = 1;
+	uint32_t B = 0;
+	for (uint32_t Index = 0; Index < Size; Index++)
+	{
+		A = (A + Source[Index]) % 65521;
+		B = (B + A) % 65521;
+	}
+	uint32_t Adler = (B << 16) | A;
+	for (int Shift = 24; Shift >= 0; Shift -= 8)
+	{
+		*Writer.At++ = (uint8_t)(Adler >> Shift);
+	}
+	return((uint32_t)(Writer.At - Dest));
+}
+
+inline uint8_t*
+WriteBenchBigEndian32(uint8_t* At, uint32_t Value)
+{
+	At[0] = (uint8_t)(Value >> 24);
+	At[1] = (uint8_t)(Value >> 16);
+	At[2] = (uint8_t)(Value >> 8);
+	At[3] = (uint8_t)Value;
+	return(At + 4);
+}
+
+//Length, type, data and CRC - the decoder skips CRCs, but the files come out valid anyway
+internal uint8_t*
+WriteBenchPNGChunk(uint8_t* At, uint32_t Type, uint8_t* Data, uint32_t Length)
+{
+	At = WriteBenchBigEndian32(At, Length);
+	uint8_t* TypeAt = At;
+	At = WriteBenchBigEndian32(At, Type);
+	memmove(At, Data, Length);
+	At += Length;
+
+	uint32_t CRC = 0xFFFFFFFF;
+	for (uint8_t* Byte = TypeAt; Byte < At; Byte++)
+	{
+		CRC ^= *Byte;
+		for (int Bit = 0; Bit < 8; Bit++)
+		{
+			CRC = (CRC >> 1) ^ (0xEDB88320 & (0 - (CRC & 1)));
+		}
+	}
+	return(WriteBenchBigEndian32(At, ~CRC));
+}
+
+//The filter with the smallest sum of bytes taken as signed - libpng's default heuristic
+internal void
+FilterBenchRow(uint8_t* Dest, uint8_t* Row, uint8_t* Prior, uint32_t RowBytes, uint32_t BytesPerPixel)
+{
+	uint32_t BestSum = 0xFFFFFFFF;
+	for (uint32_t Filter = PNGFilter_None; Filter <= PNGFilter_Paeth; Filter++)
+	{
+		uint8_t* Out = Dest + RowBytes + 1;
+		uint32_t Sum = 0;
+		for (uint32_t Index = 0; Index < RowBytes; Index++)
+		{
+			int32_t A = (Index >= BytesPerPixel) ? Row[Index - BytesPerPixel] : 0;
+			int32_t B = Prior[Index];
+			int32_t C = (Index >= BytesPerPixel) ? Prior[Index - BytesPerPixel] : 0;
+			int32_t Predicted = 0;
+			switch (Filter)
+			{
+				case PNGFilter_Sub: {Predicted = A;}break;
+				case PNGFilter_Up: {Predicted = B;}break;
+				case PNGFilter_Average: {Predicted = (A + B) >> 1;}break;
+				case PNGFilter_Paeth: {Predicted = PaethPredictor(A, B, C);}break;
+			}
+			Out[Index] = (uint8_t)(Row[Index] - Predicted);
+			Sum += (Out[Index] < 128) ? Out[Index] : 256 - Out[Index];
+		}
+		if (Sum < BestSum)
+		{
+			BestSum = Sum;
+			Dest[0] = (uint8_t)Filter;
+			memcpy(Dest + 1, Out, RowBytes);
+		}
+	}
+}
+
+//Channel values that are smooth with a little noise, so filtering and matching both find something
+inline uint32_t
+GetBenchImageSample(uint32_t X, uint32_t Y, uint32_t Channel, uint32_t BitDepth, bench_random* Random)
+{
+	uint32_t Value = (X*(Channel + 1)*9 + Y*(3 - Channel)*13 + ((X*Y) >> 8)) & 0xFFFF;
+	if ((NextRandom(Random) & 15) == 0)
+	{
+		Value ^= NextRandom(Random) & 0x0303;
+	}
+	return((BitDepth == 16) ? Value : (Value >> 4) & 0xFF);
+}
+
+struct bench_png
+{
+	uint8_t* File;
+	uint32_t FileSize;
+
+	//What DecodePNG should turn it into
+	uint32_t* Expected;
+};
+
+internal bench_png
+MakeBenchPNG(uint32_t Width, uint32_t Height, png_color_type ColorType, uint32_t BitDepth)
+{
+	uint32_t Channels = (ColorType == PNGColorType_RGBA) ? 4 : (ColorType == PNGColorType_RGB) ? 3 :
+		(ColorType == PNGColorType_GrayAlpha) ? 2 : 1;
+	uint32_t BytesPerPixel = Channels*BitDepth / 8;
+	uint32_t RowBytes = Width*BytesPerPixel;
+	uint32_t FilteredSize = Height*(RowBytes + 1);
+
+	uint8_t* Raw = (uint8_t*)malloc((uint64_t)Height*RowBytes);
+	uint8_t* Filtered = (uint8_t*)malloc(FilteredSize + RowBytes);
+	uint8_t* ZeroRow = (uint8_t*)calloc(RowBytes, 1);
+	int32_t* HashHeads = (int32_t*)malloc((1 << 15)*sizeof(int32_t));
+
+	bench_png Result = {};
+	Result.Expected = (uint32_t*)malloc((uint64_t)Width*Height*sizeof(uint32_t));
+	bench_random Random = {0xB5297A4D};
+	for (uint32_t Y = 0; Y < Height; Y++)
+	{
+		uint8_t* Row = Raw + (uint64_t)Y*RowBytes;
+		for (uint32_t X = 0; X < Width; X++)
+		{
+			uint32_t Sample8[4];
+			for (uint32_t Channel = 0; Channel < Channels; Channel++)
+			{
+				uint32_t Sample = GetBenchImageSample(X, Y, Channel, BitDepth, &Random);
+				if (BitDepth == 16)
+				{
+					Row[(X*Channels + Channel)*2] = (uint8_t)(Sample >> 8);
+					Row[(X*Channels + Channel)*2 + 1] = (uint8_t)Sample;
+				}
+				else
+				{
+					Row[X*Channels + Channel] = (uint8_t)Sample;
+				}
+				Sample8[Channel] = ScaleSample(Sample, BitDepth);
+			}
+
+			uint32_t Alpha = (Channels == 4) ? Sample8[3] : (Channels == 2) ? Sample8[1] : 255;
+			Result.Expected[(uint64_t)Y*Width + X] = (Channels >= 3) ? Premultiply(Sample8[0], Sample8[1], Sample8[2], Alpha) :
+				Premultiply(Sample8[0], Sample8[0], Sample8[0], Alpha);
+		}
+		FilterBenchRow(Filtered + (uint64_t)Y*(RowBytes + 1), Row, Y ? Row - RowBytes : ZeroRow, RowBytes, BytesPerPixel);
+	}
+
+	Result.File = (uint8_t*)malloc(FilteredSize + FilteredSize/8 + 1024);
+	uint8_t* Compressed = (uint8_t*)malloc(FilteredSize + FilteredSize/8 + 64);
+	uint32_t CompressedSize = BenchZlibCompress(Filtered, FilteredSize, Compressed, HashHeads);
+
+	uint8_t Header[13];
+	WriteBenchBigEndian32(Header, Width);
+	WriteBenchBigEndian32(Header + 4, Height);
+	Header[8] = (uint8_t)BitDepth;
+	Header[9] = (uint8_t)ColorType;
+	Header[10] = Header[11] = Header[12] = 0;
+
+	uint8_t* At = Result.File;
+	memcpy(At, PNGSignature, sizeof(PNGSignature));
+	At += sizeof(PNGSignature);
+	At = WriteBenchPNGChunk(At, PNG_CHUNK_TYPE('I', 'H', 'D', 'R'), Header, sizeof(Header));
+	At = WriteBenchPNGChunk(At, PNG_CHUNK_TYPE('I', 'D', 'A', 'T'), Compressed, CompressedSize);
+	At = WriteBenchPNGChunk(At, PNG_CHUNK_TYPE('I', 'E', 'N', 'D'), 0, 0);
+	Result.FileSize = (uint32_t)(At - Result.File);
+
+	free(Compressed);
+	free(HashHeads);
+	free(ZeroRow);
+	free(Filtered);
+	free(Raw);
+	return(Result);
+}
+
+//Decodes File RepeatCount times; returns the best time, since the first pass pays for faulting the memory in
+internal double
+TimeBenchDecode(uint8_t* File, uint32_t FileSize, uint32_t RepeatCount, png_decode_result* Decoded, void** DecodeMemory)
+{
+	png_info Info = GetPNGInfo(File, FileSize);
+	*DecodeMemory = Info.IsValid ? malloc(Info.MemoryRequired) : 0;
+	double Best = 0.0;
+	*Decoded = {};
+	for (uint32_t Repeat = 0; *DecodeMemory && (Repeat < RepeatCount); Repeat++)
+	{
+		double Start = GetBenchMilliseconds();
+		*Decoded = DecodePNG(File, FileSize, *DecodeMemory, Info.MemoryRequired);
+		double Milliseconds = GetBenchMilliseconds() - Start;
+		Best = (!Repeat || (Milliseconds < Best)) ? Milliseconds : Best;
+	}
+	return(Best);
+}
+
+internal debug_read_file_result
+ReadBenchFile(char* Path)
+{
+	debug_read_file_result Result = {};
+	FILE* File = fopen(Path, "rb");
+	if (File)
+	{
+		fseek(File, 0, SEEK_END);
+		Result.ContentSize = (uint32_t)ftell(File);
+		fseek(File, 0, SEEK_SET);
+		Result.Contents = malloc(Result.ContentSize);
+		if (fread(Result.Contents, 1, Result.ContentSize, File) != Result.ContentSize)
+		{
+			free(Result.Contents);
+			Result.Contents = 0;
+		}
+		fclose(File);
+	}
+	return(Result);
+}
+
+//Looks next to the bench and one directory up, which covers running it from the build directory or beside it
+internal char*
+FindBenchFern()
+{
+	char* Result = 0;
+	char* FernPaths[] = {"l_fern.png", "../l_fern.png"};
+	for (int PathIndex = 0; !Result && (PathIndex < ArrayCount(FernPaths)); PathIndex++)
+	{
+		FILE* File = fopen(FernPaths[PathIndex], "rb");
+		if (File)
+		{
+			Result = FernPaths[PathIndex];
+			fclose(File);
+		}
+	}
+	return(Result);
+}
+
+internal debug_read_file_result
+ReadBenchFern()
+{
+	char* Path = FindBenchFern();
+	debug_read_file_result Result = {};
+	if (Path)
+	{
+		Result = ReadBenchFile(Path);
+	}
+	return(Result);
+}
+
+internal void
+BenchPNGDecode(uint32_t RepeatCount)
+{
+	//Every pixel size the decoder meets, every filter, random row lengths - SSE2 has to land on scalar's bytes exactly
+	uint32_t PixelSizes[] = {1, 2, 3, 4, 6, 8};
+	uint32_t const MaxRowBytes = 8*2048;
+	uint8_t* Prior = (uint8_t*)malloc(MaxRowBytes);
+	uint8_t* Reference = (uint8_t*)malloc(MaxRowBytes);
+	uint8_t* Row = (uint8_t*)malloc(MaxRowBytes);
+	bench_random Random = {0x6A09E667};
+	printf("png unfilter: MB/s of row, scalar against SSE2, on 2048-pixel rows\n");
+	for (int SizeIndex = 0; SizeIndex < ArrayCount(PixelSizes); SizeIndex++)
+	{
+		uint32_t BytesPerPixel = PixelSizes[SizeIndex];
+		uint32_t FailedCount = 0;
+		for (uint32_t CaseIndex = 0; CaseIndex < 500; CaseIndex++)
+		{
+			uint32_t RowBytes = BytesPerPixel*(1 + NextRandom(&Random) % 300);
+			uint32_t Filter = CaseIndex % 5;
+			for (uint32_t Index = 0; Index < RowBytes; Index++)
+			{
+				Prior[Index] = (uint8_t)NextRandom(&Random);
+				Reference[Index] = Row[Index] = (uint8_t)NextRandom(&Random);
+			}
+			UnfilterRowScalar(Filter, Reference, Prior, RowBytes, BytesPerPixel);
+			UnfilterRowSSE2(Filter, Row, Prior, RowBytes, BytesPerPixel);
+			FailedCount += (memcmp(Reference, Row, RowBytes) != 0) ? 1 : 0;
+		}
+
+		printf("  %u B/px", BytesPerPixel);
+		uint32_t RowBytes = 2048*BytesPerPixel;
+		for (uint32_t Filter = PNGFilter_Sub; Filter <= PNGFilter_Paeth; Filter++)
+		{
+			double Milliseconds[2];
+			for (int Kernel = 0; Kernel < 2; Kernel++)
+			{
+				double Start = GetBenchMilliseconds();
+				for (uint32_t Repeat = 0; Repeat < RepeatCount*50; Repeat++)
+				{
+					if (Kernel)
+					{
+						UnfilterRowSSE2(Filter, Row, Prior, RowBytes, BytesPerPixel);
+					}
+					else
+					{
+						UnfilterRowScalar(Filter, Row, Prior, RowBytes, BytesPerPixel);
+					}
+				}
+				Milliseconds[Kernel] = GetBenchMilliseconds() - Start;
+			}
+			char* FilterNames[] = {"None", "Sub", "Up", "Average", "Paeth"};
+			double Megabytes = (double)RowBytes*RepeatCount*50 / (1024.0*1024.0);
+			printf("  %-7s %5.0f %5.0f", FilterNames[Filter], Megabytes / (Milliseconds[0] / 1000.0), Megabytes / (Milliseconds[1] / 1000.0));
+		}
+		printf("%s\n", BenchCheck(!FailedCount) ? "" : "  SSE2 DIFFERS FROM SCALAR");
+	}
+	free(Row);
+	free(Reference);
+	free(Prior);
+
+	//MB/s counts decoded pixels (4 bytes each) so files of different formats compare
+	printf("png decode: best of %u, MB/s of decoded 32-bit pixels\n", RepeatCount);
+	debug_read_file_result Fern = ReadBenchFern();
+	if (Fern.Contents)
+	{
+		png_decode_result Decoded;
+		void* DecodeMemory;
+		double Milliseconds = TimeBenchDecode((uint8_t*)Fern.Contents, Fern.ContentSize, RepeatCount*20, &Decoded, &DecodeMemory);
+		printf("  l_fern.png         %4dx%-4d %7.1f KB file  %7.3f ms  %7.1f MB/s%s\n", Decoded.Bitmap.Width, Decoded.Bitmap.Height,
+			Fern.ContentSize / 1024.0, Milliseconds, Decoded.BitmapSize / (1024.0*1024.0) / (Milliseconds / 1000.0),
+			BenchCheck(Decoded.Success) ? "" : "  FAILED TO DECODE");
+		free(DecodeMemory);
+		free(Fern.Contents);
+	}
+	else
+	{
+		printf("  l_fern.png not found next to the bench or one directory up - skipped\n");
+	}
+
+	struct bench_png_format
+	{
+		char* Name;
+		uint32_t Width;
+		uint32_t Height;
+		png_color_type ColorType;
+		uint32_t BitDepth;
+	};
+	bench_png_format Formats[] =
+	{
+		{"RGBA 8-bit", 2048, 2048, PNGColorType_RGBA, 8},
+		{"RGB 8-bit", 2048, 2048, PNGColorType_RGB, 8},
+		{"gray 8-bit", 2048, 2048, PNGColorType_Gray, 8},
+		{"gray+alpha 8-bit", 2048, 2048, PNGColorType_GrayAlpha, 8},
+		{"RGBA 16-bit", 1024, 1024, PNGColorType_RGBA, 16},
+		{"RGB 16-bit", 1024, 1024, PNGColorType_RGB, 16},
+	};
+	for (int FormatIndex = 0; FormatIndex < ArrayCount(Formats); FormatIndex++)
+	{
+		bench_png_format* Format = Formats + FormatIndex;
+		bench_png PNG = MakeBenchPNG(Format->Width, Format->Height, Format->ColorType, Format->BitDepth);
+
+		png_decode_result Decoded;
+		void* DecodeMemory;
+		double Milliseconds = TimeBenchDecode(PNG.File, PNG.FileSize, RepeatCount, &Decoded, &DecodeMemory);
+		bool32 IsRight = Decoded.Success &&
+			(memcmp(Decoded.Bitmap.Memory, PNG.Expected, (uint64_t)Format->Width*Format->Height*sizeof(uint32_t)) == 0);
+		printf("  %-18s %4ux%-4u %7.1f KB file  %7.3f ms  %7.1f MB/s%s\n", Format->Name, Format->Width, Format->Height,
+			PNG.FileSize / 1024.0, Milliseconds, Decoded.BitmapSize / (1024.0*1024.0) / (Milliseconds / 1000.0),
+			BenchCheck(IsRight) ? "" : "  DECODED WRONG");
+
+		free(DecodeMemory);
+		free(PNG.Expected);
+		free(PNG.File);
+	}
+}
+
+//
+// Asset pack startup - what loading costs with a current pack, against reading and decoding the source like the fallback
+//
+
+inline uint64_t
+AlignBenchSize(uint64_t Value, uint64_t Alignment)
+{
+	return((Value + Alignment - 1) & ~(Alignment - 1));
+}
+
+internal bool32
+WriteBenchFile(char* Filename, void* Memory, uint64_t Size)
+{
+	bool32 Result = false;
+	FILE* File = fopen(Filename, "wb");
+	if (File)
+	{
+		Result = (fwrite(Memory, 1, (size_t)Size, File) == Size);
+		Result = (fclose(File) == 0) && Result;
+	}
+	return(Result);
+}
+
+//What the platform layers' PlatformGetFileStamp, PlatformMapReadOnlyFile and PlatformUnmapFile do
+internal platform_file_stamp
+GetBenchFileStamp(char* Filename)
+{
+	platform_file_stamp Result = {};
+#if defined(_WIN32)
+	struct _stat64 Status;
+	Result.Exists = (_stat64(Filename, &Status) == 0);
+#else
+	struct stat Status;
+	Result.Exists = (stat(Filename, &Status) == 0);
+#endif
+	if (Result.Exists)
+	{
+		Result.Size = (uint64_t)Status.st_size;
+		Result.WriteTime = (uint64_t)Status.st_mtime;
+	}
+	return(Result);
+}
+
+internal platform_file_mapping
+MapBenchFile(char* Filename)
+{
+	platform_file_mapping Result = {};
+#if defined(_WIN32)
+	HANDLE FileHandle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if (FileHandle != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER FileSize;
+		HANDLE MappingHandle = GetFileSizeEx(FileHandle, &FileSize) ? CreateFileMapping(FileHandle, 0, PAGE_READONLY, 0, 0, 0) : 0;
+		Result.Memory = MappingHandle ? MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0) : 0;
+		Result.Size = Result.Memory ? FileSize.QuadPart : 0;
+		Result.PlatformHandle = MappingHandle;
+		CloseHandle(FileHandle);
+	}
+#else
+	int File = open(Filename, O_RDONLY);
+	struct stat Status;
+	if ((File >= 0) && (fstat(File, &Status) == 0) && (Status.st_size > 0))
+	{
+		void* Memory = mmap(0, Status.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+		Result.Memory = (Memory != MAP_FAILED) ? Memory : 0;
+		Result.Size = Result.Memory ? Status.st_size : 0;
+	}
+	if (File >= 0)
+	{
+		close(File);
+	}
+#endif
+	return(Result);
+}
+
+internal void
+UnmapBenchFile(platform_file_mapping* Mapping)
+{
+#if defined(_WIN32)
+	if (Mapping->Memory)
+	{
+		UnmapViewOfFile(Mapping->Memory);
+	}
+	if (Mapping->PlatformHandle)
+	{
+		CloseHandle((HANDLE)Mapping->PlatformHandle);
+	}
+#else
+	if (Mapping->Memory)
+	{
+		munmap(Mapping->Memory, Mapping->Size);
+	}
+#endif
+	*Mapping = {};
+}
+
+//Same layout babl_packer writes, stamped with the source file as it is on disk now
+internal bool32
+WriteBenchPack(char* Filename, char* Name, char* SourceFilename, loaded_bitmap* Bitmap)
+{
+	uint32_t Pitch = (uint32_t)AlignBenchSize(Bitmap->Width*sizeof(uint32_t), BPAK_ROW_ALIGNMENT);
+	uint64_t PixelsOffset = AlignBenchSize(sizeof(bpak_header) + sizeof(bpak_bitmap), BPAK_PIXEL_ALIGNMENT);
+	uint64_t Size = PixelsOffset + (uint64_t)Pitch*Bitmap->Height;
+	uint8_t* Pack = (uint8_t*)calloc(Size, 1);
+
+	bpak_header* Header = (bpak_header*)Pack;
+	Header->MagicValue = BPAK_MAGIC_VALUE;
+	Header->Version = BPAK_VERSION;
+	Header->BitmapCount = 1;
+	Header->BitmapsOffset = sizeof(bpak_header);
+	Header->FileSize = Size;
+
+	platform_file_stamp Stamp = GetBenchFileStamp(SourceFilename);
+	bpak_bitmap* Entry = (bpak_bitmap*)(Header + 1);
+	strncpy(Entry->Name, Name, BPAK_MAX_NAME - 1);
+	Entry->Width = Bitmap->Width;
+	Entry->Height = Bitmap->Height;
+	Entry->Pitch = Pitch;
+	Entry->SourceSize = (uint32_t)Stamp.Size;
+	Entry->PixelsOffset = PixelsOffset;
+	Entry->SourceWriteTime = Stamp.WriteTime;
+	for (int Y = 0; Y < Bitmap->Height; Y++)
+	{
+		memcpy(Pack + PixelsOffset + (uint64_t)Y*Pitch, (uint8_t*)Bitmap->Memory + (int64_t)Y*Bitmap->Pitch,
+			Bitmap->Width*sizeof(uint32_t));
+	}
+	bool32 Result = WriteBenchFile(Filename, Pack, Size);
+	free(Pack);
+	return(Result);
+}
+
+/*
+	Both paths start from files on disk, as babl.cpp's init does: the fallback reads the whole source and decodes
+	it, the pack path stamps the source, maps the pack and registers the bitmap. Best of RepeatCount, so both run
+	with their files in the OS cache - a cold start adds disk time to both, and more to the bigger read.
+*/
+internal void
+BenchAssetPackStartup(uint32_t RepeatCount)
+{
+	printf("asset pack startup: best of %u, ms from the files on disk to a usable bitmap\n", RepeatCount);
+	char* SyntheticFilename = "babl_bench_asset.png";
+	char* PackFilename = "babl_bench_asset.bpak";
+	bench_png Synthetic = MakeBenchPNG(2048, 2048, PNGColorType_RGBA, 8);
+	bool32 WroteSynthetic = WriteBenchFile(SyntheticFilename, Synthetic.File, Synthetic.FileSize);
+	BenchCheck(WroteSynthetic);
+
+	char* Sources[2] = {FindBenchFern(), WroteSynthetic ? SyntheticFilename : 0};
+	char* Names[2] = {"l_fern.png", "RGBA 2048x2048"};
+	if (!Sources[0])
+	{
+		printf("  l_fern.png not found next to the bench or one directory up - skipped\n");
+	}
+
+	for (int SourceIndex = 0; SourceIndex < ArrayCount(Sources); SourceIndex++)
+	{
+		char* SourceFilename = Sources[SourceIndex];
+		if (!SourceFilename)
+		{
+			continue;
+		}
+
+		//Fallback: what babl.cpp does when there is no current pack. The decode memory is the arena's, so not timed
+		debug_read_file_result File = ReadBenchFile(SourceFilename);
+		png_info Info = GetPNGInfo(File.Contents, File.ContentSize);
+		void* DecodeMemory = Info.IsValid ? malloc(Info.MemoryRequired) : 0;
+		free(File.Contents);
+		png_decode_result Decoded = {};
+		double DecodeMilliseconds = 0.0;
+		for (uint32_t Repeat = 0; DecodeMemory && (Repeat < RepeatCount); Repeat++)
+		{
+			double Start = GetBenchMilliseconds();
+			File = ReadBenchFile(SourceFilename);
+			Info = GetPNGInfo(File.Contents, File.ContentSize);
+			Decoded = DecodePNG(File.Contents, File.ContentSize, DecodeMemory, Info.MemoryRequired);
+			free(File.Contents);
+			double Milliseconds = GetBenchMilliseconds() - Start;
+			DecodeMilliseconds = (!Repeat || (Milliseconds < DecodeMilliseconds)) ? Milliseconds : DecodeMilliseconds;
+		}
+		if (!BenchCheck(Decoded.Success) || !BenchCheck(WriteBenchPack(PackFilename, "bench", SourceFilename, &Decoded.Bitmap)))
+		{
+			printf("  %-16s FAILED TO DECODE OR PACK\n", Names[SourceIndex]);
+			free(DecodeMemory);
+			continue;
+		}
+
+		//Far too small for the bitmap - pack bitmaps are used in place, so they must not need any of it
+		uint64_t Budget = 4096;
+		void* Slab = malloc(Budget);
+		game_assets* Assets = (game_assets*)malloc(sizeof(game_assets));
+
+		//Pack path, staleness check included
+		double PackMilliseconds = 0.0;
+		uint32_t ID = 0;
+		platform_file_mapping Mapping = {};
+		for (uint32_t Repeat = 0; Repeat < RepeatCount; Repeat++)
+		{
+			UnmapBenchFile(&Mapping);
+			double Start = GetBenchMilliseconds();
+			InitializeAssets(Assets, Slab, Budget);
+			platform_file_stamp Stamp = GetBenchFileStamp(SourceFilename);
+			Mapping = MapBenchFile(PackFilename);
+			ID = (OpenAssetPack(&Assets->Pack, Mapping) && IsPackBitmapCurrent(&Assets->Pack, "bench", Stamp)) ?
+				AddPackBitmap(Assets, "bench") : 0;
+			double Milliseconds = GetBenchMilliseconds() - Start;
+			PackMilliseconds = (!Repeat || (Milliseconds < PackMilliseconds)) ? Milliseconds : PackMilliseconds;
+		}
+
+		//The first request is where the worker touches the mapped pages - inline here, as with no low-priority queue
+		game_memory Memory = {};
+		double Start = GetBenchMilliseconds();
+		RequestBitmap(Assets, ID, AssetPriority_OnScreen);
+		UpdateAssets(Assets, &Memory);
+		double FirstRequestMilliseconds = GetBenchMilliseconds() - Start;
+		UpdateAssets(Assets, &Memory);
+		asset_handle Handle = RequestBitmap(Assets, ID, AssetPriority_OnScreen);
+		uint8_t* MappedPixels = (uint8_t*)Mapping.Memory;
+		bool32 IsInPlace = ((Handle.State == AssetState_Resident) && ((uint8_t*)Handle.Bitmap->Memory >= MappedPixels) &&
+			((uint8_t*)Handle.Bitmap->Memory < MappedPixels + Mapping.Size) && !Assets->Slots[ID].Block);
+		bool32 IsRight = (Handle.State == AssetState_Resident);
+		for (int Y = 0; IsRight && (Y < Decoded.Bitmap.Height); Y++)
+		{
+			IsRight = (memcmp((uint8_t*)Handle.Bitmap->Memory + (int64_t)Y*Handle.Bitmap->Pitch,
+				(uint8_t*)Decoded.Bitmap.Memory + (int64_t)Y*Decoded.Bitmap.Pitch, Decoded.Bitmap.Width*sizeof(uint32_t)) == 0);
+		}
+
+		//An edited source has to be caught whether the edit changed its size or only its write time
+		platform_file_stamp Stamp = GetBenchFileStamp(SourceFilename);
+		platform_file_stamp Resized = Stamp;
+		Resized.Size += 1;
+		platform_file_stamp Rewritten = Stamp;
+		Rewritten.WriteTime += 1;
+		bool32 CatchesEdits = (IsPackBitmapCurrent(&Assets->Pack, "bench", Stamp) &&
+			!IsPackBitmapCurrent(&Assets->Pack, "bench", Resized) && !IsPackBitmapCurrent(&Assets->Pack, "bench", Rewritten));
+		if (SourceFilename == SyntheticFilename)
+		{
+			//And for real, through the file system
+			CatchesEdits &= (WriteBenchFile(SyntheticFilename, Synthetic.File, Synthetic.FileSize - 1) &&
+				!IsPackBitmapCurrent(&Assets->Pack, "bench", GetBenchFileStamp(SyntheticFilename)));
+		}
+
+		printf("  %-16s %4dx%-4d read+decode %8.3f ms  stamp+map+open %7.3f ms %7.0fx  first request %6.3f ms%s%s%s\n",
+			Names[SourceIndex], Decoded.Bitmap.Width, Decoded.Bitmap.Height, DecodeMilliseconds, PackMilliseconds,
+			DecodeMilliseconds / PackMilliseconds, FirstRequestMilliseconds,
+			BenchCheck(IsRight) ? "" : "  PACK PIXELS WRONG", BenchCheck(IsInPlace) ? "" : "  PACK BITMAP NOT IN THE MAPPING",
+			BenchCheck(CatchesEdits) ? "" : "  STALE SOURCE NOT CAUGHT");
+
+		UnmapBenchFile(&Mapping);
+		free(Assets);
+		free(Slab);
+		free(DecodeMemory);
+	}
+	remove(PackFilename);
+	remove(SyntheticFilename);
+	free(Synthetic.Expected);
+	free(Synthetic.File);
+}
+
+//
+// Asset streaming - synthetic assets requested through a small budget, the way a scrolling scene would
+//
+
+//Stands in for the rest of a frame - with a single core, this is the only time the asset worker gets to run
+internal void
+SleepBenchMilliseconds(uint32_t Milliseconds)
+{
+#if defined(_WIN32)
+	Sleep(Milliseconds);
+#else
+	timespec Duration = {0, (long)Milliseconds*1000000L};
+	nanosleep(&Duration, 0);
+#endif
+}
+
+struct bench_streaming_result
+{
+	asset_stats Stats;
+	uint64_t WrongPixelCount;
+	uint32_t MaxFramesWaiting;
+};
+
+/*
+	A row of AssetCount tiles scrolls past: every frame the OnScreenCount tiles at the camera are wanted on screen
+	and the next PrefetchCount are prefetched, with the camera moving one tile every FramesPerTile frames. The
+	budget holds about half again the tiles asked for at once, so the tiles left behind have to be evicted.
+	Every hit has its pixels checked against the generator.
+*/
+internal bench_streaming_result
+RunAssetStreaming(uint32_t FrameCount, game_memory* Memory)
+{
+	uint32_t const AssetCount = 48;
+	uint32_t const OnScreenCount = 4;
+	uint32_t const PrefetchCount = 2;
+	uint32_t const FramesPerTile = 8;
+	uint32_t const TileSize = 128;
+
+	uint64_t AssetSize = (uint64_t)TileSize*TileSize*sizeof(uint32_t);
+	uint64_t Budget = (OnScreenCount + PrefetchCount + 3)*(AssetSize + 64 + sizeof(asset_memory_block));
+	void* Slab = malloc(Budget);
+	game_assets* Assets = (game_assets*)malloc(sizeof(game_assets));
+	InitializeAssets(Assets, Slab, Budget);
+
+	uint32_t IDs[AssetCount];
+	uint32_t Seeds[AssetCount];
+	uint32_t WaitingSince[AssetCount];
+	for (uint32_t Index = 0; Index < AssetCount; Index++)
+	{
+		Seeds[Index] = Index*0x9E3779B9u;
+		IDs[Index] = AddSyntheticBitmap(Assets, TileSize, TileSize, Seeds[Index]);
+		WaitingSince[Index] = 0xFFFFFFFF;
+	}
+
+	bench_streaming_result Result = {};
+	bench_random Random = {0x510E527F};
+	for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		UpdateAssets(Assets, Memory);
+
+		uint32_t Camera = FrameIndex / FramesPerTile;
+		for (uint32_t Offset = 0; Offset < OnScreenCount + PrefetchCount; Offset++)
+		{
+			uint32_t Index = (Camera + Offset) % AssetCount;
+			asset_priority Priority = (Offset < OnScreenCount) ? AssetPriority_OnScreen : AssetPriority_Prefetch;
+			asset_handle Handle = RequestBitmap(Assets, IDs[Index], Priority);
+			if (Handle.State == AssetState_Resident)
+			{
+				WaitingSince[Index] = 0xFFFFFFFF;
+				loaded_bitmap* Bitmap = Handle.Bitmap;
+				uint32_t X = NextRandom(&Random) % TileSize;
+				uint32_t Y = NextRandom(&Random) % TileSize;
+				uint32_t Expected = 0xFF000000 | (((X*2654435761u) ^ (Y*40503u) ^ Seeds[Index]) & 0x00FFFFFF);
+				bool32 IsRight = ((Bitmap->Width == (int)TileSize) && (Bitmap->Height == (int)TileSize) &&
+					(*(uint32_t*)((uint8_t*)Bitmap->Memory + Y*Bitmap->Pitch + X*sizeof(uint32_t)) == Expected));
+				Result.WrongPixelCount += IsRight ? 0 : 1;
+			}
+			else if (Priority == AssetPriority_OnScreen)
+			{
+				//How long something on screen has gone without its bitmap
+				if (WaitingSince[Index] == 0xFFFFFFFF)
+				{
+					WaitingSince[Index] = FrameIndex;
+				}
+				uint32_t FramesWaiting = FrameIndex - WaitingSince[Index] + 1;
+				Result.MaxFramesWaiting = (FramesWaiting > Result.MaxFramesWaiting) ? FramesWaiting : Result.MaxFramesWaiting;
+			}
+		}
+
+		if (Memory->LowPriorityQueue)
+		{
+			SleepBenchMilliseconds(1);
+		}
+	}
+
+	//Nothing can still be loading into the slab when it goes away
+	if (Memory->LowPriorityQueue)
+	{
+		Memory->PlatformCompleteAllWork(Memory->LowPriorityQueue);
+	}
+	UpdateAssets(Assets, Memory);
+
+	Result.Stats = Assets->Stats;
+	free(Assets);
+	free(Slab);
+	return(Result);
+}
+
+internal void
+BenchAssetStreaming(uint32_t FrameCount)
+{
+	FrameCount = (FrameCount < 400) ? 400 : FrameCount;
+	printf("asset streaming: %u frames over 48 synthetic 128x128 tiles, 4 on screen + 2 prefetched, budget for 9\n", FrameCount);
+
+	platform_work_queue* Queue = (platform_work_queue*)malloc(sizeof(platform_work_queue));
+	//The worker run sleeps 1ms a frame to give the worker its turn, so its ms/frame includes that
+	char* Names[] = {"inline", "1 worker"};
+	for (int Mode = 0; Mode < ArrayCount(Names); Mode++)
+	{
+		game_memory Memory = {};
+		if (Mode)
+		{
+			MakeBenchQueue(Queue, 1);
+			Memory.LowPriorityQueue = Queue;
+			Memory.PlatformAddEntry = BenchAddEntry;
+			Memory.PlatformCompleteAllWork = BenchCompleteAllWork;
+		}
+
+		double Start = GetBenchMilliseconds();
+		bench_streaming_result Result = RunAssetStreaming(FrameCount, &Memory);
+		double Milliseconds = GetBenchMilliseconds() - Start;
+		if (Mode)
+		{
+			FreeBenchQueue(Queue);
+		}
+
+		asset_stats* Stats = &Result.Stats;
+		uint64_t AssetSize = 128*128*sizeof(uint32_t);
+		double HitRate = Stats->Requests ? (double)Stats->Hits / (double)Stats->Requests : 0.0;
+		double LatencyMean = Stats->LoadsCompleted ? (double)Stats->LatencyTicksTotal / (double)Stats->LoadsCompleted : 0.0;
+		printf("  %-8s %5.1f%% hits of %llu requests  %llu loads, %llu evictions, %.1f MB streamed  latency %.3f Mcycles mean %.3f max  "
+			"on screen waited %u frames at most  %.3f ms/frame",
+			Names[Mode], 100.0*HitRate, (unsigned long long)Stats->Requests, (unsigned long long)Stats->LoadsCompleted,
+			(unsigned long long)Stats->Evictions, Stats->BytesStreamed / (1024.0*1024.0), LatencyMean / 1.0e6,
+			Stats->LatencyTicksMax / 1.0e6, Result.MaxFramesWaiting, Milliseconds / FrameCount);
+
+		//Inline loads land before the next frame's requests, so nothing on screen should ever wait more than the frame it was asked for
+		bool32 IsConsistent = ((Stats->Hits <= Stats->Requests) && (Stats->BytesStreamed == Stats->LoadsCompleted*AssetSize) &&
+			(Stats->LoadsCompleted >= 48) && (Stats->Evictions > 0) && (HitRate > 0.5));
+		printf("%s%s%s%s\n", BenchCheck(!Stats->LoadsFailed) ? "" : "  LOADS FAILED",
+			BenchCheck(!Result.WrongPixelCount) ? "" : "  WRONG PIXELS",
+			BenchCheck(IsConsistent) ? "" : "  STATS DON'T ADD UP",
+			BenchCheck(Mode || (Result.MaxFramesWaiting <= 1)) ? "" : "  ON-SCREEN TILE WAITED");
+	}
+	free(Queue);
+}
+
+//
+// Sound streams - long WAV files played off disk through a real audio_state
+//
+
+//Plain stdio, so it builds everywhere the bench does; the refills run inline, as on a platform with no queue
+internal
+PLATFORM_OPEN_FILE(BenchOpenFile)
+{
+	platform_file_handle Result = {};
+	FILE* File = fopen(Filename, "rb");
+	if (File)
+	{
+#if defined(_WIN32)
+		_fseeki64(File, 0, SEEK_END);
+		Result.Size = (uint64_t)_ftelli64(File);
+#else
+		fseeko(File, 0, SEEK_END);
+		Result.Size = (uint64_t)ftello(File);
+#endif
+		Result.IsOpen = true;
+		Result.PlatformHandle = File;
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_READ_DATA_FROM_FILE(BenchReadDataFromFile)
+{
+	FILE* File = (FILE*)Handle->PlatformHandle;
+#if defined(_WIN32)
+	bool32 Seeked = (_fseeki64(File, (int64_t)Offset, SEEK_SET) == 0);
+#else
+	bool32 Seeked = (fseeko(File, (off_t)Offset, SEEK_SET) == 0);
+#endif
+	bool32 Result = Handle->IsOpen && Seeked && (fread(Dest, 1, Size, File) == Size);
+	return(Result);
+}
+
+internal
+PLATFORM_CLOSE_FILE(BenchCloseFile)
+{
+	if (Handle->IsOpen)
+	{
+		fclose((FILE*)Handle->PlatformHandle);
+	}
+	*Handle = {};
+}
+
+//Sample i of a bench stream, before it is written out: the same tone in both channels, or noise for mono
+inline float
+GetBenchStreamSample(uint32_t ChannelCount, double Hz, uint32_t SamplesPerSecond, uint64_t SampleIndex, bench_random* Random)
+{
+	float Result = (ChannelCount == 2) ? (float)(0.5*sin(2.0*3.14159265358979*Hz*(double)SampleIndex / SamplesPerSecond)) :
+		(float)((int)(NextRandom(Random) % 2001) - 1000) / 1000.0f;
+	return(Result);
+}
+
+//A stereo 16-bit tone or a mono float noise file, a second at a time so it never has to be in memory at once
+internal bool32
+WriteBenchStream(char* Filename, wav_sample_type SampleType, uint32_t SamplesPerSecond, double Hz, uint64_t FrameCount)
+{
+	FILE* File = fopen(Filename, "wb");
+	if (!File)
+	{
+		return(false);
+	}
+	uint32_t ChannelCount = (SampleType == WAVSampleType_PCM16) ? 2 : 1;
+	//Two int16s or one float, four bytes a frame either way
+	uint32_t BytesPerFrame = 4;
+	uint32_t DataSize = (uint32_t)(FrameCount*BytesPerFrame);
+	uint32_t Format[4] = {(uint32_t)((SampleType == WAVSampleType_PCM16) ? WAV_FORMAT_PCM : WAV_FORMAT_IEEE_FLOAT) | (ChannelCount << 16),
+		SamplesPerSecond, SamplesPerSecond*BytesPerFrame, BytesPerFrame | ((uint32_t)((SampleType == WAVSampleType_PCM16) ? 16 : 32) << 16)};
+	uint32_t Header[5] = {GetWAVChunkID("RIFF"), 36 + DataSize, GetWAVChunkID("WAVE"), GetWAVChunkID("fmt "), sizeof(Format)};
+	uint32_t DataHeader[2] = {GetWAVChunkID("data"), DataSize};
+	fwrite(Header, sizeof(Header), 1, File);
+	fwrite(Format, sizeof(Format), 1, File);
+	fwrite(DataHeader, sizeof(DataHeader), 1, File);
+
+	bench_random Random = {0x57EA};
+	uint8_t* Buffer = (uint8_t*)malloc((size_t)SamplesPerSecond*BytesPerFrame);
+	for (uint64_t Start = 0; Start < FrameCount; Start += SamplesPerSecond)
+	{
+		uint32_t Count = (FrameCount - Start < SamplesPerSecond) ? (uint32_t)(FrameCount - Start) : SamplesPerSecond;
+		for (uint32_t Index = 0; Index < Count; Index++)
+		{
+			float Sample = GetBenchStreamSample(ChannelCount, Hz, SamplesPerSecond, Start + Index, &Random);
+			if (SampleType == WAVSampleType_PCM16)
+			{
+				int16_t Value = (int16_t)lrintf(Sample*32767.0f);
+				int16_t Frame[2] = {Value, Value};
+				memcpy(Buffer + 4*Index, Frame, 4);
+			}
+			else
+			{
+				memcpy(Buffer + 4*Index, &Sample, 4);
+			}
+		}
+		fwrite(Buffer, (size_t)Count*BytesPerFrame, 1, File);
+	}
+	free(Buffer);
+	bool32 Result = (ferror(File) == 0);
+	fclose(File);
+	return(Result);
+}
+
+internal void
+BenchSoundStreams(float Seconds)
+{
+	uint64_t ArenaSize = Megabytes(16);
+	void* ArenaMemory = malloc(ArenaSize);
+	memory_arena Arena;
+	InitializeArena(&Arena, ArenaSize, ArenaMemory);
+
+	game_memory Memory = {};
+	Memory.PlatformOpenFile = BenchOpenFile;
+	Memory.PlatformReadDataFromFile = BenchReadDataFromFile;
+	Memory.PlatformCloseFile = BenchCloseFile;
+
+	printf("sound streams: %.0f s files, %d-sample chunks, %d per ring, %.1f KB per stream, refilled once per %d-sample block\n",
+		Seconds, SOUND_STREAM_CHUNK_SAMPLES, SOUND_STREAM_CHUNK_COUNT, GetSoundStreamMemorySize() / 1024.0, BENCH_SAMPLES_PER_BLOCK);
+
+	//The tone lands on a bin of the FFT taken from the middle of the output, for the same check as the resampler's -
+	//the longest FFT that fits inside what the voice plays, with room either end for the filter to fill and empty
+	uint64_t OutputLength = (uint64_t)(Seconds*BENCH_SAMPLES_PER_SECOND);
+	int FFTSize = 1 << 16;
+	while ((FFTSize > 64) && ((uint64_t)FFTSize + 2*RESAMPLER_MAX_TAPS > OutputLength))
+	{
+		FFTSize /= 2;
+	}
+	uint32_t ToneBin = (uint32_t)(1500*(uint64_t)FFTSize >> 16);
+	double ToneHz = (double)ToneBin*BENCH_SAMPLES_PER_SECOND / FFTSize;
+	struct bench_stream_file
+	{
+		char* Filename;
+		wav_sample_type SampleType;
+		uint32_t SamplesPerSecond;
+	};
+	bench_stream_file Files[] = {
+		{"babl_bench_stream_pcm16.wav", WAVSampleType_PCM16, 44100},
+		{"babl_bench_stream_float.wav", WAVSampleType_Float32, BENCH_SAMPLES_PER_SECOND},
+	};
+	for (int FileIndex = 0; FileIndex < ArrayCount(Files); FileIndex++)
+	{
+		bench_stream_file* BenchFile = &Files[FileIndex];
+		uint64_t FrameCount = (uint64_t)(Seconds*BenchFile->SamplesPerSecond);
+		if (!WriteBenchStream(BenchFile->Filename, BenchFile->SampleType, BenchFile->SamplesPerSecond, ToneHz, FrameCount))
+		{
+			printf("  couldn't write %s\n", BenchFile->Filename);
+			BenchCheck(false);
+			continue;
+		}
+
+		temporary_memory StreamMemory = BeginTemporaryMemory(&Arena);
+		audio_state Audio;
+		InitializeAudioState(&Audio, &Arena, 1, 0, 1);
+		PlayStream(&Audio, &Memory, BenchFile->Filename, 1.0f, 0.0f, false);
+
+		//Everything the voice plays, to check against what was written; the voice gives out at the end of the file
+		uint64_t ExpectedCount = (FrameCount*BENCH_SAMPLES_PER_SECOND + BenchFile->SamplesPerSecond - 1) / BenchFile->SamplesPerSecond;
+		uint64_t MaxOutputCount = ExpectedCount + 4*BENCH_SAMPLES_PER_BLOCK;
+		float* Output = (float*)malloc(MaxOutputCount*sizeof(float));
+		uint64_t OutputCount = 0;
+		double Start = GetBenchMilliseconds();
+		uint64_t StartTicks = __rdtsc();
+		float Gain = 0.0f;
+		do
+		{
+			UpdateSoundStreams(&Audio, &Memory);
+			temporary_memory MixMemory = BeginTemporaryMemory(&Arena);
+			sound_bus Bus = BeginSoundBus(&Arena, BENCH_SAMPLES_PER_BLOCK);
+			MixPlayingSounds(&Audio, &Bus, BENCH_SAMPLES_PER_SECOND);
+			if (Audio.FirstPlaying)
+			{
+				Gain = Audio.FirstPlaying->Volume*Audio.FirstPlaying->LeftGain;
+			}
+			for (int Index = 0; (Index < Bus.SampleCount) && (OutputCount < MaxOutputCount); Index++)
+			{
+				Output[OutputCount++] = Bus.Left[Index];
+			}
+			EndTemporaryMemory(MixMemory);
+		} while (Audio.PlayingCount && (OutputCount < MaxOutputCount));
+		UpdateSoundStreams(&Audio, &Memory);
+		double Milliseconds = GetBenchMilliseconds() - Start;
+		double TicksPerMillisecond = (double)(__rdtsc() - StartTicks) / Milliseconds;
+
+		//Where the voice stopped, give or take the block it ended in
+		uint64_t PlayedCount = OutputCount;
+		while ((PlayedCount > 0) && (Output[PlayedCount - 1] == 0.0f))
+		{
+			--PlayedCount;
+		}
+
+		sound_stream_stats* Stats = &Audio.StreamStats;
+		printf("  %-28s %5.1f MB, %u ch %-5s at %uHz: %llu refills of %.1f chunks, %.3f ms mean %.3f ms max, %.0f MB/s while refilling\n",
+			BenchFile->Filename, (double)Stats->BytesRead / Megabytes(1), (BenchFile->SampleType == WAVSampleType_PCM16) ? 2 : 1,
+			(BenchFile->SampleType == WAVSampleType_PCM16) ? "int16" : "float", BenchFile->SamplesPerSecond,
+			(unsigned long long)Stats->Refills, Stats->Refills ? (double)Stats->ChunksDecoded / Stats->Refills : 0.0,
+			Stats->Refills ? (double)Stats->LatencyTicksTotal / Stats->Refills / TicksPerMillisecond : 0.0,
+			(double)Stats->LatencyTicksMax / TicksPerMillisecond,
+			((double)Stats->BytesRead / Megabytes(1)) / ((double)Stats->LatencyTicksTotal / TicksPerMillisecond / 1000.0));
+
+		if (BenchFile->SampleType == WAVSampleType_Float32)
+		{
+			//Straight through at the output rate, so it has to come out exactly as it went in, times the voice's gain
+			bench_random Random = {0x57EA};
+			uint64_t MismatchCount = 0;
+			for (uint64_t Index = 0; Index < FrameCount; Index++)
+			{
+				float Expected = GetBenchStreamSample(1, 0.0, BenchFile->SamplesPerSecond, Index, &Random);
+				MismatchCount += ((Index >= OutputCount) || (Output[Index] != 0.0f + Expected*Gain));
+			}
+			BenchCheck(!MismatchCount);
+			printf("    %llu of %llu samples played, %llu differ from the file, %u underruns (%llu samples), %.0fx real time\n",
+				(unsigned long long)PlayedCount, (unsigned long long)FrameCount, (unsigned long long)MismatchCount,
+				Audio.StreamUnderrunCount, (unsigned long long)Audio.StreamUnderrunSamples,
+				(double)OutputCount / BENCH_SAMPLES_PER_SECOND*1000.0 / Milliseconds);
+		}
+		else
+		{
+			double* Real = (double*)malloc(FFTSize*sizeof(double));
+			double* Imaginary = (double*)malloc(FFTSize*sizeof(double));
+			float* Wave = (float*)malloc(FFTSize*sizeof(float));
+			uint64_t Middle = (PlayedCount > (uint64_t)FFTSize) ? (PlayedCount - FFTSize) / 2 : 0;
+			for (int Index = 0; Index < FFTSize; Index++)
+			{
+				Wave[Index] = (Middle + Index < OutputCount) ? Output[Middle + Index] : 0.0f;
+			}
+			double ToneDecibels = GetToneNoiseDecibels(Wave, FFTSize, ToneBin, Real, Imaginary);
+
+			//The filter rings on for up to half its width of source samples past the end; a last sample that happens
+			//to round to silence is forgiven at the front
+			uint64_t TailCount = (uint64_t)(RESAMPLER_MAX_TAPS / 2)*BENCH_SAMPLES_PER_SECOND / BenchFile->SamplesPerSecond + 1;
+			bool32 IsRightLength = ((PlayedCount + 1 >= ExpectedCount) && (PlayedCount <= ExpectedCount + TailCount));
+			printf("    %llu of %llu samples played, tone %.1f dB off its bin (%d-point FFT), %u underruns (%llu samples), %.0fx real time%s%s\n",
+				(unsigned long long)PlayedCount, (unsigned long long)ExpectedCount, ToneDecibels, FFTSize,
+				Audio.StreamUnderrunCount, (unsigned long long)Audio.StreamUnderrunSamples,
+				(double)OutputCount / BENCH_SAMPLES_PER_SECOND*1000.0 / Milliseconds,
+				BenchCheck(ToneDecibels <= -60.0) ? "" : "  TONE NOT CLEAN", BenchCheck(IsRightLength) ? "" : "  WRONG LENGTH");
+			free(Wave);
+			free(Imaginary);
+			free(Real);
+		}
+
+		free(Output);
+		EndTemporaryMemory(StreamMemory);
+		remove(BenchFile->Filename);
+	}
+	CheckArena(&Arena);
+
+	free(ArenaMemory);
+}
+
+//
+// Audio sync
+//
+
+//A device and a feeder thread to run audio_sync against, all on a simulated clock so every run is the same
+struct bench_sound_device
+{
+	char* Name;
+	float GranuleMilliseconds;
+	float WriteLeadMilliseconds;
+	float CursorJitterMilliseconds;
+
+	//The feeder wakes every WakeMilliseconds, up to WakeJitterMilliseconds late, and every StallIntervalSeconds it
+	//misses StallMilliseconds altogether
+	float WakeMilliseconds;
+	float WakeJitterMilliseconds;
+	float StallIntervalSeconds;
+	float StallMilliseconds;
+};
+
+struct bench_sync_result
+{
+	double StaleMilliseconds;
+	uint32_t UnderrunCount;
+	double MeanLatencyMilliseconds;
+	double MaxLatencyMilliseconds;
+};
+
+//The policy the Win32 layer used before audio_sync: keep a fixed amount written past the write cursor
+struct fixed_sync
+{
+	bool32 IsValid;
+	uint32_t RunningByte;
+	uint32_t SafetyBytes;
+};
+
+internal audio_sync_write
+UpdateFixedSync(fixed_sync* Fixed, uint32_t BufferSize, uint32_t WriteCursor)
+{
+	audio_sync_write Result = {};
+	if (!Fixed->IsValid)
+	{
+		Fixed->RunningByte = WriteCursor;
+		Fixed->IsValid = true;
+	}
+	uint32_t BytesAhead = (Fixed->RunningByte + BufferSize - WriteCursor) % BufferSize;
+	if (BytesAhead > BufferSize / 2)
+	{
+		Fixed->RunningByte = WriteCursor;
+		BytesAhead = 0;
+	}
+	if (BytesAhead < Fixed->SafetyBytes)
+	{
+		Result.ByteToLock = Fixed->RunningByte;
+		Result.BytesToWrite = Fixed->SafetyBytes - BytesAhead;
+		Fixed->RunningByte = (Fixed->RunningByte + Result.BytesToWrite) % BufferSize;
+	}
+	return(Result);
+}
+
+//Latency is how far the written end is ahead of what the card has actually played, right after each write
+internal bench_sync_result
+RunAudioSyncSimulation(bench_sound_device* Device, bool32 IsAdaptive, float Seconds)
+{
+	uint32_t BytesPerSample = 2*sizeof(int16_t);
+	uint32_t BufferSize = BENCH_SAMPLES_PER_SECOND*BytesPerSample;
+	float BytesPerMillisecond = (float)BufferSize / 1000.0f;
+
+	simulated_sound_card Card;
+	InitializeSimulatedSoundCard(&Card, 0, BufferSize, BytesPerSample, BENCH_SAMPLES_PER_SECOND,
+		(uint32_t)(Device->GranuleMilliseconds*BytesPerMillisecond), (uint32_t)(Device->WriteLeadMilliseconds*BytesPerMillisecond),
+		(uint32_t)(Device->CursorJitterMilliseconds*BytesPerMillisecond), 0);
+	audio_sync Sync;
+	InitializeAudioSync(&Sync, BufferSize, BytesPerSample, BENCH_SAMPLES_PER_SECOND);
+	fixed_sync Fixed = {};
+	Fixed.SafetyBytes = BufferSize / 30 / 2 / BytesPerSample*BytesPerSample;
+
+	bench_random Random = {0x5CA1AB1E};
+	uint64_t WakeNanoseconds = (uint64_t)(Device->WakeMilliseconds*1e6f);
+	uint64_t JitterNanoseconds = (uint64_t)(Device->WakeJitterMilliseconds*1e6f);
+	uint64_t StallInterval = (uint64_t)(Device->StallIntervalSeconds*1e9f);
+	uint64_t EndTime = (uint64_t)(Seconds*1e9f);
+	uint64_t NextStall = StallInterval;
+	uint64_t LatencyTotal = 0;
+	uint64_t LatencyReadings = 0;
+	uint64_t MaxLatency = 0;
+	for (uint64_t Time = 0; Time < EndTime;)
+	{
+		Time += WakeNanoseconds + (JitterNanoseconds ? NextRandom(&Random) % JitterNanoseconds : 0);
+		if (StallInterval && (Time >= NextStall))
+		{
+			Time += (uint64_t)(Device->StallMilliseconds*1e6f);
+			NextStall += StallInterval;
+		}
+
+		uint32_t PlayCursor;
+		uint32_t WriteCursor;
+		GetSimulatedSoundCardCursors(&Card, Time, &PlayCursor, &WriteCursor);
+		audio_sync_write Write = IsAdaptive ? UpdateAudioSync(&Sync, Time, PlayCursor, WriteCursor) :
+			UpdateFixedSync(&Fixed, BufferSize, WriteCursor);
+		if (Write.BytesToWrite)
+		{
+			WriteSimulatedSoundCard(&Card, Time, Write.ByteToLock, 0, Write.BytesToWrite);
+		}
+
+		if (Card.IsWritten && (Card.WrittenPosition > Card.PlayedPosition))
+		{
+			uint64_t Latency = Card.WrittenPosition - Card.PlayedPosition;
+			LatencyTotal += Latency;
+			++LatencyReadings;
+			MaxLatency = (Latency > MaxLatency) ? Latency : MaxLatency;
+		}
+	}
+
+	bench_sync_result Result = {};
+	Result.StaleMilliseconds = (double)Card.StaleBytes / BytesPerMillisecond;
+	Result.UnderrunCount = Card.UnderrunCount;
+	Result.MeanLatencyMilliseconds = LatencyReadings ? (double)LatencyTotal / LatencyReadings / BytesPerMillisecond : 0.0;
+	Result.MaxLatencyMilliseconds = (double)MaxLatency / BytesPerMillisecond;
+	return(Result);
+}
+
+internal void
+BenchAudioSync(float Seconds)
+{
+	bench_sound_device Devices[] =
+	{
+		{"tight", 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f},
+		{"typical", 10.0f, 10.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f},
+		{"late cursor", 10.0f, 30.0f, 5.0f, 1.0f, 1.0f, 0.0f, 0.0f},
+		{"coarse", 40.0f, 20.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f},
+		{"15ms sleep", 1.0f, 5.0f, 0.0f, 1.0f, 15.0f, 0.0f, 0.0f},
+		{"stalls", 10.0f, 10.0f, 1.0f, 1.0f, 2.0f, 3.0f, 40.0f},
+	};
+
+	printf("audio sync, %.0f simulated seconds per device (fixed keeps half a 30Hz frame past the write cursor):\n", Seconds);
+	printf("  %-12s %-26s  %-26s\n", "", "fixed", "adaptive");
+	printf("  %-12s %8s %5s %11s  %8s %5s %11s\n", "", "stale ms", "runs", "latency ms", "stale ms", "runs", "latency ms");
+	for (int DeviceIndex = 0; DeviceIndex < ArrayCount(Devices); DeviceIndex++)
+	{
+		bench_sound_device* Device = &Devices[DeviceIndex];
+		bench_sync_result Fixed = RunAudioSyncSimulation(Device, false, Seconds);
+		bench_sync_result Adaptive = RunAudioSyncSimulation(Device, true, Seconds);
+		printf("  %-12s %8.1f %5u %5.1f/%5.1f  %8.1f %5u %5.1f/%5.1f\n", Device->Name,
+			Fixed.StaleMilliseconds, Fixed.UnderrunCount, Fixed.MeanLatencyMilliseconds, Fixed.MaxLatencyMilliseconds,
+			Adaptive.StaleMilliseconds, Adaptive.UnderrunCount, Adaptive.MeanLatencyMilliseconds, Adaptive.MaxLatencyMilliseconds);
+	}
+}
+
+//
+// Frame pacing - the same pacer the platform layers use, against a simulated clock whose timer oversleeps
+//
+
+//The timer wakes on the next tick of Granularity at the earliest, Latency after that plus up to Jitter more, and
+//StallPercent of the time a further Stall on top
+struct bench_timer
+{
+	char* Name;
+	float GranularityMilliseconds;
+	float LatencyMilliseconds;
+	float JitterMilliseconds;
+	uint32_t StallPercent;
+	float StallMilliseconds;
+};
+
+//Every read of the clock costs ReadNanoseconds of CPU, and every sleep SleepCPUNanoseconds for getting in and out
+struct bench_pacing_clock
+{
+	bench_timer* Timer;
+	bench_random Random;
+	uint64_t Now;
+	uint64_t CPUTime;
+	uint64_t ReadNanoseconds;
+	uint64_t SleepCPUNanoseconds;
+};
+
+internal FRAME_PACER_GET_TIME(GetBenchPacingTime)
+{
+	bench_pacing_clock* Clock = (bench_pacing_clock*)Context;
+	Clock->Now += Clock->ReadNanoseconds;
+	Clock->CPUTime += Clock->ReadNanoseconds;
+	return(Clock->Now);
+}
+
+internal FRAME_PACER_GET_TIME(GetBenchPacingCPUTime)
+{
+	bench_pacing_clock* Clock = (bench_pacing_clock*)Context;
+	return(Clock->CPUTime);
+}
+
+internal FRAME_PACER_SLEEP_UNTIL(BenchPacingSleepUntil)
+{
+	bench_pacing_clock* Clock = (bench_pacing_clock*)Context;
+	bench_timer* Timer = Clock->Timer;
+	Clock->CPUTime += Clock->SleepCPUNanoseconds;
+	if (Deadline <= Clock->Now)
+	{
+		return;
+	}
+
+	uint64_t Granularity = (uint64_t)(Timer->GranularityMilliseconds*1e6f);
+	uint64_t Wake = Granularity ? (Deadline + Granularity - 1) / Granularity*Granularity : Deadline;
+	uint64_t Jitter = (uint64_t)(Timer->JitterMilliseconds*1e6f);
+	Wake += (uint64_t)(Timer->LatencyMilliseconds*1e6f) + (Jitter ? NextRandom(&Clock->Random) % Jitter : 0);
+	if ((NextRandom(&Clock->Random) % 100) < Timer->StallPercent)
+	{
+		Wake += (uint64_t)(Timer->StallMilliseconds*1e6f);
+	}
+	Clock->Now = Wake;
+}
+
+enum bench_pacing_policy
+{
+	BenchPacing_SleepOnly,
+	BenchPacing_SleepAndSpin,
+	BenchPacing_Paced,
+};
+
+struct bench_pacing_result
+{
+	uint32_t LateFrameCount;
+	double MeanLatenessMilliseconds;
+	double MaxLatenessMilliseconds;
+	double WaitCPUPercent;
+	double MarginMilliseconds;
+};
+
+/*
+	30Hz frames of 8 to 18ms of work, with every 97th frame running over the period altogether. Lateness is how far
+	each frame starts after its deadline, not counting the frames that were already due when their wait began - no
+	pacing can help those. Late frames are ones more than a quarter of a millisecond late.
+*/
+internal bench_pacing_result
+RunFramePacingSimulation(bench_timer* Timer, bench_pacing_policy Policy, uint32_t FrameCount)
+{
+	bench_pacing_clock Clock = {};
+	Clock.Timer = Timer;
+	Clock.Random.State = 0xF7A3E5;
+	Clock.Now = 1000000000ULL;
+	Clock.ReadNanoseconds = 1000;
+	Clock.SleepCPUNanoseconds = 5000;
+	frame_pacer_clock PacerClock = {&Clock, GetBenchPacingTime, BenchPacingSleepUntil, GetBenchPacingCPUTime};
+
+	uint64_t Period = 1000000000ULL / 30;
+	frame_pacer Pacer;
+	InitializeFramePacer(&Pacer, Period, Clock.Now);
+	bench_random Work = {0xC0FFEE};
+	uint64_t Deadline = Clock.Now + Period;
+	uint64_t WaitTime = 0;
+	uint64_t WaitCPUTime = 0;
+	uint64_t LatenessTotal = 0;
+	uint64_t MaxLateness = 0;
+	uint32_t OnTimeCount = 0;
+	bench_pacing_result Result = {};
+	for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		uint64_t WorkNanoseconds = (FrameIndex % 97 == 96) ? Period + Period / 4 : 8000000ULL + NextRandom(&Work) % 10000000ULL;
+		Clock.Now += WorkNanoseconds;
+		Clock.CPUTime += WorkNanoseconds;
+
+		uint64_t WaitStart = Clock.Now;
+		uint64_t CPUStart = Clock.CPUTime;
+		bool32 WasDue = (WaitStart >= ((Policy == BenchPacing_Paced) ? Pacer.NextDeadline : Deadline));
+		if (Policy == BenchPacing_Paced)
+		{
+			Deadline = Pacer.NextDeadline;
+			WaitForNextFrame(&Pacer, &PacerClock);
+		}
+		else if (!WasDue)
+		{
+			if (Policy == BenchPacing_SleepOnly)
+			{
+				BenchPacingSleepUntil(&Clock, Deadline);
+			}
+			else
+			{
+				//What WinMain did: Sleep for the whole milliseconds left, then spin on the clock for the rest
+				uint64_t SleepMilliseconds = (Deadline - Clock.Now) / 1000000ULL;
+				if (SleepMilliseconds)
+				{
+					BenchPacingSleepUntil(&Clock, Clock.Now + SleepMilliseconds*1000000ULL);
+				}
+				while (GetBenchPacingTime(&Clock) < Deadline)
+				{
+				}
+			}
+		}
+		WaitTime += Clock.Now - WaitStart;
+		WaitCPUTime += Clock.CPUTime - CPUStart;
+
+		if (!WasDue)
+		{
+			uint64_t Lateness = (Clock.Now > Deadline) ? Clock.Now - Deadline : 0;
+			LatenessTotal += Lateness;
+			MaxLateness = (Lateness > MaxLateness) ? Lateness : MaxLateness;
+			Result.LateFrameCount += (Lateness > 250000) ? 1 : 0;
+			++OnTimeCount;
+		}
+		if (Policy != BenchPacing_Paced)
+		{
+			Deadline = WasDue ? Clock.Now + Period : Deadline + Period;
+		}
+	}
+
+	Result.MeanLatenessMilliseconds = OnTimeCount ? (double)LatenessTotal / OnTimeCount / 1e6 : 0.0;
+	Result.MaxLatenessMilliseconds = (double)MaxLateness / 1e6;
+	Result.WaitCPUPercent = WaitTime ? 100.0*(double)WaitCPUTime / (double)WaitTime : 0.0;
+	Result.MarginMilliseconds = (double)Pacer.Margin / 1e6;
+	return(Result);
+}
+
+internal void
+BenchFramePacing(uint32_t FrameCount)
+{
+	bench_timer Timers[] =
+	{
+		{"nanosleep", 0.0f, 0.05f, 0.1f, 1, 1.0f},
+		{"hi-res wait", 0.5f, 0.0f, 0.3f, 1, 2.0f},
+		{"Sleep 1ms", 1.0f, 0.0f, 1.0f, 2, 4.0f},
+	};
+	char* PolicyNames[] = {"sleep only", "Sleep + spin", "paced"};
+
+	printf("frame pacing, %u simulated 30Hz frames per timer (late is more than 0.25ms past the deadline):\n", FrameCount);
+	printf("  %-12s %-12s %5s %9s %8s %9s %9s\n", "", "", "late", "mean ms", "max ms", "CPU wait", "margin ms");
+	for (int TimerIndex = 0; TimerIndex < ArrayCount(Timers); TimerIndex++)
+	{
+		for (int PolicyIndex = 0; PolicyIndex < ArrayCount(PolicyNames); PolicyIndex++)
+		{
+			bench_pacing_result Result = RunFramePacingSimulation(&Timers[TimerIndex], (bench_pacing_policy)PolicyIndex, FrameCount);
+			printf("  %-12s %-12s %5u %9.3f %8.3f %8.1f%%", PolicyIndex ? "" : Timers[TimerIndex].Name, PolicyNames[PolicyIndex],
+				Result.LateFrameCount, Result.MeanLatenessMilliseconds, Result.MaxLatenessMilliseconds, Result.WaitCPUPercent);
+			if (PolicyIndex == BenchPacing_Paced)
+			{
+				printf(" %9.3f", Result.MarginMilliseconds);
+			}
+			printf("\n");
+		}
+	}
+}
+
+//
+// Profiler - what one TIMED_BLOCK costs, and that a trace of known blocks comes back out whole
+//
+
+#define BENCH_DEBUG_STORAGE_SIZE Megabytes(16)
+
+//Three deep: a frame, four children, a grandchild in each
+internal void
+RecordBenchFrames(uint32_t FrameCount)
+{
+	for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+	{
+		TIMED_BLOCK("BenchFrame");
+		for (uint32_t ChildIndex = 0; ChildIndex < 4; ChildIndex++)
+		{
+			TIMED_BLOCK("BenchChild");
+			{
+				TIMED_BLOCK("BenchGrandchild");
+				CompletePreviousWritesBeforeFutureWrites;
+			}
+		}
+	}
+}
+
+internal debug_trace_stats
+ExportBenchTrace(debug_table* Table, double Milliseconds)
+{
+	debug_trace_stats Result = {};
+	char* Filename = "babl_bench_trace.json";
+	FILE* File = fopen(Filename, "wb");
+	if (File)
+	{
+		Result = WriteChromeTrace(Table, File, Table->StartNanoseconds + (uint64_t)(Milliseconds*1e6));
+		fclose(File);
+		remove(Filename);
+	}
+	return(Result);
+}
+
+internal void
+BenchProfiler(uint32_t BlockCount)
+{
+	void* Storage = malloc(BENCH_DEBUG_STORAGE_SIZE);
+	debug_table* Table = InitializeDebugTable(Storage, BENCH_DEBUG_STORAGE_SIZE, 0);
+	uint64_t RingSize = Table->Threads[0].EventMask + 1;
+
+	//The same loop bare (the calibration every figure is taken against), with GlobalDebugTable unset (what an
+	//uninstrumented run of an internal build pays), reading the cycle counter twice and nothing else (the floor for
+	//any block, and far from free under a hypervisor), and recording. The passes take turns, batch by batch, and
+	//each keeps its fastest batch - interrupts and migrations only ever add time
+	char* PassNames[] = {"empty loop", "no table", "two __rdtsc", "recording"};
+	uint32_t const BatchSize = 10000;
+	uint32_t BatchCount = (BlockCount + BatchSize - 1) / BatchSize;
+	double BestNanoseconds[4];
+	double BestCycles[4];
+	uint64_t volatile ClockSink = 0;
+	for (uint32_t Batch = 0; Batch < BatchCount; Batch++)
+	{
+		for (uint32_t Pass = 0; Pass < ArrayCount(PassNames); Pass++)
+		{
+			GlobalDebugTable = (Pass == 3) ? Table : 0;
+			double StartMilliseconds = GetBenchMilliseconds();
+			uint64_t StartCycles = __rdtsc();
+			for (uint32_t Index = 0; Index < BatchSize; Index++)
+			{
+				if (Pass == 0)
+				{
+					CompletePreviousWritesBeforeFutureWrites;
+				}
+				else if (Pass == 2)
+				{
+					ClockSink = __rdtsc();
+					CompletePreviousWritesBeforeFutureWrites;
+					ClockSink = __rdtsc();
+				}
+				else
+				{
+					TIMED_BLOCK("BenchBlock");
+					CompletePreviousWritesBeforeFutureWrites;
+				}
+			}
+			double Cycles = (double)(__rdtsc() - StartCycles) / BatchSize;
+			double Nanoseconds = (GetBenchMilliseconds() - StartMilliseconds)*1e6 / BatchSize;
+			BestCycles[Pass] = (!Batch || (Cycles < BestCycles[Pass])) ? Cycles : BestCycles[Pass];
+			BestNanoseconds[Pass] = (!Batch || (Nanoseconds < BestNanoseconds[Pass])) ? Nanoseconds : BestNanoseconds[Pass];
+		}
+	}
+	(void)ClockSink;
+
+	printf("profiler, fastest of %u batches of %u blocks, less the empty loop (%.2f ns, %.1f cycles a pass):\n", BatchCount,
+		BatchSize, BestNanoseconds[0], BestCycles[0]);
+	for (uint32_t Pass = 1; Pass < ArrayCount(PassNames); Pass++)
+	{
+		printf("  %-22s %8.2f ns %8.1f cycles per block\n", PassNames[Pass], BestNanoseconds[Pass] - BestNanoseconds[0],
+			BestCycles[Pass] - BestCycles[0]);
+	}
+
+	//Nine blocks a frame, eighteen events: a run that fits the ring has to come back exactly, and one that goes
+	//round it many times should lose no more than the blocks open where it starts (three at most)
+	GlobalDebugTable = Table;
+	uint32_t FrameCounts[] = {(uint32_t)(RingSize / 18 / 2), (uint32_t)(RingSize / 18*5)};
+	for (int RunIndex = 0; RunIndex < ArrayCount(FrameCounts); RunIndex++)
+	{
+		//A fresh ring in the same table - the sites stay registered
+		GetDebugThreadLog()->EventCount = 0;
+		Table->StartNanoseconds = 0;
+		Table->StartClock = __rdtsc();
+		double StartMilliseconds = GetBenchMilliseconds();
+		RecordBenchFrames(FrameCounts[RunIndex]);
+		debug_trace_stats Stats = ExportBenchTrace(Table, GetBenchMilliseconds() - StartMilliseconds);
+		uint64_t Expected = (uint64_t)FrameCounts[RunIndex]*9;
+		bool32 IsWhole = (RunIndex == 0) ? ((Stats.BlockCount == Expected) && !Stats.OverwrittenEventCount && !Stats.UnpairedEventCount) :
+			((Stats.BlockCount*2 + Stats.OverwrittenEventCount + Stats.UnpairedEventCount == Expected*2) && (Stats.UnpairedEventCount <= 3));
+		printf("  %6u frames (%s ring) %8llu of %8llu blocks exported, %8llu events overwritten, %llu unpaired - %s\n",
+			FrameCounts[RunIndex], RunIndex ? "5x the" : "half the", (unsigned long long)Stats.BlockCount, (unsigned long long)Expected,
+			(unsigned long long)Stats.OverwrittenEventCount, (unsigned long long)Stats.UnpairedEventCount, BenchCheck(IsWhole) ? "ok" : "WRONG");
+	}
+
+	GlobalDebugTable = 0;
+	DebugThreadLog = 0;
+	free(Storage);
+}
+
+int
+main(int ArgCount, char** Args)
+{
+	int FrameCount = (ArgCount > 1) ? atoi(Args[1]) : 1000;
+	if (FrameCount <= 0)
+	{
+		fprintf(stderr, "Usage: babl_bench [frames]\n");
+		return(1);
+	}
+
+	BenchArenaVersusMalloc(FrameCount);
+	BenchInputStream(FrameCount*18);
+	BenchStateRing(FrameCount*18, 8, Megabytes(512));
+	BenchSnapshotSweep((uint32_t)FrameCount / 10 + 3);
+	BenchStateMigration(FrameCount*10);
+	BenchAudioMixer(FrameCount / 4);
+	BenchOscillators(FrameCount / 4);
+	BenchResampler(FrameCount*4);
+	BenchRenderKernels((uint64_t)FrameCount*500000);
+	FuzzRenderKernels((uint32_t)FrameCount*200);
+	BenchRectangleSizes((uint64_t)FrameCount*500000);
+	BenchTiledRendering((uint64_t)FrameCount*500000);
+	BenchDamageTracking((uint32_t)FrameCount);
+	BenchPNGDecode((uint32_t)FrameCount / 100 + 1);
+	BenchAssetPackStartup((uint32_t)FrameCount / 20 + 1);
+	BenchAssetStreaming((uint32_t)FrameCount*20);
+	BenchSoundStreams((float)FrameCount*0.06f);
+	BenchAudioSync((float)FrameCount*0.06f);
+	BenchFramePacing((uint32_t)FrameCount*30);
+	BenchProfiler((uint32_t)FrameCount*100000);
+
+	if (FailedCheckCount)
+	{
+		printf("%u checks FAILED\n", FailedCheckCount);
+	}
+	return(FailedCheckCount ? 1 : 0);
+}
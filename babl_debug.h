@@ -0,0 +1,287 @@
+#if !defined(BABL_DEBUG_H)
+#define BABL_DEBUG_H
+
+#include <string.h>
+
+/*
+	Scoped timing for the game and the platform layer alike:
+
+		TIMED_BLOCK("MixPlayingSounds");
+		TIMED_FUNCTION();
+
+	stamps the cycle counter where the scope opens and again where it closes. Each thread appends to a ring of its
+	own in the debug table, so recording takes no lock and no atomic - the owner writes the event, then moves its
+	count past it, and readers only ever look behind the count. Blocks nest however the code nests them, which is all
+	babl_debug_trace.h needs to rebuild the hierarchy.
+
+	The platform lays the table out over DebugStorage and hands it over in game_memory, and each module points
+	GlobalDebugTable at it before it times anything; until then blocks cost a branch. Names, files and lines are
+	copied into the table the first time a block runs, so a trace still reads right after the library that
+	recorded it has been unloaded. A thread finds its ring by GetThreadID, so the platform and the game share one
+	ring per thread and their blocks nest into each other.
+
+	All of it compiles away unless BABL_PROFILE, which internal builds have on.
+*/
+#if !defined(BABL_PROFILE)
+#define BABL_PROFILE BABL_INTERNAL
+#endif
+
+#define DEBUG_MAX_THREADS 32
+#define DEBUG_MAX_SITES 1024
+#define DEBUG_MAX_NAME_LENGTH 64
+
+enum debug_event_type
+{
+	DebugEvent_BeginBlock,
+	DebugEvent_EndBlock,
+};
+
+struct debug_event
+{
+	uint64_t Clock;
+	uint32_t SiteIndex;
+	uint32_t Type;
+};
+
+//Where a block is in the code. Site 0 is never used, so 0 can mean not registered yet
+struct debug_site
+{
+	char Name[DEBUG_MAX_NAME_LENGTH];
+	char File[DEBUG_MAX_NAME_LENGTH];
+	uint32_t Line;
+};
+
+//Only the thread with ThreadID writes here. EventCount only ever goes up; event N is at Events[N & EventMask]
+struct debug_thread_log
+{
+	uint64_t ThreadID;
+	char Name[DEBUG_MAX_NAME_LENGTH];
+	debug_event* Events;
+	uint64_t EventMask;
+	uint64_t volatile EventCount;
+};
+
+struct debug_table
+{
+	//Cycle counter and platform clock (nanoseconds) read together at startup, so a trace can be put in real time
+	uint64_t StartClock;
+	uint64_t StartNanoseconds;
+
+	//Held only to add a site or a thread, each of which happens once
+	uint32_t volatile Lock;
+
+	uint32_t volatile SiteCount;
+	debug_site Sites[DEBUG_MAX_SITES];
+
+	uint32_t volatile ThreadCount;
+	debug_thread_log Threads[DEBUG_MAX_THREADS];
+};
+
+global_variable debug_table* GlobalDebugTable;
+
+//Each module's own, and each thread's: the ring this thread writes, once it has looked it up
+global_variable thread_local debug_thread_log* DebugThreadLog;
+global_variable thread_local bool32 DebugThreadIsUnlogged;
+
+inline void
+CopyDebugString(char* Dest, const char* Source)
+{
+	uint32_t Length = 0;
+	for (; Source[Length] && (Length < DEBUG_MAX_NAME_LENGTH - 1); ++Length)
+	{
+		Dest[Length] = Source[Length];
+	}
+	Dest[Length] = 0;
+}
+
+inline void
+BeginDebugLock(debug_table* Table)
+{
+	while (AtomicCompareExchangeUInt32(&Table->Lock, 1, 0) != 0)
+	{
+		_mm_pause();
+	}
+}
+
+inline void
+EndDebugLock(debug_table* Table)
+{
+	CompletePreviousWritesBeforeFutureWrites;
+	Table->Lock = 0;
+}
+
+//The rest of Storage after the table is split evenly between the threads' rings, each a power of two events long
+internal debug_table*
+InitializeDebugTable(void* Storage, uint64_t Size, uint64_t Nanoseconds)
+{
+	if (!Storage || (Size < sizeof(debug_table) + DEBUG_MAX_THREADS*sizeof(debug_event)))
+	{
+		return(0);
+	}
+
+	debug_table* Table = (debug_table*)Storage;
+	memset(Table, 0, sizeof(*Table));
+	Table->StartClock = __rdtsc();
+	Table->StartNanoseconds = Nanoseconds;
+	Table->SiteCount = 1;
+
+	uint64_t EventsPerThread = (Size - sizeof(debug_table)) / DEBUG_MAX_THREADS / sizeof(debug_event);
+	uint64_t RingSize = 1;
+	while (RingSize*2 <= EventsPerThread)
+	{
+		RingSize *= 2;
+	}
+	debug_event* Events = (debug_event*)(Table + 1);
+	for (uint32_t ThreadIndex = 0; ThreadIndex < DEBUG_MAX_THREADS; ThreadIndex++)
+	{
+		Table->Threads[ThreadIndex].Events = Events + ThreadIndex*RingSize;
+		Table->Threads[ThreadIndex].EventMask = RingSize - 1;
+	}
+	return(Table);
+}
+
+//The same block registered again - by another thread racing this one, or by a reloaded library - gets the same site
+internal uint32_t
+RegisterDebugSite(const char* Name, const char* File, uint32_t Line)
+{
+	debug_table* Table = GlobalDebugTable;
+	uint32_t Result = 0;
+	if (Table)
+	{
+		char SiteName[DEBUG_MAX_NAME_LENGTH];
+		char SiteFile[DEBUG_MAX_NAME_LENGTH];
+		CopyDebugString(SiteName, Name);
+
+		//Only the file's own name - builds pass full paths in
+		const char* FileName = File;
+		for (const char* At = File; *At; ++At)
+		{
+			if ((*At == '/') || (*At == '\\'))
+			{
+				FileName = At + 1;
+			}
+		}
+		CopyDebugString(SiteFile, FileName);
+
+		BeginDebugLock(Table);
+		for (uint32_t SiteIndex = 1; SiteIndex < Table->SiteCount; SiteIndex++)
+		{
+			debug_site* Site = &Table->Sites[SiteIndex];
+			if ((Site->Line == Line) && (strcmp(Site->Name, SiteName) == 0) && (strcmp(Site->File, SiteFile) == 0))
+			{
+				Result = SiteIndex;
+				break;
+			}
+		}
+		if (!Result && (Table->SiteCount < DEBUG_MAX_SITES))
+		{
+			Result = Table->SiteCount;
+			debug_site* Site = &Table->Sites[Result];
+			memcpy(Site->Name, SiteName, sizeof(SiteName));
+			memcpy(Site->File, SiteFile, sizeof(SiteFile));
+			Site->Line = Line;
+			CompletePreviousWritesBeforeFutureWrites;
+			Table->SiteCount = Result + 1;
+		}
+		EndDebugLock(Table);
+	}
+	return(Result);
+}
+
+//A thread that finds every ring taken records nothing, rather than asking again on every block
+internal debug_thread_log*
+GetDebugThreadLog()
+{
+	debug_table* Table = GlobalDebugTable;
+	if (!DebugThreadLog && !DebugThreadIsUnlogged && Table)
+	{
+		uint64_t ThreadID = GetThreadID();
+		BeginDebugLock(Table);
+		for (uint32_t ThreadIndex = 0; ThreadIndex < Table->ThreadCount; ThreadIndex++)
+		{
+			if (Table->Threads[ThreadIndex].ThreadID == ThreadID)
+			{
+				DebugThreadLog = &Table->Threads[ThreadIndex];
+				break;
+			}
+		}
+		if (!DebugThreadLog && (Table->ThreadCount < DEBUG_MAX_THREADS))
+		{
+			DebugThreadLog = &Table->Threads[Table->ThreadCount];
+			DebugThreadLog->ThreadID = ThreadID;
+			CompletePreviousWritesBeforeFutureWrites;
+			++Table->ThreadCount;
+		}
+		DebugThreadIsUnlogged = !DebugThreadLog;
+		EndDebugLock(Table);
+	}
+	return(DebugThreadLog);
+}
+
+inline void
+RecordDebugEvent(uint32_t SiteIndex, uint32_t Type)
+{
+	debug_thread_log* Log = DebugThreadLog ? DebugThreadLog : GetDebugThreadLog();
+	if (Log)
+	{
+		uint64_t EventIndex = Log->EventCount;
+		debug_event* Event = Log->Events + (EventIndex & Log->EventMask);
+		Event->Clock = __rdtsc();
+		Event->SiteIndex = SiteIndex;
+		Event->Type = Type;
+		CompletePreviousWritesBeforeFutureWrites;
+		Log->EventCount = EventIndex + 1;
+	}
+}
+
+inline void
+SetDebugThreadName(const char* Name)
+{
+	debug_thread_log* Log = GetDebugThreadLog();
+	if (Log)
+	{
+		CopyDebugString(Log->Name, Name);
+	}
+}
+
+struct timed_block
+{
+	uint32_t SiteIndex;
+
+	timed_block(uint32_t* Site, const char* Name, const char* File, uint32_t Line)
+	{
+		if (!*Site)
+		{
+			*Site = RegisterDebugSite(Name, File, Line);
+		}
+		SiteIndex = *Site;
+		if (SiteIndex)
+		{
+			RecordDebugEvent(SiteIndex, DebugEvent_BeginBlock);
+		}
+	}
+
+	~timed_block()
+	{
+		if (SiteIndex)
+		{
+			RecordDebugEvent(SiteIndex, DebugEvent_EndBlock);
+		}
+	}
+};
+
+#if BABL_PROFILE
+#define DEBUG_JOIN_(A, B) A##B
+#define DEBUG_JOIN(A, B) DEBUG_JOIN_(A, B)
+#define TIMED_BLOCK(Name) \
+	local_persist uint32_t DEBUG_JOIN(DebugSite_, __LINE__); \
+	timed_block DEBUG_JOIN(TimedBlock_, __LINE__)(&DEBUG_JOIN(DebugSite_, __LINE__), Name, __FILE__, __LINE__)
+#define TIMED_FUNCTION() TIMED_BLOCK(__FUNCTION__)
+#define DEBUG_THREAD_NAME(Name) SetDebugThreadName(Name)
+#else
+#define TIMED_BLOCK(Name)
+#define TIMED_FUNCTION()
+#define DEBUG_THREAD_NAME(Name)
+#endif
+
+#endif
@@ -0,0 +1,138 @@
+#if !defined(BABL_DEBUG_TRACE_H)
+#define BABL_DEBUG_TRACE_H
+
+/*
+	Writes what the debug table holds as a Chrome trace (chrome://tracing, Perfetto, Speedscope): one complete event
+	per timed block, on the lane of the thread that ran it, in microseconds since the table was set up.
+
+	Safe to run while threads are still recording. Each ring is copied out first, and anything its thread may have
+	written over while the copy was being taken is thrown away. Whatever that leaves without a partner - ends whose
+	begins were overwritten, blocks still open - is counted rather than guessed at. The cycle counter is put in real
+	time against the platform clock, using everything since startup.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEBUG_TRACE_MAX_DEPTH 256
+
+struct debug_trace_stats
+{
+	uint32_t ThreadCount;
+	uint64_t BlockCount;
+
+	//Events the rings had already gone round over, and events left with nothing to pair with: ends whose begins
+	//were overwritten, and begins of blocks still open
+	uint64_t OverwrittenEventCount;
+	uint64_t UnpairedEventCount;
+};
+
+internal void
+WriteDebugTraceString(FILE* File, char* String)
+{
+	fputc('"', File);
+	for (char* At = String; *At; ++At)
+	{
+		if ((*At == '"') || (*At == '\\'))
+		{
+			fputc('\\', File);
+			fputc(*At, File);
+		}
+		else if ((uint8_t)*At < 0x20)
+		{
+			fprintf(File, "\\u%04x", (uint8_t)*At);
+		}
+		else
+		{
+			fputc(*At, File);
+		}
+	}
+	fputc('"', File);
+}
+
+internal debug_trace_stats
+WriteChromeTrace(debug_table* Table, FILE* File, uint64_t Nanoseconds)
+{
+	debug_trace_stats Stats = {};
+	uint64_t Clock = __rdtsc();
+	double ElapsedMicroseconds = (double)(Nanoseconds - Table->StartNanoseconds) / 1000.0;
+	double CyclesPerMicrosecond = (ElapsedMicroseconds > 0.0) ? (double)(Clock - Table->StartClock) / ElapsedMicroseconds : 1.0;
+
+	fprintf(File, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(File, "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"babl\"}}");
+
+	uint32_t ThreadCount = Table->ThreadCount;
+	CompletePreviousReadsBeforeFutureReads;
+	Stats.ThreadCount = ThreadCount;
+	debug_event* Events = ThreadCount ? (debug_event*)malloc((size_t)(Table->Threads[0].EventMask + 1)*sizeof(debug_event)) : 0;
+	for (uint32_t ThreadIndex = 0; Events && (ThreadIndex < ThreadCount); ThreadIndex++)
+	{
+		debug_thread_log* Log = &Table->Threads[ThreadIndex];
+		uint64_t RingSize = Log->EventMask + 1;
+		if (Log->Name[0])
+		{
+			fprintf(File, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", ThreadIndex);
+			WriteDebugTraceString(File, Log->Name);
+			fprintf(File, "}}");
+		}
+
+		uint64_t EndIndex = Log->EventCount;
+		CompletePreviousReadsBeforeFutureReads;
+		uint64_t FirstIndex = (EndIndex > RingSize) ? EndIndex - RingSize : 0;
+		for (uint64_t EventIndex = FirstIndex; EventIndex < EndIndex; EventIndex++)
+		{
+			Events[EventIndex - FirstIndex] = Log->Events[EventIndex & Log->EventMask];
+		}
+		CompletePreviousReadsBeforeFutureReads;
+		//The thread may also be halfway through the event after its count, which is the oldest one's slot
+		uint64_t OverwrittenIndex = (Log->EventCount + 1 > RingSize) ? Log->EventCount + 1 - RingSize : 0;
+		uint64_t ValidIndex = (OverwrittenIndex > FirstIndex) ? OverwrittenIndex : FirstIndex;
+		Stats.OverwrittenEventCount += ValidIndex;
+
+		uint32_t Depth = 0;
+		debug_event* Open[DEBUG_TRACE_MAX_DEPTH];
+		for (uint64_t EventIndex = ValidIndex; EventIndex < EndIndex; EventIndex++)
+		{
+			debug_event* Event = &Events[EventIndex - FirstIndex];
+			if ((Event->SiteIndex == 0) || (Event->SiteIndex >= Table->SiteCount))
+			{
+				++Stats.UnpairedEventCount;
+			}
+			else if (Event->Type == DebugEvent_BeginBlock)
+			{
+				if (Depth < DEBUG_TRACE_MAX_DEPTH)
+				{
+					Open[Depth++] = Event;
+				}
+				else
+				{
+					++Stats.UnpairedEventCount;
+				}
+			}
+			else if ((Depth > 0) && (Open[Depth - 1]->SiteIndex == Event->SiteIndex))
+			{
+				debug_event* Begin = Open[--Depth];
+				debug_site* Site = &Table->Sites[Event->SiteIndex];
+				double Start = (double)(Begin->Clock - Table->StartClock) / CyclesPerMicrosecond;
+				double Duration = (double)(Event->Clock - Begin->Clock) / CyclesPerMicrosecond;
+				fprintf(File, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", ThreadIndex, Start, Duration);
+				WriteDebugTraceString(File, Site->Name);
+				fprintf(File, ",\"args\":{\"file\":");
+				WriteDebugTraceString(File, Site->File);
+				fprintf(File, ",\"line\":%u}}", Site->Line);
+				++Stats.BlockCount;
+			}
+			else
+			{
+				//Its begin went round the ring before it
+				++Stats.UnpairedEventCount;
+			}
+		}
+		Stats.UnpairedEventCount += Depth;
+	}
+	free(Events);
+
+	fprintf(File, "\n]}\n");
+	return(Stats);
+}
+
+#endif
@@ -0,0 +1,126 @@
+#if !defined(BABL_DIRTY_REGION_H)
+#define BABL_DIRTY_REGION_H
+
+//Shared by the game (which records damage) and the platform (which presents it), so everything here is inline
+//and knows nothing about windows or device contexts - presenting goes through a present_rect callback
+
+inline bool32
+TouchesOrOverlaps(rectangle2i A, rectangle2i B)
+{
+	return((A.MinX <= B.MaxX) && (B.MinX <= A.MaxX) && (A.MinY <= B.MaxY) && (B.MinY <= A.MaxY));
+}
+
+inline void
+RemoveDirtyRect(dirty_region_set* Set, uint32_t Index)
+{
+	Set->Rects[Index] = Set->Rects[--Set->RectCount];
+}
+
+//Anything the new rect overlaps or touches gets folded into it; if the set is still full, the rect is merged
+//into whichever existing rect grows the least. Either way the set never exceeds MAX_DIRTY_RECTS.
+inline void
+AddDirtyRect(dirty_region_set* Set, rectangle2i Rect)
+{
+	if (Set->FullFrame || !HasArea(Rect))
+	{
+		return;
+	}
+
+	for (;;)
+	{
+		bool32 Absorbed = false;
+		for (uint32_t Index = 0; Index < Set->RectCount; Index++)
+		{
+			if (TouchesOrOverlaps(Set->Rects[Index], Rect))
+			{
+				Rect = Union(Set->Rects[Index], Rect);
+				RemoveDirtyRect(Set, Index);
+				Absorbed = true;
+				break;
+			}
+		}
+
+		if (Absorbed)
+		{
+			continue;
+		}
+
+		if (Set->RectCount < ArrayCount(Set->Rects))
+		{
+			Set->Rects[Set->RectCount++] = Rect;
+			break;
+		}
+
+		uint32_t BestIndex = 0;
+		int64_t BestGrowth = INT64_MAX;
+		for (uint32_t Index = 0; Index < Set->RectCount; Index++)
+		{
+			int64_t Growth = GetArea(Union(Set->Rects[Index], Rect)) - GetArea(Set->Rects[Index]);
+			if (Growth < BestGrowth)
+			{
+				BestGrowth = Growth;
+				BestIndex = Index;
+			}
+		}
+		Rect = Union(Set->Rects[BestIndex], Rect);
+		RemoveDirtyRect(Set, BestIndex);
+	}
+}
+
+inline int64_t
+GetDirtyArea(dirty_region_set* Set)
+{
+	int64_t Result = 0;
+	for (uint32_t Index = 0; Index < Set->RectCount; Index++)
+	{
+		Result += GetArea(Set->Rects[Index]);
+	}
+	return(Result);
+}
+
+inline bool32
+IsDirty(dirty_region_set* Set, rectangle2i Rect)
+{
+	bool32 Result = Set->FullFrame;
+	for (uint32_t Index = 0; !Result && (Index < Set->RectCount); Index++)
+	{
+		Result = HasArea(Intersect(Set->Rects[Index], Rect));
+	}
+	return(Result);
+}
+
+#define PRESENT_RECT(name) void name(void* Context, rectangle2i Rect)
+typedef PRESENT_RECT(present_rect);
+
+//Once the damaged area passes FullFrameFraction of the frame, one full blit beats a pile of small ones
+//Returns the number of bytes handed to PresentRect
+inline uint64_t
+PresentDirtyRegions(dirty_region_set* Set, int Width, int Height, int BytesPerPixel, float FullFrameFraction,
+	present_rect* PresentRect, void* Context)
+{
+	uint64_t BytesPresented = 0;
+	rectangle2i Frame = {0, 0, Width, Height};
+	int64_t FrameArea = GetArea(Frame);
+
+	if (Set->FullFrame || ((float)GetDirtyArea(Set) > FullFrameFraction*(float)FrameArea))
+	{
+		PresentRect(Context, Frame);
+		BytesPresented = FrameArea*BytesPerPixel;
+	}
+	else
+	{
+		for (uint32_t Index = 0; Index < Set->RectCount; Index++)
+		{
+			rectangle2i Rect = Intersect(Set->Rects[Index], Frame);
+			if (HasArea(Rect))
+			{
+				PresentRect(Context, Rect);
+				BytesPresented += GetArea(Rect)*BytesPerPixel;
+			}
+		}
+	}
+
+	return(BytesPresented);
+}
+
+#endif
@@ -0,0 +1,172 @@
+#if !defined(BABL_FRAME_PACER_H)
+#define BABL_FRAME_PACER_H
+
+/*
+	Holds the main loop to a fixed frame period without burning a core on the wait. The platform's timer is asked to
+	wake the loop Margin before the frame is due, and only what is left after it does gets spun on the clock.
+
+	Timers wake late - how late depends on the OS, the timer and the load - so Margin is learned from how late they
+	actually woke: FRAME_PACER_MARGIN_SCALE times the FRAME_PACER_MARGIN_PERCENTILE of the last FRAME_PACER_HISTORY
+	oversleeps, plus FRAME_PACER_MIN_SPIN_NANOSECONDS for getting back from the timer to the loop. The 99th
+	percentile covers a timer that stalls about one wake in a hundred part of the time; going all the way to the
+	worst wake would cover every stall, but only by spinning through one on every frame (in the bench, 4.8% CPU
+	waiting on nanosleep and 25.7% on a 1ms Sleep, against 1.4% and 15.0%). The stalls it misses start their
+	frames late instead, and are counted as late wakes.
+
+	The clock and the timer are passed in, so the same policy runs against a simulated clock in the bench. Times are
+	nanoseconds on any clock that only goes forward.
+*/
+#define FRAME_PACER_HISTORY 128
+#define FRAME_PACER_MARGIN_PERCENTILE 99
+#define FRAME_PACER_MARGIN_SCALE 1.25f
+#define FRAME_PACER_MIN_SPIN_NANOSECONDS 20000ULL
+#define FRAME_PACER_INITIAL_MARGIN_NANOSECONDS 1000000ULL
+
+//Bucket 0 is frames within 25us of the period, each bucket after doubles it, and the last takes everything beyond
+#define FRAME_PACER_HISTOGRAM_BUCKETS 10
+#define FRAME_PACER_HISTOGRAM_FIRST_LIMIT_NANOSECONDS 25000ULL
+
+#define FRAME_PACER_GET_TIME(name) uint64_t name(void* Context)
+typedef FRAME_PACER_GET_TIME(frame_pacer_get_time);
+
+//May return early (the pacer spins the rest) or late (the pacer learns from it)
+#define FRAME_PACER_SLEEP_UNTIL(name) void name(void* Context, uint64_t Deadline)
+typedef FRAME_PACER_SLEEP_UNTIL(frame_pacer_sleep_until);
+
+struct frame_pacer_clock
+{
+	void* Context;
+	frame_pacer_get_time* GetTime;
+	frame_pacer_sleep_until* SleepUntil;
+
+	//CPU time the calling thread has used, to show what the waiting costs - 0 where the platform can't say
+	frame_pacer_get_time* GetThreadCPUTime;
+};
+
+struct frame_pacer
+{
+	uint64_t Period;
+	uint64_t NextDeadline;
+	uint64_t LastFrameStart;
+	uint64_t FrameCount;
+
+	//How late the timer woke, indexed by OversleepCount, which only ever goes up
+	uint64_t Oversleeps[FRAME_PACER_HISTORY];
+	uint32_t OversleepCount;
+	uint64_t Margin;
+
+	//Frames that were already due when the wait began, so the schedule started over from then; and wakes that
+	//landed past the deadline, which start the frame late but keep the schedule
+	uint32_t MissedFrameCount;
+	uint32_t LateWakeCount;
+	uint64_t MaxOversleep;
+
+	//Where the waiting went: handed to the timer, spun on the clock, and the CPU the whole wait actually used
+	uint64_t SleepNanoseconds;
+	uint64_t SpinNanoseconds;
+	uint64_t WaitCPUNanoseconds;
+	uint64_t WaitNanoseconds;
+
+	//How far each frame's start-to-start time landed from Period
+	uint32_t JitterHistogram[FRAME_PACER_HISTOGRAM_BUCKETS];
+};
+
+inline void
+InitializeFramePacer(frame_pacer* Pacer, uint64_t Period, uint64_t Now)
+{
+	*Pacer = {};
+	Pacer->Period = Period;
+	Pacer->NextDeadline = Now + Period;
+	Pacer->LastFrameStart = Now;
+	Pacer->Margin = FRAME_PACER_INITIAL_MARGIN_NANOSECONDS;
+}
+
+//The upper limit of Bucket - the last bucket has none
+inline uint64_t
+GetFramePacerBucketLimit(uint32_t Bucket)
+{
+	return(FRAME_PACER_HISTOGRAM_FIRST_LIMIT_NANOSECONDS << Bucket);
+}
+
+internal void
+UpdateFramePacerMargin(frame_pacer* Pacer, uint64_t Oversleep)
+{
+	Pacer->MaxOversleep = (Oversleep > Pacer->MaxOversleep) ? Oversleep : Pacer->MaxOversleep;
+	Pacer->Oversleeps[Pacer->OversleepCount++ % FRAME_PACER_HISTORY] = Oversleep;
+
+	uint32_t Count = (Pacer->OversleepCount < FRAME_PACER_HISTORY) ? Pacer->OversleepCount : FRAME_PACER_HISTORY;
+	uint64_t Sorted[FRAME_PACER_HISTORY];
+	for (uint32_t Index = 0; Index < Count; Index++)
+	{
+		uint64_t Value = Pacer->Oversleeps[Index];
+		uint32_t Insert = Index;
+		for (; (Insert > 0) && (Sorted[Insert - 1] > Value); --Insert)
+		{
+			Sorted[Insert] = Sorted[Insert - 1];
+		}
+		Sorted[Insert] = Value;
+	}
+	uint64_t Typical = Sorted[(Count - 1)*FRAME_PACER_MARGIN_PERCENTILE / 100];
+	Pacer->Margin = (uint64_t)(FRAME_PACER_MARGIN_SCALE*(float)Typical) + FRAME_PACER_MIN_SPIN_NANOSECONDS;
+}
+
+/*
+	Waits out the rest of the frame and returns the time the next one starts. A frame that is already due starts
+	now, and the schedule starts over from it rather than rushing to catch up.
+*/
+internal uint64_t
+WaitForNextFrame(frame_pacer* Pacer, frame_pacer_clock* Clock)
+{
+	uint64_t WaitStart = Clock->GetTime(Clock->Context);
+	uint64_t CPUStart = Clock->GetThreadCPUTime ? Clock->GetThreadCPUTime(Clock->Context) : 0;
+	uint64_t Deadline = Pacer->NextDeadline;
+	uint64_t Now = WaitStart;
+	if (Now >= Deadline)
+	{
+		++Pacer->MissedFrameCount;
+		Deadline = Now;
+	}
+	else
+	{
+		uint64_t WakeTime = Deadline - ((Pacer->Margin < Deadline) ? Pacer->Margin : Deadline);
+		if (WakeTime > Now)
+		{
+			Clock->SleepUntil(Clock->Context, WakeTime);
+			Now = Clock->GetTime(Clock->Context);
+			Pacer->SleepNanoseconds += Now - WaitStart;
+
+			Pacer->LateWakeCount += (Now > Deadline) ? 1 : 0;
+			UpdateFramePacerMargin(Pacer, (Now > WakeTime) ? Now - WakeTime : 0);
+		}
+
+		uint64_t SpinStart = Now;
+		while (Now < Deadline)
+		{
+			_mm_pause();
+			Now = Clock->GetTime(Clock->Context);
+		}
+		Pacer->SpinNanoseconds += Now - SpinStart;
+	}
+
+	Pacer->WaitNanoseconds += Now - WaitStart;
+	if (Clock->GetThreadCPUTime)
+	{
+		Pacer->WaitCPUNanoseconds += Clock->GetThreadCPUTime(Clock->Context) - CPUStart;
+	}
+
+	uint64_t FrameTime = Now - Pacer->LastFrameStart;
+	uint64_t Jitter = (FrameTime > Pacer->Period) ? FrameTime - Pacer->Period : Pacer->Period - FrameTime;
+	uint32_t Bucket = 0;
+	while ((Bucket < FRAME_PACER_HISTOGRAM_BUCKETS - 1) && (Jitter >= GetFramePacerBucketLimit(Bucket)))
+	{
+		++Bucket;
+	}
+	++Pacer->JitterHistogram[Bucket];
+
+	Pacer->LastFrameStart = Now;
+	Pacer->NextDeadline = Deadline + Pacer->Period;
+	++Pacer->FrameCount;
+	return(Now);
+}
+
+#endif
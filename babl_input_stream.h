@@ -0,0 +1,347 @@
+#if !defined(BABL_INPUT_STREAM_H)
+#define BABL_INPUT_STREAM_H
+
+/*
+	.ir input recordings - one game_input_buffer per frame, delta-encoded against the frame before.
+
+	[input_stream_header][frame 0][frame 1]...[input_stream_index_entry x IndexCount]
+
+	The input is treated as an array of 32-bit words and each frame stores only the words that changed,
+	XORed with their old value:
+		varint GroupMask                  one bit per group of 8 words
+		u8 WordMask                       per set group, one bit per word in it
+		varint XorValue                   per set word
+	An unchanged frame is the single byte 0. Every KeyframeInterval frames the frame is encoded against
+	all-zero input instead, and its offset goes in the index, so a reader can seek there and decode forward.
+	The header is rewritten with the final counts when recording ends; a stream cut short (crash) still
+	plays back, it just has no index. Bit-exact, padding bytes included. Little-endian only.
+*/
+
+#define INPUT_STREAM_CODE(a, b, c, d) (((uint32_t)(a) << 0) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define INPUT_STREAM_MAGIC_VALUE INPUT_STREAM_CODE('b', 'i', 'n', 'p')
+#define INPUT_STREAM_VERSION 1
+
+#define INPUT_STREAM_KEYFRAME_INTERVAL 256
+#define INPUT_STREAM_MAX_INDEX 4096
+
+#define INPUT_STREAM_WORD_COUNT ((sizeof(game_input_buffer) + 3) / 4)
+#define INPUT_STREAM_GROUP_COUNT ((INPUT_STREAM_WORD_COUNT + 7) / 8)
+
+//Group masks are a single varint
+static_assert(INPUT_STREAM_GROUP_COUNT < 64, "game_input_buffer has outgrown the input stream format");
+
+//Worst case: every word changed, each taking a 5-byte varint
+#define INPUT_STREAM_MAX_FRAME_SIZE (10 + INPUT_STREAM_GROUP_COUNT + 5*INPUT_STREAM_WORD_COUNT)
+
+struct input_stream_header
+{
+	uint32_t MagicValue;
+	uint32_t Version;
+
+	//sizeof(game_input_buffer) when recorded - a stream from a different layout will not load
+	uint32_t InputSize;
+	uint32_t KeyframeInterval;
+
+	uint32_t FrameCount;
+	uint32_t IndexCount;
+	uint64_t IndexOffset;
+};
+
+struct input_stream_index_entry
+{
+	uint32_t FrameIndex;
+	uint32_t Reserved;
+	uint64_t Offset;
+};
+
+//Word view of one frame of input, padded out to whole words
+union input_stream_frame
+{
+	game_input_buffer Input;
+	uint32_t Words[INPUT_STREAM_WORD_COUNT];
+};
+
+struct input_stream_writer
+{
+	input_stream_frame Previous;
+	uint32_t FrameCount;
+	uint64_t Offset;
+
+	uint32_t IndexCount;
+	input_stream_index_entry Index[INPUT_STREAM_MAX_INDEX];
+};
+
+struct input_stream_reader
+{
+	input_stream_header* Header;
+	uint8_t* Data;
+	uint64_t Size;
+	uint64_t FramesEnd;
+	uint8_t* Index;
+
+	uint64_t At;
+	uint32_t FrameIndex;
+	input_stream_frame Previous;
+};
+
+inline uint32_t
+WriteVarint(uint8_t* Dest, uint64_t Value)
+{
+	uint32_t Count = 0;
+	do
+	{
+		uint8_t Byte = (uint8_t)(Value & 0x7F);
+		Value >>= 7;
+		Dest[Count++] = Byte | (Value ? 0x80 : 0);
+	} while (Value);
+	return(Count);
+}
+
+inline bool32
+ReadVarint(input_stream_reader* Reader, uint64_t* Value)
+{
+	uint64_t Result = 0;
+	for (uint32_t Shift = 0; Shift < 64; Shift += 7)
+	{
+		if (Reader->At >= Reader->FramesEnd)
+		{
+			return(false);
+		}
+		uint8_t Byte = Reader->Data[Reader->At++];
+		Result |= (uint64_t)(Byte & 0x7F) << Shift;
+		if (!(Byte & 0x80))
+		{
+			*Value = Result;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+//
+// Writing
+//
+
+inline input_stream_header
+MakeInputStreamHeader(input_stream_writer* Writer)
+{
+	input_stream_header Header = {};
+	Header.MagicValue = INPUT_STREAM_MAGIC_VALUE;
+	Header.Version = INPUT_STREAM_VERSION;
+	Header.InputSize = sizeof(game_input_buffer);
+	Header.KeyframeInterval = INPUT_STREAM_KEYFRAME_INTERVAL;
+	Header.FrameCount = Writer->FrameCount;
+	Header.IndexCount = Writer->IndexCount;
+	Header.IndexOffset = Writer->IndexCount ? Writer->Offset : 0;
+	return(Header);
+}
+
+//Returns the header to write first - it gets rewritten by EndInputStream
+internal input_stream_header
+BeginInputStream(input_stream_writer* Writer)
+{
+	*Writer = {};
+	Writer->Offset = sizeof(input_stream_header);
+	return(MakeInputStreamHeader(Writer));
+}
+
+//Encodes one frame into Dest (at least INPUT_STREAM_MAX_FRAME_SIZE bytes), returns the bytes written
+internal uint32_t
+EncodeInputFrame(input_stream_writer* Writer, game_input_buffer* Input, uint8_t* Dest)
+{
+	input_stream_frame Current = {};
+	Current.Input = *Input;
+
+	if ((Writer->FrameCount % INPUT_STREAM_KEYFRAME_INTERVAL) == 0)
+	{
+		Writer->Previous = {};
+		if (Writer->IndexCount < ArrayCount(Writer->Index))
+		{
+			input_stream_index_entry* Entry = &Writer->Index[Writer->IndexCount++];
+			Entry->FrameIndex = Writer->FrameCount;
+			Entry->Reserved = 0;
+			Entry->Offset = Writer->Offset;
+		}
+	}
+
+	uint64_t GroupMask = 0;
+	uint8_t WordMasks[INPUT_STREAM_GROUP_COUNT] = {};
+	for (uint32_t WordIndex = 0; WordIndex < INPUT_STREAM_WORD_COUNT; WordIndex++)
+	{
+		if (Current.Words[WordIndex] != Writer->Previous.Words[WordIndex])
+		{
+			GroupMask |= 1ULL << (WordIndex / 8);
+			WordMasks[WordIndex / 8] |= (uint8_t)(1 << (WordIndex % 8));
+		}
+	}
+
+	uint32_t Size = WriteVarint(Dest, GroupMask);
+	for (uint32_t GroupIndex = 0; GroupIndex < INPUT_STREAM_GROUP_COUNT; GroupIndex++)
+	{
+		if (WordMasks[GroupIndex])
+		{
+			Dest[Size++] = WordMasks[GroupIndex];
+			for (uint32_t Bit = 0; Bit < 8; Bit++)
+			{
+				if (WordMasks[GroupIndex] & (1 << Bit))
+				{
+					uint32_t WordIndex = GroupIndex*8 + Bit;
+					Size += WriteVarint(Dest + Size, Current.Words[WordIndex] ^ Writer->Previous.Words[WordIndex]);
+				}
+			}
+		}
+	}
+
+	Writer->Previous = Current;
+	++Writer->FrameCount;
+	Writer->Offset += Size;
+	return(Size);
+}
+
+//The final header - write Writer->Index (IndexCount entries) at Header.IndexOffset, then this over the first one
+internal input_stream_header
+EndInputStream(input_stream_writer* Writer)
+{
+	return(MakeInputStreamHeader(Writer));
+}
+
+//
+// Reading
+//
+
+//The index follows the frames directly, so in a mapped file it is only byte-aligned
+inline input_stream_index_entry
+GetInputStreamIndexEntry(input_stream_reader* Reader, uint32_t EntryIndex)
+{
+	input_stream_index_entry Result;
+	memcpy(&Result, Reader->Index + EntryIndex*sizeof(input_stream_index_entry), sizeof(Result));
+	return(Result);
+}
+
+//Memory is the whole file, which has to outlive the reader
+internal bool32
+OpenInputStream(input_stream_reader* Reader, void* Memory, uint64_t Size)
+{
+	*Reader = {};
+	input_stream_header* Header = (input_stream_header*)Memory;
+	if (!Memory || (Size < sizeof(input_stream_header)) ||
+		(Header->MagicValue != INPUT_STREAM_MAGIC_VALUE) || (Header->Version != INPUT_STREAM_VERSION) ||
+		(Header->InputSize != sizeof(game_input_buffer)))
+	{
+		return(false);
+	}
+
+	Reader->Header = Header;
+	Reader->Data = (uint8_t*)Memory;
+	Reader->Size = Size;
+	Reader->FramesEnd = Size;
+	Reader->At = sizeof(input_stream_header);
+
+	//No index (or a damaged one) just means no seeking - the frames are still good
+	uint64_t IndexSize = (uint64_t)Header->IndexCount*sizeof(input_stream_index_entry);
+	if (Header->IndexCount && (Header->IndexOffset >= sizeof(input_stream_header)) &&
+		(Header->IndexOffset <= Size) && (IndexSize <= Size - Header->IndexOffset))
+	{
+		Reader->Index = Reader->Data + Header->IndexOffset;
+		Reader->FramesEnd = Header->IndexOffset;
+	}
+	return(true);
+}
+
+internal bool32
+DecodeNextInputFrame(input_stream_reader* Reader, game_input_buffer* Input)
+{
+	uint32_t KeyframeInterval = Reader->Header->KeyframeInterval;
+	if (KeyframeInterval && ((Reader->FrameIndex % KeyframeInterval) == 0))
+	{
+		Reader->Previous = {};
+	}
+
+	uint64_t GroupMask;
+	if (!ReadVarint(Reader, &GroupMask) || (GroupMask >> INPUT_STREAM_GROUP_COUNT))
+	{
+		return(false);
+	}
+
+	input_stream_frame Current = Reader->Previous;
+	for (uint32_t GroupIndex = 0; GroupIndex < INPUT_STREAM_GROUP_COUNT; GroupIndex++)
+	{
+		if (GroupMask & (1ULL << GroupIndex))
+		{
+			if (Reader->At >= Reader->FramesEnd)
+			{
+				return(false);
+			}
+			uint8_t WordMask = Reader->Data[Reader->At++];
+			for (uint32_t Bit = 0; Bit < 8; Bit++)
+			{
+				if (WordMask & (1 << Bit))
+				{
+					uint32_t WordIndex = GroupIndex*8 + Bit;
+					uint64_t Xor;
+					if ((WordIndex >= INPUT_STREAM_WORD_COUNT) || !ReadVarint(Reader, &Xor))
+					{
+						return(false);
+					}
+					Current.Words[WordIndex] ^= (uint32_t)Xor;
+				}
+			}
+		}
+	}
+
+	Reader->Previous = Current;
+	++Reader->FrameIndex;
+	*Input = Current.Input;
+	return(true);
+}
+
+//Puts the reader at FrameIndex: jumps to the closest keyframe at or before it through the index, then decodes forward
+internal bool32
+SeekInputStream(input_stream_reader* Reader, uint32_t FrameIndex)
+{
+	uint32_t StartFrame = 0;
+	uint64_t StartOffset = sizeof(input_stream_header);
+	if (Reader->Index)
+	{
+		//Entries are in frame order, so binary search for the last one not past FrameIndex
+		uint32_t Low = 0;
+		uint32_t High = Reader->Header->IndexCount;
+		while (Low < High)
+		{
+			uint32_t Middle = (Low + High) / 2;
+			if (GetInputStreamIndexEntry(Reader, Middle).FrameIndex <= FrameIndex)
+			{
+				Low = Middle + 1;
+			}
+			else
+			{
+				High = Middle;
+			}
+		}
+		if (Low)
+		{
+			input_stream_index_entry Entry = GetInputStreamIndexEntry(Reader, Low - 1);
+			if ((Entry.Offset >= sizeof(input_stream_header)) && (Entry.Offset < Reader->FramesEnd))
+			{
+				StartFrame = Entry.FrameIndex;
+				StartOffset = Entry.Offset;
+			}
+		}
+	}
+
+	Reader->At = StartOffset;
+	Reader->FrameIndex = StartFrame;
+	Reader->Previous = {};
+
+	game_input_buffer Skipped;
+	while (Reader->FrameIndex < FrameIndex)
+	{
+		if (!DecodeNextInputFrame(Reader, &Skipped))
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+#endif
@@ -0,0 +1,122 @@
+#if !defined(BABL_INTRINSICS_H)
+#define BABL_INTRINSICS_H
+
+//Anything that talks to the CPU directly lives here, so the rest of the game never has to care which compiler built it
+//MSVC hands us every intrinsic regardless of /arch, GCC and Clang want each function tagged with the ISA it uses
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BABL_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define BABL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+//x86 doesn't reorder stores with other stores, loads with other loads, or loads with later stores,
+//so all we need is to stop the compiler doing it
+#if defined(_MSC_VER)
+#define CompletePreviousWritesBeforeFutureWrites _WriteBarrier()
+#define CompletePreviousReadsBeforeFutureReads _ReadBarrier()
+#define CompletePreviousReadsBeforeFutureWrites _ReadWriteBarrier()
+#else
+#define CompletePreviousWritesBeforeFutureWrites __asm__ volatile("" ::: "memory")
+#define CompletePreviousReadsBeforeFutureReads __asm__ volatile("" ::: "memory")
+#define CompletePreviousReadsBeforeFutureWrites __asm__ volatile("" ::: "memory")
+#endif
+
+inline uint32_t
+AtomicCompareExchangeUInt32(uint32_t volatile* Value, uint32_t New, uint32_t Expected)
+{
+#if defined(_MSC_VER)
+	return((uint32_t)_InterlockedCompareExchange((long volatile*)Value, (long)New, (long)Expected));
+#else
+	return(__sync_val_compare_and_swap(Value, Expected, New));
+#endif
+}
+
+//Returns the value from before the add
+inline uint32_t
+AtomicAddUInt32(uint32_t volatile* Value, uint32_t Addend)
+{
+#if defined(_MSC_VER)
+	return((uint32_t)_InterlockedExchangeAdd((long volatile*)Value, (long)Addend));
+#else
+	return(__sync_fetch_and_add(Value, Addend));
+#endif
+}
+
+//Unique among the threads running right now, and one instruction to read - the thread's own block, which the OS
+//keeps in GS on Windows and FS on Linux
+inline uint64_t
+GetThreadID()
+{
+#if defined(_MSC_VER)
+	uint8_t* ThreadLocalStorage = (uint8_t*)__readgsqword(0x30);
+	return(*(uint32_t*)(ThreadLocalStorage + 0x48));
+#else
+	uint64_t Result;
+	__asm__("mov %%fs:0, %0" : "=r"(Result));
+	return(Result);
+#endif
+}
+
+struct cpu_features
+{
+	bool32 SSE2;
+	bool32 AVX2;
+};
+
+inline void
+CPUID(int Leaf, int SubLeaf, uint32_t* Registers)
+{
+#if defined(_MSC_VER)
+	__cpuidex((int*)Registers, Leaf, SubLeaf);
+#else
+	__cpuid_count(Leaf, SubLeaf, Registers[0], Registers[1], Registers[2], Registers[3]);
+#endif
+}
+
+inline uint64_t
+ReadXCR0()
+{
+#if defined(_MSC_VER)
+	return(_xgetbv(0));
+#else
+	uint32_t Low, High;
+	__asm__ volatile("xgetbv" : "=a"(Low), "=d"(High) : "c"(0));
+	return(((uint64_t)High << 32) | Low);
+#endif
+}
+
+//AVX2 being reported by the chip is not enough - the OS also has to save the YMM registers on a context switch (OSXSAVE + XCR0)
+inline cpu_features
+DetectCPUFeatures()
+{
+	cpu_features Result = {};
+
+	uint32_t Registers[4] = {};
+	CPUID(0, 0, Registers);
+	uint32_t MaxLeaf = Registers[0];
+
+	if (MaxLeaf >= 1)
+	{
+		CPUID(1, 0, Registers);
+		Result.SSE2 = (Registers[3] & (1 << 26)) != 0;
+
+		bool32 OSXSave = (Registers[2] & (1 << 27)) != 0;
+		bool32 AVX = (Registers[2] & (1 << 28)) != 0;
+		bool32 OSSavesYMM = OSXSave && ((ReadXCR0() & 0x6) == 0x6);
+
+		if (MaxLeaf >= 7 && AVX && OSSavesYMM)
+		{
+			CPUID(7, 0, Registers);
+			Result.AVX2 = (Registers[1] & (1 << 5)) != 0;
+		}
+	}
+
+	return(Result);
+}
+
+#endif
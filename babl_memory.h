@@ -0,0 +1,184 @@
+#if !defined(BABL_MEMORY_H)
+#define BABL_MEMORY_H
+
+/*
+	Linear arenas over the blocks the platform hands us. Nothing is ever freed individually - an arena is
+	reset as a whole, or rolled back to where a temporary_memory scope began. Scopes nest, but must end
+	in the reverse order they began (CheckArena catches a scope that was never closed).
+	Sub-arenas are carved out of a parent and then live independently of it.
+
+	Arenas over reserved memory commit as they grow: a push past CommittedSize asks the platform for the
+	pages first, and comes back 0 if the platform refuses (commit ceiling hit).
+*/
+#define PLATFORM_COMMIT_MEMORY(name) bool32 name(void* Memory, uint64_t Size)
+typedef PLATFORM_COMMIT_MEMORY(platform_commit_memory);
+
+//Copied out of game_memory at the top of every game entry point - 0 when the platform commits everything up front
+global_variable platform_commit_memory* PlatformCommitMemory;
+
+#define ARENA_COMMIT_GRANULARITY Kilobytes(64)
+
+//Declared from its member list (see babl_meta.h), since game_state holds one across hot reloads.
+//CommittedSize: everything below this offset is known to be committed.
+//HighWaterMark: most this arena has ever had pushed onto it, scopes included - what to size the backing block by
+#define MEMORY_ARENA_MEMBERS(Member) \
+	Member(memory_arena, uint64_t, Size) \
+	Member(memory_arena, uint8_t*, Base) \
+	Member(memory_arena, uint64_t, Used) \
+	Member(memory_arena, uint64_t, CommittedSize) \
+	Member(memory_arena, uint64_t, HighWaterMark) \
+	Member(memory_arena, int32_t, TempCount)
+
+struct memory_arena
+{
+	MEMORY_ARENA_MEMBERS(META_DECLARE_MEMBER)
+};
+
+struct temporary_memory
+{
+	memory_arena* Arena;
+	uint64_t Used;
+};
+
+#define DEFAULT_ARENA_ALIGNMENT 8
+
+inline void
+InitializeArena(memory_arena* Arena, uint64_t Size, void* Base)
+{
+	Arena->Size = Size;
+	Arena->Base = (uint8_t*)Base;
+	Arena->Used = 0;
+	Arena->CommittedSize = Size;
+	Arena->HighWaterMark = 0;
+	Arena->TempCount = 0;
+}
+
+inline void
+InitializeReservedArena(memory_arena* Arena, uint64_t Size, void* Base)
+{
+	InitializeArena(Arena, Size, Base);
+	if (PlatformCommitMemory)
+	{
+		Arena->CommittedSize = 0;
+	}
+}
+
+inline uint64_t
+GetAlignmentOffset(memory_arena* Arena, uint64_t Alignment)
+{
+	//Alignment must be a power of two
+	Assert((Alignment & (Alignment - 1)) == 0);
+	uint64_t ResultPointer = (uint64_t)(uintptr_t)(Arena->Base + Arena->Used);
+	uint64_t AlignmentMask = Alignment - 1;
+	uint64_t AlignmentOffset = (ResultPointer & AlignmentMask) ? Alignment - (ResultPointer & AlignmentMask) : 0;
+	return(AlignmentOffset);
+}
+
+inline uint64_t
+GetArenaSizeRemaining(memory_arena* Arena, uint64_t Alignment = DEFAULT_ARENA_ALIGNMENT)
+{
+	uint64_t Consumed = Arena->Used + GetAlignmentOffset(Arena, Alignment);
+	uint64_t Result = (Consumed < Arena->Size) ? Arena->Size - Consumed : 0;
+	return(Result);
+}
+
+//Commits [Offset, Offset + Size), rounding the end up so a run of small pushes does not call the platform each time
+inline bool32
+CommitArenaRange(memory_arena* Arena, uint64_t Offset, uint64_t Size)
+{
+	uint64_t End = Offset + Size;
+	uint64_t RoundedEnd = (End + ARENA_COMMIT_GRANULARITY - 1) & ~(uint64_t)(ARENA_COMMIT_GRANULARITY - 1);
+	RoundedEnd = (RoundedEnd > Arena->Size) ? Arena->Size : RoundedEnd;
+	uint64_t Start = (Offset > Arena->CommittedSize) ? Offset : Arena->CommittedSize;
+
+	bool32 Result = PlatformCommitMemory(Arena->Base + Start, RoundedEnd - Start);
+	if (!Result && (RoundedEnd > End))
+	{
+		//Near the ceiling the rounding alone can be what does not fit
+		RoundedEnd = End;
+		Result = PlatformCommitMemory(Arena->Base + Start, RoundedEnd - Start);
+	}
+
+	//Only a push that starts inside the committed prefix extends it - one above an uncommitted hole cannot
+	if (Result && (Start == Arena->CommittedSize))
+	{
+		Arena->CommittedSize = RoundedEnd;
+	}
+	return(Result);
+}
+
+//Claims address space only - whoever uses it commits what they touch through PlatformCommitMemory. Until they do
+//it is a hole the committed prefix cannot grow past, so every push above it goes back to the platform
+inline void*
+PushUncommittedSize(memory_arena* Arena, uint64_t Size, uint64_t Alignment = DEFAULT_ARENA_ALIGNMENT)
+{
+	uint64_t Offset = Arena->Used + GetAlignmentOffset(Arena, Alignment);
+	Assert(Offset + Size <= Arena->Size);
+	if (Offset + Size > Arena->Size)
+	{
+		return(0);
+	}
+
+	Arena->Used = Offset + Size;
+	if (Arena->Used > Arena->HighWaterMark)
+	{
+		Arena->HighWaterMark = Arena->Used;
+	}
+	return(Arena->Base + Offset);
+}
+
+#define PushStruct(Arena, type, ...) (type*)PushSize_(Arena, sizeof(type), ## __VA_ARGS__)
+#define PushArray(Arena, Count, type, ...) (type*)PushSize_(Arena, (Count)*sizeof(type), ## __VA_ARGS__)
+#define PushSize(Arena, Size, ...) PushSize_(Arena, Size, ## __VA_ARGS__)
+inline void*
+PushSize_(memory_arena* Arena, uint64_t Size, uint64_t Alignment = DEFAULT_ARENA_ALIGNMENT)
+{
+	uint64_t Offset = Arena->Used + GetAlignmentOffset(Arena, Alignment);
+	if ((Offset + Size > Arena->CommittedSize) && (Offset + Size <= Arena->Size) &&
+		!CommitArenaRange(Arena, Offset, Size))
+	{
+		return(0);
+	}
+	return(PushUncommittedSize(Arena, Size, Alignment));
+}
+
+//The child starts empty; the parent only ever sees it as one push of Size bytes, and commits none of it
+inline void
+SubArena(memory_arena* Result, memory_arena* Arena, uint64_t Size, uint64_t Alignment = 16)
+{
+	uint8_t* Base = (uint8_t*)PushUncommittedSize(Arena, Size, Alignment);
+	InitializeArena(Result, Base ? Size : 0, Base);
+
+	uint64_t Offset = Base ? (uint64_t)(Base - Arena->Base) : 0;
+	uint64_t CommittedAbove = (Arena->CommittedSize > Offset) ? Arena->CommittedSize - Offset : 0;
+	Result->CommittedSize = (CommittedAbove < Result->Size) ? CommittedAbove : Result->Size;
+}
+
+inline temporary_memory
+BeginTemporaryMemory(memory_arena* Arena)
+{
+	temporary_memory Result;
+	Result.Arena = Arena;
+	Result.Used = Arena->Used;
+	++Arena->TempCount;
+	return(Result);
+}
+
+inline void
+EndTemporaryMemory(temporary_memory TempMem)
+{
+	memory_arena* Arena = TempMem.Arena;
+	Assert(Arena->Used >= TempMem.Used);
+	Assert(Arena->TempCount > 0);
+	Arena->Used = TempMem.Used;
+	--Arena->TempCount;
+}
+
+//Call once per frame on arenas that use temporary memory - every scope opened this frame should be closed
+inline void
+CheckArena(memory_arena* Arena)
+{
+	Assert(Arena->TempCount == 0);
+}
+
+#endif
@@ -0,0 +1,204 @@
+#include <string.h>
+
+#include "babl_meta.h"
+
+global_variable member_definition MembersOf_memory_arena[] = {MEMORY_ARENA_MEMBERS(META_MEMBER_DEFINITION)};
+
+internal member_definition*
+GetMetaStructMembers(meta_type Type, uint32_t* MemberCount)
+{
+	member_definition* Result = 0;
+	*MemberCount = 0;
+	switch (Type)
+	{
+		case MetaType_memory_arena:
+		{
+			Result = MembersOf_memory_arena;
+			*MemberCount = (uint32_t)ArrayCount(MembersOf_memory_arena);
+		} break;
+
+		default:
+		{
+		} break;
+	}
+	return(Result);
+}
+
+internal void
+FlattenMembers(meta_layout* Layout, member_definition* Members, uint32_t MemberCount, char* Prefix, uint32_t BaseOffset)
+{
+	for (uint32_t MemberIndex = 0; MemberIndex < MemberCount; MemberIndex++)
+	{
+		member_definition* Member = &Members[MemberIndex];
+
+		//Names cut short could match the wrong member after a reload
+		Assert(strlen(Prefix) + strlen(Member->Name) + 1 < META_MAX_NAME_LENGTH);
+		char Name[META_MAX_NAME_LENGTH] = {};
+		int NameLength = 0;
+		for (char* At = Prefix; *At && (NameLength < META_MAX_NAME_LENGTH - 1); ++At)
+		{
+			Name[NameLength++] = *At;
+		}
+		for (char* At = Member->Name; *At && (NameLength < META_MAX_NAME_LENGTH - 1); ++At)
+		{
+			Name[NameLength++] = *At;
+		}
+		Name[NameLength] = 0;
+
+		uint32_t SubMemberCount;
+		member_definition* SubMembers = GetMetaStructMembers(Member->Type, &SubMemberCount);
+		if (SubMembers)
+		{
+			Name[NameLength++] = '.';
+			Name[NameLength] = 0;
+			FlattenMembers(Layout, SubMembers, SubMemberCount, Name, BaseOffset + Member->Offset);
+		}
+		else
+		{
+			Assert(Layout->MemberCount < META_MAX_LAYOUT_MEMBERS);
+			if (Layout->MemberCount < META_MAX_LAYOUT_MEMBERS)
+			{
+				meta_layout_member* Dest = &Layout->Members[Layout->MemberCount++];
+				Dest->Type = Member->Type;
+				Dest->Offset = BaseOffset + Member->Offset;
+				Dest->Size = Member->Size;
+				memcpy(Dest->Name, Name, sizeof(Name));
+			}
+		}
+	}
+}
+
+//Version is FNV-1a over the whole flattened layout, never 0 so that a zeroed layout matches nothing
+internal void
+BuildMetaLayout(meta_layout* Layout, member_definition* Members, uint32_t MemberCount, uint32_t Size)
+{
+	memset(Layout, 0, sizeof(*Layout));
+	Layout->Size = Size;
+	FlattenMembers(Layout, Members, MemberCount, "", 0);
+
+	uint64_t Hash = 14695981039346656037ULL;
+	uint8_t* Bytes = (uint8_t*)&Layout->Size;
+	uint64_t ByteCount = sizeof(Layout->Size) + sizeof(Layout->MemberCount) + Layout->MemberCount*sizeof(meta_layout_member);
+	for (uint64_t Index = 0; Index < ByteCount; Index++)
+	{
+		Hash = (Hash ^ Bytes[Index])*1099511628211ULL;
+	}
+	Layout->Version = Hash ? Hash : 1;
+}
+
+inline bool32
+IsMetaTypeInteger(uint32_t Type)
+{
+	return((Type == MetaType_int32) || (Type == MetaType_uint32) || (Type == MetaType_int64) || (Type == MetaType_uint64));
+}
+
+inline bool32
+IsMetaTypeReal(uint32_t Type)
+{
+	return((Type == MetaType_float) || (Type == MetaType_double));
+}
+
+//Integers convert among themselves as C converts them; reals going to integers are clamped to the integer's range
+//first, then truncated toward zero as a C cast would
+internal void
+ConvertMetaScalar(uint32_t SourceType, void* Source, uint32_t DestType, void* Dest)
+{
+	bool32 IsInteger = IsMetaTypeInteger(SourceType);
+	int64_t Integer = 0;
+	double Real = 0.0;
+	switch (SourceType)
+	{
+		case MetaType_int32: {Integer = *(int32_t*)Source;} break;
+		case MetaType_uint32: {Integer = *(uint32_t*)Source;} break;
+		case MetaType_int64: {Integer = *(int64_t*)Source;} break;
+		case MetaType_uint64: {Integer = (int64_t)*(uint64_t*)Source;} break;
+		case MetaType_float: {Real = *(float*)Source;} break;
+		case MetaType_double: {Real = *(double*)Source;} break;
+		default: {} break;
+	}
+
+	if (IsInteger)
+	{
+		Real = (SourceType == MetaType_uint64) ? (double)(uint64_t)Integer : (double)Integer;
+	}
+	else if (IsMetaTypeInteger(DestType))
+	{
+		double Min = (DestType == MetaType_int32) ? -2147483648.0 : (DestType == MetaType_int64) ? -9223372036854775808.0 : 0.0;
+		double Max = (DestType == MetaType_int32) ? 2147483647.0 : (DestType == MetaType_uint32) ? 4294967295.0 :
+			(DestType == MetaType_int64) ? 9223372036854775807.0 : 18446744073709551615.0;
+		Real = (Real != Real) ? 0.0 : (Real < Min) ? Min : (Real > Max) ? Max : Real;
+		if (DestType == MetaType_uint64)
+		{
+			uint64_t Unsigned = (Real >= 18446744073709551615.0) ? 0xFFFFFFFFFFFFFFFFULL : (uint64_t)Real;
+			Integer = (int64_t)Unsigned;
+		}
+		else
+		{
+			Integer = (Real >= 9223372036854775807.0) ? 0x7FFFFFFFFFFFFFFFLL : (int64_t)Real;
+		}
+	}
+
+	switch (DestType)
+	{
+		case MetaType_int32: {*(int32_t*)Dest = (int32_t)Integer;} break;
+		case MetaType_uint32: {*(uint32_t*)Dest = (uint32_t)Integer;} break;
+		case MetaType_int64: {*(int64_t*)Dest = Integer;} break;
+		case MetaType_uint64: {*(uint64_t*)Dest = (uint64_t)Integer;} break;
+		case MetaType_float: {*(float*)Dest = (float)Real;} break;
+		case MetaType_double: {*(double*)Dest = Real;} break;
+		default: {} break;
+	}
+}
+
+/*
+	Carries Old, laid out as OldLayout, across into New, laid out as NewLayout, member by member name. New should
+	already hold its defaults - whatever the old layout has no (convertible) member for keeps them. A member whose
+	type changed between scalar types is converted; pointers only carry over to pointers.
+*/
+internal meta_migration
+MigrateMembers(meta_layout* OldLayout, void* Old, meta_layout* NewLayout, void* New)
+{
+	meta_migration Result = {};
+	uint32_t MatchedOldCount = 0;
+	for (uint32_t NewIndex = 0; NewIndex < NewLayout->MemberCount; NewIndex++)
+	{
+		meta_layout_member* NewMember = &NewLayout->Members[NewIndex];
+		meta_layout_member* OldMember = 0;
+		for (uint32_t OldIndex = 0; OldIndex < OldLayout->MemberCount; OldIndex++)
+		{
+			if (strcmp(OldLayout->Members[OldIndex].Name, NewMember->Name) == 0)
+			{
+				OldMember = &OldLayout->Members[OldIndex];
+				break;
+			}
+		}
+
+		//A stored layout is only as good as the memory it was found in
+		bool32 OldIsInBounds = OldMember && (OldMember->Offset + OldMember->Size <= OldLayout->Size);
+		uint8_t* Source = (uint8_t*)Old + (OldMember ? OldMember->Offset : 0);
+		uint8_t* Dest = (uint8_t*)New + NewMember->Offset;
+		if (!OldIsInBounds)
+		{
+			++Result.DefaultedCount;
+		}
+		else if ((OldMember->Type == NewMember->Type) && (OldMember->Size == NewMember->Size))
+		{
+			memcpy(Dest, Source, NewMember->Size);
+			++Result.CopiedCount;
+			++MatchedOldCount;
+		}
+		else if ((IsMetaTypeInteger(OldMember->Type) || IsMetaTypeReal(OldMember->Type)) &&
+			(IsMetaTypeInteger(NewMember->Type) || IsMetaTypeReal(NewMember->Type)))
+		{
+			ConvertMetaScalar(OldMember->Type, Source, NewMember->Type, Dest);
+			++Result.ConvertedCount;
+			++MatchedOldCount;
+		}
+		else
+		{
+			++Result.DefaultedCount;
+		}
+	}
+	Result.DroppedCount = OldLayout->MemberCount - MatchedOldCount;
+	return(Result);
+}
@@ -0,0 +1,92 @@
+#if !defined(BABL_META_H)
+#define BABL_META_H
+
+#include <stddef.h>
+
+/*
+	Compile-time descriptions of the structs that outlive a hot reload. Such a struct is declared from a member list,
+
+		#define THING_MEMBERS(Member) \
+			Member(thing, int32_t, Count) \
+			Member(thing, memory_arena, Arena)
+
+		struct thing
+		{
+			THING_MEMBERS(META_DECLARE_MEMBER)
+		};
+
+	and the same list expands into a member_definition table, so the description can never fall behind the struct.
+	Members are scalars, pointers, or structs with member lists of their own (which need a MetaType_ and a
+	GetMetaType overload); no arrays. A type with no GetMetaType is a compile error, not a silently skipped member.
+*/
+enum meta_type
+{
+	MetaType_int32,
+	MetaType_uint32,
+	MetaType_int64,
+	MetaType_uint64,
+	MetaType_float,
+	MetaType_double,
+	MetaType_pointer,
+
+	//Structs with member lists
+	MetaType_memory_arena,
+};
+
+struct member_definition
+{
+	meta_type Type;
+	char* Name;
+	uint32_t Offset;
+	uint32_t Size;
+};
+
+#define META_DECLARE_MEMBER(Struct, Type, Name) Type Name;
+#define META_MEMBER_DEFINITION(Struct, Type, Name) {GetMetaType((Type*)0), #Name, (uint32_t)offsetof(Struct, Name), (uint32_t)sizeof(Type)},
+
+inline meta_type GetMetaType(int32_t*) {return(MetaType_int32);}
+inline meta_type GetMetaType(uint32_t*) {return(MetaType_uint32);}
+inline meta_type GetMetaType(int64_t*) {return(MetaType_int64);}
+inline meta_type GetMetaType(uint64_t*) {return(MetaType_uint64);}
+inline meta_type GetMetaType(float*) {return(MetaType_float);}
+inline meta_type GetMetaType(double*) {return(MetaType_double);}
+template <typename Type> inline meta_type GetMetaType(Type**) {return(MetaType_pointer);}
+
+struct memory_arena;
+inline meta_type GetMetaType(memory_arena*) {return(MetaType_memory_arena);}
+
+/*
+	A struct's layout flattened to its scalars and pointers, named by their path ("PermanentArena.Used"). This is
+	what gets stored next to the struct, so a later build can tell what the bytes it finds there were - Version is
+	a hash of all of it, and any change to a name, type, offset or size changes it.
+*/
+#define META_MAX_LAYOUT_MEMBERS 128
+#define META_MAX_NAME_LENGTH 52
+
+struct meta_layout_member
+{
+	uint32_t Type;
+	uint32_t Offset;
+	uint32_t Size;
+	char Name[META_MAX_NAME_LENGTH];
+};
+
+struct meta_layout
+{
+	uint64_t Version;
+	uint32_t Size;
+	uint32_t MemberCount;
+	meta_layout_member Members[META_MAX_LAYOUT_MEMBERS];
+};
+
+//What a migration did with each member: copied as it was, converted to a new type, or left at the new default
+//because the old layout had nothing of that name (or nothing convertible); Dropped are old members with no home
+struct meta_migration
+{
+	uint32_t CopiedCount;
+	uint32_t ConvertedCount;
+	uint32_t DefaultedCount;
+	uint32_t DroppedCount;
+};
+
+#endif
@@ -0,0 +1,219 @@
+/*
+	Offline asset packer - turns source images into a .bpak the game can memory-map and use as-is.
+
+	babl_packer <output.bpak> <image.png> [image.png...]
+
+	Each image is stored under its file name without directory or extension ("l_fern.png" -> "l_fern").
+	This is a build tool, so unlike the game it is free to use the CRT heap and stdio.
+*/
+#include "babl.h"
+#include "babl_intrinsics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "babl_png.cpp"
+#include "babl_asset_pack.h"
+
+struct packer_bitmap
+{
+	char Name[BPAK_MAX_NAME];
+	loaded_bitmap Bitmap;
+	void* DecodeMemory;
+};
+
+internal void*
+ReadEntireFile(char* Filename, uint32_t* Size)
+{
+	void* Result = 0;
+	FILE* File = fopen(Filename, "rb");
+	if (File)
+	{
+		fseek(File, 0, SEEK_END);
+		long FileSize = ftell(File);
+		fseek(File, 0, SEEK_SET);
+		if (FileSize > 0)
+		{
+			Result = malloc(FileSize);
+			if (Result && fread(Result, 1, FileSize, File) == (size_t)FileSize)
+			{
+				*Size = (uint32_t)FileSize;
+			}
+			else
+			{
+				free(Result);
+				Result = 0;
+			}
+		}
+		fclose(File);
+	}
+	return(Result);
+}
+
+//The same stamp the game's PlatformGetFileStamp gives, so the two compare equal while the source is untouched
+internal platform_file_stamp
+GetSourceStamp(char* Path)
+{
+	platform_file_stamp Result = {};
+#if defined(_WIN32)
+	struct _stat64 Status;
+	Result.Exists = (_stat64(Path, &Status) == 0);
+#else
+	struct stat Status;
+	Result.Exists = (stat(Path, &Status) == 0);
+#endif
+	if (Result.Exists)
+	{
+		Result.Size = (uint64_t)Status.st_size;
+		Result.WriteTime = (uint64_t)Status.st_mtime;
+	}
+	return(Result);
+}
+
+internal void
+GetAssetName(char* Path, char* Name)
+{
+	char* Start = Path;
+	for (char* Scan = Path; *Scan; ++Scan)
+	{
+		if ((*Scan == '/') || (*Scan == '\\'))
+		{
+			Start = Scan + 1;
+		}
+	}
+
+	int Length = 0;
+	while (Start[Length] && (Start[Length] != '.') && (Length < BPAK_MAX_NAME - 1))
+	{
+		Name[Length] = Start[Length];
+		++Length;
+	}
+	for (; Length < BPAK_MAX_NAME; ++Length)
+	{
+		Name[Length] = 0;
+	}
+}
+
+inline uint64_t
+AlignUp(uint64_t Value, uint64_t Alignment)
+{
+	return((Value + Alignment - 1) & ~(Alignment - 1));
+}
+
+internal bool
+WritePadding(FILE* Out, uint64_t* At, uint64_t Target)
+{
+	static uint8_t Zeros[BPAK_PIXEL_ALIGNMENT] = {};
+	while (*At < Target)
+	{
+		uint64_t Count = Target - *At;
+		if (Count > sizeof(Zeros))
+		{
+			Count = sizeof(Zeros);
+		}
+		if (fwrite(Zeros, 1, (size_t)Count, Out) != Count)
+		{
+			return(false);
+		}
+		*At += Count;
+	}
+	return(true);
+}
+
+int
+main(int ArgCount, char** Args)
+{
+	if (ArgCount < 3)
+	{
+		fprintf(stderr, "Usage: %s <output.bpak> <image.png> [image.png...]\n", Args[0]);
+		return(1);
+	}
+
+	uint32_t BitmapCount = ArgCount - 2;
+	packer_bitmap* Sources = (packer_bitmap*)calloc(BitmapCount, sizeof(packer_bitmap));
+	bpak_bitmap* Entries = (bpak_bitmap*)calloc(BitmapCount, sizeof(bpak_bitmap));
+
+	bpak_header Header = {};
+	Header.MagicValue = BPAK_MAGIC_VALUE;
+	Header.Version = BPAK_VERSION;
+	Header.BitmapCount = BitmapCount;
+	Header.BitmapsOffset = sizeof(bpak_header);
+
+	uint64_t FileAt = Header.BitmapsOffset + BitmapCount*sizeof(bpak_bitmap);
+	for (uint32_t Index = 0; Index < BitmapCount; Index++)
+	{
+		char* Path = Args[Index + 2];
+		packer_bitmap* Source = &Sources[Index];
+
+		uint32_t FileSize = 0;
+		void* Contents = ReadEntireFile(Path, &FileSize);
+		png_info Info = Contents ? GetPNGInfo(Contents, FileSize) : png_info{};
+		platform_file_stamp Stamp = GetSourceStamp(Path);
+		if (Info.IsValid)
+		{
+			Source->DecodeMemory = malloc(Info.MemoryRequired);
+			png_decode_result Decoded = DecodePNG(Contents, FileSize, Source->DecodeMemory, Info.MemoryRequired);
+			Info.IsValid = Decoded.Success;
+			Source->Bitmap = Decoded.Bitmap;
+		}
+		free(Contents);
+
+		if (!Info.IsValid)
+		{
+			fprintf(stderr, "%s: could not read or decode\n", Path);
+			return(1);
+		}
+
+		GetAssetName(Path, Source->Name);
+
+		bpak_bitmap* Entry = &Entries[Index];
+		memcpy(Entry->Name, Source->Name, BPAK_MAX_NAME);
+		Entry->Width = Source->Bitmap.Width;
+		Entry->Height = Source->Bitmap.Height;
+		Entry->Pitch = (uint32_t)AlignUp(Entry->Width*sizeof(uint32_t), BPAK_ROW_ALIGNMENT);
+		Entry->SourceSize = (uint32_t)Stamp.Size;
+		Entry->SourceWriteTime = Stamp.WriteTime;
+
+		FileAt = AlignUp(FileAt, BPAK_PIXEL_ALIGNMENT);
+		Entry->PixelsOffset = FileAt;
+		FileAt += (uint64_t)Entry->Pitch*Entry->Height;
+	}
+	Header.FileSize = FileAt;
+
+	FILE* Out = fopen(Args[1], "wb");
+	if (!Out)
+	{
+		fprintf(stderr, "%s: could not open for writing\n", Args[1]);
+		return(1);
+	}
+
+	bool Written = ((fwrite(&Header, sizeof(Header), 1, Out) == 1) &&
+		(fwrite(Entries, sizeof(bpak_bitmap), BitmapCount, Out) == BitmapCount));
+	uint64_t OutAt = Header.BitmapsOffset + BitmapCount*sizeof(bpak_bitmap);
+	for (uint32_t Index = 0; Written && (Index < BitmapCount); Index++)
+	{
+		bpak_bitmap* Entry = &Entries[Index];
+		loaded_bitmap* Bitmap = &Sources[Index].Bitmap;
+		Written = WritePadding(Out, &OutAt, Entry->PixelsOffset);
+		for (uint32_t Y = 0; Written && (Y < Entry->Height); Y++)
+		{
+			uint8_t* Row = (uint8_t*)Bitmap->Memory + (uint64_t)Y*Bitmap->Pitch;
+			Written = (fwrite(Row, sizeof(uint32_t), Entry->Width, Out) == Entry->Width);
+			OutAt += Entry->Width*sizeof(uint32_t);
+			Written = Written && WritePadding(Out, &OutAt, Entry->PixelsOffset + (uint64_t)(Y + 1)*Entry->Pitch);
+		}
+		printf("%s: %ux%u\n", Entry->Name, Entry->Width, Entry->Height);
+	}
+	Written = (fclose(Out) == 0) && Written;
+
+	if (!Written)
+	{
+		fprintf(stderr, "%s: write failed\n", Args[1]);
+		return(1);
+	}
+
+	printf("Wrote %u bitmaps, %llu bytes to %s\n", BitmapCount, (unsigned long long)Header.FileSize, Args[1]);
+	return(0);
+}
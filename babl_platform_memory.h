@@ -0,0 +1,675 @@
+#if !defined(BABL_PLATFORM_MEMORY_H)
+#define BABL_PLATFORM_MEMORY_H
+
+/*
+	Platform side of game memory: the whole range is reserved up front (so addresses are stable and the
+	fixed base still works for replays), but pages are only committed when an arena grows into them.
+	Commit is tracked in fixed-size chunks so snapshots can skip everything that was never committed.
+	Win32 uses VirtualAlloc MEM_RESERVE / MEM_COMMIT, everything else mmap PROT_NONE / mprotect.
+
+	Writes are tracked per page so snapshots only copy what changed: Win32 reserves with MEM_WRITE_WATCH,
+	everything else write-protects committed pages and catches the first write to each in a SIGSEGV handler.
+	(So off Win32, a syscall asked to write straight into tracked game memory fails with EFAULT instead.)
+*/
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/mman.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#define PLATFORM_MEMORY_CHUNK_SIZE Kilobytes(64)
+#define PLATFORM_MEMORY_MAX_CHUNKS 65536
+
+//Sized for 4KB pages, the smallest we run on
+#define PLATFORM_MEMORY_MAX_PAGES (PLATFORM_MEMORY_MAX_CHUNKS*(PLATFORM_MEMORY_CHUNK_SIZE / Kilobytes(4)))
+#define PLATFORM_MEMORY_MAX_STALE_SETS 8
+
+struct platform_memory_stats
+{
+	uint64_t Reserved;
+	uint64_t Committed;
+	uint64_t CommitCeiling;
+
+	//Committed pages the OS says are actually backed by RAM right now - only filled in when asked for
+	uint64_t Touched;
+
+	uint32_t FailedCommitCount;
+};
+
+/*
+	A copy of the block in a buffer the size of the reservation, pages at the same offsets.
+	StalePages marks every page where that copy may no longer match the live block, so saving copies
+	only stale pages out and restoring copies only stale pages back.
+*/
+struct platform_memory_snapshot
+{
+	bool32 IsValid;
+	uint8_t* Memory;
+	uint64_t CommittedChunks[PLATFORM_MEMORY_MAX_CHUNKS / 64];
+	uint64_t* StalePages;
+};
+
+struct platform_snapshot_stats
+{
+	uint32_t PagesCopied;
+	uint64_t BytesCopied;
+	uint32_t ChunksCommitted;
+	uint32_t ChunksDecommitted;
+};
+
+struct platform_memory_block
+{
+	uint8_t* Base;
+	uint64_t ReservedSize;
+	uint32_t ChunkCount;
+	uint32_t PageSize;
+	uint32_t PagesPerChunk;
+	uint32_t PageCount;
+
+	//Commits that would take CommittedSize past this fail instead
+	uint64_t CommitCeiling;
+	uint64_t CommittedSize;
+	uint32_t FailedCommitCount;
+
+	uint64_t CommittedChunks[PLATFORM_MEMORY_MAX_CHUNKS / 64];
+
+	//Pages written (or committed, or decommitted) since CollectDirtyPages last ran - set from any thread
+	uint64_t volatile DirtyPages[PLATFORM_MEMORY_MAX_PAGES / 64];
+
+	//One page bitmap per copy of the block (snapshot, state ring) - every page that may differ from that copy
+	uint32_t StaleSetCount;
+	uint64_t* StaleSets[PLATFORM_MEMORY_MAX_STALE_SETS];
+};
+
+inline bool32
+IsChunkCommitted(uint64_t* Chunks, uint32_t ChunkIndex)
+{
+	return((Chunks[ChunkIndex / 64] >> (ChunkIndex % 64)) & 1);
+}
+
+inline bool32
+IsPageSet(uint64_t* Pages, uint32_t PageIndex)
+{
+	return((Pages[PageIndex / 64] >> (PageIndex % 64)) & 1);
+}
+
+inline uint64_t
+AtomicExchangeUInt64(uint64_t volatile* Value, uint64_t New)
+{
+#if defined(_MSC_VER)
+	return((uint64_t)InterlockedExchange64((LONG64 volatile*)Value, (LONG64)New));
+#else
+	return(__atomic_exchange_n(Value, New, __ATOMIC_SEQ_CST));
+#endif
+}
+
+inline void
+AtomicOrUInt64(uint64_t volatile* Value, uint64_t Bits)
+{
+#if defined(_MSC_VER)
+	InterlockedOr64((LONG64 volatile*)Value, (LONG64)Bits);
+#else
+	__atomic_fetch_or(Value, Bits, __ATOMIC_SEQ_CST);
+#endif
+}
+
+inline void
+MarkPageDirty(platform_memory_block* Block, uint32_t PageIndex)
+{
+	AtomicOrUInt64(&Block->DirtyPages[PageIndex / 64], 1ULL << (PageIndex % 64));
+}
+
+//For writes the platform makes itself (restores), which the write tracking is told to ignore
+inline void
+MarkPageStaleEverywhere(platform_memory_block* Block, uint32_t PageIndex)
+{
+	for (uint32_t SetIndex = 0; SetIndex < Block->StaleSetCount; SetIndex++)
+	{
+		Block->StaleSets[SetIndex][PageIndex / 64] |= (1ULL << (PageIndex % 64));
+	}
+}
+
+inline void
+ClearPageStale(uint64_t* StalePages, uint32_t PageIndex)
+{
+	StalePages[PageIndex / 64] &= ~(1ULL << (PageIndex % 64));
+}
+
+//A chunk's pages never straddle a word (PagesPerChunk is a power of two no bigger than 16), so this is one AND
+inline void
+ClearChunkStale(platform_memory_block* Block, uint64_t* StalePages, uint32_t ChunkIndex)
+{
+	uint32_t FirstPage = ChunkIndex*Block->PagesPerChunk;
+	uint64_t Mask = ((1ULL << Block->PagesPerChunk) - 1) << (FirstPage % 64);
+	StalePages[FirstPage / 64] &= ~Mask;
+}
+
+inline void
+MarkChunkDirty(platform_memory_block* Block, uint32_t ChunkIndex)
+{
+	for (uint32_t PageIndex = 0; PageIndex < Block->PagesPerChunk; PageIndex++)
+	{
+		MarkPageDirty(Block, ChunkIndex*Block->PagesPerChunk + PageIndex);
+	}
+}
+
+internal bool32
+ReservePlatformMemory(platform_memory_block* Block, void* BaseAddress, uint64_t Size, uint64_t CommitCeiling)
+{
+	*Block = {};
+	Size = (Size + PLATFORM_MEMORY_CHUNK_SIZE - 1) & ~(uint64_t)(PLATFORM_MEMORY_CHUNK_SIZE - 1);
+	if (Size > (uint64_t)PLATFORM_MEMORY_MAX_CHUNKS*PLATFORM_MEMORY_CHUNK_SIZE)
+	{
+		return(false);
+	}
+
+#if defined(_WIN32)
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	uint32_t PageSize = SystemInfo.dwPageSize;
+	void* Base = VirtualAlloc(BaseAddress, Size, MEM_RESERVE | MEM_WRITE_WATCH, PAGE_NOACCESS);
+#else
+	uint32_t PageSize = (uint32_t)sysconf(_SC_PAGESIZE);
+
+	//MAP_NORESERVE keeps the reservation out of the overcommit accounting until mprotect makes pages writable
+	int Flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+#if defined(MAP_FIXED_NOREPLACE)
+	if (BaseAddress)
+	{
+		Flags |= MAP_FIXED_NOREPLACE;
+	}
+#endif
+	void* Base = mmap(BaseAddress, Size, PROT_NONE, Flags, -1, 0);
+	if (Base == MAP_FAILED)
+	{
+		Base = 0;
+	}
+	else if (BaseAddress && (Base != BaseAddress))
+	{
+		munmap(Base, Size);
+		Base = 0;
+	}
+#endif
+
+	if (Base && (PageSize >= Kilobytes(4)) && (PageSize <= PLATFORM_MEMORY_CHUNK_SIZE))
+	{
+		Block->Base = (uint8_t*)Base;
+		Block->ReservedSize = Size;
+		Block->ChunkCount = (uint32_t)(Size / PLATFORM_MEMORY_CHUNK_SIZE);
+		Block->PageSize = PageSize;
+		Block->PagesPerChunk = (uint32_t)(PLATFORM_MEMORY_CHUNK_SIZE / PageSize);
+		Block->PageCount = Block->ChunkCount*Block->PagesPerChunk;
+		Block->CommitCeiling = (CommitCeiling < Size) ? CommitCeiling : Size;
+	}
+	return(Block->Base != 0);
+}
+
+inline uint8_t*
+GetChunkMemory(platform_memory_block* Block, uint32_t ChunkIndex)
+{
+	return(Block->Base + (uint64_t)ChunkIndex*PLATFORM_MEMORY_CHUNK_SIZE);
+}
+
+inline bool32
+CommitChunk(platform_memory_block* Block, uint32_t ChunkIndex)
+{
+	uint8_t* Memory = GetChunkMemory(Block, ChunkIndex);
+#if defined(_WIN32)
+	bool32 Result = VirtualAlloc(Memory, PLATFORM_MEMORY_CHUNK_SIZE, MEM_COMMIT, PAGE_READWRITE) != 0;
+#else
+	bool32 Result = mprotect(Memory, PLATFORM_MEMORY_CHUNK_SIZE, PROT_READ | PROT_WRITE) == 0;
+#endif
+	if (Result)
+	{
+		Block->CommittedChunks[ChunkIndex / 64] |= (1ULL << (ChunkIndex % 64));
+		Block->CommittedSize += PLATFORM_MEMORY_CHUNK_SIZE;
+	}
+	return(Result);
+}
+
+//Makes [Memory, Memory + Size) readable and writable. Fails, committing nothing, if that would cross the ceiling
+internal bool32
+CommitPlatformMemory(platform_memory_block* Block, void* Memory, uint64_t Size)
+{
+	uint8_t* Start = (uint8_t*)Memory;
+	if ((Start < Block->Base) || (Start + Size > Block->Base + Block->ReservedSize))
+	{
+		++Block->FailedCommitCount;
+		return(false);
+	}
+	if (Size == 0)
+	{
+		return(true);
+	}
+
+	uint32_t FirstChunk = (uint32_t)((Start - Block->Base) / PLATFORM_MEMORY_CHUNK_SIZE);
+	uint32_t OnePastLastChunk = (uint32_t)((Start + Size - Block->Base + PLATFORM_MEMORY_CHUNK_SIZE - 1) / PLATFORM_MEMORY_CHUNK_SIZE);
+
+	uint64_t NewBytes = 0;
+	for (uint32_t ChunkIndex = FirstChunk; ChunkIndex < OnePastLastChunk; ChunkIndex++)
+	{
+		if (!IsChunkCommitted(Block->CommittedChunks, ChunkIndex))
+		{
+			NewBytes += PLATFORM_MEMORY_CHUNK_SIZE;
+		}
+	}
+	if (Block->CommittedSize + NewBytes > Block->CommitCeiling)
+	{
+		++Block->FailedCommitCount;
+		return(false);
+	}
+
+	//Chunk by chunk, so pages already committed (and possibly write-protected for tracking) are left alone
+	//New chunks count as dirty - every snapshot has to pick them up
+	for (uint32_t ChunkIndex = FirstChunk; ChunkIndex < OnePastLastChunk; ChunkIndex++)
+	{
+		if (!IsChunkCommitted(Block->CommittedChunks, ChunkIndex))
+		{
+			if (!CommitChunk(Block, ChunkIndex))
+			{
+				++Block->FailedCommitCount;
+				return(false);
+			}
+			MarkChunkDirty(Block, ChunkIndex);
+		}
+	}
+	return(true);
+}
+
+//Hands the chunk back to the OS - it reads as zero if it is ever committed again
+internal void
+DecommitPlatformChunk(platform_memory_block* Block, uint32_t ChunkIndex)
+{
+	if (IsChunkCommitted(Block->CommittedChunks, ChunkIndex))
+	{
+		uint8_t* Memory = GetChunkMemory(Block, ChunkIndex);
+#if defined(_WIN32)
+		VirtualFree(Memory, PLATFORM_MEMORY_CHUNK_SIZE, MEM_DECOMMIT);
+#else
+		madvise(Memory, PLATFORM_MEMORY_CHUNK_SIZE, MADV_DONTNEED);
+		mprotect(Memory, PLATFORM_MEMORY_CHUNK_SIZE, PROT_NONE);
+#endif
+		Block->CommittedChunks[ChunkIndex / 64] &= ~(1ULL << (ChunkIndex % 64));
+		Block->CommittedSize -= PLATFORM_MEMORY_CHUNK_SIZE;
+		MarkChunkDirty(Block, ChunkIndex);
+	}
+}
+
+//Asks the OS which committed pages are resident, a page at a time. Only committed chunks are queried, but that is
+//still every committed page - too slow for every frame once the game has grown
+internal uint64_t
+GetTouchedBytes(platform_memory_block* Block)
+{
+	uint64_t Result = 0;
+#if defined(_WIN32)
+	PSAPI_WORKING_SET_EX_INFORMATION Pages[64];
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Block->ChunkCount; ChunkIndex++)
+	{
+		if (IsChunkCommitted(Block->CommittedChunks, ChunkIndex))
+		{
+			uint8_t* Chunk = GetChunkMemory(Block, ChunkIndex);
+			for (uint32_t PageIndex = 0; PageIndex < Block->PagesPerChunk; PageIndex += ArrayCount(Pages))
+			{
+				uint32_t Count = Block->PagesPerChunk - PageIndex;
+				Count = (Count > ArrayCount(Pages)) ? ArrayCount(Pages) : Count;
+				for (uint32_t Index = 0; Index < Count; Index++)
+				{
+					Pages[Index].VirtualAddress = Chunk + (uint64_t)(PageIndex + Index)*Block->PageSize;
+				}
+				if (QueryWorkingSetEx(GetCurrentProcess(), Pages, Count*sizeof(Pages[0])))
+				{
+					for (uint32_t Index = 0; Index < Count; Index++)
+					{
+						Result += Pages[Index].VirtualAttributes.Valid ? Block->PageSize : 0;
+					}
+				}
+			}
+		}
+	}
+#else
+	unsigned char Residency[PLATFORM_MEMORY_CHUNK_SIZE / Kilobytes(4)];
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Block->ChunkCount; ChunkIndex++)
+	{
+		if (IsChunkCommitted(Block->CommittedChunks, ChunkIndex) &&
+			(mincore(GetChunkMemory(Block, ChunkIndex), PLATFORM_MEMORY_CHUNK_SIZE, Residency) == 0))
+		{
+			for (uint32_t PageIndex = 0; PageIndex < Block->PagesPerChunk; PageIndex++)
+			{
+				Result += (Residency[PageIndex] & 1) ? Block->PageSize : 0;
+			}
+		}
+	}
+#endif
+	return(Result);
+}
+
+//The counts are free; QueryTouched adds the GetTouchedBytes walk
+internal platform_memory_stats
+GetPlatformMemoryStats(platform_memory_block* Block, bool32 QueryTouched)
+{
+	platform_memory_stats Result = {};
+	Result.Reserved = Block->ReservedSize;
+	Result.Committed = Block->CommittedSize;
+	Result.CommitCeiling = Block->CommitCeiling;
+	Result.Touched = QueryTouched ? GetTouchedBytes(Block) : 0;
+	Result.FailedCommitCount = Block->FailedCommitCount;
+	return(Result);
+}
+
+//
+// Write tracking
+//
+
+#if !defined(_WIN32)
+//Only one block is ever tracked - the signal handler has no other way to find it
+global_variable platform_memory_block* GlobalTrackedMemory;
+global_variable struct sigaction GlobalPreviousSegvAction;
+
+internal void
+HandleTrackedWriteFault(int Signal, siginfo_t* SignalInfo, void* Context)
+{
+	platform_memory_block* Block = GlobalTrackedMemory;
+	uint8_t* Address = (uint8_t*)SignalInfo->si_addr;
+	if (Block && (Address >= Block->Base) && (Address < Block->Base + Block->ReservedSize))
+	{
+		uint32_t PageIndex = (uint32_t)((Address - Block->Base) / Block->PageSize);
+		if (IsChunkCommitted(Block->CommittedChunks, PageIndex / Block->PagesPerChunk))
+		{
+			//First write since the page was last collected - let it through and remember it
+			mprotect(Block->Base + (uint64_t)PageIndex*Block->PageSize, Block->PageSize, PROT_READ | PROT_WRITE);
+			MarkPageDirty(Block, PageIndex);
+			return;
+		}
+	}
+
+	//A real crash - put back whoever handled it before us and let the access fault again
+	if (GlobalPreviousSegvAction.sa_flags & SA_SIGINFO)
+	{
+		GlobalPreviousSegvAction.sa_sigaction(Signal, SignalInfo, Context);
+	}
+	else
+	{
+		sigaction(SIGSEGV, &GlobalPreviousSegvAction, 0);
+	}
+}
+
+inline void
+ProtectPages(platform_memory_block* Block, uint32_t FirstPage, uint32_t PageCount)
+{
+	mprotect(Block->Base + (uint64_t)FirstPage*Block->PageSize, (uint64_t)PageCount*Block->PageSize, PROT_READ);
+}
+#endif
+
+/*
+	Takes the pages written since last time, marks them stale in every snapshot and starts watching them again.
+	Cost is proportional to committed chunks (Win32) or dirty pages (mprotect), never to the reservation.
+	Nothing else may write game memory while this, SavePlatformMemory or RestorePlatformMemory run.
+*/
+internal void
+CollectDirtyPages(platform_memory_block* Block)
+{
+#if defined(_WIN32)
+	void* Addresses[PLATFORM_MEMORY_CHUNK_SIZE / Kilobytes(4)];
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Block->ChunkCount; ChunkIndex++)
+	{
+		if (IsChunkCommitted(Block->CommittedChunks, ChunkIndex))
+		{
+			ULONG_PTR Count = ArrayCount(Addresses);
+			ULONG Granularity;
+			if (GetWriteWatch(WRITE_WATCH_FLAG_RESET, GetChunkMemory(Block, ChunkIndex), PLATFORM_MEMORY_CHUNK_SIZE,
+				Addresses, &Count, &Granularity) == 0)
+			{
+				for (ULONG_PTR Index = 0; Index < Count; Index++)
+				{
+					MarkPageDirty(Block, (uint32_t)(((uint8_t*)Addresses[Index] - Block->Base) / Block->PageSize));
+				}
+			}
+		}
+	}
+#else
+	if (!GlobalTrackedMemory)
+	{
+		struct sigaction Action = {};
+		Action.sa_sigaction = HandleTrackedWriteFault;
+		Action.sa_flags = SA_SIGINFO | SA_NODEFER;
+		sigemptyset(&Action.sa_mask);
+		GlobalTrackedMemory = Block;
+		sigaction(SIGSEGV, &Action, &GlobalPreviousSegvAction);
+	}
+#endif
+
+	for (uint32_t WordIndex = 0; WordIndex < (Block->PageCount + 63) / 64; WordIndex++)
+	{
+		if (Block->DirtyPages[WordIndex])
+		{
+			uint64_t Bits = AtomicExchangeUInt64(&Block->DirtyPages[WordIndex], 0);
+			for (uint32_t SetIndex = 0; SetIndex < Block->StaleSetCount; SetIndex++)
+			{
+				Block->StaleSets[SetIndex][WordIndex] |= Bits;
+			}
+
+#if !defined(_WIN32)
+			//Write-protect them again, in runs, skipping any that were decommitted
+			uint32_t RunStart = 0;
+			uint32_t RunCount = 0;
+			for (uint32_t Bit = 0; Bit < 64; Bit++)
+			{
+				uint32_t PageIndex = WordIndex*64 + Bit;
+				bool32 Protect = ((Bits >> Bit) & 1) && IsChunkCommitted(Block->CommittedChunks, PageIndex / Block->PagesPerChunk);
+				if (Protect && (RunCount == 0))
+				{
+					RunStart = PageIndex;
+				}
+				if (Protect)
+				{
+					++RunCount;
+				}
+				else if (RunCount)
+				{
+					ProtectPages(Block, RunStart, RunCount);
+					RunCount = 0;
+				}
+			}
+			if (RunCount)
+			{
+				ProtectPages(Block, RunStart, RunCount);
+			}
+#endif
+		}
+	}
+}
+
+//Zeroed pages outside the tracked block, for the bookkeeping that sits beside it
+internal void*
+AllocatePlatformPages(uint64_t Size)
+{
+#if defined(_WIN32)
+	void* Result = VirtualAlloc(0, Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	void* Result = mmap(0, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	Result = (Result == MAP_FAILED) ? 0 : Result;
+#endif
+	return(Result);
+}
+
+//A new page bitmap that CollectDirtyPages and restores keep up to date. Starts with every page stale
+internal uint64_t*
+AddStalePageSet(platform_memory_block* Block)
+{
+	uint64_t* Result = 0;
+	uint64_t StaleSize = ((Block->PageCount + 63) / 64)*sizeof(uint64_t);
+	if (Block->StaleSetCount < ArrayCount(Block->StaleSets))
+	{
+		Result = (uint64_t*)AllocatePlatformPages(StaleSize);
+	}
+	if (Result)
+	{
+		memset(Result, 0xFF, StaleSize);
+		Block->StaleSets[Block->StaleSetCount++] = Result;
+	}
+	return(Result);
+}
+
+//Hands the whole reservation back and stops watching it, so another block can be tracked. The stale sets go
+//with it - snapshots and state rings made on it must not be used again
+internal void
+ReleasePlatformMemory(platform_memory_block* Block)
+{
+#if defined(_WIN32)
+	for (uint32_t SetIndex = 0; SetIndex < Block->StaleSetCount; SetIndex++)
+	{
+		VirtualFree(Block->StaleSets[SetIndex], 0, MEM_RELEASE);
+	}
+	VirtualFree(Block->Base, 0, MEM_RELEASE);
+#else
+	if (GlobalTrackedMemory == Block)
+	{
+		sigaction(SIGSEGV, &GlobalPreviousSegvAction, 0);
+		GlobalTrackedMemory = 0;
+	}
+	uint64_t StaleSize = ((Block->PageCount + 63) / 64)*sizeof(uint64_t);
+	for (uint32_t SetIndex = 0; SetIndex < Block->StaleSetCount; SetIndex++)
+	{
+		munmap(Block->StaleSets[SetIndex], StaleSize);
+	}
+	munmap(Block->Base, Block->ReservedSize);
+#endif
+	*Block = {};
+}
+
+//
+// Snapshots
+//
+
+//Memory is a buffer the size of the reservation. Everything starts stale, so the first save copies all committed pages
+internal bool32
+AddPlatformMemorySnapshot(platform_memory_block* Block, platform_memory_snapshot* Snapshot, void* Memory)
+{
+	*Snapshot = {};
+	if (!Memory)
+	{
+		return(false);
+	}
+
+	Snapshot->Memory = (uint8_t*)Memory;
+	Snapshot->StalePages = AddStalePageSet(Block);
+	return(Snapshot->StalePages != 0);
+}
+
+inline void
+CopyPage(platform_memory_block* Block, uint8_t* Dest, uint8_t* Source, uint32_t PageIndex, platform_snapshot_stats* Stats)
+{
+	uint64_t Offset = (uint64_t)PageIndex*Block->PageSize;
+	memcpy(Dest + Offset, Source + Offset, Block->PageSize);
+	++Stats->PagesCopied;
+	Stats->BytesCopied += Block->PageSize;
+}
+
+internal platform_snapshot_stats
+SavePlatformMemory(platform_memory_block* Block, platform_memory_snapshot* Snapshot)
+{
+	platform_snapshot_stats Stats = {};
+	CollectDirtyPages(Block);
+
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Block->ChunkCount; ChunkIndex++)
+	{
+		if (IsChunkCommitted(Block->CommittedChunks, ChunkIndex))
+		{
+			uint32_t FirstPage = ChunkIndex*Block->PagesPerChunk;
+			for (uint32_t PageIndex = FirstPage; PageIndex < FirstPage + Block->PagesPerChunk; PageIndex++)
+			{
+				if (IsPageSet(Snapshot->StalePages, PageIndex))
+				{
+					CopyPage(Block, Snapshot->Memory, Block->Base, PageIndex, &Stats);
+					ClearPageStale(Snapshot->StalePages, PageIndex);
+				}
+			}
+		}
+	}
+	memcpy(Snapshot->CommittedChunks, Block->CommittedChunks, sizeof(Block->CommittedChunks));
+	Snapshot->IsValid = true;
+	return(Stats);
+}
+
+//Leaves exactly the saved chunks committed, so the arenas' idea of what is committed matches the platform's again
+internal platform_snapshot_stats
+RestorePlatformMemory(platform_memory_block* Block, platform_memory_snapshot* Snapshot)
+{
+	platform_snapshot_stats Stats = {};
+	if (!Snapshot->IsValid)
+	{
+		return(Stats);
+	}
+	CollectDirtyPages(Block);
+
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Block->ChunkCount; ChunkIndex++)
+	{
+		bool32 WasCommitted = IsChunkCommitted(Snapshot->CommittedChunks, ChunkIndex);
+		bool32 IsCommitted = IsChunkCommitted(Block->CommittedChunks, ChunkIndex);
+		uint32_t FirstPage = ChunkIndex*Block->PagesPerChunk;
+		uint32_t OnePastLastPage = FirstPage + Block->PagesPerChunk;
+		uint8_t* Chunk = GetChunkMemory(Block, ChunkIndex);
+
+		if (WasCommitted)
+		{
+			//It fit under the ceiling when it was saved, so the ceiling does not apply here
+			bool32 CommittedNow = !IsCommitted && CommitChunk(Block, ChunkIndex);
+			Stats.ChunksCommitted += CommittedNow ? 1 : 0;
+
+			bool32 CopiedAny = false;
+			for (uint32_t PageIndex = FirstPage; PageIndex < OnePastLastPage; PageIndex++)
+			{
+				if (CommittedNow || IsPageSet(Snapshot->StalePages, PageIndex))
+				{
+#if !defined(_WIN32)
+					if (!CopiedAny && !CommittedNow)
+					{
+						mprotect(Chunk, PLATFORM_MEMORY_CHUNK_SIZE, PROT_READ | PROT_WRITE);
+					}
+#endif
+					CopyPage(Block, Block->Base, Snapshot->Memory, PageIndex, &Stats);
+					CopiedAny = true;
+
+					//The live page changed, so every other copy is now stale there
+					MarkPageStaleEverywhere(Block, PageIndex);
+				}
+			}
+
+			//The copy itself is not a game write - watch from here on
+			if (CopiedAny)
+			{
+#if defined(_WIN32)
+				ResetWriteWatch(Chunk, PLATFORM_MEMORY_CHUNK_SIZE);
+#else
+				mprotect(Chunk, PLATFORM_MEMORY_CHUNK_SIZE, PROT_READ);
+#endif
+			}
+		}
+		else if (IsCommitted)
+		{
+			//Marks the chunk dirty, which the collect below turns into stale for everyone else
+			DecommitPlatformChunk(Block, ChunkIndex);
+			++Stats.ChunksDecommitted;
+		}
+
+		ClearChunkStale(Block, Snapshot->StalePages, ChunkIndex);
+	}
+
+	//Hand the decommits out as stale pages, then forget them for this snapshot - it matches the block exactly
+	CollectDirtyPages(Block);
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Block->ChunkCount; ChunkIndex++)
+	{
+		if (!IsChunkCommitted(Block->CommittedChunks, ChunkIndex))
+		{
+			ClearChunkStale(Block, Snapshot->StalePages, ChunkIndex);
+		}
+	}
+	return(Stats);
+}
+
+#endif
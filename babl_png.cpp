@@ -0,0 +1,957 @@
+#include <string.h>
+
+#include "babl_png.h"
+
+inline uint32_t
+ReadBigEndian32(uint8_t* At)
+{
+	uint32_t Result = ((uint32_t)At[0] << 24) | ((uint32_t)At[1] << 16) | ((uint32_t)At[2] << 8) | (uint32_t)At[3];
+	return(Result);
+}
+
+//
+// Bit stream
+//
+
+inline void
+RefillBits(png_bit_stream* Stream)
+{
+	while (Stream->BitCount <= 56)
+	{
+		uint64_t Byte = 0;
+		if (Stream->At < Stream->End)
+		{
+			Byte = *Stream->At++;
+		}
+		else
+		{
+			Stream->PaddingBits += 8;
+		}
+		Stream->BitBuffer |= Byte << Stream->BitCount;
+		Stream->BitCount += 8;
+	}
+}
+
+inline void
+ConsumeBits(png_bit_stream* Stream, uint32_t Count)
+{
+	Stream->BitBuffer >>= Count;
+	Stream->BitCount -= Count;
+}
+
+//Deflate packs everything except Huffman codes LSB first
+inline uint32_t
+GetBits(png_bit_stream* Stream, uint32_t Count)
+{
+	Assert(Count <= 32);
+	RefillBits(Stream);
+	uint32_t Result = (uint32_t)(Stream->BitBuffer & ((1ULL << Count) - 1));
+	ConsumeBits(Stream, Count);
+	return(Result);
+}
+
+inline bool32
+StreamOverran(png_bit_stream* Stream)
+{
+	return(Stream->BitCount < Stream->PaddingBits);
+}
+
+//
+// Huffman
+//
+
+internal bool32
+BuildHuffman(png_huffman* Huffman, uint8_t* Lengths, uint32_t SymbolCount)
+{
+	for (uint32_t Index = 0; Index < ArrayCount(Huffman->Count); Index++)
+	{
+		Huffman->Count[Index] = 0;
+	}
+	for (uint32_t Index = 0; Index < ArrayCount(Huffman->Fast); Index++)
+	{
+		Huffman->Fast[Index] = 0;
+	}
+
+	for (uint32_t Symbol = 0; Symbol < SymbolCount; Symbol++)
+	{
+		++Huffman->Count[Lengths[Symbol]];
+	}
+	Huffman->Count[0] = 0;
+
+	//Over-subscribed code sets are corrupt; incomplete ones are legal (a lone distance code, for instance)
+	int32_t Left = 1;
+	for (uint32_t Length = 1; Length <= PNG_HUFFMAN_MAX_BITS; Length++)
+	{
+		Left <<= 1;
+		Left -= Huffman->Count[Length];
+		if (Left < 0)
+		{
+			return(false);
+		}
+	}
+
+	uint16_t Offsets[PNG_HUFFMAN_MAX_BITS + 1];
+	uint32_t NextCode[PNG_HUFFMAN_MAX_BITS + 1];
+	Offsets[1] = 0;
+	NextCode[1] = 0;
+	for (uint32_t Length = 1; Length < PNG_HUFFMAN_MAX_BITS; Length++)
+	{
+		Offsets[Length + 1] = Offsets[Length] + Huffman->Count[Length];
+		NextCode[Length + 1] = (NextCode[Length] + Huffman->Count[Length]) << 1;
+	}
+
+	for (uint32_t Symbol = 0; Symbol < SymbolCount; Symbol++)
+	{
+		uint32_t Length = Lengths[Symbol];
+		if (Length)
+		{
+			Huffman->Symbol[Offsets[Length]++] = (uint16_t)Symbol;
+
+			uint32_t Code = NextCode[Length]++;
+			if (Length <= PNG_HUFFMAN_FAST_BITS)
+			{
+				uint32_t Reversed = 0;
+				for (uint32_t Bit = 0; Bit < Length; Bit++)
+				{
+					Reversed |= ((Code >> Bit) & 1) << (Length - 1 - Bit);
+				}
+
+				uint16_t Entry = (uint16_t)((Length << 12) | Symbol);
+				for (uint32_t Fill = Reversed; Fill < ArrayCount(Huffman->Fast); Fill += (1 << Length))
+				{
+					Huffman->Fast[Fill] = Entry;
+				}
+			}
+		}
+	}
+
+	return(true);
+}
+
+//Returns -1 on a code that isn't in the table
+internal int32_t
+DecodeHuffman(png_bit_stream* Stream, png_huffman* Huffman)
+{
+	RefillBits(Stream);
+
+	uint16_t Entry = Huffman->Fast[Stream->BitBuffer & ((1 << PNG_HUFFMAN_FAST_BITS) - 1)];
+	if (Entry)
+	{
+		ConsumeBits(Stream, Entry >> 12);
+		return(Entry & 0x1FF);
+	}
+
+	int32_t Code = 0;
+	int32_t First = 0;
+	int32_t Index = 0;
+	uint64_t Bits = Stream->BitBuffer;
+	for (uint32_t Length = 1; Length <= PNG_HUFFMAN_MAX_BITS; Length++)
+	{
+		Code |= (int32_t)(Bits & 1);
+		Bits >>= 1;
+		int32_t Count = Huffman->Count[Length];
+		if (Code < First + Count)
+		{
+			ConsumeBits(Stream, Length);
+			return(Huffman->Symbol[Index + (Code - First)]);
+		}
+		Index += Count;
+		First += Count;
+		First <<= 1;
+		Code <<= 1;
+	}
+
+	return(-1);
+}
+
+//
+// Inflate
+//
+
+global_variable uint16_t PNGLengthBase[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+global_variable uint8_t PNGLengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+global_variable uint16_t PNGDistanceBase[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+global_variable uint8_t PNGDistanceExtra[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+internal bool32
+InflateBlock(png_bit_stream* Stream, png_huffman* LiteralLength, png_huffman* Distance,
+	uint8_t* OutStart, uint8_t** OutAt, uint8_t* OutEnd)
+{
+	uint8_t* Out = *OutAt;
+	for (;;)
+	{
+		int32_t Symbol = DecodeHuffman(Stream, LiteralLength);
+		if (Symbol < 0)
+		{
+			return(false);
+		}
+
+		if (Symbol < 256)
+		{
+			if (Out >= OutEnd)
+			{
+				return(false);
+			}
+			*Out++ = (uint8_t)Symbol;
+		}
+		else if (Symbol == 256)
+		{
+			break;
+		}
+		else
+		{
+			Symbol -= 257;
+			if (Symbol >= (int32_t)ArrayCount(PNGLengthBase))
+			{
+				return(false);
+			}
+			uint32_t Length = PNGLengthBase[Symbol] + GetBits(Stream, PNGLengthExtra[Symbol]);
+
+			int32_t DistanceSymbol = DecodeHuffman(Stream, Distance);
+			if ((DistanceSymbol < 0) || (DistanceSymbol >= (int32_t)ArrayCount(PNGDistanceBase)))
+			{
+				return(false);
+			}
+			uint32_t Back = PNGDistanceBase[DistanceSymbol] + GetBits(Stream, PNGDistanceExtra[DistanceSymbol]);
+
+			if ((Back > (uint32_t)(Out - OutStart)) || (Length > (uint32_t)(OutEnd - Out)))
+			{
+				return(false);
+			}
+
+			//Byte at a time on purpose - the source may overlap the bytes being written (run-length style copies)
+			uint8_t* Source = Out - Back;
+			while (Length--)
+			{
+				*Out++ = *Source++;
+			}
+		}
+	}
+
+	*OutAt = Out;
+	return(true);
+}
+
+internal bool32
+ReadDynamicTables(png_bit_stream* Stream, png_huffman* LiteralLength, png_huffman* Distance)
+{
+	local_persist uint8_t CodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+	uint32_t LiteralCount = GetBits(Stream, 5) + 257;
+	uint32_t DistanceCount = GetBits(Stream, 5) + 1;
+	uint32_t CodeLengthCount = GetBits(Stream, 4) + 4;
+	if ((LiteralCount > 286) || (DistanceCount > 30))
+	{
+		return(false);
+	}
+
+	uint8_t CodeLengthLengths[19] = {};
+	for (uint32_t Index = 0; Index < CodeLengthCount; Index++)
+	{
+		CodeLengthLengths[CodeLengthOrder[Index]] = (uint8_t)GetBits(Stream, 3);
+	}
+
+	png_huffman CodeLength;
+	if (!BuildHuffman(&CodeLength, CodeLengthLengths, 19))
+	{
+		return(false);
+	}
+
+	uint8_t Lengths[286 + 30] = {};
+	uint32_t TotalCount = LiteralCount + DistanceCount;
+	uint32_t Index = 0;
+	while (Index < TotalCount)
+	{
+		int32_t Symbol = DecodeHuffman(Stream, &CodeLength);
+		uint32_t Repeat = 0;
+		uint8_t Value = 0;
+		if ((Symbol >= 0) && (Symbol < 16))
+		{
+			Lengths[Index++] = (uint8_t)Symbol;
+			continue;
+		}
+		else if (Symbol == 16)
+		{
+			if (Index == 0)
+			{
+				return(false);
+			}
+			Value = Lengths[Index - 1];
+			Repeat = 3 + GetBits(Stream, 2);
+		}
+		else if (Symbol == 17)
+		{
+			Repeat = 3 + GetBits(Stream, 3);
+		}
+		else if (Symbol == 18)
+		{
+			Repeat = 11 + GetBits(Stream, 7);
+		}
+		else
+		{
+			return(false);
+		}
+
+		if (Index + Repeat > TotalCount)
+		{
+			return(false);
+		}
+		while (Repeat--)
+		{
+			Lengths[Index++] = Value;
+		}
+	}
+
+	//A block with no end-of-block code can never terminate
+	if (Lengths[256] == 0)
+	{
+		return(false);
+	}
+
+	return(BuildHuffman(LiteralLength, Lengths, LiteralCount) &&
+		BuildHuffman(Distance, Lengths + LiteralCount, DistanceCount));
+}
+
+//Inflates a zlib stream into [Out, Out + OutSize); returns the number of bytes produced, or -1 on corrupt input
+internal int64_t
+ZlibInflate(uint8_t* Source, uint32_t SourceSize, uint8_t* Out, uint64_t OutSize)
+{
+	if (SourceSize < 2)
+	{
+		return(-1);
+	}
+
+	uint32_t CMF = Source[0];
+	uint32_t FLG = Source[1];
+	bool32 HeaderIsValid = (((CMF & 0xF) == 8) && (((CMF << 8) | FLG) % 31 == 0) && !(FLG & 0x20));
+	if (!HeaderIsValid)
+	{
+		return(-1);
+	}
+
+	png_bit_stream Stream = {};
+	Stream.At = Source + 2;
+	Stream.End = Source + SourceSize;
+
+	png_huffman LiteralLength;
+	png_huffman Distance;
+
+	uint8_t* OutAt = Out;
+	uint8_t* OutEnd = Out + OutSize;
+	bool32 IsFinal = false;
+	while (!IsFinal)
+	{
+		IsFinal = GetBits(&Stream, 1);
+		uint32_t BlockType = GetBits(&Stream, 2);
+		if (BlockType == 0)
+		{
+			ConsumeBits(&Stream, Stream.BitCount & 7);
+			uint32_t Length = GetBits(&Stream, 16);
+			uint32_t NotLength = GetBits(&Stream, 16);
+			if ((Length != (~NotLength & 0xFFFF)) || (Length > (uint64_t)(OutEnd - OutAt)))
+			{
+				return(-1);
+			}
+			while (Length--)
+			{
+				*OutAt++ = (uint8_t)GetBits(&Stream, 8);
+			}
+		}
+		else if (BlockType == 1)
+		{
+			uint8_t Lengths[288 + 30];
+			uint32_t Index = 0;
+			for (; Index < 144; Index++) Lengths[Index] = 8;
+			for (; Index < 256; Index++) Lengths[Index] = 9;
+			for (; Index < 280; Index++) Lengths[Index] = 7;
+			for (; Index < 288; Index++) Lengths[Index] = 8;
+			for (; Index < 288 + 30; Index++) Lengths[Index] = 5;
+			BuildHuffman(&LiteralLength, Lengths, 288);
+			BuildHuffman(&Distance, Lengths + 288, 30);
+			if (!InflateBlock(&Stream, &LiteralLength, &Distance, Out, &OutAt, OutEnd))
+			{
+				return(-1);
+			}
+		}
+		else if (BlockType == 2)
+		{
+			if (!ReadDynamicTables(&Stream, &LiteralLength, &Distance) ||
+				!InflateBlock(&Stream, &LiteralLength, &Distance, Out, &OutAt, OutEnd))
+			{
+				return(-1);
+			}
+		}
+		else
+		{
+			return(-1);
+		}
+
+		if (StreamOverran(&Stream))
+		{
+			return(-1);
+		}
+	}
+
+	return(OutAt - Out);
+}
+
+//
+// Unfiltering
+//
+
+enum png_filter_type
+{
+	PNGFilter_None = 0,
+	PNGFilter_Sub = 1,
+	PNGFilter_Up = 2,
+	PNGFilter_Average = 3,
+	PNGFilter_Paeth = 4,
+};
+
+inline uint8_t
+PaethPredictor(int32_t A, int32_t B, int32_t C)
+{
+	int32_t P = A + B - C;
+	int32_t PA = (P > A) ? P - A : A - P;
+	int32_t PB = (P > B) ? P - B : B - P;
+	int32_t PC = (P > C) ? P - C : C - P;
+	if ((PA <= PB) && (PA <= PC))
+	{
+		return((uint8_t)A);
+	}
+	else if (PB <= PC)
+	{
+		return((uint8_t)B);
+	}
+	return((uint8_t)C);
+}
+
+//Prior is the already-unfiltered row above (all zeros for the first row)
+internal void
+UnfilterRowScalar(uint32_t Filter, uint8_t* Row, uint8_t* Prior, uint32_t RowBytes, uint32_t BytesPerPixel)
+{
+	switch (Filter)
+	{
+		case PNGFilter_Sub:
+		{
+			for (uint32_t Index = BytesPerPixel; Index < RowBytes; Index++)
+			{
+				Row[Index] = (uint8_t)(Row[Index] + Row[Index - BytesPerPixel]);
+			}
+		}break;
+		case PNGFilter_Up:
+		{
+			for (uint32_t Index = 0; Index < RowBytes; Index++)
+			{
+				Row[Index] = (uint8_t)(Row[Index] + Prior[Index]);
+			}
+		}break;
+		case PNGFilter_Average:
+		{
+			for (uint32_t Index = 0; Index < RowBytes; Index++)
+			{
+				uint32_t Left = (Index >= BytesPerPixel) ? Row[Index - BytesPerPixel] : 0;
+				Row[Index] = (uint8_t)(Row[Index] + ((Left + Prior[Index]) >> 1));
+			}
+		}break;
+		case PNGFilter_Paeth:
+		{
+			for (uint32_t Index = 0; Index < RowBytes; Index++)
+			{
+				int32_t Left = (Index >= BytesPerPixel) ? Row[Index - BytesPerPixel] : 0;
+				int32_t UpLeft = (Index >= BytesPerPixel) ? Prior[Index - BytesPerPixel] : 0;
+				Row[Index] = (uint8_t)(Row[Index] + PaethPredictor(Left, Prior[Index], UpLeft));
+			}
+		}break;
+	}
+}
+
+//One whole pixel - any size PNG has, 1 to 8 bytes - in the low bytes of a register, touching nothing past its last byte
+inline __m128i
+LoadPixelBytes(uint8_t* At, uint32_t BytesPerPixel)
+{
+	__m128i Result;
+	if (BytesPerPixel == 8)
+	{
+		Result = _mm_loadl_epi64((__m128i*)At);
+	}
+	else if (BytesPerPixel == 6)
+	{
+		uint32_t Low;
+		memcpy(&Low, At, sizeof(Low));
+		Result = _mm_insert_epi16(_mm_cvtsi32_si128((int)Low), (int)At[4] | ((int)At[5] << 8), 2);
+	}
+	else if (BytesPerPixel <= 2)
+	{
+		uint32_t Value = (BytesPerPixel == 2) ? ((uint32_t)At[0] | ((uint32_t)At[1] << 8)) : (uint32_t)At[0];
+		Result = _mm_cvtsi32_si128((int)Value);
+	}
+	else
+	{
+		uint32_t Value = (uint32_t)At[0] | ((uint32_t)At[1] << 8) | ((uint32_t)At[2] << 16);
+		if (BytesPerPixel == 4)
+		{
+			Value |= (uint32_t)At[3] << 24;
+		}
+		Result = _mm_cvtsi32_si128((int)Value);
+	}
+	return(Result);
+}
+
+inline void
+StorePixelBytes(uint8_t* At, __m128i Pixel, uint32_t BytesPerPixel)
+{
+	if (BytesPerPixel == 8)
+	{
+		_mm_storel_epi64((__m128i*)At, Pixel);
+	}
+	else
+	{
+		uint32_t Value = (uint32_t)_mm_cvtsi128_si32(Pixel);
+		At[0] = (uint8_t)Value;
+		if (BytesPerPixel >= 2)
+		{
+			At[1] = (uint8_t)(Value >> 8);
+		}
+		if (BytesPerPixel >= 3)
+		{
+			At[2] = (uint8_t)(Value >> 16);
+		}
+		if (BytesPerPixel >= 4)
+		{
+			At[3] = (uint8_t)(Value >> 24);
+		}
+		if (BytesPerPixel == 6)
+		{
+			uint32_t High = (uint32_t)_mm_extract_epi16(Pixel, 2);
+			At[4] = (uint8_t)High;
+			At[5] = (uint8_t)(High >> 8);
+		}
+	}
+}
+
+/*
+	Up has no dependency along the row and goes 16 bytes at a time for any pixel size.
+	Sub, Average and Paeth each depend on the pixel to the left, so they process a whole pixel per step in one
+	register instead of one channel at a time - Paeth widens to 16 bits, and 8 bytes of pixel is exactly one
+	register of those. For 1 and 2 byte pixels (gray, gray+alpha, 16-bit gray) a step is so little work that only
+	Paeth comes out ahead; Sub and Average stay scalar there (babl_bench measures both).
+*/
+internal void
+UnfilterRowSSE2(uint32_t Filter, uint8_t* Row, uint8_t* Prior, uint32_t RowBytes, uint32_t BytesPerPixel)
+{
+	if (Filter == PNGFilter_Up)
+	{
+		uint32_t Index = 0;
+		for (; Index + 16 <= RowBytes; Index += 16)
+		{
+			__m128i X = _mm_loadu_si128((__m128i*)(Row + Index));
+			__m128i B = _mm_loadu_si128((__m128i*)(Prior + Index));
+			_mm_storeu_si128((__m128i*)(Row + Index), _mm_add_epi8(X, B));
+		}
+		UnfilterRowScalar(Filter, Row + Index, Prior + Index, RowBytes - Index, BytesPerPixel);
+		return;
+	}
+
+	if ((Filter == PNGFilter_None) || ((BytesPerPixel < 3) && (Filter != PNGFilter_Paeth)))
+	{
+		UnfilterRowScalar(Filter, Row, Prior, RowBytes, BytesPerPixel);
+		return;
+	}
+
+	__m128i Zero = _mm_setzero_si128();
+	__m128i A = Zero;
+	switch (Filter)
+	{
+		case PNGFilter_Sub:
+		{
+			for (uint32_t Index = 0; Index < RowBytes; Index += BytesPerPixel)
+			{
+				A = _mm_add_epi8(LoadPixelBytes(Row + Index, BytesPerPixel), A);
+				StorePixelBytes(Row + Index, A, BytesPerPixel);
+			}
+		}break;
+		case PNGFilter_Average:
+		{
+			//avg_epu8 rounds up, PNG rounds down - knock the carry back off where the low bits differ
+			__m128i One = _mm_set1_epi8(1);
+			for (uint32_t Index = 0; Index < RowBytes; Index += BytesPerPixel)
+			{
+				__m128i B = LoadPixelBytes(Prior + Index, BytesPerPixel);
+				__m128i Average = _mm_sub_epi8(_mm_avg_epu8(A, B), _mm_and_si128(_mm_xor_si128(A, B), One));
+				A = _mm_add_epi8(LoadPixelBytes(Row + Index, BytesPerPixel), Average);
+				StorePixelBytes(Row + Index, A, BytesPerPixel);
+			}
+		}break;
+		case PNGFilter_Paeth:
+		{
+			//Widened to 16 bits so a + b - c can't wrap
+			__m128i C = Zero;
+			__m128i A16 = Zero;
+			__m128i ByteMask = _mm_set1_epi16(0xFF);
+			for (uint32_t Index = 0; Index < RowBytes; Index += BytesPerPixel)
+			{
+				__m128i B16 = _mm_unpacklo_epi8(LoadPixelBytes(Prior + Index, BytesPerPixel), Zero);
+				__m128i D16 = _mm_unpacklo_epi8(LoadPixelBytes(Row + Index, BytesPerPixel), Zero);
+
+				__m128i PA = _mm_sub_epi16(B16, C);
+				__m128i PB = _mm_sub_epi16(A16, C);
+				__m128i PC = _mm_add_epi16(PA, PB);
+				PA = _mm_max_epi16(PA, _mm_sub_epi16(Zero, PA));
+				PB = _mm_max_epi16(PB, _mm_sub_epi16(Zero, PB));
+				PC = _mm_max_epi16(PC, _mm_sub_epi16(Zero, PC));
+
+				//Ties favor a, then b, then c
+				__m128i Smallest = _mm_min_epi16(PC, _mm_min_epi16(PA, PB));
+				__m128i UseA = _mm_cmpeq_epi16(Smallest, PA);
+				__m128i UseB = _mm_andnot_si128(UseA, _mm_cmpeq_epi16(Smallest, PB));
+				__m128i UseC = _mm_andnot_si128(_mm_or_si128(UseA, UseB), _mm_set1_epi16(-1));
+				__m128i Nearest = _mm_or_si128(_mm_or_si128(_mm_and_si128(UseA, A16), _mm_and_si128(UseB, B16)),
+					_mm_and_si128(UseC, C));
+
+				A16 = _mm_and_si128(_mm_add_epi16(Nearest, D16), ByteMask);
+				C = B16;
+				StorePixelBytes(Row + Index, _mm_packus_epi16(A16, Zero), BytesPerPixel);
+			}
+		}break;
+	}
+}
+
+//
+// PNG
+//
+
+global_variable uint8_t PNGSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+struct png_chunk_iterator
+{
+	uint8_t* At;
+	uint8_t* End;
+
+	uint32_t Length;
+	uint32_t Type;
+	uint8_t* Data;
+};
+
+#define PNG_CHUNK_TYPE(a, b, c, d) (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+
+inline bool32
+NextPNGChunk(png_chunk_iterator* Iter)
+{
+	bool32 Result = false;
+	if ((Iter->End - Iter->At) >= 12)
+	{
+		Iter->Length = ReadBigEndian32(Iter->At);
+		Iter->Type = ReadBigEndian32(Iter->At + 4);
+		Iter->Data = Iter->At + 8;
+		if ((uint64_t)(Iter->End - Iter->Data) >= (uint64_t)Iter->Length + 4)
+		{
+			Iter->At = Iter->Data + Iter->Length + 4;
+			Result = true;
+		}
+	}
+	return(Result);
+}
+
+inline png_chunk_iterator
+BeginPNGChunks(void* Contents, uint32_t ContentSize)
+{
+	png_chunk_iterator Iter = {};
+	Iter.At = (uint8_t*)Contents + sizeof(PNGSignature);
+	Iter.End = (uint8_t*)Contents + ContentSize;
+	return(Iter);
+}
+
+//Reads the header and sizes everything DecodePNG will need, without touching any output memory
+internal png_info
+GetPNGInfo(void* Contents, uint32_t ContentSize)
+{
+	png_info Info = {};
+	if ((ContentSize < sizeof(PNGSignature)) || memcmp(Contents, PNGSignature, sizeof(PNGSignature)) != 0)
+	{
+		return(Info);
+	}
+
+	bool32 SawHeader = false;
+	png_chunk_iterator Iter = BeginPNGChunks(Contents, ContentSize);
+	while (NextPNGChunk(&Iter))
+	{
+		if (Iter.Type == PNG_CHUNK_TYPE('I', 'H', 'D', 'R'))
+		{
+			if (Iter.Length != 13)
+			{
+				return(Info);
+			}
+			Info.Width = ReadBigEndian32(Iter.Data);
+			Info.Height = ReadBigEndian32(Iter.Data + 4);
+			Info.BitDepth = Iter.Data[8];
+			Info.ColorType = Iter.Data[9];
+			uint32_t Compression = Iter.Data[10];
+			uint32_t FilterMethod = Iter.Data[11];
+			uint32_t Interlace = Iter.Data[12];
+			if (Compression || FilterMethod || Interlace)
+			{
+				return(Info);
+			}
+			SawHeader = true;
+		}
+		else if (Iter.Type == PNG_CHUNK_TYPE('I', 'D', 'A', 'T'))
+		{
+			Info.CompressedSize += Iter.Length;
+		}
+		else if (Iter.Type == PNG_CHUNK_TYPE('I', 'E', 'N', 'D'))
+		{
+			break;
+		}
+	}
+
+	uint32_t D = Info.BitDepth;
+	switch (Info.ColorType)
+	{
+		case PNGColorType_Gray: {Info.Channels = (D == 1 || D == 2 || D == 4 || D == 8 || D == 16) ? 1 : 0;}break;
+		case PNGColorType_RGB: {Info.Channels = (D == 8 || D == 16) ? 3 : 0;}break;
+		case PNGColorType_Palette: {Info.Channels = (D == 1 || D == 2 || D == 4 || D == 8) ? 1 : 0;}break;
+		case PNGColorType_GrayAlpha: {Info.Channels = (D == 8 || D == 16) ? 2 : 0;}break;
+		case PNGColorType_RGBA: {Info.Channels = (D == 8 || D == 16) ? 4 : 0;}break;
+		default: {Info.Channels = 0;}break;
+	}
+
+	//Width*4 has to fit the int Pitch of a loaded_bitmap
+	if (SawHeader && Info.Channels && Info.Width && Info.Height &&
+		(Info.Width <= (1 << 24)) && (Info.Height <= (1 << 24)) && Info.CompressedSize)
+	{
+		uint64_t BitsPerPixel = Info.Channels*Info.BitDepth;
+		Info.FilterBytesPerPixel = (uint32_t)((BitsPerPixel + 7) / 8);
+		Info.RowBytes = (uint32_t)((Info.Width*BitsPerPixel + 7) / 8);
+		Info.BitmapSize = (uint64_t)Info.Width*Info.Height*4;
+
+		uint64_t FilteredSize = (uint64_t)Info.Height*(Info.RowBytes + 1);
+		Info.MemoryRequired = Info.BitmapSize + Info.CompressedSize + FilteredSize + Info.RowBytes;
+		Info.IsValid = true;
+	}
+
+	return(Info);
+}
+
+inline uint32_t
+Premultiply(uint32_t R, uint32_t G, uint32_t B, uint32_t A)
+{
+	R = (R*A + 127) / 255;
+	G = (G*A + 127) / 255;
+	B = (B*A + 127) / 255;
+	return((A << 24) | (R << 16) | (G << 8) | B);
+}
+
+//Raw sample Index from an unfiltered row, at any bit depth, without rescaling
+inline uint32_t
+GetSample(uint8_t* Row, uint32_t Index, uint32_t BitDepth)
+{
+	uint32_t Result = 0;
+	if (BitDepth == 8)
+	{
+		Result = Row[Index];
+	}
+	else if (BitDepth == 16)
+	{
+		Result = ((uint32_t)Row[2*Index] << 8) | Row[2*Index + 1];
+	}
+	else
+	{
+		uint32_t Bit = Index*BitDepth;
+		uint32_t Shift = 8 - BitDepth - (Bit & 7);
+		Result = (Row[Bit >> 3] >> Shift) & ((1 << BitDepth) - 1);
+	}
+	return(Result);
+}
+
+//Samples to 8 bits: 16-bit keeps its high byte, sub-byte gray is stretched to the full range
+inline uint32_t
+ScaleSample(uint32_t Sample, uint32_t BitDepth)
+{
+	uint32_t Result = Sample;
+	if (BitDepth == 16)
+	{
+		Result = Sample >> 8;
+	}
+	else if (BitDepth < 8)
+	{
+		Result = Sample*(255 / ((1 << BitDepth) - 1));
+	}
+	return(Result);
+}
+
+internal png_decode_result
+DecodePNG(void* Contents, uint32_t ContentSize, void* Memory, uint64_t MemorySize)
+{
+	png_decode_result Result = {};
+	png_info Info = GetPNGInfo(Contents, ContentSize);
+	if (!Info.IsValid || (Info.MemoryRequired > MemorySize))
+	{
+		return(Result);
+	}
+
+	uint32_t* Pixels = (uint32_t*)Memory;
+	uint8_t* Compressed = (uint8_t*)Memory + Info.BitmapSize;
+	uint8_t* Filtered = Compressed + Info.CompressedSize;
+	uint64_t FilteredSize = (uint64_t)Info.Height*(Info.RowBytes + 1);
+	uint8_t* ZeroRow = Filtered + FilteredSize;
+
+	//Palette with tRNS alpha folded in, premultiplied up front so the pixel loop is a lookup
+	uint32_t Palette[256];
+	uint32_t PaletteCount = 0;
+	for (uint32_t Index = 0; Index < ArrayCount(Palette); Index++)
+	{
+		Palette[Index] = 0xFF000000;
+	}
+
+	bool32 HasColorKey = false;
+	uint32_t ColorKey[3] = {};
+
+	uint32_t CompressedAt = 0;
+	png_chunk_iterator Iter = BeginPNGChunks(Contents, ContentSize);
+	while (NextPNGChunk(&Iter))
+	{
+		if (Iter.Type == PNG_CHUNK_TYPE('P', 'L', 'T', 'E'))
+		{
+			PaletteCount = Iter.Length / 3;
+			if (PaletteCount > 256)
+			{
+				return(Result);
+			}
+			for (uint32_t Index = 0; Index < PaletteCount; Index++)
+			{
+				uint8_t* Entry = Iter.Data + 3*Index;
+				Palette[Index] = 0xFF000000 | (Entry[0] << 16) | (Entry[1] << 8) | Entry[2];
+			}
+		}
+		else if (Iter.Type == PNG_CHUNK_TYPE('t', 'R', 'N', 'S'))
+		{
+			if (Info.ColorType == PNGColorType_Palette)
+			{
+				for (uint32_t Index = 0; (Index < Iter.Length) && (Index < 256); Index++)
+				{
+					Palette[Index] = (Palette[Index] & 0x00FFFFFF) | ((uint32_t)Iter.Data[Index] << 24);
+				}
+			}
+			else if ((Info.ColorType == PNGColorType_Gray) && (Iter.Length >= 2))
+			{
+				HasColorKey = true;
+				ColorKey[0] = ((uint32_t)Iter.Data[0] << 8) | Iter.Data[1];
+			}
+			else if ((Info.ColorType == PNGColorType_RGB) && (Iter.Length >= 6))
+			{
+				HasColorKey = true;
+				for (uint32_t Channel = 0; Channel < 3; Channel++)
+				{
+					ColorKey[Channel] = ((uint32_t)Iter.Data[2*Channel] << 8) | Iter.Data[2*Channel + 1];
+				}
+			}
+		}
+		else if (Iter.Type == PNG_CHUNK_TYPE('I', 'D', 'A', 'T'))
+		{
+			memcpy(Compressed + CompressedAt, Iter.Data, Iter.Length);
+			CompressedAt += Iter.Length;
+		}
+		else if (Iter.Type == PNG_CHUNK_TYPE('I', 'E', 'N', 'D'))
+		{
+			break;
+		}
+	}
+
+	if ((Info.ColorType == PNGColorType_Palette) && !PaletteCount)
+	{
+		return(Result);
+	}
+	for (uint32_t Index = 0; Index < ArrayCount(Palette); Index++)
+	{
+		uint32_t P = Palette[Index];
+		Palette[Index] = Premultiply((P >> 16) & 0xFF, (P >> 8) & 0xFF, P & 0xFF, P >> 24);
+	}
+
+	int64_t InflatedSize = ZlibInflate(Compressed, Info.CompressedSize, Filtered, FilteredSize);
+	if (InflatedSize != (int64_t)FilteredSize)
+	{
+		return(Result);
+	}
+
+	for (uint32_t Index = 0; Index < Info.RowBytes; Index++)
+	{
+		ZeroRow[Index] = 0;
+	}
+
+	uint8_t* Prior = ZeroRow;
+	for (uint32_t Y = 0; Y < Info.Height; Y++)
+	{
+		uint8_t* FilterByte = Filtered + (uint64_t)Y*(Info.RowBytes + 1);
+		uint8_t* Row = FilterByte + 1;
+		if (*FilterByte > PNGFilter_Paeth)
+		{
+			return(Result);
+		}
+		UnfilterRowSSE2(*FilterByte, Row, Prior, Info.RowBytes, Info.FilterBytesPerPixel);
+
+		uint32_t* Dest = Pixels + (uint64_t)Y*Info.Width;
+		uint32_t D = Info.BitDepth;
+		switch (Info.ColorType)
+		{
+			case PNGColorType_Palette:
+			{
+				for (uint32_t X = 0; X < Info.Width; X++)
+				{
+					*Dest++ = Palette[GetSample(Row, X, D)];
+				}
+			}break;
+			case PNGColorType_Gray:
+			{
+				for (uint32_t X = 0; X < Info.Width; X++)
+				{
+					uint32_t Sample = GetSample(Row, X, D);
+					uint32_t Gray = ScaleSample(Sample, D);
+					*Dest++ = (HasColorKey && (Sample == ColorKey[0])) ? 0 : Premultiply(Gray, Gray, Gray, 255);
+				}
+			}break;
+			case PNGColorType_GrayAlpha:
+			{
+				for (uint32_t X = 0; X < Info.Width; X++)
+				{
+					uint32_t Gray = ScaleSample(GetSample(Row, 2*X, D), D);
+					uint32_t Alpha = ScaleSample(GetSample(Row, 2*X + 1, D), D);
+					*Dest++ = Premultiply(Gray, Gray, Gray, Alpha);
+				}
+			}break;
+			case PNGColorType_RGB:
+			{
+				for (uint32_t X = 0; X < Info.Width; X++)
+				{
+					uint32_t R = GetSample(Row, 3*X, D);
+					uint32_t G = GetSample(Row, 3*X + 1, D);
+					uint32_t B = GetSample(Row, 3*X + 2, D);
+					bool32 IsKeyed = HasColorKey && (R == ColorKey[0]) && (G == ColorKey[1]) && (B == ColorKey[2]);
+					*Dest++ = IsKeyed ? 0 : Premultiply(ScaleSample(R, D), ScaleSample(G, D), ScaleSample(B, D), 255);
+				}
+			}break;
+			case PNGColorType_RGBA:
+			{
+				for (uint32_t X = 0; X < Info.Width; X++)
+				{
+					*Dest++ = Premultiply(ScaleSample(GetSample(Row, 4*X, D), D), ScaleSample(GetSample(Row, 4*X + 1, D), D),
+						ScaleSample(GetSample(Row, 4*X + 2, D), D), ScaleSample(GetSample(Row, 4*X + 3, D), D));
+				}
+			}break;
+		}
+
+		Prior = Row;
+	}
+
+	Result.Success = true;
+	Result.Bitmap.Width = (int)Info.Width;
+	Result.Bitmap.Height = (int)Info.Height;
+	Result.Bitmap.Pitch = (int)Info.Width*4;
+	Result.Bitmap.Memory = Pixels;
+	Result.BitmapSize = Info.BitmapSize;
+	return(Result);
+}
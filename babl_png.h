@@ -0,0 +1,73 @@
+#if !defined(BABL_PNG_H)
+#define BABL_PNG_H
+
+/*
+	Self-contained PNG decoding straight into memory the caller hands over - no heap, no CRT allocation.
+	The region is laid out as [output bitmap][scratch], so after DecodePNG returns only the first
+	BitmapSize bytes need to be kept; the scratch (IDAT stream, inflated rows) can be reused.
+	Output is always 0xAARRGGBB with premultiplied alpha, matching the backbuffer.
+	Not supported: Adam7 interlacing. CRCs and the zlib Adler-32 are not checked.
+*/
+
+enum png_color_type
+{
+	PNGColorType_Gray = 0,
+	PNGColorType_RGB = 2,
+	PNGColorType_Palette = 3,
+	PNGColorType_GrayAlpha = 4,
+	PNGColorType_RGBA = 6,
+};
+
+struct png_info
+{
+	bool32 IsValid;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t BitDepth;
+	uint32_t ColorType;
+	uint32_t Channels;
+
+	//Bytes per complete pixel for filtering, rounded up to 1 for sub-byte formats
+	uint32_t FilterBytesPerPixel;
+	uint32_t RowBytes;
+
+	uint32_t CompressedSize;
+	uint64_t BitmapSize;
+	uint64_t MemoryRequired;
+};
+
+struct png_decode_result
+{
+	bool32 Success;
+	loaded_bitmap Bitmap;
+	uint64_t BitmapSize;
+};
+
+//
+// Inflate
+//
+
+struct png_bit_stream
+{
+	uint8_t* At;
+	uint8_t* End;
+	uint64_t BitBuffer;
+	uint32_t BitCount;
+
+	//Zero bytes fed in after End - if we ever consume into them the stream was truncated
+	uint32_t PaddingBits;
+};
+
+#define PNG_HUFFMAN_FAST_BITS 10
+#define PNG_HUFFMAN_MAX_BITS 15
+
+//Codes up to PNG_HUFFMAN_FAST_BITS long resolve in one table lookup (symbol in the low 9 bits, length in the top 4),
+//longer ones fall back to the canonical count/symbol walk
+struct png_huffman
+{
+	uint16_t Fast[1 << PNG_HUFFMAN_FAST_BITS];
+	uint16_t Count[PNG_HUFFMAN_MAX_BITS + 1];
+	uint16_t Symbol[288];
+};
+
+#endif
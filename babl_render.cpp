@@ -0,0 +1,722 @@
+#include "babl_render.h"
+#include "babl_dirty_region.h"
+
+//Picked once per DLL load by InitRenderKernels - statics are wiped on hot reload, so the game re-detects on the next frame
+global_variable render_kernels RenderKernels;
+
+//Also wiped on hot reload - new code may draw the same entries differently, so the first frame after a reload is fully dirty
+global_variable bool32 FrameHistoryIsTrusted;
+
+internal
+FILL_ROW(FillRowScalar)
+{
+	for (int Index = 0; Index < Count; Index++)
+	{
+		*Dest++ = Color;
+	}
+}
+
+internal
+GRADIENT_ROW(GradientRowScalar)
+{
+	for (int Index = 0; Index < Count; Index++)
+	{
+		uint8_t G = (uint8_t)(GStart + Index);
+		*Dest++ = ((R << 16) | (G << 8));
+	}
+}
+
+//Scalar up to the first 16-byte boundary, aligned stores through the interior, scalar tail
+internal
+FILL_ROW(FillRowSSE2)
+{
+	int Head = (int)((16 - ((uintptr_t)Dest & 15)) & 15) / (int)sizeof(uint32_t);
+	if (Head > Count)
+	{
+		Head = Count;
+	}
+	FillRowScalar(Dest, Head, Color);
+
+	__m128i Wide = _mm_set1_epi32((int)Color);
+	int Index = Head;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		_mm_store_si128((__m128i*)(Dest + Index), Wide);
+	}
+	FillRowScalar(Dest + Index, Count - Index, Color);
+}
+
+internal
+GRADIENT_ROW(GradientRowSSE2)
+{
+	__m128i RBits = _mm_set1_epi32((int)(R << 16));
+	__m128i ByteMask = _mm_set1_epi32(0xFF);
+	__m128i LaneStep = _mm_set1_epi32(4);
+	__m128i G = _mm_add_epi32(_mm_set1_epi32(GStart), _mm_setr_epi32(0, 1, 2, 3));
+
+	int Index = 0;
+	for (; Index + 4 <= Count; Index += 4)
+	{
+		__m128i Pixel = _mm_or_si128(RBits, _mm_slli_epi32(_mm_and_si128(G, ByteMask), 8));
+		_mm_storeu_si128((__m128i*)(Dest + Index), Pixel);
+		G = _mm_add_epi32(G, LaneStep);
+	}
+	GradientRowScalar(Dest + Index, Count - Index, R, GStart + Index);
+}
+
+//Walks 32-byte aligned blocks; the partial blocks at either edge go out through maskstore, which never touches
+//the masked lanes - important because those pixels may belong to a tile another thread is drawing
+//The head is masked from Dest itself, by how far Dest sits from the next boundary, so no pointer ever lands before the row
+internal BABL_TARGET_AVX2
+FILL_ROW(FillRowAVX2)
+{
+	__m256i Wide = _mm256_set1_epi32((int)Color);
+	__m256i LaneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	int Head = (int)((32 - ((uintptr_t)Dest & 31)) & 31) / (int)sizeof(uint32_t);
+	if (Head > Count)
+	{
+		Head = Count;
+	}
+	if (Head > 0)
+	{
+		__m256i HeadMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(Head), LaneIndex);
+		_mm256_maskstore_epi32((int*)Dest, HeadMask, Wide);
+	}
+
+	int Index = Head;
+	for (; Index + 8 <= Count; Index += 8)
+	{
+		_mm256_store_si256((__m256i*)(Dest + Index), Wide);
+	}
+
+	if (Index < Count)
+	{
+		__m256i TailMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(Count - Index), LaneIndex);
+		_mm256_maskstore_epi32((int*)(Dest + Index), TailMask, Wide);
+	}
+}
+
+internal BABL_TARGET_AVX2
+GRADIENT_ROW(GradientRowAVX2)
+{
+	__m256i RBits = _mm256_set1_epi32((int)(R << 16));
+	__m256i ByteMask = _mm256_set1_epi32(0xFF);
+	__m256i LaneStep = _mm256_set1_epi32(8);
+	__m256i G = _mm256_add_epi32(_mm256_set1_epi32(GStart), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+	int Index = 0;
+	for (; Index + 8 <= Count; Index += 8)
+	{
+		__m256i Pixel = _mm256_or_si256(RBits, _mm256_slli_epi32(_mm256_and_si256(G, ByteMask), 8));
+		_mm256_storeu_si256((__m256i*)(Dest + Index), Pixel);
+		G = _mm256_add_epi32(G, LaneStep);
+	}
+	GradientRowScalar(Dest + Index, Count - Index, R, GStart + Index);
+}
+
+internal void
+InitRenderKernels(cpu_features Features)
+{
+	RenderKernels.Name = "Scalar";
+	RenderKernels.FillRow = FillRowScalar;
+	RenderKernels.GradientRow = GradientRowScalar;
+
+	if (Features.AVX2)
+	{
+		RenderKernels.Name = "AVX2";
+		RenderKernels.FillRow = FillRowAVX2;
+		RenderKernels.GradientRow = GradientRowAVX2;
+	}
+	else if (Features.SSE2)
+	{
+		RenderKernels.Name = "SSE2";
+		RenderKernels.FillRow = FillRowSSE2;
+		RenderKernels.GradientRow = GradientRowSSE2;
+	}
+}
+
+inline rectangle2i
+BufferBounds(game_offscreen_buffer* buffer)
+{
+	rectangle2i Result = {0, 0, buffer->Width, buffer->Height};
+	return(Result);
+}
+
+inline uint32_t*
+PixelAt(game_offscreen_buffer* buffer, int X, int Y)
+{
+	uint32_t* Result = (uint32_t*)((uint8_t*)buffer->Memory + Y*buffer->Pitch + X*buffer->BytesPerPixel);
+	return(Result);
+}
+
+//Every draw routine takes a ClipRect so tiles can be rendered on separate threads without touching each other's pixels
+internal void
+FillBuffer(game_offscreen_buffer* buffer, uint32_t Color, rectangle2i ClipRect)
+{
+	rectangle2i Fill = Intersect(BufferBounds(buffer), ClipRect);
+	if (HasArea(Fill))
+	{
+		uint8_t* row = (uint8_t*)PixelAt(buffer, Fill.MinX, Fill.MinY);
+		for (int y = Fill.MinY; y < Fill.MaxY; ++y)
+		{
+			RenderKernels.FillRow((uint32_t*)row, Fill.MaxX - Fill.MinX, Color);
+			row += buffer->Pitch;
+		}
+	}
+}
+
+internal void
+RenderWeirdGradient(game_offscreen_buffer* buffer, int x_offset, int y_offset, rectangle2i ClipRect)
+{
+	rectangle2i Fill = Intersect(BufferBounds(buffer), ClipRect);
+	if (HasArea(Fill))
+	{
+		uint8_t* row = (uint8_t*)PixelAt(buffer, Fill.MinX, Fill.MinY);
+		for (int y = Fill.MinY; y < Fill.MaxY; ++y)
+		{
+			uint8_t r = (uint8_t)(y + y_offset);
+			RenderKernels.GradientRow((uint32_t*)row, Fill.MaxX - Fill.MinX, r, Fill.MinX + x_offset);
+			row += buffer->Pitch;
+		}
+	}
+}
+
+//Clips once up front, then fills row by row so memory is walked in order
+internal void
+DrawRectangle(game_offscreen_buffer* buffer, rectangle2i Rect, uint32_t Color, rectangle2i ClipRect)
+{
+	rectangle2i Fill = Intersect(Intersect(BufferBounds(buffer), ClipRect), Rect);
+	if (HasArea(Fill))
+	{
+		uint8_t* Row = (uint8_t*)PixelAt(buffer, Fill.MinX, Fill.MinY);
+		int Width = Fill.MaxX - Fill.MinX;
+		for (int Y = Fill.MinY; Y < Fill.MaxY; Y++)
+		{
+			RenderKernels.FillRow((uint32_t*)Row, Width, Color);
+			Row += buffer->Pitch;
+		}
+	}
+}
+
+inline uint32_t
+BlendChannel(uint32_t Source, uint32_t Dest, uint32_t InvAlpha, int Shift)
+{
+	uint32_t S = (Source >> Shift) & 0xFF;
+	uint32_t D = (Dest >> Shift) & 0xFF;
+	uint32_t Result = S + (D*InvAlpha + 127) / 255;
+	return(Result << Shift);
+}
+
+//Premultiplied "over": Dest = Source + Dest*(1 - SourceAlpha)
+internal void
+DrawBitmap(game_offscreen_buffer* buffer, loaded_bitmap* Bitmap, int X, int Y, rectangle2i ClipRect)
+{
+	rectangle2i BitmapRect = {X, Y, X + Bitmap->Width, Y + Bitmap->Height};
+	rectangle2i Fill = Intersect(Intersect(BufferBounds(buffer), ClipRect), BitmapRect);
+	if (HasArea(Fill))
+	{
+		uint8_t* SourceRow = (uint8_t*)Bitmap->Memory + (Fill.MinY - Y)*Bitmap->Pitch + (Fill.MinX - X)*sizeof(uint32_t);
+		uint8_t* DestRow = (uint8_t*)PixelAt(buffer, Fill.MinX, Fill.MinY);
+		for (int PixelY = Fill.MinY; PixelY < Fill.MaxY; PixelY++)
+		{
+			uint32_t* Source = (uint32_t*)SourceRow;
+			uint32_t* Dest = (uint32_t*)DestRow;
+			for (int PixelX = Fill.MinX; PixelX < Fill.MaxX; PixelX++)
+			{
+				uint32_t S = *Source++;
+				uint32_t D = *Dest;
+				uint32_t InvAlpha = 255 - (S >> 24);
+				*Dest++ = (BlendChannel(S, D, InvAlpha, 24) | BlendChannel(S, D, InvAlpha, 16) |
+					BlendChannel(S, D, InvAlpha, 8) | BlendChannel(S, D, InvAlpha, 0));
+			}
+			SourceRow += Bitmap->Pitch;
+			DestRow += buffer->Pitch;
+		}
+	}
+}
+
+//
+// Render group
+//
+
+internal render_group*
+AllocateRenderGroup(void* Memory, uint32_t MemorySize)
+{
+	Assert(MemorySize > sizeof(render_group));
+	render_group* Group = (render_group*)Memory;
+	Group->PushBufferBase = (uint8_t*)(Group + 1);
+	Group->MaxPushBufferSize = (MemorySize - sizeof(render_group)) & ~7u;
+	Group->PushBufferSize = 0;
+	Group->SortEntryCount = 0;
+	Group->SortEntryAt = (render_sort_entry*)(Group->PushBufferBase + Group->MaxPushBufferSize);
+	Group->Stats = {};
+	return(Group);
+}
+
+#define PushRenderElement(Group, type, Layer) (type*)PushRenderElement_(Group, sizeof(type), RenderGroupEntryType_##type, Layer)
+internal void*
+PushRenderElement_(render_group* Group, uint32_t Size, render_group_entry_type Type, int Layer)
+{
+	void* Result = 0;
+
+	//Bodies hold pointers, so keep every entry 8-byte aligned
+	Size = (sizeof(render_group_entry_header) + Size + 7) & ~7u;
+
+	//Space for two sort entries per element - the second half is the merge sort's scratch
+	uint32_t SortBytes = 2*(Group->SortEntryCount + 1)*sizeof(render_sort_entry);
+	if ((Group->PushBufferSize + Size + SortBytes <= Group->MaxPushBufferSize) &&
+		(Group->SortEntryCount < 0xFFFF))
+	{
+		Assert(Layer >= 0 && Layer <= 0xFFFF);
+		render_group_entry_header* Header = (render_group_entry_header*)(Group->PushBufferBase + Group->PushBufferSize);
+		Header->Type = Type;
+		Header->Layer = (uint32_t)Layer;
+
+		--Group->SortEntryAt;
+		Group->SortEntryAt->SortKey = ((uint32_t)Layer << 16) | Group->SortEntryCount;
+		Group->SortEntryAt->PushBufferOffset = Group->PushBufferSize;
+
+		Result = Header + 1;
+		Group->PushBufferSize += Size;
+		++Group->SortEntryCount;
+	}
+	else
+	{
+		Assert(!"Render group push buffer is full");
+	}
+
+	return(Result);
+}
+
+inline void
+PushClear(render_group* Group, int Layer, uint32_t Color)
+{
+	render_entry_clear* Entry = PushRenderElement(Group, render_entry_clear, Layer);
+	if (Entry)
+	{
+		Entry->Color = Color;
+	}
+}
+
+inline void
+PushGradient(render_group* Group, int Layer, int XOffset, int YOffset)
+{
+	render_entry_gradient* Entry = PushRenderElement(Group, render_entry_gradient, Layer);
+	if (Entry)
+	{
+		Entry->XOffset = XOffset;
+		Entry->YOffset = YOffset;
+	}
+}
+
+inline void
+PushRect(render_group* Group, int Layer, rectangle2i Rect, uint32_t Color)
+{
+	render_entry_rectangle* Entry = PushRenderElement(Group, render_entry_rectangle, Layer);
+	if (Entry)
+	{
+		Entry->Rect = Rect;
+		Entry->Color = Color;
+	}
+}
+
+inline void
+PushBitmap(render_group* Group, int Layer, loaded_bitmap* Bitmap, int X, int Y)
+{
+	render_entry_bitmap* Entry = PushRenderElement(Group, render_entry_bitmap, Layer);
+	if (Entry)
+	{
+		Entry->Bitmap = Bitmap;
+		Entry->X = X;
+		Entry->Y = Y;
+	}
+}
+
+inline render_group_entry_header*
+GetEntryHeader(render_group* Group, render_sort_entry* SortEntry)
+{
+	render_group_entry_header* Result = (render_group_entry_header*)(Group->PushBufferBase + SortEntry->PushBufferOffset);
+	return(Result);
+}
+
+//Bottom-up merge sort - stable, no recursion, and Temp needs to be as big as Entries
+internal void
+SortRenderEntries(render_sort_entry* Entries, uint32_t Count, render_sort_entry* Temp)
+{
+	render_sort_entry* Source = Entries;
+	render_sort_entry* Dest = Temp;
+	for (uint32_t Width = 1; Width < Count; Width *= 2)
+	{
+		for (uint32_t Start = 0; Start < Count; Start += 2*Width)
+		{
+			uint32_t Middle = (Start + Width < Count) ? Start + Width : Count;
+			uint32_t End = (Start + 2*Width < Count) ? Start + 2*Width : Count;
+
+			uint32_t Left = Start;
+			uint32_t Right = Middle;
+			for (uint32_t Out = Start; Out < End; Out++)
+			{
+				if ((Right >= End) || ((Left < Middle) && (Source[Left].SortKey <= Source[Right].SortKey)))
+				{
+					Dest[Out] = Source[Left++];
+				}
+				else
+				{
+					Dest[Out] = Source[Right++];
+				}
+			}
+		}
+
+		render_sort_entry* Swap = Source;
+		Source = Dest;
+		Dest = Swap;
+	}
+
+	if (Source != Entries)
+	{
+		for (uint32_t Index = 0; Index < Count; Index++)
+		{
+			Entries[Index] = Source[Index];
+		}
+	}
+}
+
+//Two same-colored rectangles that share a full edge draw exactly like their union
+internal bool32
+TryMergeRectangles(render_entry_rectangle* A, render_entry_rectangle* B)
+{
+	bool32 Result = false;
+	if (A->Color == B->Color)
+	{
+		rectangle2i RA = A->Rect;
+		rectangle2i RB = B->Rect;
+		if ((RA.MinY == RB.MinY) && (RA.MaxY == RB.MaxY) && ((RA.MaxX == RB.MinX) || (RB.MaxX == RA.MinX)))
+		{
+			A->Rect.MinX = (RA.MinX < RB.MinX) ? RA.MinX : RB.MinX;
+			A->Rect.MaxX = (RA.MaxX > RB.MaxX) ? RA.MaxX : RB.MaxX;
+			Result = true;
+		}
+		else if ((RA.MinX == RB.MinX) && (RA.MaxX == RB.MaxX) && ((RA.MaxY == RB.MinY) || (RB.MaxY == RA.MinY)))
+		{
+			A->Rect.MinY = (RA.MinY < RB.MinY) ? RA.MinY : RB.MinY;
+			A->Rect.MaxY = (RA.MaxY > RB.MaxY) ? RA.MaxY : RB.MaxY;
+			Result = true;
+		}
+	}
+	return(Result);
+}
+
+//Walks the sorted list once, folding each entry into its predecessor where the pixels come out the same
+internal void
+MergeRenderEntries(render_group* Group)
+{
+	render_sort_entry* Entries = Group->SortEntryAt;
+	uint32_t OutCount = 0;
+	for (uint32_t Index = 0; Index < Group->SortEntryCount; Index++)
+	{
+		render_group_entry_header* Header = GetEntryHeader(Group, &Entries[Index]);
+		if (OutCount > 0)
+		{
+			render_group_entry_header* Previous = GetEntryHeader(Group, &Entries[OutCount - 1]);
+			if ((Previous->Layer == Header->Layer) && (Previous->Type == Header->Type))
+			{
+				if (Header->Type == RenderGroupEntryType_render_entry_rectangle)
+				{
+					if (TryMergeRectangles((render_entry_rectangle*)(Previous + 1), (render_entry_rectangle*)(Header + 1)))
+					{
+						++Group->Stats.MergedCount;
+						continue;
+					}
+				}
+				else if (Header->Type == RenderGroupEntryType_render_entry_clear)
+				{
+					//Back-to-back clears - only the second one is ever visible
+					Entries[OutCount - 1] = Entries[Index];
+					++Group->Stats.MergedCount;
+					continue;
+				}
+			}
+		}
+		Entries[OutCount++] = Entries[Index];
+	}
+	Group->SortEntryCount = OutCount;
+}
+
+//True if the entry writes every pixel of ClipRect opaquely, making everything drawn before it there invisible
+internal bool32
+CoversClipRect(render_group_entry_header* Header, rectangle2i ClipRect)
+{
+	bool32 Result = false;
+	switch (Header->Type)
+	{
+		case RenderGroupEntryType_render_entry_clear:
+		case RenderGroupEntryType_render_entry_gradient:
+		{
+			Result = true;
+		}break;
+		case RenderGroupEntryType_render_entry_rectangle:
+		{
+			rectangle2i Rect = ((render_entry_rectangle*)(Header + 1))->Rect;
+			Result = ((Rect.MinX <= ClipRect.MinX) && (Rect.MinY <= ClipRect.MinY) &&
+				(Rect.MaxX >= ClipRect.MaxX) && (Rect.MaxY >= ClipRect.MaxY));
+		}break;
+		default:
+		{
+		}break;
+	}
+	return(Result);
+}
+
+//Returns how many entries were culled for this tile
+internal uint32_t
+RenderGroupToTile(render_group* Group, game_offscreen_buffer* Buffer, rectangle2i ClipRect)
+{
+	render_sort_entry* Entries = Group->SortEntryAt;
+
+	uint32_t FirstVisible = 0;
+	for (uint32_t Index = Group->SortEntryCount; Index > 0; Index--)
+	{
+		if (CoversClipRect(GetEntryHeader(Group, &Entries[Index - 1]), ClipRect))
+		{
+			FirstVisible = Index - 1;
+			break;
+		}
+	}
+
+	for (uint32_t Index = FirstVisible; Index < Group->SortEntryCount; Index++)
+	{
+		render_group_entry_header* Header = GetEntryHeader(Group, &Entries[Index]);
+		void* Data = Header + 1;
+		switch (Header->Type)
+		{
+			case RenderGroupEntryType_render_entry_clear:
+			{
+				render_entry_clear* Entry = (render_entry_clear*)Data;
+				FillBuffer(Buffer, Entry->Color, ClipRect);
+			}break;
+			case RenderGroupEntryType_render_entry_gradient:
+			{
+				render_entry_gradient* Entry = (render_entry_gradient*)Data;
+				RenderWeirdGradient(Buffer, Entry->XOffset, Entry->YOffset, ClipRect);
+			}break;
+			case RenderGroupEntryType_render_entry_rectangle:
+			{
+				render_entry_rectangle* Entry = (render_entry_rectangle*)Data;
+				DrawRectangle(Buffer, Entry->Rect, Entry->Color, ClipRect);
+			}break;
+			case RenderGroupEntryType_render_entry_bitmap:
+			{
+				render_entry_bitmap* Entry = (render_entry_bitmap*)Data;
+				DrawBitmap(Buffer, Entry->Bitmap, Entry->X, Entry->Y, ClipRect);
+			}break;
+			default:
+			{
+				Assert(!"Unknown render entry type");
+			}break;
+		}
+	}
+
+	return(FirstVisible);
+}
+
+inline uint32_t
+GetEntryBodySize(render_group_entry_type Type)
+{
+	uint32_t Result = 0;
+	switch (Type)
+	{
+		case RenderGroupEntryType_render_entry_clear: {Result = sizeof(render_entry_clear);}break;
+		case RenderGroupEntryType_render_entry_gradient: {Result = sizeof(render_entry_gradient);}break;
+		case RenderGroupEntryType_render_entry_rectangle: {Result = sizeof(render_entry_rectangle);}break;
+		case RenderGroupEntryType_render_entry_bitmap: {Result = sizeof(render_entry_bitmap);}break;
+		default: {Assert(!"Unknown render entry type");}break;
+	}
+	return(Result);
+}
+
+//FNV-1a over the header and body
+internal uint64_t
+HashRenderEntry(render_group_entry_header* Header)
+{
+	uint64_t Hash = 14695981039346656037ULL;
+	uint8_t* At = (uint8_t*)Header;
+	uint32_t Size = sizeof(render_group_entry_header) + GetEntryBodySize(Header->Type);
+	for (uint32_t Index = 0; Index < Size; Index++)
+	{
+		Hash = (Hash ^ At[Index])*1099511628211ULL;
+	}
+	return(Hash);
+}
+
+internal rectangle2i
+GetEntryBounds(render_group_entry_header* Header, rectangle2i Frame)
+{
+	rectangle2i Result = Frame;
+	if (Header->Type == RenderGroupEntryType_render_entry_rectangle)
+	{
+		Result = Intersect(((render_entry_rectangle*)(Header + 1))->Rect, Frame);
+	}
+	else if (Header->Type == RenderGroupEntryType_render_entry_bitmap)
+	{
+		render_entry_bitmap* Entry = (render_entry_bitmap*)(Header + 1);
+		rectangle2i BitmapRect = {Entry->X, Entry->Y, Entry->X + Entry->Bitmap->Width, Entry->Y + Entry->Bitmap->Height};
+		Result = Intersect(BitmapRect, Frame);
+	}
+	return(Result);
+}
+
+/*
+	Compares this frame's sorted entries against last frame's, index by index. A pixel can only change if some
+	entry covering it differs at its index, so the bounds of every mismatched pair (plus any entries past the end
+	of the shorter list) cover all the damage. Inserting an entry early shifts everything after it and dirties
+	a lot - that is conservative, never wrong.
+*/
+internal void
+ComputeDamage(render_group* Group, render_frame_history* History, game_offscreen_buffer* Buffer)
+{
+	dirty_region_set* Dirty = &Buffer->Dirty;
+	bool32 RepaintRequested = Dirty->FullFrame;
+	*Dirty = {};
+
+	//History lives in transient storage, so a restore rewinds it while the backbuffer keeps the newer pixels -
+	//the platform asks for a repaint then, since nothing in here can tell
+	rectangle2i Frame = BufferBounds(Buffer);
+	Dirty->FullFrame = (RepaintRequested || !FrameHistoryIsTrusted || !History->IsValid ||
+		(History->BufferMemory != Buffer->Memory) ||
+		(History->Width != Buffer->Width) || (History->Height != Buffer->Height));
+
+	bool32 Fits = (Group->SortEntryCount <= ArrayCount(History->Entries));
+	render_sort_entry* Entries = Group->SortEntryAt;
+	uint32_t CompareCount = (Group->SortEntryCount > History->EntryCount) ? Group->SortEntryCount : History->EntryCount;
+	for (uint32_t Index = 0; !Dirty->FullFrame && (Index < CompareCount); Index++)
+	{
+		render_entry_signature* Old = (Index < History->EntryCount) ? &History->Entries[Index] : 0;
+		if (Index < Group->SortEntryCount)
+		{
+			render_group_entry_header* Header = GetEntryHeader(Group, &Entries[Index]);
+			uint64_t Hash = HashRenderEntry(Header);
+			if (!Old || (Old->Hash != Hash))
+			{
+				AddDirtyRect(Dirty, GetEntryBounds(Header, Frame));
+				if (Old)
+				{
+					AddDirtyRect(Dirty, Old->Bounds);
+				}
+			}
+		}
+		else
+		{
+			AddDirtyRect(Dirty, Old->Bounds);
+		}
+	}
+
+	History->IsValid = Fits;
+	History->BufferMemory = Buffer->Memory;
+	History->Width = Buffer->Width;
+	History->Height = Buffer->Height;
+	History->EntryCount = 0;
+	if (Fits)
+	{
+		for (uint32_t Index = 0; Index < Group->SortEntryCount; Index++)
+		{
+			render_group_entry_header* Header = GetEntryHeader(Group, &Entries[Index]);
+			render_entry_signature* Signature = &History->Entries[History->EntryCount++];
+			Signature->Hash = HashRenderEntry(Header);
+			Signature->Bounds = GetEntryBounds(Header, Frame);
+		}
+	}
+	FrameHistoryIsTrusted = true;
+}
+
+struct tile_render_work
+{
+	render_group* Group;
+	game_offscreen_buffer* Buffer;
+	rectangle2i ClipRect;
+	uint32_t CulledCount;
+};
+
+internal
+PLATFORM_WORK_QUEUE_CALLBACK(DoTileRenderWork)
+{
+	TIMED_FUNCTION();
+	tile_render_work* Work = (tile_render_work*)Data;
+	Work->CulledCount = RenderGroupToTile(Work->Group, Work->Buffer, Work->ClipRect);
+}
+
+//Tiles are 128 pixels wide (512 bytes, a whole number of cache lines, so neighbouring tiles never share a line)
+//and 64 rows tall, which keeps one tile's pixels at 32KB - about the size of L1
+//Only tiles touching this frame's damage are rasterized - everything else is still on the backbuffer from last frame
+internal void
+TiledRenderGroupToOutput(game_memory* Memory, render_group* Group, render_frame_history* History, game_offscreen_buffer* Buffer)
+{
+	TIMED_FUNCTION();
+	uint64_t StartCycles = __rdtsc();
+
+	Group->Stats.PushBufferBytes = Group->PushBufferSize;
+	Group->Stats.EntryCount = Group->SortEntryCount;
+
+	render_sort_entry* SortTemp = (render_sort_entry*)(Group->PushBufferBase + Group->PushBufferSize);
+	SortRenderEntries(Group->SortEntryAt, Group->SortEntryCount, SortTemp);
+	MergeRenderEntries(Group);
+	ComputeDamage(Group, History, Buffer);
+
+	if (!Memory->RenderQueue)
+	{
+		if (IsDirty(&Buffer->Dirty, BufferBounds(Buffer)))
+		{
+			Group->Stats.CulledCount = RenderGroupToTile(Group, Buffer, BufferBounds(Buffer));
+		}
+	}
+	else
+	{
+		tile_render_work WorkArray[512];
+		int TileWidth = 128;
+		int TileHeight = 64;
+		int TileCountX = (Buffer->Width + TileWidth - 1) / TileWidth;
+		int TileCountY = (Buffer->Height + TileHeight - 1) / TileHeight;
+		while (TileCountX*TileCountY > ArrayCount(WorkArray))
+		{
+			TileHeight *= 2;
+			TileCountY = (Buffer->Height + TileHeight - 1) / TileHeight;
+		}
+
+		int WorkCount = 0;
+		for (int TileY = 0; TileY < TileCountY; TileY++)
+		{
+			for (int TileX = 0; TileX < TileCountX; TileX++)
+			{
+				rectangle2i ClipRect;
+				ClipRect.MinX = TileX*TileWidth;
+				ClipRect.MinY = TileY*TileHeight;
+				ClipRect.MaxX = ClipRect.MinX + TileWidth;
+				ClipRect.MaxY = ClipRect.MinY + TileHeight;
+				ClipRect = Intersect(ClipRect, BufferBounds(Buffer));
+				if (!IsDirty(&Buffer->Dirty, ClipRect))
+				{
+					++Group->Stats.SkippedTileCount;
+					continue;
+				}
+
+				tile_render_work* Work = &WorkArray[WorkCount++];
+				Work->Group = Group;
+				Work->Buffer = Buffer;
+				Work->ClipRect = ClipRect;
+				Work->CulledCount = 0;
+
+				Memory->PlatformAddEntry(Memory->RenderQueue, DoTileRenderWork, Work);
+			}
+		}
+
+		Memory->PlatformCompleteAllWork(Memory->RenderQueue);
+
+		for (int WorkIndex = 0; WorkIndex < WorkCount; WorkIndex++)
+		{
+			Group->Stats.CulledCount += WorkArray[WorkIndex].CulledCount;
+		}
+	}
+
+	Group->Stats.RenderCycles = __rdtsc() - StartCycles;
+	Buffer->RenderStats = Group->Stats;
+}
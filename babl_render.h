@@ -0,0 +1,103 @@
+#if !defined(BABL_RENDER_H)
+#define BABL_RENDER_H
+
+//Row kernels - every fill in the renderer bottoms out in one of these, writing Count contiguous 0xAARRGGBB pixels
+//The scalar versions are the reference; the wide versions must produce bit-identical output
+#define FILL_ROW(name) void name(uint32_t* Dest, int Count, uint32_t Color)
+typedef FILL_ROW(fill_row);
+
+//Pixel i of the row gets red = R, green = low byte of (GStart + i), blue = 0
+#define GRADIENT_ROW(name) void name(uint32_t* Dest, int Count, uint32_t R, int GStart)
+typedef GRADIENT_ROW(gradient_row);
+
+struct render_kernels
+{
+	char* Name;
+	fill_row* FillRow;
+	gradient_row* GradientRow;
+};
+
+/*
+	The game never draws directly - it pushes these entries into a render_group, and TiledRenderGroupToOutput
+	sorts them by layer, merges what it can, culls what is hidden and rasterizes the rest in tiles.
+	There is only the one render target (the backbuffer) for now, so layer is the whole sort key.
+	Each entry is a render_group_entry_header followed immediately by its body.
+*/
+enum render_group_entry_type
+{
+	RenderGroupEntryType_render_entry_clear,
+	RenderGroupEntryType_render_entry_gradient,
+	RenderGroupEntryType_render_entry_rectangle,
+	RenderGroupEntryType_render_entry_bitmap,
+};
+
+struct render_group_entry_header
+{
+	render_group_entry_type Type;
+	uint32_t Layer;
+};
+
+struct render_entry_clear
+{
+	uint32_t Color;
+};
+
+struct render_entry_gradient
+{
+	int XOffset;
+	int YOffset;
+};
+
+struct render_entry_rectangle
+{
+	rectangle2i Rect;
+	uint32_t Color;
+};
+
+struct render_entry_bitmap
+{
+	loaded_bitmap* Bitmap;
+	int X;
+	int Y;
+};
+
+//Layer in the high 16 bits, push order in the low 16, so sorting keeps same-layer entries in the order they were pushed
+struct render_sort_entry
+{
+	uint32_t SortKey;
+	uint32_t PushBufferOffset;
+};
+
+//Last frame's sorted entry list, boiled down to what each entry hashed to and where it could have drawn
+//Bitmaps hash by pointer, so a bitmap whose pixels change in place has to be re-pushed somewhere new to show up
+struct render_entry_signature
+{
+	uint64_t Hash;
+	rectangle2i Bounds;
+};
+
+struct render_frame_history
+{
+	bool32 IsValid;
+	void* BufferMemory;
+	int Width;
+	int Height;
+
+	uint32_t EntryCount;
+	render_entry_signature Entries[4096];
+};
+
+//Entries grow up from the bottom of the push buffer, sort entries grow down from the top
+struct render_group
+{
+	uint32_t MaxPushBufferSize;
+	uint32_t PushBufferSize;
+	uint8_t* PushBufferBase;
+
+	uint32_t SortEntryCount;
+	render_sort_entry* SortEntryAt;
+
+	render_group_stats Stats;
+};
+
+#endif
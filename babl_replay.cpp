@@ -0,0 +1,574 @@
+/*
+	Headless replay runner - loads the game library and drives it from an input recording as fast as it will go.
+	No window, no sound device, no frame pacing: a fixed-size offscreen buffer, a fixed number of sound samples
+	per frame, and every queued work entry run on this thread. The same library, recording and options give the
+	same checksums every time, so this doubles as a regression gate for game-layer speed and behaviour.
+
+	Usage: babl_replay <babl.so> <recording.ir | -synthetic frames> [-data dir] [-size WxH] [-runs N]
+		-data     where asset files the game asks for are looked up by file name (the game's paths are Windows ones)
+		-size     offscreen buffer size, 1280x720 by default
+		-runs     replays from a fresh game memory N times; checksums must agree across runs
+
+	POSIX only. The recording replays from a freshly initialized game, not from the state it was recorded in.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "babl.h"
+#include "babl_platform_memory.h"
+#include "babl_input_stream.h"
+
+//Game memory and file mappings go at fixed addresses, so the pointers stored in game memory hash the same every run
+#define REPLAY_GAME_MEMORY_BASE Terabytes(2)
+#define REPLAY_FILE_MAPPING_BASE Terabytes(3)
+#define REPLAY_FILE_MAPPING_STRIDE Gigabytes(4)
+
+#define REPLAY_SAMPLES_PER_SECOND 48000
+#define REPLAY_GAME_UPDATE_HZ 30
+
+global_variable platform_memory_block GlobalGameMemory;
+global_variable char* GlobalDataDirectory = ".";
+global_variable uint32_t GlobalFileMappingCount;
+
+struct replay_game_code
+{
+	void* Library;
+	game_update_and_render* UpdateAndRender;
+	game_get_sound_samples* GetSoundSamples;
+};
+
+//Work is queued and run to completion on this thread - rendering waits on its queue, asset loads land the frame after
+struct platform_work_queue
+{
+	uint32_t EntryCount;
+	platform_work_queue_callback* Callbacks[1024];
+	void* Data[1024];
+};
+
+internal
+PLATFORM_COMPLETE_ALL_WORK(ReplayCompleteAllWork)
+{
+	//Entries may add more entries - run until none are left
+	for (uint32_t EntryIndex = 0; EntryIndex < Queue->EntryCount; EntryIndex++)
+	{
+		Queue->Callbacks[EntryIndex](Queue, Queue->Data[EntryIndex]);
+	}
+	Queue->EntryCount = 0;
+}
+
+internal
+PLATFORM_ADD_ENTRY(ReplayAddEntry)
+{
+	if (Queue->EntryCount == ArrayCount(Queue->Callbacks))
+	{
+		ReplayCompleteAllWork(Queue);
+	}
+	Queue->Callbacks[Queue->EntryCount] = Callback;
+	Queue->Data[Queue->EntryCount] = Data;
+	++Queue->EntryCount;
+}
+
+internal
+PLATFORM_COMMIT_MEMORY(ReplayCommitMemory)
+{
+	return(CommitPlatformMemory(&GlobalGameMemory, Memory, Size));
+}
+
+//The game asks for files by absolute Windows path - try it as given, then by file name in the data directory
+internal int
+OpenGameFile(char* Filename)
+{
+	int File = open(Filename, O_RDONLY);
+	if (File < 0)
+	{
+		char* Name = Filename;
+		for (char* Scan = Filename; *Scan; Scan++)
+		{
+			if ((*Scan == '/') || (*Scan == '\\'))
+			{
+				Name = Scan + 1;
+			}
+		}
+		char Path[4096];
+		snprintf(Path, sizeof(Path), "%s/%s", GlobalDataDirectory, Name);
+		File = open(Path, O_RDONLY);
+	}
+	return(File);
+}
+
+internal
+PLATFORM_MAP_READ_ONLY_FILE(ReplayMapReadOnlyFile)
+{
+	platform_file_mapping Result = {};
+	int File = OpenGameFile(Filename);
+	struct stat FileStatus;
+	if ((File >= 0) && (fstat(File, &FileStatus) == 0) && (FileStatus.st_size > 0) &&
+		((uint64_t)FileStatus.st_size <= REPLAY_FILE_MAPPING_STRIDE))
+	{
+		int Flags = MAP_PRIVATE;
+#if defined(MAP_FIXED_NOREPLACE)
+		Flags |= MAP_FIXED_NOREPLACE;
+#endif
+		void* Address = (void*)(uintptr_t)(REPLAY_FILE_MAPPING_BASE + GlobalFileMappingCount*REPLAY_FILE_MAPPING_STRIDE);
+		void* Memory = mmap(Address, FileStatus.st_size, PROT_READ, Flags, File, 0);
+		if (Memory != MAP_FAILED)
+		{
+			++GlobalFileMappingCount;
+			Result.Memory = Memory;
+			Result.Size = FileStatus.st_size;
+		}
+	}
+	if (File >= 0)
+	{
+		close(File);
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_UNMAP_FILE(ReplayUnmapFile)
+{
+	if (Mapping->Memory)
+	{
+		munmap(Mapping->Memory, Mapping->Size);
+	}
+	*Mapping = {};
+}
+
+internal
+PLATFORM_GET_FILE_STAMP(ReplayGetFileStamp)
+{
+	platform_file_stamp Result = {};
+	int File = OpenGameFile(Filename);
+	struct stat FileStatus;
+	if ((File >= 0) && (fstat(File, &FileStatus) == 0))
+	{
+		Result.Exists = true;
+		Result.Size = FileStatus.st_size;
+		Result.WriteTime = FileStatus.st_mtime;
+	}
+	if (File >= 0)
+	{
+		close(File);
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_OPEN_FILE(ReplayOpenFile)
+{
+	platform_file_handle Result = {};
+	int File = OpenGameFile(Filename);
+	struct stat FileStatus;
+	if ((File >= 0) && (fstat(File, &FileStatus) == 0))
+	{
+		Result.IsOpen = true;
+		Result.Size = FileStatus.st_size;
+		Result.PlatformHandle = (void*)(intptr_t)File;
+	}
+	else if (File >= 0)
+	{
+		close(File);
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_READ_DATA_FROM_FILE(ReplayReadDataFromFile)
+{
+	bool32 Result = Handle->IsOpen && (Offset + Size <= Handle->Size);
+	int File = (int)(intptr_t)Handle->PlatformHandle;
+	uint32_t BytesRead = 0;
+	while (Result && (BytesRead < Size))
+	{
+		ssize_t Read = pread(File, (uint8_t*)Dest + BytesRead, Size - BytesRead, (off_t)(Offset + BytesRead));
+		if (Read > 0)
+		{
+			BytesRead += (uint32_t)Read;
+		}
+		else if ((Read < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		else
+		{
+			Result = false;
+		}
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_CLOSE_FILE(ReplayCloseFile)
+{
+	if (Handle->IsOpen)
+	{
+		close((int)(intptr_t)Handle->PlatformHandle);
+	}
+	*Handle = {};
+}
+
+internal
+DEBUG_PLATFORM_READ_ENTIRE_FILE(ReplayReadEntireFile)
+{
+	debug_read_file_result Result = {};
+	int File = OpenGameFile(Filename);
+	struct stat FileStatus;
+	if ((File >= 0) && (fstat(File, &FileStatus) == 0) && (FileStatus.st_size > 0) && (FileStatus.st_size <= 0xFFFFFFFF))
+	{
+		Result.Contents = malloc(FileStatus.st_size);
+		if (Result.Contents && (read(File, Result.Contents, FileStatus.st_size) == FileStatus.st_size))
+		{
+			Result.ContentSize = (uint32_t)FileStatus.st_size;
+		}
+		else
+		{
+			free(Result.Contents);
+			Result.Contents = 0;
+		}
+	}
+	if (File >= 0)
+	{
+		close(File);
+	}
+	return(Result);
+}
+
+internal
+DEBUG_PLATFORM_FREE_FILE_MEMORY(ReplayFreeFileMemory)
+{
+	free(Memory);
+	return(0);
+}
+
+//Replays must not leave files behind - writes are accepted and dropped
+internal
+DEBUG_PLATFORM_WRITE_ENTIRE_FILE(ReplayWriteEntireFile)
+{
+	return(true);
+}
+
+internal replay_game_code
+LoadGameCode(char* LibraryPath)
+{
+	replay_game_code Result = {};
+	Result.Library = dlopen(LibraryPath, RTLD_NOW | RTLD_LOCAL);
+	if (Result.Library)
+	{
+		Result.UpdateAndRender = (game_update_and_render*)dlsym(Result.Library, "GameUpdateAndRender");
+		Result.GetSoundSamples = (game_get_sound_samples*)dlsym(Result.Library, "GameGetSoundSamples");
+	}
+	return(Result);
+}
+
+inline uint64_t
+HashBytes(uint64_t Hash, void* Memory, uint64_t Size)
+{
+	uint8_t* Bytes = (uint8_t*)Memory;
+	for (uint64_t Index = 0; Index < Size; Index++)
+	{
+		Hash = (Hash ^ Bytes[Index])*1099511628211ULL;
+	}
+	return(Hash);
+}
+
+#define REPLAY_HASH_SEED 14695981039346656037ULL
+
+//Only permanent storage counts as state - transient storage is caches and timing stats, rebuilt at will
+internal uint64_t
+HashPermanentStorage(platform_memory_block* Block, uint64_t PermanentStorageSize)
+{
+	uint64_t Hash = REPLAY_HASH_SEED;
+	uint32_t ChunkCount = (uint32_t)(PermanentStorageSize / PLATFORM_MEMORY_CHUNK_SIZE);
+	for (uint32_t ChunkIndex = 0; ChunkIndex < ChunkCount; ChunkIndex++)
+	{
+		if (IsChunkCommitted(Block->CommittedChunks, ChunkIndex))
+		{
+			Hash = HashBytes(Hash, &ChunkIndex, sizeof(ChunkIndex));
+			Hash = HashBytes(Hash, GetChunkMemory(Block, ChunkIndex), PLATFORM_MEMORY_CHUNK_SIZE);
+		}
+	}
+	return(Hash);
+}
+
+inline uint64_t
+GetNanoseconds()
+{
+	struct timespec Time;
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+	return((uint64_t)Time.tv_sec*1000000000ULL + Time.tv_nsec);
+}
+
+internal int
+CompareUInt64(const void* A, const void* B)
+{
+	uint64_t ValueA = *(uint64_t*)A;
+	uint64_t ValueB = *(uint64_t*)B;
+	return((ValueA < ValueB) ? -1 : (ValueA > ValueB) ? 1 : 0);
+}
+
+inline double
+GetPercentile(uint64_t* Sorted, uint32_t Count, uint32_t Percent)
+{
+	uint32_t Index = (uint32_t)(((uint64_t)Count*Percent + 99) / 100);
+	Index = (Index > 0) ? Index - 1 : 0;
+	return((double)Sorted[Index] / 1000000.0);
+}
+
+//Input that changes now and then, for when there is no recording to hand - same seed, same frames
+internal void
+MakeSyntheticInput(uint32_t FrameIndex, game_input_buffer* Input)
+{
+	uint32_t Random = FrameIndex*2654435761u + 0x9E3779B9;
+	Random ^= Random >> 15;
+	Random *= 0x2C1B3C6D;
+	Random ^= Random >> 12;
+
+	if ((FrameIndex % 30) == 0)
+	{
+		game_controller_input* Controller = &Input->Controllers[0];
+		for (int ButtonIndex = 0; ButtonIndex < ArrayCount(Controller->Buttons); ButtonIndex++)
+		{
+			Controller->Buttons[ButtonIndex].EndedDown = (Random >> ButtonIndex) & (ButtonIndex < 4);
+		}
+		Controller->FaceDown.EndedDown = (Random >> 20) & 1;
+
+		Input->Controllers[1].IsAnalog = true;
+		Input->Controllers[1].StickX = (float)((int)(Random % 201) - 100) / 100.0f;
+		Input->Controllers[1].StickY = (float)((int)((Random >> 8) % 201) - 100) / 100.0f;
+	}
+	Input->MouseX = (int32_t)(FrameIndex*7 % 1280);
+	Input->MouseY = (int32_t)(FrameIndex*3 % 720);
+}
+
+struct replay_result
+{
+	uint64_t StateHash;
+	uint64_t PixelHash;
+	uint64_t SoundHash;
+};
+
+int
+main(int ArgCount, char** Args)
+{
+	char* LibraryPath = 0;
+	char* RecordingPath = 0;
+	uint32_t SyntheticFrameCount = 0;
+	int Width = 1280;
+	int Height = 720;
+	int RunCount = 1;
+	for (int ArgIndex = 1; ArgIndex < ArgCount; ArgIndex++)
+	{
+		char* Arg = Args[ArgIndex];
+		bool32 HasValue = (ArgIndex + 1 < ArgCount);
+		if ((strcmp(Arg, "-synthetic") == 0) && HasValue)
+		{
+			SyntheticFrameCount = (uint32_t)atoi(Args[++ArgIndex]);
+		}
+		else if ((strcmp(Arg, "-data") == 0) && HasValue)
+		{
+			GlobalDataDirectory = Args[++ArgIndex];
+		}
+		else if ((strcmp(Arg, "-size") == 0) && HasValue)
+		{
+			sscanf(Args[++ArgIndex], "%dx%d", &Width, &Height);
+		}
+		else if ((strcmp(Arg, "-runs") == 0) && HasValue)
+		{
+			RunCount = atoi(Args[++ArgIndex]);
+		}
+		else if (!LibraryPath)
+		{
+			LibraryPath = Arg;
+		}
+		else if (!RecordingPath)
+		{
+			RecordingPath = Arg;
+		}
+	}
+
+	if (!LibraryPath || (!RecordingPath == !SyntheticFrameCount) || (Width <= 0) || (Height <= 0) || (RunCount <= 0))
+	{
+		fprintf(stderr, "Usage: babl_replay <babl.so> <recording.ir | -synthetic frames> [-data dir] [-size WxH] [-runs N]\n");
+		return(1);
+	}
+
+	replay_game_code Game = LoadGameCode(LibraryPath);
+	if (!Game.UpdateAndRender || !Game.GetSoundSamples)
+	{
+		fprintf(stderr, "babl_replay: could not load the game from %s: %s\n", LibraryPath, dlerror());
+		return(1);
+	}
+
+	//The recording is read in place, so it stays mapped for the whole replay
+	input_stream_reader Reader = {};
+	platform_file_mapping Recording = {};
+	uint32_t FrameCount = SyntheticFrameCount;
+	if (RecordingPath)
+	{
+		Recording = ReplayMapReadOnlyFile(RecordingPath);
+		if (!OpenInputStream(&Reader, Recording.Memory, Recording.Size))
+		{
+			fprintf(stderr, "babl_replay: %s is not an input recording this build can read\n", RecordingPath);
+			return(1);
+		}
+		//Cut short while recording - no count in the header, so count the frames first
+		FrameCount = Reader.Header->FrameCount;
+		game_input_buffer Scratch;
+		while (!FrameCount && DecodeNextInputFrame(&Reader, &Scratch))
+		{
+		}
+		FrameCount = FrameCount ? FrameCount : Reader.FrameIndex;
+	}
+	if (!FrameCount)
+	{
+		fprintf(stderr, "babl_replay: nothing to replay\n");
+		return(1);
+	}
+
+	game_memory GameMemory = {};
+	GameMemory.PermanentStorageSize = Megabytes(64);
+	GameMemory.TransientStorageSize = Gigabytes(1);
+	uint64_t TotalSize = GameMemory.PermanentStorageSize + GameMemory.TransientStorageSize;
+	bool32 FixedBase = ReservePlatformMemory(&GlobalGameMemory, (void*)(uintptr_t)REPLAY_GAME_MEMORY_BASE, TotalSize, Megabytes(512));
+	if (!FixedBase && !ReservePlatformMemory(&GlobalGameMemory, 0, TotalSize, Megabytes(512)))
+	{
+		fprintf(stderr, "babl_replay: could not reserve game memory\n");
+		return(1);
+	}
+	if (!FixedBase)
+	{
+		fprintf(stderr, "babl_replay: game memory is not at the usual address, state checksums will not match other machines\n");
+	}
+
+	static platform_work_queue RenderQueue;
+	static platform_work_queue LowPriorityQueue;
+	GameMemory.PermanentStorage = GlobalGameMemory.Base;
+	GameMemory.TransientStorage = GlobalGameMemory.Base + GameMemory.PermanentStorageSize;
+	GameMemory.RenderQueue = &RenderQueue;
+	GameMemory.LowPriorityQueue = &LowPriorityQueue;
+	GameMemory.PlatformAddEntry = ReplayAddEntry;
+	GameMemory.PlatformCompleteAllWork = ReplayCompleteAllWork;
+	GameMemory.PlatformCommitMemory = ReplayCommitMemory;
+	GameMemory.PlatformMapReadOnlyFile = ReplayMapReadOnlyFile;
+	GameMemory.PlatformUnmapFile = ReplayUnmapFile;
+	GameMemory.PlatformGetFileStamp = ReplayGetFileStamp;
+	GameMemory.PlatformOpenFile = ReplayOpenFile;
+	GameMemory.PlatformReadDataFromFile = ReplayReadDataFromFile;
+	GameMemory.PlatformCloseFile = ReplayCloseFile;
+	GameMemory.DEBUGPlatformReadEntireFile = ReplayReadEntireFile;
+	GameMemory.DEBUGPlatformFreeFileMemory = ReplayFreeFileMemory;
+	GameMemory.DEBUGPlatformWriteEntireFile = ReplayWriteEntireFile;
+
+	game_offscreen_buffer Buffer = {};
+	Buffer.Width = Width;
+	Buffer.Height = Height;
+	Buffer.BytesPerPixel = 4;
+	Buffer.Pitch = Width*Buffer.BytesPerPixel;
+	Buffer.Memory = calloc((uint64_t)Buffer.Pitch*Height, 1);
+
+	game_sound_buffer SoundBuffer = {};
+	SoundBuffer.SamplesPerSecond = REPLAY_SAMPLES_PER_SECOND;
+	SoundBuffer.SampleCount = REPLAY_SAMPLES_PER_SECOND / REPLAY_GAME_UPDATE_HZ;
+	SoundBuffer.Samples = (int16_t*)calloc(SoundBuffer.SampleCount*2, sizeof(int16_t));
+
+	//Mappings after the recording's are the game's
+	uint32_t FirstGameMapping = GlobalFileMappingCount;
+	uint64_t* FrameTimes = (uint64_t*)malloc((uint64_t)FrameCount*RunCount*sizeof(uint64_t));
+	replay_result FirstResult = {};
+	bool32 Deterministic = true;
+	uint64_t StartTime = GetNanoseconds();
+	for (int RunIndex = 0; RunIndex < RunCount; RunIndex++)
+	{
+		//Start every run from nothing: no committed memory, no mappings, an uninitialized game
+		for (uint32_t ChunkIndex = 0; ChunkIndex < GlobalGameMemory.ChunkCount; ChunkIndex++)
+		{
+			DecommitPlatformChunk(&GlobalGameMemory, ChunkIndex);
+		}
+		GameMemory.IsInitialized = false;
+		GlobalFileMappingCount = FirstGameMapping;
+		memset(Buffer.Memory, 0, (uint64_t)Buffer.Pitch*Height);
+		if (RecordingPath)
+		{
+			SeekInputStream(&Reader, 0);
+		}
+
+		replay_result Result = {REPLAY_HASH_SEED, REPLAY_HASH_SEED, REPLAY_HASH_SEED};
+		game_input_buffer Input = {};
+		for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+		{
+			if (RecordingPath)
+			{
+				DecodeNextInputFrame(&Reader, &Input);
+			}
+			else
+			{
+				MakeSyntheticInput(FrameIndex, &Input);
+			}
+
+			//The buffer carries last frame's dirty set - clear it so only the first frame asks for a full repaint
+			Buffer.Dirty = {};
+			Buffer.Dirty.FullFrame = (FrameIndex == 0);
+
+			uint64_t FrameStart = GetNanoseconds();
+			Game.UpdateAndRender(&GameMemory, &Buffer, &Input);
+			Game.GetSoundSamples(&GameMemory, &SoundBuffer);
+			ReplayCompleteAllWork(&LowPriorityQueue);
+			FrameTimes[(uint64_t)RunIndex*FrameCount + FrameIndex] = GetNanoseconds() - FrameStart;
+
+			Result.SoundHash = HashBytes(Result.SoundHash, SoundBuffer.Samples, SoundBuffer.SampleCount*2*sizeof(int16_t));
+		}
+		Result.StateHash = HashPermanentStorage(&GlobalGameMemory, GameMemory.PermanentStorageSize);
+		Result.PixelHash = HashBytes(Result.PixelHash, Buffer.Memory, (uint64_t)Buffer.Pitch*Height);
+
+		//Mapped files are the game's to unmap - whatever it kept goes away with the run
+		for (uint32_t MappingIndex = FirstGameMapping; MappingIndex < GlobalFileMappingCount; MappingIndex++)
+		{
+			munmap((void*)(uintptr_t)(REPLAY_FILE_MAPPING_BASE + MappingIndex*REPLAY_FILE_MAPPING_STRIDE), REPLAY_FILE_MAPPING_STRIDE);
+		}
+
+		if (RunIndex == 0)
+		{
+			FirstResult = Result;
+		}
+		else if (memcmp(&Result, &FirstResult, sizeof(Result)) != 0)
+		{
+			Deterministic = false;
+			fprintf(stderr, "babl_replay: run %d diverged from run 1\n", RunIndex + 1);
+		}
+	}
+	uint64_t TotalTime = GetNanoseconds() - StartTime;
+
+	uint32_t TimedCount = FrameCount*RunCount;
+	uint64_t FrameTimeSum = 0;
+	for (uint32_t Index = 0; Index < TimedCount; Index++)
+	{
+		FrameTimeSum += FrameTimes[Index];
+	}
+	qsort(FrameTimes, TimedCount, sizeof(uint64_t), CompareUInt64);
+
+	printf("replay: %u frames x %d runs at %dx%d, %s\n", FrameCount, RunCount, Width, Height, RecordingPath ? RecordingPath : "synthetic input");
+	printf("  frame ms      mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+		(double)FrameTimeSum / TimedCount / 1000000.0, GetPercentile(FrameTimes, TimedCount, 50),
+		GetPercentile(FrameTimes, TimedCount, 90), GetPercentile(FrameTimes, TimedCount, 99),
+		GetPercentile(FrameTimes, TimedCount, 100));
+	printf("  total         %.3f s (%.0f frames/s)\n", (double)TotalTime / 1e9, (double)TimedCount*1e9 / (double)TotalTime);
+	printf("  committed     %llu KB\n", (unsigned long long)(GlobalGameMemory.CommittedSize / 1024));
+	printf("  state   %016llx\n", (unsigned long long)FirstResult.StateHash);
+	printf("  pixels  %016llx\n", (unsigned long long)FirstResult.PixelHash);
+	printf("  sound   %016llx\n", (unsigned long long)FirstResult.SoundHash);
+	if (RunCount > 1)
+	{
+		printf("  runs          %s\n", Deterministic ? "identical" : "DIVERGED");
+	}
+
+	return(Deterministic ? 0 : 2);
+}
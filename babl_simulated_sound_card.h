@@ -0,0 +1,160 @@
+#if !defined(BABL_SIMULATED_SOUND_CARD_H)
+#define BABL_SIMULATED_SOUND_CARD_H
+
+/*
+	A stand-in for a DirectSound-style looping buffer, for driving audio_sync where there is no device (Linux, the
+	bench). It plays at exactly SamplesPerSecond on whatever clock the caller passes in. It reports its cursors the way
+	drivers do: rounded down to GranuleBytes, with the write cursor WriteLeadBytes past the play cursor. Each report
+	can also lag by up to CursorJitterBytes more, for drivers that are slow to update the cursors.
+
+	Like DirectSound it has already taken everything up to the write cursor, so a byte is on time only if it was
+	written before the real write cursor passed it. Unlike the program feeding it, the card knows what was written
+	where, so it counts exactly how much it took that had not been written in time (stale) and how much was written
+	over before it was played (overwritten). Positions are unwrapped bytes, times nanoseconds.
+*/
+struct simulated_sound_card
+{
+	uint32_t BufferSize;
+	uint32_t BytesPerSample;
+	uint32_t BytesPerSecond;
+	uint32_t GranuleBytes;
+	uint32_t WriteLeadBytes;
+	uint32_t CursorJitterBytes;
+	uint32_t RandomState;
+	uint64_t StartTime;
+
+	//0 when only the counts matter
+	uint8_t* Buffer;
+
+	//How far it has played, the furthest it has reported playing, and the end of what was written ahead of that.
+	//It has taken up to PlayedPosition + WriteLeadBytes
+	uint64_t PlayedPosition;
+	uint64_t ReportedPosition;
+	uint64_t WrittenPosition;
+
+	//Nothing is stale until the first write - the card just plays the silence it started with.
+	//An underrun is one unbroken stretch of stale playback
+	bool32 IsWritten;
+	uint64_t StaleBytes;
+	uint32_t UnderrunCount;
+	bool32 IsStarved;
+	uint64_t OverwrittenBytes;
+};
+
+inline void
+InitializeSimulatedSoundCard(simulated_sound_card* Card, void* Buffer, uint32_t BufferSize, uint32_t BytesPerSample,
+	uint32_t SamplesPerSecond, uint32_t GranuleBytes, uint32_t WriteLeadBytes, uint32_t CursorJitterBytes, uint64_t StartTime)
+{
+	*Card = {};
+	Card->BufferSize = BufferSize;
+	Card->BytesPerSample = BytesPerSample;
+	Card->BytesPerSecond = BytesPerSample*SamplesPerSecond;
+	Card->GranuleBytes = (GranuleBytes < BytesPerSample) ? BytesPerSample : GranuleBytes / BytesPerSample*BytesPerSample;
+	Card->WriteLeadBytes = WriteLeadBytes / BytesPerSample*BytesPerSample;
+	Card->CursorJitterBytes = CursorJitterBytes;
+	Card->RandomState = 0x5EED1234;
+	Card->StartTime = StartTime;
+	Card->Buffer = (uint8_t*)Buffer;
+	if (Buffer)
+	{
+		memset(Buffer, 0, BufferSize);
+	}
+}
+
+internal void
+AdvanceSimulatedSoundCard(simulated_sound_card* Card, uint64_t Time)
+{
+	uint64_t Elapsed = (Time > Card->StartTime) ? Time - Card->StartTime : 0;
+	uint64_t Position = Elapsed*Card->BytesPerSecond / 1000000000ULL / Card->BytesPerSample*Card->BytesPerSample;
+	if (Position <= Card->PlayedPosition)
+	{
+		return;
+	}
+
+	uint64_t Taken = Position + Card->WriteLeadBytes;
+	if (Card->IsWritten && (Taken > Card->WrittenPosition))
+	{
+		uint64_t LastTaken = Card->PlayedPosition + Card->WriteLeadBytes;
+		uint64_t StaleStart = (LastTaken > Card->WrittenPosition) ? LastTaken : Card->WrittenPosition;
+		Card->StaleBytes += Taken - StaleStart;
+		if (!Card->IsStarved)
+		{
+			++Card->UnderrunCount;
+			Card->IsStarved = true;
+		}
+	}
+	else
+	{
+		Card->IsStarved = false;
+	}
+	Card->PlayedPosition = Position;
+}
+
+internal void
+GetSimulatedSoundCardCursors(simulated_sound_card* Card, uint64_t Time, uint32_t* PlayCursor, uint32_t* WriteCursor)
+{
+	AdvanceSimulatedSoundCard(Card, Time);
+
+	uint64_t Lag = 0;
+	if (Card->CursorJitterBytes)
+	{
+		Card->RandomState ^= Card->RandomState << 13;
+		Card->RandomState ^= Card->RandomState >> 17;
+		Card->RandomState ^= Card->RandomState << 5;
+		Lag = Card->RandomState % Card->CursorJitterBytes;
+	}
+
+	//A late report can never go back past one that was already made
+	uint64_t Reported = (Card->PlayedPosition > Lag) ? Card->PlayedPosition - Lag : 0;
+	Reported -= Reported % Card->GranuleBytes;
+	Card->ReportedPosition = (Reported > Card->ReportedPosition) ? Reported : Card->ReportedPosition;
+
+	*PlayCursor = (uint32_t)(Card->ReportedPosition % Card->BufferSize);
+	*WriteCursor = (uint32_t)((Card->ReportedPosition + Card->WriteLeadBytes) % Card->BufferSize);
+}
+
+//The write lands wherever ByteToLock is nearest the written end, so a write that skips ahead leaves a gap that will
+//play stale, and one that starts behind rewrites what is there
+internal void
+WriteSimulatedSoundCard(simulated_sound_card* Card, uint64_t Time, uint32_t ByteToLock, void* Source, uint32_t ByteCount)
+{
+	AdvanceSimulatedSoundCard(Card, Time);
+	uint32_t BufferSize = Card->BufferSize;
+	uint64_t Taken = Card->PlayedPosition + Card->WriteLeadBytes;
+	if (!Card->IsWritten)
+	{
+		Card->IsWritten = true;
+		Card->WrittenPosition = Taken;
+	}
+
+	uint32_t Ahead = (ByteToLock + BufferSize - (uint32_t)(Card->WrittenPosition % BufferSize)) % BufferSize;
+	uint64_t Start = (Ahead <= BufferSize / 2) ? Card->WrittenPosition + Ahead : Card->WrittenPosition - (BufferSize - Ahead);
+	uint64_t End = Start + ByteCount;
+
+	//Skipping ahead leaves bytes nothing will ever be written to
+	uint64_t GapStart = (Card->WrittenPosition > Taken) ? Card->WrittenPosition : Taken;
+	if (Start > GapStart)
+	{
+		Card->StaleBytes += Start - GapStart;
+		if (!Card->IsStarved)
+		{
+			++Card->UnderrunCount;
+		}
+	}
+	uint64_t Unplayed = Card->PlayedPosition + BufferSize;
+	if (End > Unplayed)
+	{
+		Card->OverwrittenBytes += End - ((Start > Unplayed) ? Start : Unplayed);
+	}
+	Card->WrittenPosition = (End > Card->WrittenPosition) ? End : Card->WrittenPosition;
+
+	if (Card->Buffer && Source)
+	{
+		uint32_t FirstBytes = BufferSize - ByteToLock;
+		FirstBytes = (FirstBytes < ByteCount) ? FirstBytes : ByteCount;
+		memcpy(Card->Buffer + ByteToLock, Source, FirstBytes);
+		memcpy(Card->Buffer, (uint8_t*)Source + FirstBytes, ByteCount - FirstBytes);
+	}
+}
+
+#endif
@@ -0,0 +1,104 @@
+#if !defined(BABL_SPSC_RING_H)
+#define BABL_SPSC_RING_H
+
+/*
+	A fixed ring of fixed-size elements between exactly one producer thread and one consumer thread, with no locks.
+	WriteIndex only ever moves on the producer and ReadIndex only on the consumer. Both count up forever and wrap at
+	2^32, so WriteIndex - ReadIndex is the occupancy even across the wrap, and with Capacity a power of two the slot
+	is just the index masked.
+	Each side fills or drains its slot first and publishes the moved index after, so neither ever sees a slot the
+	other is still working on. The two indices sit on cache lines of their own so the cores don't fight over one.
+	Needs babl_intrinsics.h for the barriers.
+*/
+struct spsc_ring
+{
+	uint32_t ElementSize;
+	uint32_t Capacity;
+	uint8_t* Elements;
+
+	uint8_t Pad0[64];
+	uint32_t volatile WriteIndex;
+	uint8_t Pad1[64];
+	uint32_t volatile ReadIndex;
+	uint8_t Pad2[64];
+};
+
+//Elements has to hold Capacity*ElementSize bytes, and Capacity has to be a power of two
+inline void
+InitializeSPSCRing(spsc_ring* Ring, void* Elements, uint32_t ElementSize, uint32_t Capacity)
+{
+	Assert((Capacity > 0) && ((Capacity & (Capacity - 1)) == 0));
+	*Ring = {};
+	Ring->ElementSize = ElementSize;
+	Ring->Capacity = Capacity;
+	Ring->Elements = (uint8_t*)Elements;
+}
+
+//Exact on either side's own thread; from anywhere else it is a snapshot that may already be stale
+inline uint32_t
+GetRingOccupancy(spsc_ring* Ring)
+{
+	uint32_t Result = Ring->WriteIndex - Ring->ReadIndex;
+	return(Result);
+}
+
+inline void*
+GetRingSlot(spsc_ring* Ring, uint32_t Index)
+{
+	void* Result = Ring->Elements + (uint64_t)(Index & (Ring->Capacity - 1))*Ring->ElementSize;
+	return(Result);
+}
+
+//
+// Producer
+//
+
+//The next slot to fill, or 0 when the ring is full; nothing is published until EndRingWrite
+inline void*
+BeginRingWrite(spsc_ring* Ring)
+{
+	void* Result = 0;
+	uint32_t WriteIndex = Ring->WriteIndex;
+	if ((WriteIndex - Ring->ReadIndex) < Ring->Capacity)
+	{
+		Result = GetRingSlot(Ring, WriteIndex);
+	}
+	return(Result);
+}
+
+inline void
+EndRingWrite(spsc_ring* Ring)
+{
+	//The element has to be visible before the index that publishes it
+	CompletePreviousWritesBeforeFutureWrites;
+	Ring->WriteIndex = Ring->WriteIndex + 1;
+}
+
+//
+// Consumer
+//
+
+//The oldest filled slot, or 0 when the ring is empty; it stays the consumer's until EndRingRead
+inline void*
+BeginRingRead(spsc_ring* Ring)
+{
+	void* Result = 0;
+	uint32_t ReadIndex = Ring->ReadIndex;
+	if (Ring->WriteIndex != ReadIndex)
+	{
+		//No reading the element before the index that says it is there
+		CompletePreviousReadsBeforeFutureReads;
+		Result = GetRingSlot(Ring, ReadIndex);
+	}
+	return(Result);
+}
+
+inline void
+EndRingRead(spsc_ring* Ring)
+{
+	//Done reading the element before the producer is told it can have the slot back
+	CompletePreviousReadsBeforeFutureWrites;
+	Ring->ReadIndex = Ring->ReadIndex + 1;
+}
+
+#endif
@@ -0,0 +1,422 @@
+#if !defined(BABL_STATE_RING_H)
+#define BABL_STATE_RING_H
+
+/*
+	Keyframes of game memory taken every KeyframeInterval frames while recording, so playback can jump to
+	any frame: restore the closest keyframe at or before it, then replay inputs forward from there.
+
+	Keyframes share pages. Each one is a list of page slots, one per committed page, in a pool sized by the
+	memory budget; a page that was not written since the keyframe before reuses that keyframe's slot, so
+	a keyframe costs roughly what the game wrote in the last interval. Slots are refcounted.
+	When the pool or the lists run out the oldest keyframes go first - a ring.
+
+	LiveSlots says which slot each live page currently matches (apart from pages in StalePages), which
+	makes both directions incremental: capturing copies only pages written since, restoring copies only
+	pages that differ from the keyframe.
+	Same rules as snapshots: nothing else may write game memory while capturing or restoring.
+*/
+#define STATE_RING_NO_SLOT 0xFFFFFFFF
+#define STATE_RING_MAX_KEYFRAMES 4096
+
+struct state_ring_keyframe
+{
+	uint32_t FrameIndex;
+	uint32_t PageCount;
+
+	//Into Lists: the committed-chunk bitmap (as pairs of words), then a slot per committed page in page order
+	uint64_t ListOffset;
+	uint64_t ListSize;
+};
+
+struct state_ring_stats
+{
+	uint32_t KeyframeCount;
+	uint32_t OldestFrame;
+	uint32_t NewestFrame;
+	uint32_t SlotsUsed;
+	uint32_t SlotCount;
+	uint32_t DroppedKeyframes;
+};
+
+struct state_ring
+{
+	platform_memory_block* Block;
+	uint64_t* StalePages;
+	uint32_t KeyframeInterval;
+
+	uint8_t* Pool;
+	uint32_t SlotCount;
+	uint32_t* RefCounts;
+	uint32_t* FreeSlots;
+	uint32_t FreeCount;
+
+	uint32_t* LiveSlots;
+
+	//Keyframe lists come and go in order, so they share one circular buffer
+	uint32_t* Lists;
+	uint64_t ListCapacity;
+	uint64_t ListEnd;
+
+	uint32_t FirstKeyframe;
+	uint32_t KeyframeCount;
+	state_ring_keyframe Keyframes[STATE_RING_MAX_KEYFRAMES];
+
+	//Keyframes that could not be taken at all, even with the ring emptied
+	uint32_t DroppedKeyframes;
+};
+
+inline uint32_t
+GetChunkListSize(platform_memory_block* Block)
+{
+	return(((Block->ChunkCount + 63) / 64)*2);
+}
+
+//A quarter of the budget goes to keyframe lists (a word per committed page each), the rest to pages
+//(plus a refcount and a free-list entry each)
+internal bool32
+InitializeStateRing(state_ring* Ring, platform_memory_block* Block, uint64_t Budget, uint32_t KeyframeInterval)
+{
+	*Ring = {};
+	uint64_t ListBytes = Budget / 4;
+	uint64_t SlotCount = (Budget - ListBytes) / (Block->PageSize + 2*sizeof(uint32_t));
+	SlotCount = (SlotCount < STATE_RING_NO_SLOT) ? SlotCount : STATE_RING_NO_SLOT - 1;
+
+	Ring->Block = Block;
+	Ring->KeyframeInterval = KeyframeInterval ? KeyframeInterval : 1;
+	Ring->SlotCount = (uint32_t)SlotCount;
+	Ring->ListCapacity = ListBytes / sizeof(uint32_t);
+
+	Ring->Pool = (uint8_t*)AllocatePlatformPages(SlotCount*Block->PageSize);
+	Ring->RefCounts = (uint32_t*)AllocatePlatformPages(SlotCount*sizeof(uint32_t));
+	Ring->FreeSlots = (uint32_t*)AllocatePlatformPages(SlotCount*sizeof(uint32_t));
+	Ring->LiveSlots = (uint32_t*)AllocatePlatformPages((uint64_t)Block->PageCount*sizeof(uint32_t));
+	Ring->Lists = (uint32_t*)AllocatePlatformPages(Ring->ListCapacity*sizeof(uint32_t));
+	if (!Ring->Pool || !Ring->RefCounts || !Ring->FreeSlots || !Ring->LiveSlots || !Ring->Lists ||
+		(Ring->ListCapacity < GetChunkListSize(Block)))
+	{
+		return(false);
+	}
+	Ring->StalePages = AddStalePageSet(Block);
+
+	//Pop order is lowest slot first, which keeps the pool's touched pages compact
+	for (uint32_t SlotIndex = 0; SlotIndex < Ring->SlotCount; SlotIndex++)
+	{
+		Ring->FreeSlots[SlotIndex] = Ring->SlotCount - 1 - SlotIndex;
+	}
+	Ring->FreeCount = Ring->SlotCount;
+	memset(Ring->LiveSlots, 0xFF, (uint64_t)Block->PageCount*sizeof(uint32_t));
+	return(Ring->StalePages != 0);
+}
+
+inline uint8_t*
+GetSlotMemory(state_ring* Ring, uint32_t Slot)
+{
+	return(Ring->Pool + (uint64_t)Slot*Ring->Block->PageSize);
+}
+
+inline void
+RetainSlot(state_ring* Ring, uint32_t Slot)
+{
+	if (Slot != STATE_RING_NO_SLOT)
+	{
+		++Ring->RefCounts[Slot];
+	}
+}
+
+inline void
+ReleaseSlot(state_ring* Ring, uint32_t Slot)
+{
+	if (Slot != STATE_RING_NO_SLOT)
+	{
+		Assert(Ring->RefCounts[Slot] > 0);
+		if (--Ring->RefCounts[Slot] == 0)
+		{
+			Ring->FreeSlots[Ring->FreeCount++] = Slot;
+		}
+	}
+}
+
+inline state_ring_keyframe*
+GetKeyframe(state_ring* Ring, uint32_t Index)
+{
+	return(&Ring->Keyframes[(Ring->FirstKeyframe + Index) % STATE_RING_MAX_KEYFRAMES]);
+}
+
+internal void
+DropOldestKeyframe(state_ring* Ring)
+{
+	Assert(Ring->KeyframeCount > 0);
+	state_ring_keyframe* Keyframe = GetKeyframe(Ring, 0);
+	uint32_t* Slots = Ring->Lists + Keyframe->ListOffset + GetChunkListSize(Ring->Block);
+	for (uint32_t PageIndex = 0; PageIndex < Keyframe->PageCount; PageIndex++)
+	{
+		ReleaseSlot(Ring, Slots[PageIndex]);
+	}
+	Ring->FirstKeyframe = (Ring->FirstKeyframe + 1) % STATE_RING_MAX_KEYFRAMES;
+	--Ring->KeyframeCount;
+}
+
+//Drops every keyframe. The live page bookkeeping stays, so the next capture is still incremental
+internal void
+ResetStateRing(state_ring* Ring)
+{
+	while (Ring->KeyframeCount)
+	{
+		DropOldestKeyframe(Ring);
+	}
+	Ring->ListEnd = 0;
+	Ring->DroppedKeyframes = 0;
+}
+
+//Where a list of Size words would go without overwriting a live keyframe, or false if it does not fit right now
+internal bool32
+FindListSpace(state_ring* Ring, uint64_t Size, uint64_t* Offset)
+{
+	if (Ring->KeyframeCount == 0)
+	{
+		*Offset = 0;
+		return(Size <= Ring->ListCapacity);
+	}
+
+	uint64_t OldestStart = GetKeyframe(Ring, 0)->ListOffset;
+	if (Ring->ListEnd > OldestStart)
+	{
+		//Not wrapped: free space after the newest, and before the oldest
+		if (Ring->ListEnd + Size <= Ring->ListCapacity)
+		{
+			*Offset = Ring->ListEnd;
+			return(true);
+		}
+		*Offset = 0;
+		return(Size <= OldestStart);
+	}
+
+	*Offset = Ring->ListEnd;
+	return(Ring->ListEnd + Size <= OldestStart);
+}
+
+//Index of the newest keyframe at or before FrameIndex, or -1 if the ring has nothing that early
+internal int32_t
+FindKeyframe(state_ring* Ring, uint32_t FrameIndex)
+{
+	int32_t Low = 0;
+	int32_t High = (int32_t)Ring->KeyframeCount;
+	while (Low < High)
+	{
+		int32_t Middle = (Low + High) / 2;
+		if (GetKeyframe(Ring, Middle)->FrameIndex <= FrameIndex)
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	}
+	return(Low - 1);
+}
+
+//Stale pages whose old slot only LiveSlots still holds - each frees its slot just before it needs a new one
+internal uint32_t
+CountReclaimableSlots(state_ring* Ring)
+{
+	uint32_t Result = 0;
+	for (uint32_t PageIndex = 0; PageIndex < Ring->Block->PageCount; PageIndex++)
+	{
+		uint32_t Slot = Ring->LiveSlots[PageIndex];
+		if ((Slot != STATE_RING_NO_SLOT) && (Ring->RefCounts[Slot] == 1) && IsPageSet(Ring->StalePages, PageIndex))
+		{
+			Result += IsChunkCommitted(Ring->Block->CommittedChunks, PageIndex / Ring->Block->PagesPerChunk) ? 1 : 0;
+		}
+	}
+	return(Result);
+}
+
+/*
+	Keyframes the block as it is now, as frame FrameIndex (frames must only go up between resets).
+	Makes room by dropping the oldest keyframes, and gives up if even an empty ring could not hold the
+	pages that need copying.
+*/
+internal bool32
+CaptureStateKeyframe(state_ring* Ring, uint32_t FrameIndex, platform_snapshot_stats* Stats)
+{
+	platform_memory_block* Block = Ring->Block;
+	*Stats = {};
+	CollectDirtyPages(Block);
+	if (Ring->KeyframeCount)
+	{
+		Assert(GetKeyframe(Ring, Ring->KeyframeCount - 1)->FrameIndex < FrameIndex);
+	}
+
+	uint32_t PageCount = 0;
+	uint32_t NewSlotCount = 0;
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Block->ChunkCount; ChunkIndex++)
+	{
+		if (IsChunkCommitted(Block->CommittedChunks, ChunkIndex))
+		{
+			uint32_t FirstPage = ChunkIndex*Block->PagesPerChunk;
+			for (uint32_t PageIndex = FirstPage; PageIndex < FirstPage + Block->PagesPerChunk; PageIndex++)
+			{
+				++PageCount;
+				if (IsPageSet(Ring->StalePages, PageIndex) || (Ring->LiveSlots[PageIndex] == STATE_RING_NO_SLOT))
+				{
+					++NewSlotCount;
+				}
+			}
+		}
+	}
+
+	//Lists stay an even number of words long so every chunk bitmap is 8-byte aligned
+	uint64_t ListSize = (GetChunkListSize(Block) + PageCount + 1) & ~(uint64_t)1;
+	uint64_t ListOffset = 0;
+	while ((Ring->KeyframeCount == STATE_RING_MAX_KEYFRAMES) ||
+		((Ring->FreeCount < NewSlotCount) && (Ring->FreeCount + CountReclaimableSlots(Ring) < NewSlotCount)) ||
+		!FindListSpace(Ring, ListSize, &ListOffset))
+	{
+		if (Ring->KeyframeCount == 0)
+		{
+			++Ring->DroppedKeyframes;
+			return(false);
+		}
+		DropOldestKeyframe(Ring);
+	}
+
+	uint32_t* List = Ring->Lists + ListOffset;
+	memcpy(List, Block->CommittedChunks, GetChunkListSize(Block)*sizeof(uint32_t));
+	uint32_t* Slots = List + GetChunkListSize(Block);
+
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Block->ChunkCount; ChunkIndex++)
+	{
+		uint32_t FirstPage = ChunkIndex*Block->PagesPerChunk;
+		bool32 IsCommitted = IsChunkCommitted(Block->CommittedChunks, ChunkIndex);
+		for (uint32_t PageIndex = FirstPage; PageIndex < FirstPage + Block->PagesPerChunk; PageIndex++)
+		{
+			uint32_t* LiveSlot = &Ring->LiveSlots[PageIndex];
+			if (!IsCommitted)
+			{
+				ReleaseSlot(Ring, *LiveSlot);
+				*LiveSlot = STATE_RING_NO_SLOT;
+				continue;
+			}
+
+			if (IsPageSet(Ring->StalePages, PageIndex) || (*LiveSlot == STATE_RING_NO_SLOT))
+			{
+				ReleaseSlot(Ring, *LiveSlot);
+				*LiveSlot = Ring->FreeSlots[--Ring->FreeCount];
+				Ring->RefCounts[*LiveSlot] = 1;
+				memcpy(GetSlotMemory(Ring, *LiveSlot), Block->Base + (uint64_t)PageIndex*Block->PageSize, Block->PageSize);
+				++Stats->PagesCopied;
+				Stats->BytesCopied += Block->PageSize;
+			}
+			RetainSlot(Ring, *LiveSlot);
+			*Slots++ = *LiveSlot;
+		}
+	}
+	memset(Ring->StalePages, 0, ((Block->PageCount + 63) / 64)*sizeof(uint64_t));
+
+	state_ring_keyframe* Keyframe = GetKeyframe(Ring, Ring->KeyframeCount++);
+	Keyframe->FrameIndex = FrameIndex;
+	Keyframe->PageCount = PageCount;
+	Keyframe->ListOffset = ListOffset;
+	Keyframe->ListSize = ListSize;
+	Ring->ListEnd = ListOffset + ListSize;
+	return(true);
+}
+
+//Puts the block back the way it was at the keyframe, committing and decommitting chunks to match
+internal platform_snapshot_stats
+RestoreStateKeyframe(state_ring* Ring, uint32_t KeyframeIndex)
+{
+	platform_memory_block* Block = Ring->Block;
+	platform_snapshot_stats Stats = {};
+	CollectDirtyPages(Block);
+
+	state_ring_keyframe* Keyframe = GetKeyframe(Ring, KeyframeIndex);
+	uint64_t* KeyframeChunks = (uint64_t*)(Ring->Lists + Keyframe->ListOffset);
+	uint32_t* Slots = Ring->Lists + Keyframe->ListOffset + GetChunkListSize(Block);
+
+	for (uint32_t ChunkIndex = 0; ChunkIndex < Block->ChunkCount; ChunkIndex++)
+	{
+		bool32 WasCommitted = IsChunkCommitted(KeyframeChunks, ChunkIndex);
+		bool32 IsCommitted = IsChunkCommitted(Block->CommittedChunks, ChunkIndex);
+		uint32_t FirstPage = ChunkIndex*Block->PagesPerChunk;
+		uint32_t OnePastLastPage = FirstPage + Block->PagesPerChunk;
+		uint8_t* Chunk = GetChunkMemory(Block, ChunkIndex);
+
+		if (WasCommitted)
+		{
+			//It fit under the ceiling when it was captured, so the ceiling does not apply here
+			bool32 CommittedNow = !IsCommitted && CommitChunk(Block, ChunkIndex);
+			Stats.ChunksCommitted += CommittedNow ? 1 : 0;
+
+			bool32 CopiedAny = false;
+			for (uint32_t PageIndex = FirstPage; PageIndex < OnePastLastPage; PageIndex++)
+			{
+				uint32_t Slot = *Slots++;
+				uint32_t* LiveSlot = &Ring->LiveSlots[PageIndex];
+				if ((IsCommitted || CommittedNow) &&
+					(CommittedNow || IsPageSet(Ring->StalePages, PageIndex) || (*LiveSlot != Slot)))
+				{
+#if !defined(_WIN32)
+					if (!CopiedAny && !CommittedNow)
+					{
+						mprotect(Chunk, PLATFORM_MEMORY_CHUNK_SIZE, PROT_READ | PROT_WRITE);
+					}
+#endif
+					memcpy(Block->Base + (uint64_t)PageIndex*Block->PageSize, GetSlotMemory(Ring, Slot), Block->PageSize);
+					++Stats.PagesCopied;
+					Stats.BytesCopied += Block->PageSize;
+					CopiedAny = true;
+					MarkPageStaleEverywhere(Block, PageIndex);
+
+					RetainSlot(Ring, Slot);
+					ReleaseSlot(Ring, *LiveSlot);
+					*LiveSlot = Slot;
+				}
+			}
+
+			//The copy itself is not a game write - watch from here on
+			if (CopiedAny)
+			{
+#if defined(_WIN32)
+				ResetWriteWatch(Chunk, PLATFORM_MEMORY_CHUNK_SIZE);
+#else
+				mprotect(Chunk, PLATFORM_MEMORY_CHUNK_SIZE, PROT_READ);
+#endif
+			}
+		}
+		else if (IsCommitted)
+		{
+			DecommitPlatformChunk(Block, ChunkIndex);
+			++Stats.ChunksDecommitted;
+			for (uint32_t PageIndex = FirstPage; PageIndex < OnePastLastPage; PageIndex++)
+			{
+				ReleaseSlot(Ring, Ring->LiveSlots[PageIndex]);
+				Ring->LiveSlots[PageIndex] = STATE_RING_NO_SLOT;
+			}
+		}
+	}
+
+	//Hand the decommits out to everyone else - the live block now matches LiveSlots exactly
+	CollectDirtyPages(Block);
+	memset(Ring->StalePages, 0, ((Block->PageCount + 63) / 64)*sizeof(uint64_t));
+	return(Stats);
+}
+
+internal state_ring_stats
+GetStateRingStats(state_ring* Ring)
+{
+	state_ring_stats Result = {};
+	Result.KeyframeCount = Ring->KeyframeCount;
+	if (Ring->KeyframeCount)
+	{
+		Result.OldestFrame = GetKeyframe(Ring, 0)->FrameIndex;
+		Result.NewestFrame = GetKeyframe(Ring, Ring->KeyframeCount - 1)->FrameIndex;
+	}
+	Result.SlotsUsed = Ring->SlotCount - Ring->FreeCount;
+	Result.SlotCount = Ring->SlotCount;
+	Result.DroppedKeyframes = Ring->DroppedKeyframes;
+	return(Result);
+}
+
+#endif
@@ -0,0 +1,151 @@
+#if !defined(BABL_WAV_H)
+#define BABL_WAV_H
+
+/*
+	Just enough of WAV to stream one from disk: the header is found with a handful of small reads, so nothing ever
+	has to hold the whole file, and frames are decoded a chunk at a time into mono float.
+	Supported: 16-bit PCM and 32-bit float, mono or stereo (mixed down to mono - voices are panned by the mixer).
+	Offsets are 64-bit, but the RIFF sizes are 32-bit; a data chunk whose size runs past the end of the file (as
+	writers that never went back to fill it in leave it) is taken to run to the end of the file.
+*/
+enum wav_sample_type
+{
+	WAVSampleType_PCM16,
+	WAVSampleType_Float32,
+};
+
+struct wav_info
+{
+	bool32 IsValid;
+	wav_sample_type SampleType;
+	uint32_t ChannelCount;
+	uint32_t SamplesPerSecond;
+	uint32_t BytesPerFrame;
+
+	uint64_t DataOffset;
+	uint64_t FrameCount;
+};
+
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_IEEE_FLOAT 3
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+inline uint32_t
+GetWAVChunkID(char* Name)
+{
+	uint32_t Result = (uint32_t)Name[0] | ((uint32_t)Name[1] << 8) | ((uint32_t)Name[2] << 16) | ((uint32_t)Name[3] << 24);
+	return(Result);
+}
+
+//Walks the chunks from the start of the file until it has both the format and the data
+internal wav_info
+ReadWAVInfo(platform_read_data_from_file* ReadDataFromFile, platform_file_handle* File)
+{
+	wav_info Result = {};
+	uint32_t RIFFHeader[3];
+	if (!ReadDataFromFile(File, 0, sizeof(RIFFHeader), RIFFHeader) ||
+		(RIFFHeader[0] != GetWAVChunkID("RIFF")) || (RIFFHeader[2] != GetWAVChunkID("WAVE")))
+	{
+		return(Result);
+	}
+
+	bool32 HasFormat = false;
+	uint16_t FormatTag = 0;
+	uint16_t BitsPerSample = 0;
+	uint64_t Offset = sizeof(RIFFHeader);
+	while (Offset + 8 <= File->Size)
+	{
+		uint32_t ChunkHeader[2];
+		if (!ReadDataFromFile(File, Offset, sizeof(ChunkHeader), ChunkHeader))
+		{
+			break;
+		}
+		uint64_t ChunkOffset = Offset + sizeof(ChunkHeader);
+		uint64_t ChunkSize = ChunkHeader[1];
+
+		if ((ChunkHeader[0] == GetWAVChunkID("fmt ")) && (ChunkSize >= 16))
+		{
+			//Tag, channels, rate, bytes per second, block align, bits - then the extensible tail, whose first
+			//two bytes of sub-format GUID are the real tag
+			uint8_t Format[40] = {};
+			uint32_t FormatSize = (ChunkSize < sizeof(Format)) ? (uint32_t)ChunkSize : (uint32_t)sizeof(Format);
+			if (!ReadDataFromFile(File, ChunkOffset, FormatSize, Format))
+			{
+				break;
+			}
+			memcpy(&FormatTag, Format, 2);
+			uint16_t ChannelCount;
+			uint16_t BlockAlign;
+			memcpy(&ChannelCount, Format + 2, 2);
+			memcpy(&Result.SamplesPerSecond, Format + 4, 4);
+			memcpy(&BlockAlign, Format + 12, 2);
+			memcpy(&BitsPerSample, Format + 14, 2);
+			if ((FormatTag == WAV_FORMAT_EXTENSIBLE) && (FormatSize >= 26))
+			{
+				memcpy(&FormatTag, Format + 24, 2);
+			}
+			Result.ChannelCount = ChannelCount;
+			Result.BytesPerFrame = BlockAlign;
+			HasFormat = true;
+		}
+		else if ((ChunkHeader[0] == GetWAVChunkID("data")) && HasFormat)
+		{
+			uint64_t DataSize = ChunkSize;
+			if ((DataSize == 0xFFFFFFFF) || (ChunkOffset + DataSize > File->Size))
+			{
+				DataSize = File->Size - ChunkOffset;
+			}
+			Result.DataOffset = ChunkOffset;
+			Result.FrameCount = Result.BytesPerFrame ? DataSize / Result.BytesPerFrame : 0;
+			break;
+		}
+
+		//Chunks are padded to an even size
+		Offset = ChunkOffset + ChunkSize + (ChunkSize & 1);
+	}
+
+	if ((FormatTag == WAV_FORMAT_PCM) && (BitsPerSample == 16))
+	{
+		Result.SampleType = WAVSampleType_PCM16;
+		Result.IsValid = true;
+	}
+	else if ((FormatTag == WAV_FORMAT_IEEE_FLOAT) && (BitsPerSample == 32))
+	{
+		Result.SampleType = WAVSampleType_Float32;
+		Result.IsValid = true;
+	}
+	Result.IsValid = Result.IsValid && Result.DataOffset && Result.SamplesPerSecond &&
+		((Result.ChannelCount == 1) || (Result.ChannelCount == 2)) &&
+		(Result.BytesPerFrame == Result.ChannelCount*BitsPerSample / 8);
+	return(Result);
+}
+
+//FrameCount whole frames from Source, which does not have to be aligned
+internal void
+DecodeWAVFrames(wav_info* Info, void* Source, uint32_t FrameCount, float* Dest)
+{
+	uint8_t* At = (uint8_t*)Source;
+	if (Info->SampleType == WAVSampleType_PCM16)
+	{
+		float Scale = (Info->ChannelCount == 2) ? 0.5f / 32768.0f : 1.0f / 32768.0f;
+		for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+		{
+			int16_t Samples[2] = {};
+			memcpy(Samples, At, Info->BytesPerFrame);
+			Dest[FrameIndex] = (float)(Samples[0] + Samples[1])*Scale;
+			At += Info->BytesPerFrame;
+		}
+	}
+	else
+	{
+		for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; FrameIndex++)
+		{
+			float Samples[2] = {};
+			memcpy(Samples, At, Info->BytesPerFrame);
+			Dest[FrameIndex] = (Info->ChannelCount == 2) ? 0.5f*(Samples[0] + Samples[1]) : Samples[0];
+			At += Info->BytesPerFrame;
+		}
+	}
+}
+
+#endif
@@ -13,9 +13,15 @@ REM -EHa disables exception handling - which generates extra stack memory that m
 REM -Fm win32_BABL.map
 
 set CompilerFlags= -nologo -WX -W4 -wd4100 -wd4201 -Oi -EHa -DBABL_INTERNAL=1 -DBABL_SLOW=1 -DBABL_WIN32=1 /FC /Zi /GR /Fmwin32_babl.map
-set LinkerFlags= -opt:ref user32.lib Gdi32.lib Winmm.lib
+set LinkerFlags= -opt:ref user32.lib Gdi32.lib Winmm.lib Psapi.lib
 
 del *.pdb > NUL 2> NUL
+REM A running win32_babl waits for the lock to go before it reloads the DLL
+echo WAITING FOR PDB > lock.tmp
 cl  %CompilerFlags% ../babl.cpp -LD /link -incremental:no -opt:ref -PDB:babl_%random%.pdb /EXPORT:GameUpdateAndRender /EXPORT:GameGetSoundSamples
+del lock.tmp
 cl  %CompilerFlags% ../win32_babl.cpp /link %LinkerFlags%
+cl  %CompilerFlags% -D_CRT_SECURE_NO_WARNINGS ../babl_packer.cpp /link -incremental:no
+babl_packer.exe ../babl.bpak ../l_fern.png
+cl %CompilerFlags% -O2 -D_CRT_SECURE_NO_WARNINGS ../babl_bench.cpp /link -incremental:no
 popd
\ No newline at end of file
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Linux counterpart of build.bat for the pieces that run there: the game library and the tools around it
+set -e
+
+CompilerFlags="-g -O2 -Wall -Wno-unused-function -Wno-write-strings -Wno-sign-compare -Wno-missing-braces -DBABL_INTERNAL=1 -DBABL_SLOW=1"
+
+mkdir -p build
+cd build
+
+# A running linux_babl waits for the lock to go before it reloads the library
+echo "waiting for babl.so" > lock.tmp
+c++ $CompilerFlags -shared -fPIC ../babl.cpp -o babl.so
+rm -f lock.tmp
+c++ $CompilerFlags ../babl_replay.cpp -o babl_replay -ldl
+c++ $CompilerFlags ../linux_babl.cpp -o linux_babl -ldl -lpthread
+c++ $CompilerFlags ../babl_packer.cpp -o babl_packer
+./babl_packer ../babl.bpak ../l_fern.png
+c++ $CompilerFlags ../babl_bench.cpp -o babl_bench -lpthread
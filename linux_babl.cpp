@@ -0,0 +1,1377 @@
+/*
+	Linux platform layer - the same game_memory contract as win32_babl.cpp, for running the game under perf.
+	There is no window or audio device: frames are presented into an offscreen front buffer, and sound goes
+	nowhere or into a WAV file. Input comes from a recording (-play), otherwise the controllers sit idle.
+	The game library is reloaded whenever babl.so next to the executable changes: a watcher thread loads the new
+	build once it is finished, and the main loop swaps it in between frames.
+
+	Sound is mixed on a thread of its own, a block at a time, into a ring kept -latency ms full. A feeder thread
+	drains it into a simulated sound card every millisecond (up to -jitter ms late), using audio_sync to decide how
+	much to write. The card's cursors move in -granule ms steps, with the write cursor -lead ms past the play cursor.
+	-spike N:ms stalls every Nth frame, to show a long frame no longer reaches the audio.
+	Files the game streams are looked up by file name in -data when their (Windows) path does not open.
+	-trace writes every TIMED_BLOCK still in the debug rings out as a Chrome trace at exit.
+
+	Usage: linux_babl [-play recording.ir] [-wav out.wav] [-frames N] [-hz N] [-size WxH] [-dump frame.ppm]
+		[-latency ms] [-granule ms] [-lead ms] [-jitter ms] [-spike N:ms] [-data dir] [-trace trace.json]
+	Runs until -frames have gone by or it gets SIGINT/SIGTERM, then prints the frame-time jitter and audio reports.
+*/
+#include "babl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "babl_intrinsics.h"
+#include "babl_debug.h"
+#include "babl_debug_trace.h"
+#include "babl_platform_memory.h"
+#include "babl_input_stream.h"
+#include "babl_spsc_ring.h"
+#include "babl_audio_stream.h"
+#include "babl_audio_sync.h"
+#include "babl_frame_pacer.h"
+#include "babl_simulated_sound_card.h"
+#include "linux_babl.h"
+#include "babl_dirty_region.h"
+
+global_variable bool32 volatile Running;
+global_variable linux_offscreen_buffer GlobalBackbuffer;
+global_variable platform_memory_block GlobalGameMemory;
+global_variable char* GlobalDataDirectory = ".";
+
+DEBUG_PLATFORM_FREE_FILE_MEMORY(DEBUGPlatformFreeFileMemory)
+{
+	free(Memory);
+	return 0;
+}
+
+DEBUG_PLATFORM_READ_ENTIRE_FILE(DEBUGPlatformReadEntireFile)
+{
+	debug_read_file_result Result = {};
+	int File = open(Filename, O_RDONLY);
+	if (File >= 0)
+	{
+		struct stat FileStatus;
+		if (fstat(File, &FileStatus) == 0)
+		{
+			//Same 4GB limit as the Win32 version, so the game sees the same behaviour on both
+			uint32_t FileSize32 = SafeTruncateUInt64(FileStatus.st_size);
+			Result.Contents = malloc(FileSize32);
+			if (Result.Contents)
+			{
+				ssize_t BytesRead = read(File, Result.Contents, FileSize32);
+				if (BytesRead == (ssize_t)FileSize32)
+				{
+					Result.ContentSize = FileSize32;
+				}
+				else
+				{
+					DEBUGPlatformFreeFileMemory(Result.Contents);
+					Result.Contents = 0;
+				}
+			}
+		}
+		close(File);
+	}
+	return(Result);
+}
+
+DEBUG_PLATFORM_WRITE_ENTIRE_FILE(DEBUGPlatformWriteEntireFile)
+{
+	bool Result = false;
+	int File = open(Filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (File >= 0)
+	{
+		ssize_t BytesWritten = write(File, Memory, MemorySize);
+		Result = (BytesWritten == (ssize_t)MemorySize);
+		close(File);
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_COMMIT_MEMORY(LinuxCommitMemory)
+{
+	bool32 Result = CommitPlatformMemory(&GlobalGameMemory, Memory, Size);
+	if (!Result)
+	{
+		fprintf(stderr, "Game memory commit of %lluKB refused: %lluKB of %lluKB ceiling already committed\n",
+			(unsigned long long)(Size / 1024), (unsigned long long)(GlobalGameMemory.CommittedSize / 1024),
+			(unsigned long long)(GlobalGameMemory.CommitCeiling / 1024));
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_MAP_READ_ONLY_FILE(LinuxMapReadOnlyFile)
+{
+	platform_file_mapping Result = {};
+	int File = open(Filename, O_RDONLY);
+	if (File >= 0)
+	{
+		struct stat FileStatus;
+		if ((fstat(File, &FileStatus) == 0) && (FileStatus.st_size > 0))
+		{
+			void* Memory = mmap(0, FileStatus.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+			if (Memory != MAP_FAILED)
+			{
+				Result.Memory = Memory;
+				Result.Size = FileStatus.st_size;
+			}
+		}
+		//The mapping keeps its own reference to the file
+		close(File);
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_UNMAP_FILE(LinuxUnmapFile)
+{
+	if (Mapping->Memory)
+	{
+		munmap(Mapping->Memory, Mapping->Size);
+	}
+	*Mapping = {};
+}
+
+internal
+PLATFORM_GET_FILE_STAMP(LinuxGetFileStamp)
+{
+	platform_file_stamp Result = {};
+	struct stat FileStatus;
+	if (stat(Filename, &FileStatus) == 0)
+	{
+		Result.Exists = true;
+		Result.Size = FileStatus.st_size;
+		Result.WriteTime = FileStatus.st_mtime;
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_OPEN_FILE(LinuxOpenFile)
+{
+	platform_file_handle Result = {};
+	int File = open(Filename, O_RDONLY);
+	if (File < 0)
+	{
+		char* Name = Filename;
+		for (char* Scan = Filename; *Scan; Scan++)
+		{
+			if ((*Scan == '/') || (*Scan == '\\'))
+			{
+				Name = Scan + 1;
+			}
+		}
+		char Path[4096];
+		snprintf(Path, sizeof(Path), "%s/%s", GlobalDataDirectory, Name);
+		File = open(Path, O_RDONLY);
+	}
+
+	struct stat FileStatus;
+	if ((File >= 0) && (fstat(File, &FileStatus) == 0))
+	{
+		Result.IsOpen = true;
+		Result.Size = FileStatus.st_size;
+		Result.PlatformHandle = (void*)(intptr_t)File;
+	}
+	else if (File >= 0)
+	{
+		close(File);
+	}
+	return(Result);
+}
+
+//pread can come back short without anything being wrong, so it goes round until it has it all
+internal
+PLATFORM_READ_DATA_FROM_FILE(LinuxReadDataFromFile)
+{
+	bool32 Result = Handle->IsOpen && (Offset + Size <= Handle->Size);
+	int File = (int)(intptr_t)Handle->PlatformHandle;
+	uint32_t BytesRead = 0;
+	while (Result && (BytesRead < Size))
+	{
+		ssize_t Read = pread(File, (uint8_t*)Dest + BytesRead, Size - BytesRead, (off_t)(Offset + BytesRead));
+		if (Read > 0)
+		{
+			BytesRead += (uint32_t)Read;
+		}
+		else if ((Read < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+		else
+		{
+			Result = false;
+		}
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_CLOSE_FILE(LinuxCloseFile)
+{
+	if (Handle->IsOpen)
+	{
+		close((int)(intptr_t)Handle->PlatformHandle);
+	}
+	*Handle = {};
+}
+
+internal void
+CatStrings(size_t SourceACount, char* SourceA, size_t SourceBCount, char* SourceB, size_t DestCount, char* Dest)
+{
+	for (size_t Index = 0; (Index < SourceACount) && (DestCount > 1); Index++, DestCount--)
+	{
+		*Dest++ = *SourceA++;
+	}
+	for (size_t Index = 0; (Index < SourceBCount) && (DestCount > 1); Index++, DestCount--)
+	{
+		*Dest++ = *SourceB++;
+	}
+	*Dest++ = 0;
+}
+
+internal void
+LinuxBuildExePathFilename(linux_state* LinuxState, char* Filename, int DestCount, char* Dest)
+{
+	CatStrings(LinuxState->OnePastLastSlash - LinuxState->EXEFileName, LinuxState->EXEFileName,
+		strlen(Filename), Filename, DestCount, Dest);
+}
+
+internal void
+LinuxGetExeFilename(linux_state* LinuxState)
+{
+	ssize_t Length = readlink("/proc/self/exe", LinuxState->EXEFileName, sizeof(LinuxState->EXEFileName) - 1);
+	LinuxState->EXEFileName[(Length > 0) ? Length : 0] = 0;
+	LinuxState->OnePastLastSlash = LinuxState->EXEFileName;
+	for (char* Scan = LinuxState->EXEFileName; *Scan; ++Scan)
+	{
+		if (*Scan == '/')
+		{
+			LinuxState->OnePastLastSlash = Scan + 1;
+		}
+	}
+}
+
+inline struct timespec
+LinuxGetLastWriteTime(char* Filename)
+{
+	struct timespec LastWriteTime = {};
+	struct stat FileStatus;
+	if (stat(Filename, &FileStatus) == 0)
+	{
+		LastWriteTime = FileStatus.st_mtim;
+	}
+	return(LastWriteTime);
+}
+
+inline bool32
+LinuxFileTimesMatch(struct timespec A, struct timespec B)
+{
+	return((A.tv_sec == B.tv_sec) && (A.tv_nsec == B.tv_nsec));
+}
+
+//The copy is written as a new file rather than over the old one - the old one may still be mapped
+internal bool32
+LinuxCopyFile(char* SourceName, char* DestName)
+{
+	bool32 Result = false;
+	unlink(DestName);
+	int Source = open(SourceName, O_RDONLY);
+	int Dest = open(DestName, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+	if ((Source >= 0) && (Dest >= 0))
+	{
+		Result = true;
+		char Buffer[65536];
+		ssize_t BytesRead;
+		while (Result && ((BytesRead = read(Source, Buffer, sizeof(Buffer))) > 0))
+		{
+			Result = (write(Dest, Buffer, BytesRead) == BytesRead);
+		}
+		Result = Result && (BytesRead == 0);
+	}
+	if (Source >= 0)
+	{
+		close(Source);
+	}
+	if (Dest >= 0)
+	{
+		close(Dest);
+	}
+	return(Result);
+}
+
+internal linux_game_code
+LinuxLoadGameCode(char* SourceLibraryName, char* TempLibraryName)
+{
+	TIMED_FUNCTION();
+	linux_game_code Result = {};
+
+	//Loading a copy leaves the compiler free to overwrite the original while we run
+	Result.LibraryLastWriteTime = LinuxGetLastWriteTime(SourceLibraryName);
+	if (LinuxCopyFile(SourceLibraryName, TempLibraryName))
+	{
+		Result.GameCodeLibrary = dlopen(TempLibraryName, RTLD_NOW | RTLD_LOCAL);
+	}
+	if (Result.GameCodeLibrary)
+	{
+		Result.UpdateAndRender = (game_update_and_render*)dlsym(Result.GameCodeLibrary, "GameUpdateAndRender");
+		Result.GetSoundSamples = (game_get_sound_samples*)dlsym(Result.GameCodeLibrary, "GameGetSoundSamples");
+		Result.IsValid = (Result.UpdateAndRender && Result.GetSoundSamples);
+	}
+	else
+	{
+		fprintf(stderr, "Could not load %s: %s\n", SourceLibraryName, dlerror());
+	}
+
+	if (!Result.IsValid)
+	{
+		Result.UpdateAndRender = 0;
+		Result.GetSoundSamples = 0;
+	}
+
+	return Result;
+}
+
+internal void
+LinuxUnloadGameCode(linux_game_code* GameCode)
+{
+	if (GameCode->GameCodeLibrary)
+	{
+		dlclose(GameCode->GameCodeLibrary);
+		GameCode->GameCodeLibrary = 0;
+	}
+	GameCode->IsValid = false;
+	GameCode->UpdateAndRender = 0;
+	GameCode->GetSoundSamples = 0;
+}
+
+internal void
+ResizeOffscreenBuffer(linux_offscreen_buffer* Buffer, int Width, int Height)
+{
+	free(Buffer->Memory);
+	free(Buffer->FrontBuffer);
+	Buffer->Width = Width;
+	Buffer->Height = Height;
+	Buffer->BytesPerPixel = 4;
+	Buffer->Pitch = Buffer->Width*Buffer->BytesPerPixel;
+	Buffer->Memory = calloc((size_t)Buffer->Pitch*Buffer->Height, 1);
+	Buffer->FrontBuffer = calloc((size_t)Buffer->Pitch*Buffer->Height, 1);
+}
+
+internal
+PRESENT_RECT(LinuxPresentRect)
+{
+	linux_offscreen_buffer* Buffer = (linux_offscreen_buffer*)Context;
+	size_t RowBytes = (size_t)(Rect.MaxX - Rect.MinX)*Buffer->BytesPerPixel;
+	for (int Y = Rect.MinY; Y < Rect.MaxY; Y++)
+	{
+		size_t Offset = (size_t)Y*Buffer->Pitch + (size_t)Rect.MinX*Buffer->BytesPerPixel;
+		memcpy((uint8_t*)Buffer->FrontBuffer + Offset, (uint8_t*)Buffer->Memory + Offset, RowBytes);
+	}
+}
+
+//Returns the bytes copied to the front buffer
+internal uint64_t
+LinuxPresentBuffer(linux_offscreen_buffer* Buffer, dirty_region_set* Dirty)
+{
+	TIMED_FUNCTION();
+	float FullFrameFraction = 0.5f;
+	uint64_t BytesPresented = PresentDirtyRegions(Dirty, Buffer->Width, Buffer->Height,
+		Buffer->BytesPerPixel, FullFrameFraction, LinuxPresentRect, Buffer);
+	return(BytesPresented);
+}
+
+//Whatever was last presented, as a binary PPM - the nearest thing to a screenshot without a window
+internal bool32
+LinuxDumpFrontBuffer(linux_offscreen_buffer* Buffer, char* Filename)
+{
+	FILE* File = fopen(Filename, "wb");
+	if (!File)
+	{
+		return(false);
+	}
+	fprintf(File, "P6\n%d %d\n255\n", Buffer->Width, Buffer->Height);
+	uint8_t* Row = (uint8_t*)Buffer->FrontBuffer;
+	uint8_t* RGB = (uint8_t*)malloc((size_t)Buffer->Width*3);
+	for (int Y = 0; Y < Buffer->Height; Y++)
+	{
+		uint32_t* Pixel = (uint32_t*)Row;
+		for (int X = 0; X < Buffer->Width; X++)
+		{
+			RGB[X*3 + 0] = (uint8_t)(Pixel[X] >> 16);
+			RGB[X*3 + 1] = (uint8_t)(Pixel[X] >> 8);
+			RGB[X*3 + 2] = (uint8_t)(Pixel[X] >> 0);
+		}
+		fwrite(RGB, 3, Buffer->Width, File);
+		Row += Buffer->Pitch;
+	}
+	free(RGB);
+	fclose(File);
+	return(true);
+}
+
+//
+// Audio sink
+//
+
+struct wav_header
+{
+	char RIFF[4];
+	uint32_t RIFFSize;
+	char WAVE[4];
+	char Format[4];
+	uint32_t FormatSize;
+	uint16_t FormatTag;
+	uint16_t Channels;
+	uint32_t SamplesPerSecond;
+	uint32_t BytesPerSecond;
+	uint16_t BlockAlign;
+	uint16_t BitsPerSample;
+	char Data[4];
+	uint32_t DataSize;
+};
+
+internal wav_header
+MakeWAVHeader(linux_sound_output* SoundOutput)
+{
+	uint32_t DataSize = (uint32_t)(SoundOutput->SamplesWritten*SoundOutput->BytesPerSample);
+	wav_header Header = {{'R', 'I', 'F', 'F'}, 36 + DataSize, {'W', 'A', 'V', 'E'}, {'f', 'm', 't', ' '}, 16,
+		1, 2, (uint32_t)SoundOutput->SamplesPerSecond, (uint32_t)(SoundOutput->SamplesPerSecond*SoundOutput->BytesPerSample),
+		(uint16_t)SoundOutput->BytesPerSample, 16, {'d', 'a', 't', 'a'}, DataSize};
+	return(Header);
+}
+
+internal void
+LinuxOpenWAVSink(linux_sound_output* SoundOutput, char* Filename)
+{
+	SoundOutput->File = fopen(Filename, "wb");
+	if (SoundOutput->File)
+	{
+		//Sizes are filled in when the sink closes
+		wav_header Header = MakeWAVHeader(SoundOutput);
+		fwrite(&Header, sizeof(Header), 1, SoundOutput->File);
+	}
+	else
+	{
+		fprintf(stderr, "Could not open %s for writing, sound goes nowhere\n", Filename);
+	}
+}
+
+internal void
+LinuxWriteSound(linux_sound_output* SoundOutput, game_sound_buffer* SoundBuffer)
+{
+	if (SoundOutput->File)
+	{
+		fwrite(SoundBuffer->Samples, SoundOutput->BytesPerSample, SoundBuffer->SampleCount, SoundOutput->File);
+	}
+	SoundOutput->SamplesWritten += SoundBuffer->SampleCount;
+}
+
+internal void
+LinuxCloseWAVSink(linux_sound_output* SoundOutput)
+{
+	if (SoundOutput->File)
+	{
+		wav_header Header = MakeWAVHeader(SoundOutput);
+		fseek(SoundOutput->File, 0, SEEK_SET);
+		fwrite(&Header, sizeof(Header), 1, SoundOutput->File);
+		fclose(SoundOutput->File);
+		SoundOutput->File = 0;
+	}
+}
+
+//
+// Input playback
+//
+
+internal bool32
+LinuxBeginInputPlayback(linux_state* LinuxState, char* Filename)
+{
+	LinuxState->PlaybackMapping = LinuxMapReadOnlyFile(Filename);
+	LinuxState->IsPlayingBack = OpenInputStream(&LinuxState->InputReader, LinuxState->PlaybackMapping.Memory,
+		LinuxState->PlaybackMapping.Size);
+	if (!LinuxState->IsPlayingBack)
+	{
+		//Missing, or recorded by a build with a different game_input_buffer
+		LinuxUnmapFile(&LinuxState->PlaybackMapping);
+	}
+	return(LinuxState->IsPlayingBack);
+}
+
+//Loops back to the first frame at the end, like Win32 playback (minus the memory restore - there is no snapshot here)
+internal void
+LinuxPlaybackInput(linux_state* LinuxState, game_input_buffer* NewInput)
+{
+	if (!DecodeNextInputFrame(&LinuxState->InputReader, NewInput))
+	{
+		SeekInputStream(&LinuxState->InputReader, 0);
+		DecodeNextInputFrame(&LinuxState->InputReader, NewInput);
+	}
+}
+
+//
+// Work queues
+//
+
+internal
+PLATFORM_ADD_ENTRY(LinuxAddEntry)
+{
+	uint32_t NewNextEntryToWrite = (Queue->NextEntryToWrite + 1) % ArrayCount(Queue->Entries);
+	Assert(NewNextEntryToWrite != Queue->NextEntryToRead);
+	platform_work_queue_entry* Entry = &Queue->Entries[Queue->NextEntryToWrite];
+	Entry->Callback = Callback;
+	Entry->Data = Data;
+	__atomic_add_fetch(&Queue->CompletionGoal, 1, __ATOMIC_SEQ_CST);
+
+	//The entry has to be visible before the index that publishes it
+	__atomic_store_n(&Queue->NextEntryToWrite, NewNextEntryToWrite, __ATOMIC_RELEASE);
+	sem_post(&Queue->Semaphore);
+}
+
+//Returns true when the queue was empty and the caller can go to sleep
+internal bool
+LinuxDoNextWorkQueueEntry(platform_work_queue* Queue)
+{
+	bool ShouldSleep = false;
+
+	uint32_t OriginalNextEntryToRead = Queue->NextEntryToRead;
+	uint32_t NewNextEntryToRead = (OriginalNextEntryToRead + 1) % ArrayCount(Queue->Entries);
+	if (OriginalNextEntryToRead != __atomic_load_n(&Queue->NextEntryToWrite, __ATOMIC_ACQUIRE))
+	{
+		if (__atomic_compare_exchange_n(&Queue->NextEntryToRead, &OriginalNextEntryToRead, NewNextEntryToRead,
+			false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+		{
+			platform_work_queue_entry Entry = Queue->Entries[OriginalNextEntryToRead];
+			Entry.Callback(Queue, Entry.Data);
+			__atomic_add_fetch(&Queue->CompletionCount, 1, __ATOMIC_SEQ_CST);
+		}
+	}
+	else
+	{
+		ShouldSleep = true;
+	}
+
+	return(ShouldSleep);
+}
+
+internal
+PLATFORM_COMPLETE_ALL_WORK(LinuxCompleteAllWork)
+{
+	while (__atomic_load_n(&Queue->CompletionGoal, __ATOMIC_SEQ_CST) != __atomic_load_n(&Queue->CompletionCount, __ATOMIC_SEQ_CST))
+	{
+		LinuxDoNextWorkQueueEntry(Queue);
+	}
+
+	Queue->CompletionGoal = 0;
+	Queue->CompletionCount = 0;
+}
+
+internal void*
+WorkerThreadProc(void* Parameter)
+{
+	platform_work_queue* Queue = (platform_work_queue*)Parameter;
+	DEBUG_THREAD_NAME("Worker");
+	for (;;)
+	{
+		if (LinuxDoNextWorkQueueEntry(Queue))
+		{
+			sem_wait(&Queue->Semaphore);
+		}
+	}
+	return(0);
+}
+
+//One worker per logical core besides the main thread, which also chews through entries while it waits
+internal void
+LinuxMakeQueue(platform_work_queue* Queue, uint32_t ThreadCount)
+{
+	Queue->CompletionGoal = 0;
+	Queue->CompletionCount = 0;
+	Queue->NextEntryToWrite = 0;
+	Queue->NextEntryToRead = 0;
+	sem_init(&Queue->Semaphore, 0, 0);
+
+	for (uint32_t ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex++)
+	{
+		pthread_t Thread;
+		if (pthread_create(&Thread, 0, WorkerThreadProc, Queue) == 0)
+		{
+			pthread_detach(Thread);
+		}
+	}
+}
+
+//
+// Frame pacing
+//
+
+inline uint64_t
+LinuxGetWallClock()
+{
+	struct timespec Time;
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+	return((uint64_t)Time.tv_sec*1000000000ULL + Time.tv_nsec);
+}
+
+inline float
+LinuxGetSecondsElapsed(uint64_t Start, uint64_t End)
+{
+	float Result = (float)(End - Start) / 1e9f;
+	return Result;
+}
+
+//Sleeps to an absolute deadline, so time spent waking up late is not added on to the next frame
+internal void
+LinuxSleepUntil(uint64_t Deadline)
+{
+	struct timespec Time;
+	Time.tv_sec = (time_t)(Deadline / 1000000000ULL);
+	Time.tv_nsec = (long)(Deadline % 1000000000ULL);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &Time, 0) == EINTR)
+	{
+		if (!Running)
+		{
+			break;
+		}
+	}
+}
+
+internal FRAME_PACER_GET_TIME(LinuxGetPacerTime)
+{
+	return(LinuxGetWallClock());
+}
+
+internal FRAME_PACER_SLEEP_UNTIL(LinuxPacerSleepUntil)
+{
+	LinuxSleepUntil(Deadline);
+}
+
+internal FRAME_PACER_GET_TIME(LinuxGetThreadCPUTime)
+{
+	struct timespec Time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Time);
+	return((uint64_t)Time.tv_sec*1000000000ULL + Time.tv_nsec);
+}
+
+internal void
+LinuxRecordFrameTiming(linux_frame_timing* Timing, uint64_t FrameNanoseconds, uint64_t WorkNanoseconds)
+{
+	if (Timing->FrameCount < Timing->MaxFrameCount)
+	{
+		Timing->FrameNanoseconds[Timing->FrameCount] = FrameNanoseconds;
+		Timing->WorkNanoseconds[Timing->FrameCount] = WorkNanoseconds;
+		++Timing->FrameCount;
+	}
+}
+
+internal int
+CompareUInt64(const void* A, const void* B)
+{
+	uint64_t ValueA = *(uint64_t*)A;
+	uint64_t ValueB = *(uint64_t*)B;
+	return((ValueA < ValueB) ? -1 : (ValueA > ValueB) ? 1 : 0);
+}
+
+inline double
+GetPercentileMilliseconds(uint64_t* Sorted, uint32_t Count, uint32_t Percent)
+{
+	uint32_t Index = (uint32_t)(((uint64_t)Count*Percent + 99) / 100);
+	Index = (Index > 0) ? Index - 1 : 0;
+	return((double)Sorted[Index] / 1e6);
+}
+
+//Jitter is how far each frame's start-to-start time lands from the target period
+internal void
+LinuxReportFrameTiming(linux_frame_timing* Timing, frame_pacer* Pacer)
+{
+	uint64_t TargetNanoseconds = Pacer->Period;
+	uint32_t Count = Timing->FrameCount;
+	if (Count == 0)
+	{
+		return;
+	}
+
+	double Sum = 0;
+	double SumOfSquares = 0;
+	for (uint32_t Index = 0; Index < Count; Index++)
+	{
+		double Deviation = (double)Timing->FrameNanoseconds[Index] - (double)TargetNanoseconds;
+		Sum += (double)Timing->FrameNanoseconds[Index];
+		SumOfSquares += Deviation*Deviation;
+		int64_t AbsoluteDeviation = (int64_t)Timing->FrameNanoseconds[Index] - (int64_t)TargetNanoseconds;
+		Timing->FrameNanoseconds[Index] = (uint64_t)((AbsoluteDeviation < 0) ? -AbsoluteDeviation : AbsoluteDeviation);
+	}
+	qsort(Timing->FrameNanoseconds, Count, sizeof(uint64_t), CompareUInt64);
+	qsort(Timing->WorkNanoseconds, Count, sizeof(uint64_t), CompareUInt64);
+
+	printf("%u frames at a %.3f ms target, %u missed\n", Count, (double)TargetNanoseconds / 1e6, Pacer->MissedFrameCount);
+	printf("  frame period  mean %.3f ms, rms jitter %.3f ms\n", Sum / Count / 1e6, sqrt(SumOfSquares / Count) / 1e6);
+	printf("  |jitter|      p50 %.3f  p90 %.3f  p99 %.3f  max %.3f ms\n",
+		GetPercentileMilliseconds(Timing->FrameNanoseconds, Count, 50), GetPercentileMilliseconds(Timing->FrameNanoseconds, Count, 90),
+		GetPercentileMilliseconds(Timing->FrameNanoseconds, Count, 99), GetPercentileMilliseconds(Timing->FrameNanoseconds, Count, 100));
+	printf("  work          p50 %.3f  p90 %.3f  p99 %.3f  max %.3f ms\n",
+		GetPercentileMilliseconds(Timing->WorkNanoseconds, Count, 50), GetPercentileMilliseconds(Timing->WorkNanoseconds, Count, 90),
+		GetPercentileMilliseconds(Timing->WorkNanoseconds, Count, 99), GetPercentileMilliseconds(Timing->WorkNanoseconds, Count, 100));
+
+	double Frames = (double)(Pacer->FrameCount ? Pacer->FrameCount : 1);
+	printf("  waiting       %.3f ms/frame: %.3f asleep, %.3f spinning, %.3f ms CPU (%.1f%% of the wait)\n",
+		(double)Pacer->WaitNanoseconds / Frames / 1e6, (double)Pacer->SleepNanoseconds / Frames / 1e6,
+		(double)Pacer->SpinNanoseconds / Frames / 1e6, (double)Pacer->WaitCPUNanoseconds / Frames / 1e6,
+		Pacer->WaitNanoseconds ? 100.0*(double)Pacer->WaitCPUNanoseconds / (double)Pacer->WaitNanoseconds : 0.0);
+	printf("  timer margin  %.3f ms (oversleep max %.3f ms), %u late wakes\n", (double)Pacer->Margin / 1e6,
+		(double)Pacer->MaxOversleep / 1e6, Pacer->LateWakeCount);
+	printf("  |jitter| us  ");
+	for (uint32_t Bucket = 0; Bucket < FRAME_PACER_HISTOGRAM_BUCKETS - 1; Bucket++)
+	{
+		printf("<%llu:%u ", (unsigned long long)(GetFramePacerBucketLimit(Bucket) / 1000), Pacer->JitterHistogram[Bucket]);
+	}
+	printf("more:%u\n", Pacer->JitterHistogram[FRAME_PACER_HISTOGRAM_BUCKETS - 1]);
+}
+
+//
+// Hot reload
+//
+
+//Long enough for a linker between writes to have moved on, short enough not to be noticed
+#define LINUX_RELOAD_SETTLE_NANOSECONDS 50000000ULL
+
+//A build in progress holds the lock file; a library written any other way has to have stopped changing
+internal bool32
+LinuxIsLibraryReady(linux_game_code_watcher* Watcher, struct timespec* WriteTime)
+{
+	struct stat Before;
+	if ((access(Watcher->LockFileName, F_OK) == 0) || (stat(Watcher->SourceLibraryName, &Before) != 0) ||
+		LinuxFileTimesMatch(Before.st_mtim, Watcher->LoadedWriteTime))
+	{
+		return(false);
+	}
+
+	LinuxSleepUntil(LinuxGetWallClock() + LINUX_RELOAD_SETTLE_NANOSECONDS);
+	struct stat After;
+	bool32 Result = (access(Watcher->LockFileName, F_OK) != 0) && (stat(Watcher->SourceLibraryName, &After) == 0) &&
+		(After.st_size > 0) && (After.st_size == Before.st_size) && LinuxFileTimesMatch(After.st_mtim, Before.st_mtim);
+	*WriteTime = After.st_mtim;
+	return(Result);
+}
+
+//Whatever the events were, the library on disk decides - anything not ready yet sends more events when it is
+internal void*
+LinuxGameCodeWatcherThreadProc(void* Parameter)
+{
+	linux_game_code_watcher* Watcher = (linux_game_code_watcher*)Parameter;
+	DEBUG_THREAD_NAME("Game code watcher");
+	int Notify = inotify_init1(IN_CLOEXEC);
+	if ((Notify < 0) ||
+		(inotify_add_watch(Notify, Watcher->DirectoryName, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0))
+	{
+		fprintf(stderr, "linux_babl: can't watch %s, so the game won't reload\n", Watcher->DirectoryName);
+		return(0);
+	}
+
+	alignas(struct inotify_event) char Events[4096];
+	for (;;)
+	{
+		if ((read(Notify, Events, sizeof(Events)) < 0) && (errno != EINTR))
+		{
+			break;
+		}
+
+		struct timespec WriteTime;
+		if (!LinuxIsLibraryReady(Watcher, &WriteTime))
+		{
+			continue;
+		}
+
+		//The main loop takes the last one at its next frame
+		while (Watcher->IsPending)
+		{
+			LinuxSleepUntil(LinuxGetWallClock() + 1000000);
+		}
+		CompletePreviousReadsBeforeFutureReads;
+		LinuxUnloadGameCode(&Watcher->Retired);
+
+		uint64_t LoadStart = LinuxGetWallClock();
+		linux_game_code Code = LinuxLoadGameCode(Watcher->SourceLibraryName, Watcher->TempLibraryNames[Watcher->NextTempIndex]);
+		uint64_t LoadNanoseconds = LinuxGetWallClock() - LoadStart;
+		Watcher->LoadedWriteTime = WriteTime;
+		if (Code.IsValid)
+		{
+			++Watcher->LoadCount;
+			Watcher->LoadNanosecondsTotal += LoadNanoseconds;
+			Watcher->LoadNanosecondsMax = (LoadNanoseconds > Watcher->LoadNanosecondsMax) ? LoadNanoseconds : Watcher->LoadNanosecondsMax;
+			Watcher->NextTempIndex ^= 1;
+
+			Watcher->Pending = Code;
+			CompletePreviousWritesBeforeFutureWrites;
+			Watcher->IsPending = 1;
+		}
+		else
+		{
+			++Watcher->FailedCount;
+			LinuxUnloadGameCode(&Code);
+		}
+	}
+
+	close(Notify);
+	return(0);
+}
+
+internal void
+LinuxStartGameCodeWatcher(linux_game_code_watcher* Watcher, linux_game_code* Loaded)
+{
+	Watcher->LoadedWriteTime = Loaded->LibraryLastWriteTime;
+	pthread_t Thread;
+	if (pthread_create(&Thread, 0, LinuxGameCodeWatcherThreadProc, Watcher) == 0)
+	{
+		pthread_detach(Thread);
+	}
+}
+
+internal void
+LinuxReportGameCodeWatcher(linux_game_code_watcher* Watcher)
+{
+	printf("  hot reload    %u swaps, %.3f ms mean %.3f ms max in the frame; %u loads off it, %.1f ms mean %.1f ms max, %u failed\n",
+		Watcher->SwapCount, Watcher->SwapCount ? (double)Watcher->SwapNanosecondsTotal / Watcher->SwapCount / 1e6 : 0.0,
+		(double)Watcher->SwapNanosecondsMax / 1e6, Watcher->LoadCount,
+		Watcher->LoadCount ? (double)Watcher->LoadNanosecondsTotal / Watcher->LoadCount / 1e6 : 0.0,
+		(double)Watcher->LoadNanosecondsMax / 1e6, Watcher->FailedCount);
+}
+
+//
+// Audio threads
+//
+
+internal void*
+LinuxMixerThreadProc(void* Parameter)
+{
+	linux_audio* Audio = (linux_audio*)Parameter;
+	uint64_t BlockNanoseconds = (uint64_t)AUDIO_STREAM_BLOCK_SAMPLES*1000000000ULL / Audio->Stream.SamplesPerSecond;
+	DEBUG_THREAD_NAME("Mixer");
+	while (Audio->IsRunning)
+	{
+		{
+			TIMED_BLOCK("MixAudioStream");
+			pthread_mutex_lock(&Audio->GameCodeLock);
+			MixAudioStream(&Audio->Stream, Audio->Game->GetSoundSamples, Audio->GameMemory);
+			pthread_mutex_unlock(&Audio->GameCodeLock);
+		}
+
+		//Back as soon as the device takes some, and after a block's worth of time regardless
+		struct timespec Timeout;
+		clock_gettime(CLOCK_REALTIME, &Timeout);
+		uint64_t TimeoutNanoseconds = (uint64_t)Timeout.tv_nsec + BlockNanoseconds;
+		Timeout.tv_sec += (time_t)(TimeoutNanoseconds / 1000000000ULL);
+		Timeout.tv_nsec = (long)(TimeoutNanoseconds % 1000000000ULL);
+		sem_timedwait(&Audio->MixerWake, &Timeout);
+	}
+	return(0);
+}
+
+//Feeds the simulated card the way the Win32 device thread feeds DirectSound. The WAV gets exactly what was written,
+//so anything the card played stale is missing from it rather than silent
+internal void*
+LinuxAudioDeviceThreadProc(void* Parameter)
+{
+	linux_audio* Audio = (linux_audio*)Parameter;
+	linux_sound_output* Output = Audio->Output;
+	uint32_t RandomState = 0x2545F491;
+	uint64_t Deadline = LinuxGetWallClock();
+	DEBUG_THREAD_NAME("Audio device");
+	while (Audio->IsRunning)
+	{
+		uint64_t Late = 0;
+		if (Audio->JitterNanoseconds)
+		{
+			RandomState ^= RandomState << 13;
+			RandomState ^= RandomState >> 17;
+			RandomState ^= RandomState << 5;
+			Late = RandomState % Audio->JitterNanoseconds;
+		}
+		Deadline += Audio->WakeNanoseconds;
+		LinuxSleepUntil(Deadline + Late);
+
+		TIMED_BLOCK("FeedSoundCard");
+		uint64_t Now = LinuxGetWallClock();
+		uint32_t PlayCursor;
+		uint32_t WriteCursor;
+		GetSimulatedSoundCardCursors(&Audio->Card, Now, &PlayCursor, &WriteCursor);
+		audio_sync_write Write = UpdateAudioSync(&Audio->Sync, Now, PlayCursor, WriteCursor);
+		if (Write.BytesToWrite)
+		{
+			int SampleCount = (int)(Write.BytesToWrite / Output->BytesPerSample);
+			PlayAudioStream(&Audio->Stream, Output->Samples, SampleCount);
+			sem_post(&Audio->MixerWake);
+			WriteSimulatedSoundCard(&Audio->Card, LinuxGetWallClock(), Write.ByteToLock, 0, Write.BytesToWrite);
+
+			game_sound_buffer SoundBuffer = {};
+			SoundBuffer.SamplesPerSecond = Output->SamplesPerSecond;
+			SoundBuffer.SampleCount = SampleCount;
+			SoundBuffer.Samples = Output->Samples;
+			LinuxWriteSound(Output, &SoundBuffer);
+		}
+	}
+	return(0);
+}
+
+internal void
+LinuxStartAudio(linux_audio* Audio)
+{
+	pthread_mutex_init(&Audio->GameCodeLock, 0);
+	sem_init(&Audio->MixerWake, 0, 0);
+	Audio->IsRunning = true;
+	Audio->Card.StartTime = LinuxGetWallClock();
+	pthread_create(&Audio->MixerThread, 0, LinuxMixerThreadProc, Audio);
+	pthread_create(&Audio->DeviceThread, 0, LinuxAudioDeviceThreadProc, Audio);
+}
+
+internal void
+LinuxStopAudio(linux_audio* Audio)
+{
+	Audio->IsRunning = false;
+	sem_post(&Audio->MixerWake);
+	pthread_join(Audio->DeviceThread, 0);
+	pthread_join(Audio->MixerThread, 0);
+	sem_destroy(&Audio->MixerWake);
+	pthread_mutex_destroy(&Audio->GameCodeLock);
+}
+
+internal void
+LinuxReportAudio(linux_audio* Audio)
+{
+	audio_stream* Stream = &Audio->Stream;
+	double MillisecondsPerSample = 1000.0 / Stream->SamplesPerSecond;
+	printf("audio: %u blocks (%.1f ms) mixed ahead\n", Stream->TargetBlocks,
+		Stream->TargetBlocks*AUDIO_STREAM_BLOCK_SAMPLES*MillisecondsPerSample);
+	printf("  underruns     %u (%.1f ms of silence) in %.1f s played\n", Stream->UnderrunCount,
+		Stream->UnderrunSamples*MillisecondsPerSample, Stream->SamplesPlayed*MillisecondsPerSample / 1000.0);
+	if (Stream->OccupancyReadings)
+	{
+		printf("  ring          min %.1f  mean %.1f  max %.1f ms queued, %llu blocks mixed\n",
+			Stream->MinOccupancy*MillisecondsPerSample,
+			(double)Stream->OccupancyTotal / Stream->OccupancyReadings*MillisecondsPerSample,
+			Stream->MaxOccupancy*MillisecondsPerSample, (unsigned long long)Stream->BlocksMixed);
+	}
+
+	audio_sync* Sync = &Audio->Sync;
+	simulated_sound_card* Card = &Audio->Card;
+	double MillisecondsPerByte = 1000.0 / Sync->BytesPerSecond;
+	printf("  card          %.1f ms granule, %.1f ms write lead; played %.1f ms stale in %u underruns, %.1f ms overwritten\n",
+		Card->GranuleBytes*MillisecondsPerByte, Card->WriteLeadBytes*MillisecondsPerByte, Card->StaleBytes*MillisecondsPerByte,
+		Card->UnderrunCount, Card->OverwrittenBytes*MillisecondsPerByte);
+	printf("  sync          lead %.1f  granule %.1f  gap %.2f +- %.2f  peak %.1f ms, safety %.1f ms at margin %.2f\n",
+		Sync->WriteLead*MillisecondsPerByte, Sync->Granule*MillisecondsPerByte, Sync->MeanGap*MillisecondsPerByte,
+		Sync->GapJitter*MillisecondsPerByte, Sync->PeakGap*MillisecondsPerByte, Sync->SafetyBytes*MillisecondsPerByte, Sync->Margin);
+	if (Sync->LatencyReadings)
+	{
+		printf("  latency       mean %.1f  max %.1f ms written ahead of the play cursor, %u resyncs\n",
+			(double)Sync->LatencyTotal / Sync->LatencyReadings*MillisecondsPerByte, Sync->MaxLatency*MillisecondsPerByte,
+			Sync->UnderrunCount);
+	}
+}
+
+internal void
+LinuxWriteDebugTrace(char* Filename)
+{
+#if BABL_PROFILE
+	FILE* File = GlobalDebugTable ? fopen(Filename, "wb") : 0;
+	if (!File)
+	{
+		fprintf(stderr, "linux_babl: could not write a trace to %s\n", Filename);
+		return;
+	}
+	debug_trace_stats Stats = WriteChromeTrace(GlobalDebugTable, File, LinuxGetWallClock());
+	fclose(File);
+	printf("  trace         %llu blocks from %u threads in %s; %llu events overwritten, %llu unpaired\n",
+		(unsigned long long)Stats.BlockCount, Stats.ThreadCount, Filename, (unsigned long long)Stats.OverwrittenEventCount,
+		(unsigned long long)Stats.UnpairedEventCount);
+#else
+	fprintf(stderr, "linux_babl: built without BABL_PROFILE, so there is no trace for %s\n", Filename);
+#endif
+}
+
+internal void
+HandleQuitSignal(int Signal)
+{
+	Running = false;
+}
+
+int
+main(int ArgCount, char** Args)
+{
+	linux_state LinuxState = {};
+
+	char* PlaybackFilename = 0;
+	char* WAVFilename = 0;
+	char* DumpFilename = 0;
+	char* TraceFilename = 0;
+	uint32_t MaxFrameCount = 0;
+	float GameUpdateHz = 30.0f;
+	int Width = 1280;
+	int Height = 720;
+	float AudioLatencyMilliseconds = 40.0f;
+	float CardGranuleMilliseconds = 10.0f;
+	float CardLeadMilliseconds = 10.0f;
+	float FeederJitterMilliseconds = 0.0f;
+	uint32_t SpikeInterval = 0;
+	float SpikeMilliseconds = 0.0f;
+	for (int ArgIndex = 1; ArgIndex < ArgCount; ArgIndex++)
+	{
+		char* Arg = Args[ArgIndex];
+		bool32 HasValue = (ArgIndex + 1 < ArgCount);
+		if ((strcmp(Arg, "-play") == 0) && HasValue)
+		{
+			PlaybackFilename = Args[++ArgIndex];
+		}
+		else if ((strcmp(Arg, "-wav") == 0) && HasValue)
+		{
+			WAVFilename = Args[++ArgIndex];
+		}
+		else if ((strcmp(Arg, "-dump") == 0) && HasValue)
+		{
+			DumpFilename = Args[++ArgIndex];
+		}
+		else if ((strcmp(Arg, "-frames") == 0) && HasValue)
+		{
+			MaxFrameCount = (uint32_t)atoi(Args[++ArgIndex]);
+		}
+		else if ((strcmp(Arg, "-hz") == 0) && HasValue)
+		{
+			GameUpdateHz = (float)atof(Args[++ArgIndex]);
+		}
+		else if ((strcmp(Arg, "-size") == 0) && HasValue)
+		{
+			sscanf(Args[++ArgIndex], "%dx%d", &Width, &Height);
+		}
+		else if ((strcmp(Arg, "-latency") == 0) && HasValue)
+		{
+			AudioLatencyMilliseconds = (float)atof(Args[++ArgIndex]);
+		}
+		else if ((strcmp(Arg, "-granule") == 0) && HasValue)
+		{
+			CardGranuleMilliseconds = (float)atof(Args[++ArgIndex]);
+		}
+		else if ((strcmp(Arg, "-lead") == 0) && HasValue)
+		{
+			CardLeadMilliseconds = (float)atof(Args[++ArgIndex]);
+		}
+		else if ((strcmp(Arg, "-jitter") == 0) && HasValue)
+		{
+			FeederJitterMilliseconds = (float)atof(Args[++ArgIndex]);
+		}
+		else if ((strcmp(Arg, "-spike") == 0) && HasValue)
+		{
+			sscanf(Args[++ArgIndex], "%u:%f", &SpikeInterval, &SpikeMilliseconds);
+		}
+		else if ((strcmp(Arg, "-data") == 0) && HasValue)
+		{
+			GlobalDataDirectory = Args[++ArgIndex];
+		}
+		else if ((strcmp(Arg, "-trace") == 0) && HasValue)
+		{
+			TraceFilename = Args[++ArgIndex];
+		}
+		else
+		{
+			fprintf(stderr, "Usage: linux_babl [-play recording.ir] [-wav out.wav] [-frames N] [-hz N] [-size WxH] [-dump frame.ppm]\n"
+				"                  [-latency ms] [-granule ms] [-lead ms] [-jitter ms] [-spike N:ms] [-data dir] [-trace trace.json]\n");
+			return(1);
+		}
+	}
+	if ((GameUpdateHz <= 0.0f) || (Width <= 0) || (Height <= 0) || (AudioLatencyMilliseconds <= 0.0f) ||
+		(CardGranuleMilliseconds <= 0.0f) || (CardLeadMilliseconds < 0.0f) || (FeederJitterMilliseconds < 0.0f))
+	{
+		fprintf(stderr, "linux_babl: -hz, -size, -latency and -granule have to be positive\n");
+		return(1);
+	}
+
+	LinuxGetExeFilename(&LinuxState);
+
+	char SourceGameCodeLibraryFullPath[4096];
+	LinuxBuildExePathFilename(&LinuxState, "babl.so", sizeof(SourceGameCodeLibraryFullPath), SourceGameCodeLibraryFullPath);
+
+	char LockFileFullPath[4096];
+	LinuxBuildExePathFilename(&LinuxState, "lock.tmp", sizeof(LockFileFullPath), LockFileFullPath);
+
+	char EXEDirectory[4096];
+	LinuxBuildExePathFilename(&LinuxState, "", sizeof(EXEDirectory), EXEDirectory);
+
+	//Two temp copies: a library can't be loaded over the one still running, and dlopen hands back a name it has open
+	static linux_game_code_watcher Watcher;
+	Watcher.SourceLibraryName = SourceGameCodeLibraryFullPath;
+	Watcher.LockFileName = LockFileFullPath;
+	Watcher.DirectoryName = EXEDirectory;
+	LinuxBuildExePathFilename(&LinuxState, "babl_temp_0.so", sizeof(Watcher.TempLibraryNames[0]), Watcher.TempLibraryNames[0]);
+	LinuxBuildExePathFilename(&LinuxState, "babl_temp_1.so", sizeof(Watcher.TempLibraryNames[1]), Watcher.TempLibraryNames[1]);
+
+#if BABL_PROFILE
+	//Before any thread starts, so every one of them finds it. It stays out of game memory, as on Win32, where the
+	//state ring snapshots and restores all of game memory while other threads keep recording
+	uint64_t DebugStorageSize = Megabytes(64);
+	void* DebugStorage = mmap(0, DebugStorageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	GlobalDebugTable = InitializeDebugTable((DebugStorage != MAP_FAILED) ? DebugStorage : 0, DebugStorageSize, LinuxGetWallClock());
+	DEBUG_THREAD_NAME("Main");
+#endif
+
+	long ProcessorCount = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t RenderThreadCount = (ProcessorCount > 1) ? (uint32_t)ProcessorCount - 1 : 0;
+	static platform_work_queue RenderQueue;
+	LinuxMakeQueue(&RenderQueue, RenderThreadCount);
+
+	//Asset loads are mostly waiting on the disk, so a couple of threads is plenty and they stay off the render workers
+	static platform_work_queue LowPriorityQueue;
+	LinuxMakeQueue(&LowPriorityQueue, 2);
+
+#if BABL_INTERNAL
+	void* BaseAddress = (void*)Terabytes((uint64_t)2); //Same known base address as the Win32 layer
+#else
+	void* BaseAddress = 0;
+#endif
+
+	game_memory GameMemory = {};
+	GameMemory.PermanentStorageSize = Megabytes(64);
+	GameMemory.TransientStorageSize = Gigabytes(1);
+
+	//One mapping for the lot, committed only as the game's arenas grow, and never more than the ceiling
+	uint64_t CommitCeiling = Megabytes(512);
+	LinuxState.TotalSize = GameMemory.PermanentStorageSize + GameMemory.TransientStorageSize;
+	if (!ReservePlatformMemory(&GlobalGameMemory, BaseAddress, LinuxState.TotalSize, CommitCeiling))
+	{
+		fprintf(stderr, "linux_babl: could not reserve %lluMB of game memory\n", (unsigned long long)(LinuxState.TotalSize / Megabytes(1)));
+		return(1);
+	}
+	LinuxState.GameMemoryBlock = GlobalGameMemory.Base;
+	GameMemory.PlatformCommitMemory = LinuxCommitMemory;
+
+	GameMemory.PermanentStorage = LinuxState.GameMemoryBlock;
+	GameMemory.TransientStorage = ((uint8_t*)GameMemory.PermanentStorage + GameMemory.PermanentStorageSize);
+
+	GameMemory.DebugTable = GlobalDebugTable;
+	GameMemory.RenderQueue = &RenderQueue;
+	GameMemory.LowPriorityQueue = &LowPriorityQueue;
+	LinuxState.LowPriorityQueue = &LowPriorityQueue;
+	GameMemory.PlatformAddEntry = LinuxAddEntry;
+	GameMemory.PlatformCompleteAllWork = LinuxCompleteAllWork;
+	GameMemory.PlatformMapReadOnlyFile = LinuxMapReadOnlyFile;
+	GameMemory.PlatformUnmapFile = LinuxUnmapFile;
+	GameMemory.PlatformGetFileStamp = LinuxGetFileStamp;
+	GameMemory.PlatformOpenFile = LinuxOpenFile;
+	GameMemory.PlatformReadDataFromFile = LinuxReadDataFromFile;
+	GameMemory.PlatformCloseFile = LinuxCloseFile;
+
+	GameMemory.DEBUGPlatformReadEntireFile = DEBUGPlatformReadEntireFile;
+	GameMemory.DEBUGPlatformWriteEntireFile = DEBUGPlatformWriteEntireFile;
+	GameMemory.DEBUGPlatformFreeFileMemory = DEBUGPlatformFreeFileMemory;
+
+	ResizeOffscreenBuffer(&GlobalBackbuffer, Width, Height);
+
+	linux_sound_output SoundOutput = {};
+	SoundOutput.SamplesPerSecond = 48000;
+	SoundOutput.BytesPerSample = sizeof(int16_t)*2;
+	SoundOutput.Samples = (int16_t*)calloc(SoundOutput.SamplesPerSecond, SoundOutput.BytesPerSample);
+	if (WAVFilename)
+	{
+		LinuxOpenWAVSink(&SoundOutput, WAVFilename);
+	}
+
+	//The ring holds at least twice what is kept queued, so the mixer always has somewhere to put the next block
+	static linux_audio Audio;
+	uint32_t TargetBlocks = (uint32_t)ceilf(AudioLatencyMilliseconds*SoundOutput.SamplesPerSecond / 1000.0f / AUDIO_STREAM_BLOCK_SAMPLES);
+	uint32_t BlockCount = 4;
+	while (BlockCount < 2*TargetBlocks)
+	{
+		BlockCount *= 2;
+	}
+	audio_stream_block* Blocks = (audio_stream_block*)calloc(BlockCount, sizeof(audio_stream_block));
+	InitializeAudioStream(&Audio.Stream, Blocks, BlockCount, TargetBlocks, SoundOutput.SamplesPerSecond);
+	Audio.Output = &SoundOutput;
+	Audio.WakeNanoseconds = 1000000;
+	Audio.JitterNanoseconds = (uint64_t)(FeederJitterMilliseconds*1e6f);
+
+	//A second of buffer, like the Win32 secondary buffer - and Samples holds a second, so no write can outgrow it
+	uint32_t CardBufferSize = (uint32_t)(SoundOutput.SamplesPerSecond*SoundOutput.BytesPerSample);
+	uint32_t BytesPerMillisecond = CardBufferSize / 1000;
+	InitializeSimulatedSoundCard(&Audio.Card, 0, CardBufferSize, SoundOutput.BytesPerSample, SoundOutput.SamplesPerSecond,
+		(uint32_t)(CardGranuleMilliseconds*BytesPerMillisecond), (uint32_t)(CardLeadMilliseconds*BytesPerMillisecond), 0, 0);
+	InitializeAudioSync(&Audio.Sync, CardBufferSize, SoundOutput.BytesPerSample, SoundOutput.SamplesPerSecond);
+
+	if (PlaybackFilename && !LinuxBeginInputPlayback(&LinuxState, PlaybackFilename))
+	{
+		fprintf(stderr, "linux_babl: %s is not an input recording this build can read\n", PlaybackFilename);
+		return(1);
+	}
+
+	//Keep the report whatever the run length - past the cap, frames still run but are not kept
+	linux_frame_timing FrameTiming = {};
+	FrameTiming.MaxFrameCount = MaxFrameCount ? MaxFrameCount : 1 << 20;
+	FrameTiming.FrameNanoseconds = (uint64_t*)malloc(FrameTiming.MaxFrameCount*sizeof(uint64_t));
+	FrameTiming.WorkNanoseconds = (uint64_t*)malloc(FrameTiming.MaxFrameCount*sizeof(uint64_t));
+
+	struct sigaction QuitAction = {};
+	QuitAction.sa_handler = HandleQuitSignal;
+	sigemptyset(&QuitAction.sa_mask);
+	sigaction(SIGINT, &QuitAction, 0);
+	sigaction(SIGTERM, &QuitAction, 0);
+
+	game_input_buffer Input[2] = {};
+	game_input_buffer* OldInput = &Input[0];
+	game_input_buffer* NewInput = &Input[1];
+
+	uint64_t TargetNanosecondsPerFrame = (uint64_t)(1e9 / GameUpdateHz);
+	uint64_t BytesPresented = 0;
+	uint32_t FrameIndex = 0;
+
+	//Each frame's render_group_stats added up, for the means in the exit report
+	render_group_stats RenderTotals = {};
+	uint64_t RenderBytesPushed = 0;
+	uint64_t RenderCyclesMax = 0;
+
+	linux_game_code Game = LinuxLoadGameCode(SourceGameCodeLibraryFullPath, Watcher.TempLibraryNames[0]);
+	Watcher.NextTempIndex = 1;
+	LinuxStartGameCodeWatcher(&Watcher, &Game);
+	Audio.Game = &Game;
+	Audio.GameMemory = &GameMemory;
+	LinuxStartAudio(&Audio);
+
+	Running = true;
+	uint64_t LastFrameStart = LinuxGetWallClock();
+	frame_pacer Pacer;
+	InitializeFramePacer(&Pacer, TargetNanosecondsPerFrame, LastFrameStart);
+	frame_pacer_clock PacerClock = {0, LinuxGetPacerTime, LinuxPacerSleepUntil, LinuxGetThreadCPUTime};
+	while (Running)
+	{
+		TIMED_BLOCK("Frame");
+		uint64_t FrameStart = LinuxGetWallClock();
+
+		//The watcher has already loaded it, and closes the old one later
+		if (Watcher.IsPending)
+		{
+			TIMED_BLOCK("SwapGameCode");
+			CompletePreviousReadsBeforeFutureReads;
+
+			//Queued asset loads point at code in the old library, and so might the mixer be
+			LinuxCompleteAllWork(&LowPriorityQueue);
+			pthread_mutex_lock(&Audio.GameCodeLock);
+			Watcher.Retired = Game;
+			Game = Watcher.Pending;
+			pthread_mutex_unlock(&Audio.GameCodeLock);
+			CompletePreviousWritesBeforeFutureWrites;
+			Watcher.IsPending = 0;
+
+			uint64_t SwapNanoseconds = LinuxGetWallClock() - FrameStart;
+			++Watcher.SwapCount;
+			Watcher.SwapNanosecondsTotal += SwapNanoseconds;
+			Watcher.SwapNanosecondsMax = (SwapNanoseconds > Watcher.SwapNanosecondsMax) ? SwapNanoseconds : Watcher.SwapNanosecondsMax;
+		}
+
+		//No devices: the new frame starts from the old one's held state with no transitions
+		*NewInput = *OldInput;
+		for (int ButtonIndex = 0; ButtonIndex < ArrayCount(NewInput->MouseButtons); ButtonIndex++)
+		{
+			NewInput->MouseButtons[ButtonIndex].HalfTransitionCount = 0;
+		}
+		for (int ControllerIndex = 0; ControllerIndex < ArrayCount(NewInput->Controllers); ControllerIndex++)
+		{
+			for (int ButtonIndex = 0; ButtonIndex < ArrayCount(NewInput->Controllers[ControllerIndex].Buttons); ButtonIndex++)
+			{
+				NewInput->Controllers[ControllerIndex].Buttons[ButtonIndex].HalfTransitionCount = 0;
+			}
+		}
+		if (LinuxState.IsPlayingBack)
+		{
+			LinuxPlaybackInput(&LinuxState, NewInput);
+		}
+
+		game_offscreen_buffer Buffer = {};
+		Buffer.Memory = GlobalBackbuffer.Memory;
+		Buffer.BytesPerPixel = GlobalBackbuffer.BytesPerPixel;
+		Buffer.Width = GlobalBackbuffer.Width;
+		Buffer.Height = GlobalBackbuffer.Height;
+		Buffer.Pitch = GlobalBackbuffer.Pitch;
+		Buffer.Dirty.FullFrame = (FrameIndex == 0);
+
+		//Hook into the main game loop
+		if (Game.UpdateAndRender)
+			Game.UpdateAndRender(&GameMemory, &Buffer, NewInput);
+
+		if (SpikeInterval && ((FrameIndex % SpikeInterval) == SpikeInterval - 1))
+		{
+			LinuxSleepUntil(LinuxGetWallClock() + (uint64_t)(SpikeMilliseconds*1e6f));
+		}
+
+		BytesPresented += LinuxPresentBuffer(&GlobalBackbuffer, &Buffer.Dirty);
+		RenderBytesPushed += Buffer.RenderStats.PushBufferBytes;
+		RenderTotals.EntryCount += Buffer.RenderStats.EntryCount;
+		RenderTotals.MergedCount += Buffer.RenderStats.MergedCount;
+		RenderTotals.CulledCount += Buffer.RenderStats.CulledCount;
+		RenderTotals.SkippedTileCount += Buffer.RenderStats.SkippedTileCount;
+		RenderTotals.RenderCycles += Buffer.RenderStats.RenderCycles;
+		RenderCyclesMax = (Buffer.RenderStats.RenderCycles > RenderCyclesMax) ? Buffer.RenderStats.RenderCycles : RenderCyclesMax;
+
+		game_input_buffer* Temp = NewInput;
+		NewInput = OldInput;
+		OldInput = Temp;
+
+		uint64_t WorkEnd = LinuxGetWallClock();
+		{
+			TIMED_BLOCK("WaitForNextFrame");
+			WaitForNextFrame(&Pacer, &PacerClock);
+		}
+
+		if (FrameIndex > 0)
+		{
+			LinuxRecordFrameTiming(&FrameTiming, FrameStart - LastFrameStart, WorkEnd - FrameStart);
+		}
+		LastFrameStart = FrameStart;
+
+		++FrameIndex;
+		if (MaxFrameCount && (FrameIndex >= MaxFrameCount))
+		{
+			Running = false;
+		}
+	}
+
+	LinuxStopAudio(&Audio);
+	LinuxCompleteAllWork(&LowPriorityQueue);
+	LinuxCloseWAVSink(&SoundOutput);
+	if (DumpFilename && !LinuxDumpFrontBuffer(&GlobalBackbuffer, DumpFilename))
+	{
+		fprintf(stderr, "linux_babl: could not write %s\n", DumpFilename);
+	}
+
+	LinuxReportFrameTiming(&FrameTiming, &Pacer);
+	LinuxReportGameCodeWatcher(&Watcher);
+	printf("  presented     %.1f KB/frame\n", FrameIndex ? (double)BytesPresented / FrameIndex / 1024.0 : 0.0);
+	if (FrameIndex)
+	{
+		double Frames = (double)FrameIndex;
+		printf("  render        per frame %.1f entries, %.1f merged, %.1f culled in tiles, %.1f tiles skipped, %.0f bytes pushed\n",
+			RenderTotals.EntryCount / Frames, RenderTotals.MergedCount / Frames, RenderTotals.CulledCount / Frames,
+			RenderTotals.SkippedTileCount / Frames, RenderBytesPushed / Frames);
+		printf("                %.3f Mcycles mean, %.3f max\n", RenderTotals.RenderCycles / Frames / 1e6, RenderCyclesMax / 1e6);
+	}
+	printf("  game memory   %lluKB committed of %lluKB reserved\n",
+		(unsigned long long)(GlobalGameMemory.CommittedSize / 1024), (unsigned long long)(GlobalGameMemory.ReservedSize / 1024));
+	LinuxReportAudio(&Audio);
+	if (TraceFilename)
+	{
+		LinuxWriteDebugTrace(TraceFilename);
+	}
+
+	return(0);
+}
@@ -0,0 +1,142 @@
+#ifndef LINUX_BABL_H
+#define LINUX_BABL_H
+
+struct linux_game_code
+{
+	void* GameCodeLibrary;
+	struct timespec LibraryLastWriteTime;
+	game_update_and_render* UpdateAndRender;
+	game_get_sound_samples* GetSoundSamples;
+	bool IsValid;
+};
+
+/*
+	Hot reload, off the main thread. The watcher sleeps on inotify until something next to the executable changes,
+	then waits for the build to be done with the library - no lock file (build.sh holds one while it links), and
+	the same size and write time across a short settle - before it copies it into whichever temp slot isn't loaded
+	and dlopens it there. All the main loop does is swap the new code in at the top of a frame.
+
+	Pending is the watcher's until it sets IsPending, and the main loop's until it clears it. Retired is the
+	library the main loop swapped out, which the watcher closes before it next copies over that slot.
+*/
+struct linux_game_code_watcher
+{
+	char* SourceLibraryName;
+	char* LockFileName;
+	char* DirectoryName;
+	char TempLibraryNames[2][4096];
+
+	linux_game_code Pending;
+	linux_game_code Retired;
+	uint32_t volatile IsPending;
+
+	//Watcher's: the write time it last loaded (or failed to), and how long the copying and loading took
+	uint32_t NextTempIndex;
+	struct timespec LoadedWriteTime;
+	uint32_t LoadCount;
+	uint32_t FailedCount;
+	uint64_t LoadNanosecondsTotal;
+	uint64_t LoadNanosecondsMax;
+
+	//Main loop's: how long each swap held up its frame
+	uint32_t SwapCount;
+	uint64_t SwapNanosecondsTotal;
+	uint64_t SwapNanosecondsMax;
+};
+
+//No window to blit to: presenting copies the dirty regions into FrontBuffer, which is what a window would show
+struct linux_offscreen_buffer
+{
+	void* Memory;
+	void* FrontBuffer;
+	int Width;
+	int Height;
+	int Pitch;
+	int BytesPerPixel;
+};
+
+//Null sink unless File is open, in which case every sample goes into a 16-bit stereo WAV
+struct linux_sound_output
+{
+	int SamplesPerSecond;
+	int BytesPerSample;
+	int16_t* Samples;
+
+	FILE* File;
+	uint64_t SamplesWritten;
+};
+
+//The mixer thread and a feeder for a simulated sound card, either side of an audio_stream (see babl_audio_stream.h).
+//The feeder does what the Win32 device thread does with DirectSound: wakes, reads the card's cursors, and writes as
+//much as audio_sync says to
+struct linux_audio
+{
+	audio_stream Stream;
+	linux_sound_output* Output;
+
+	//Held by the mixer while it is in game code, and by the main thread while it swaps the game library
+	pthread_mutex_t GameCodeLock;
+	linux_game_code* Game;
+	game_memory* GameMemory;
+
+	//Posted by the device every time it takes samples, so the mixer tops the ring straight back up
+	sem_t MixerWake;
+
+	//The card plays on the wall clock; the feeder wakes every WakeNanoseconds, up to JitterNanoseconds late
+	simulated_sound_card Card;
+	audio_sync Sync;
+	uint64_t WakeNanoseconds;
+	uint64_t JitterNanoseconds;
+
+	bool32 volatile IsRunning;
+	pthread_t MixerThread;
+	pthread_t DeviceThread;
+};
+
+struct platform_work_queue_entry
+{
+	platform_work_queue_callback* Callback;
+	void* Data;
+};
+
+//Single writer (the main thread), many readers (the workers plus the main thread while it waits in CompleteAllWork)
+struct platform_work_queue
+{
+	uint32_t volatile CompletionGoal;
+	uint32_t volatile CompletionCount;
+
+	uint32_t volatile NextEntryToWrite;
+	uint32_t volatile NextEntryToRead;
+	sem_t Semaphore;
+
+	platform_work_queue_entry Entries[1024];
+};
+
+//Per-frame timings kept for the jitter report at exit
+struct linux_frame_timing
+{
+	uint32_t FrameCount;
+	uint32_t MaxFrameCount;
+
+	//Start-to-start time of each frame, and how much of it was spent working rather than sleeping
+	uint64_t* FrameNanoseconds;
+	uint64_t* WorkNanoseconds;
+};
+
+struct linux_state
+{
+	uint64_t TotalSize;
+	void* GameMemoryBlock;
+
+	//Drained before the game library is unloaded - its workers run game code
+	platform_work_queue* LowPriorityQueue;
+
+	platform_file_mapping PlaybackMapping;
+	bool32 IsPlayingBack;
+	input_stream_reader InputReader;
+
+	char EXEFileName[4096];
+	char* OnePastLastSlash;
+};
+
+#endif // !LINUX_BABL_H
@@ -5,7 +5,18 @@
 #include <Xinput.h>
 #include <dsound.h>
 
+#include "babl_intrinsics.h"
+#include "babl_debug.h"
+#include "babl_debug_trace.h"
+#include "babl_platform_memory.h"
+#include "babl_input_stream.h"
+#include "babl_state_ring.h"
+#include "babl_spsc_ring.h"
+#include "babl_audio_stream.h"
+#include "babl_audio_sync.h"
+#include "babl_frame_pacer.h"
 #include "win32_babl.h"
+#include "babl_dirty_region.h"
 
 /*
 	Examples of things that will need to be done in a platform layer:
@@ -28,6 +39,9 @@
 global_variable bool Running, Pause;
 global_variable win32_offscreen_buffer GlobalBackbuffer;
 global_variable LPDIRECTSOUNDBUFFER SecondaryBuffer;
+global_variable platform_memory_block GlobalGameMemory;
+global_variable state_ring GlobalStateRing;
+global_variable win32_audio GlobalAudio;
 
 DEBUG_PLATFORM_FREE_FILE_MEMORY(DEBUGPlatformFreeFileMemory)
 {
@@ -90,6 +104,128 @@ DEBUG_PLATFORM_WRITE_ENTIRE_FILE(DEBUGPlatformWriteEntireFile)
 	return(Result);
 }
 
+internal
+PLATFORM_COMMIT_MEMORY(Win32CommitMemory)
+{
+	bool32 Result = CommitPlatformMemory(&GlobalGameMemory, Memory, Size);
+	if (!Result)
+	{
+		char Message[256];
+		sprintf_s(Message, "Game memory commit of %lluKB refused: %lluKB of %lluKB ceiling already committed\n",
+			Size / 1024, GlobalGameMemory.CommittedSize / 1024, GlobalGameMemory.CommitCeiling / 1024);
+		OutputDebugString(Message);
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_MAP_READ_ONLY_FILE(Win32MapReadOnlyFile)
+{
+	platform_file_mapping Result = {};
+	HANDLE FileHandle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if (FileHandle != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER FileSize;
+		if (GetFileSizeEx(FileHandle, &FileSize) && FileSize.QuadPart > 0)
+		{
+			HANDLE MappingHandle = CreateFileMapping(FileHandle, 0, PAGE_READONLY, 0, 0, 0);
+			if (MappingHandle)
+			{
+				Result.Memory = MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0);
+				if (Result.Memory)
+				{
+					Result.Size = FileSize.QuadPart;
+					Result.PlatformHandle = MappingHandle;
+				}
+				else
+				{
+					CloseHandle(MappingHandle);
+				}
+			}
+		}
+		//The mapping keeps its own reference to the file
+		CloseHandle(FileHandle);
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_UNMAP_FILE(Win32UnmapFile)
+{
+	if (Mapping->Memory)
+	{
+		UnmapViewOfFile(Mapping->Memory);
+		CloseHandle((HANDLE)Mapping->PlatformHandle);
+	}
+	*Mapping = {};
+}
+
+//FILETIME counts 100ns steps from 1601; the stamp wants seconds from 1970, like the packer's stat
+internal
+PLATFORM_GET_FILE_STAMP(Win32GetFileStamp)
+{
+	platform_file_stamp Result = {};
+	WIN32_FILE_ATTRIBUTE_DATA Data;
+	if (GetFileAttributesExA(Filename, GetFileExInfoStandard, &Data))
+	{
+		ULARGE_INTEGER WriteTime;
+		WriteTime.LowPart = Data.ftLastWriteTime.dwLowDateTime;
+		WriteTime.HighPart = Data.ftLastWriteTime.dwHighDateTime;
+		Result.Exists = true;
+		Result.Size = ((uint64_t)Data.nFileSizeHigh << 32) | Data.nFileSizeLow;
+		Result.WriteTime = WriteTime.QuadPart / 10000000ULL - 11644473600ULL;
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_OPEN_FILE(Win32OpenFile)
+{
+	platform_file_handle Result = {};
+	HANDLE FileHandle = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if (FileHandle != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER FileSize;
+		if (GetFileSizeEx(FileHandle, &FileSize))
+		{
+			Result.IsOpen = true;
+			Result.Size = FileSize.QuadPart;
+			Result.PlatformHandle = FileHandle;
+		}
+		else
+		{
+			CloseHandle(FileHandle);
+		}
+	}
+	return(Result);
+}
+
+//The offset goes in the OVERLAPPED, so reads from different threads never fight over a file pointer
+internal
+PLATFORM_READ_DATA_FROM_FILE(Win32ReadDataFromFile)
+{
+	bool32 Result = false;
+	if (Handle->IsOpen && (Offset + Size <= Handle->Size))
+	{
+		OVERLAPPED Overlapped = {};
+		Overlapped.Offset = (DWORD)(Offset & 0xFFFFFFFF);
+		Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+		DWORD BytesRead;
+		Result = ReadFile((HANDLE)Handle->PlatformHandle, Dest, Size, &BytesRead, &Overlapped) && (BytesRead == Size);
+	}
+	return(Result);
+}
+
+internal
+PLATFORM_CLOSE_FILE(Win32CloseFile)
+{
+	if (Handle->IsOpen)
+	{
+		CloseHandle((HANDLE)Handle->PlatformHandle);
+	}
+	*Handle = {};
+}
+
 //Dynamic loading of functions from Xinput.lib to check for platform compatibility (not all machines will have the library)
 //General strategy is to macro the target function headers to get compile-time checking, while also aliasing the API calls we need
 //to abstract away from the platform/library, which robustifies
@@ -200,6 +336,7 @@ Win32GetLastWriteTime(char* Filename)
 internal win32_game_code
 Win32LoadGameCode(char* SourceDLLName, char* TempDLLName)
 {
+	TIMED_FUNCTION();
 	win32_game_code Result = {};
 
 	CopyFile(SourceDLLName, TempDLLName, FALSE);
@@ -228,6 +365,7 @@ Win32UnloadGameCode(win32_game_code* GameCode)
 	if (GameCode->GameCodeDLL)
 	{
 		FreeLibrary(GameCode->GameCodeDLL);
+		GameCode->GameCodeDLL = 0;
 	}
 	GameCode->IsValid = false;
 	GameCode->UpdateAndRender = 0;
@@ -300,12 +438,41 @@ ResizeDIBSection(win32_offscreen_buffer *buffer, int width, int height)
 	buffer->Pitch = buffer->Width * BytesPerPixel;	
 }
 
-internal void Win32CopyBufferToWindow(win32_offscreen_buffer* buffer, HDC DeviceContext, RECT WindowRect)
+struct win32_present_context
+{
+	win32_offscreen_buffer* Buffer;
+	HDC DeviceContext;
+};
+
+internal
+PRESENT_RECT(Win32PresentRect)
 {
+	win32_present_context* Present = (win32_present_context*)Context;
+	win32_offscreen_buffer* buffer = Present->Buffer;
+	int Width = Rect.MaxX - Rect.MinX;
+	int Height = Rect.MaxY - Rect.MinY;
+	//Top-down DIB, so the source origin is the upper-left just like the destination
+	StretchDIBits(Present->DeviceContext, Rect.MinX, Rect.MinY, Width, Height, Rect.MinX, Rect.MinY, Width, Height,
+		buffer->Memory, &buffer->BitmapInfo, DIB_RGB_COLORS, SRCCOPY);
+}
+
+//Passing no Dirty set presents the whole buffer (WM_PAINT, where Windows decides what got exposed)
+//Returns the bytes handed to GDI
+internal uint64_t
+Win32CopyBufferToWindow(win32_offscreen_buffer* buffer, HDC DeviceContext, RECT WindowRect, dirty_region_set* Dirty)
+{
+	TIMED_FUNCTION();
 	//Currently only blitting by buffer size because Casey said so
 	//int window_width = WindowRect.right - WindowRect.left;
 	//int window_height = WindowRect.bottom - WindowRect.top;
-	StretchDIBits(DeviceContext, 0, 0, buffer->Width, buffer->Height, 0, 0, buffer->Width, buffer->Height, buffer->Memory, &buffer->BitmapInfo, DIB_RGB_COLORS, SRCCOPY);
+	dirty_region_set FullFrame = {};
+	FullFrame.FullFrame = true;
+
+	win32_present_context Present = {buffer, DeviceContext};
+	float FullFrameFraction = 0.5f;
+	uint64_t BytesPresented = PresentDirtyRegions(Dirty ? Dirty : &FullFrame, buffer->Width, buffer->Height,
+		buffer->BytesPerPixel, FullFrameFraction, Win32PresentRect, &Present);
+	return(BytesPresented);
 }
 
 internal void 
@@ -385,7 +552,6 @@ Win32FillSoundBuffer(win32_sound_output* SoundOutput, DWORD ByteToLock, DWORD By
 		{
 			*DestSample++ = *SourceSample++;
 			*DestSample++ = *SourceSample++;
-			++SoundOutput->RunningSampleIndex;
 		}
 
 		DestSample = (int16_t*)Region2;
@@ -394,7 +560,6 @@ Win32FillSoundBuffer(win32_sound_output* SoundOutput, DWORD ByteToLock, DWORD By
 		{
 			*DestSample++ = *SourceSample++;
 			*DestSample++ = *SourceSample++;
-			++SoundOutput->RunningSampleIndex;
 		}
 
 		SecondaryBuffer->Unlock(Region1, Region1Size, Region2, Region2Size);
@@ -405,6 +570,105 @@ Win32FillSoundBuffer(win32_sound_output* SoundOutput, DWORD ByteToLock, DWORD By
 	}
 }
 
+//
+// Audio threads
+//
+
+DWORD WINAPI
+Win32MixerThreadProc(LPVOID lpParameter)
+{
+	win32_audio* Audio = (win32_audio*)lpParameter;
+	DWORD BlockMS = (DWORD)(AUDIO_STREAM_BLOCK_SAMPLES*1000 / Audio->Stream.SamplesPerSecond);
+	DEBUG_THREAD_NAME("Mixer");
+	for (;;)
+	{
+		{
+			TIMED_BLOCK("MixAudioStream");
+			EnterCriticalSection(&Audio->GameCodeLock);
+			MixAudioStream(&Audio->Stream, Audio->Game->GetSoundSamples, Audio->GameMemory);
+			LeaveCriticalSection(&Audio->GameCodeLock);
+		}
+
+		//Back as soon as the device thread takes some, and after a block's worth of time regardless
+		WaitForSingleObjectEx(Audio->MixerWake, BlockMS, FALSE);
+	}
+}
+
+/*
+	Keeps DirectSound written just far enough past its write cursor, out of the stream - audio_sync works out how far
+	from the cursors it sees. It only wakes every millisecond or so and writes what the cursors moved, so no one
+	frame's worth is ever locked. Losing the cursors starts the sync over from wherever they are next seen.
+*/
+DWORD WINAPI
+Win32AudioDeviceThreadProc(LPVOID lpParameter)
+{
+	win32_audio* Audio = (win32_audio*)lpParameter;
+	win32_sound_output* SoundOutput = Audio->Output;
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+	DEBUG_THREAD_NAME("Audio device");
+	for (;;)
+	{
+		Sleep(1);
+
+		TIMED_BLOCK("FeedSoundCard");
+		DWORD PlayCursor, WriteCursor;
+		if (SecondaryBuffer->GetCurrentPosition(&PlayCursor, &WriteCursor) != DS_OK)
+		{
+			ResetAudioSync(&Audio->Sync);
+			continue;
+		}
+
+		//Split so the multiply can't overflow however long the machine has been up
+		LARGE_INTEGER Counter;
+		QueryPerformanceCounter(&Counter);
+		uint64_t Now = (uint64_t)(Counter.QuadPart / Frequency.QuadPart)*1000000000ULL +
+			(uint64_t)(Counter.QuadPart % Frequency.QuadPart)*1000000000ULL / (uint64_t)Frequency.QuadPart;
+
+		audio_sync_write Write = UpdateAudioSync(&Audio->Sync, Now, PlayCursor, WriteCursor);
+		if (Write.BytesToWrite)
+		{
+			game_sound_buffer SoundBuffer = {};
+			SoundBuffer.SamplesPerSecond = SoundOutput->SamplesPerSecond;
+			SoundBuffer.SampleCount = Write.BytesToWrite / SoundOutput->BytesPerSample;
+			SoundBuffer.Samples = Audio->Samples;
+			PlayAudioStream(&Audio->Stream, SoundBuffer.Samples, SoundBuffer.SampleCount);
+			ReleaseSemaphore(Audio->MixerWake, 1, 0);
+			Win32FillSoundBuffer(SoundOutput, Write.ByteToLock, Write.BytesToWrite, &SoundBuffer);
+		}
+	}
+}
+
+internal void
+Win32StartAudio(win32_audio* Audio)
+{
+	InitializeCriticalSection(&Audio->GameCodeLock);
+	Audio->MixerWake = CreateSemaphoreEx(0, 0, 1, 0, 0, SEMAPHORE_ALL_ACCESS);
+
+	DWORD ThreadID;
+	HANDLE MixerThread = CreateThread(0, 0, Win32MixerThreadProc, Audio, 0, &ThreadID);
+	SetThreadPriority(MixerThread, THREAD_PRIORITY_HIGHEST);
+	CloseHandle(MixerThread);
+
+	//The device thread is the one with a deadline, so it goes above everything else in the process
+	HANDLE DeviceThread = CreateThread(0, 0, Win32AudioDeviceThreadProc, Audio, 0, &ThreadID);
+	SetThreadPriority(DeviceThread, THREAD_PRIORITY_TIME_CRITICAL);
+	CloseHandle(DeviceThread);
+}
+
+//Holds the mixer out of game code and game memory - around a reload, and around anything that saves or restores game memory
+internal void
+Win32LockAudio()
+{
+	EnterCriticalSection(&GlobalAudio.GameCodeLock);
+}
+
+internal void
+Win32UnlockAudio()
+{
+	LeaveCriticalSection(&GlobalAudio.GameCodeLock);
+}
+
 #if 0
 internal void
 Win32DebugDrawVertical(win32_offscreen_buffer* Backbuffer, int X, int Top, int Bottom, uint32_t Color)
@@ -452,6 +716,19 @@ internal win32_replay_buffer* Win32GetReplayBuffer(win32_state* Win32State, int
 	return(ReplayBuffer);
 }
 
+internal PLATFORM_COMPLETE_ALL_WORK(Win32CompleteAllWork);
+
+//Snapshot cost should track pages written since the last one, not the size of the reservation
+internal void
+Win32ReportSnapshot(char* Operation, platform_snapshot_stats Stats, uint64_t Cycles)
+{
+	char Message[256];
+	sprintf_s(Message, "%s: %u pages (%lluKB) copied, %u chunks committed, %u decommitted, %lluKB committed of %lluKB reserved, %.02f Mcycles\n",
+		Operation, Stats.PagesCopied, Stats.BytesCopied / 1024, Stats.ChunksCommitted, Stats.ChunksDecommitted,
+		GlobalGameMemory.CommittedSize / 1024, GlobalGameMemory.ReservedSize / 1024, (float)Cycles / (1000.0f * 1000.0f));
+	OutputDebugString(Message);
+}
+
 internal void
 Win32BeginRecordingInput(win32_state* Win32State, int input_recording_index)
 {
@@ -463,12 +740,21 @@ Win32BeginRecordingInput(win32_state* Win32State, int input_recording_index)
 		char Filename[MAX_PATH];
 		Win32GetInputFileLocation(Win32State, true, input_recording_index, sizeof(Filename), Filename);
 		Win32State->RecordingHandle = CreateFileA(Filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
-#if 0
-		LARGE_INTEGER FilePosition;
-		FilePosition.QuadPart = Win32State->TotalSize;
-		SetFilePointerEx(Win32State->RecordingHandle, FilePosition, 0, FILE_BEGIN);
-#endif
-		CopyMemory(ReplayBuffer->MemoryBlock, Win32State->GameMemoryBlock, Win32State->TotalSize);
+
+		DWORD BytesWritten;
+		input_stream_header Header = BeginInputStream(&Win32State->InputWriter);
+		WriteFile(Win32State->RecordingHandle, &Header, sizeof(Header), &BytesWritten, 0);
+		if (Win32State->StateRing)
+		{
+			ResetStateRing(Win32State->StateRing);
+		}
+
+		Win32CompleteAllWork(Win32State->LowPriorityQueue);
+		Win32LockAudio();
+		uint64_t StartCycles = __rdtsc();
+		platform_snapshot_stats Stats = SavePlatformMemory(&GlobalGameMemory, &ReplayBuffer->Snapshot);
+		Win32UnlockAudio();
+		Win32ReportSnapshot("Snapshot", Stats, __rdtsc() - StartCycles);
 	}
 }
 
@@ -481,19 +767,38 @@ Win32BeginInputPlayback(win32_state* Win32State, int input_playing_index)
 		Win32State->InputPlayingIndex = input_playing_index;
 		char Filename[MAX_PATH];
 		Win32GetInputFileLocation(Win32State, true, input_playing_index, sizeof(Filename), Filename); 
-		Win32State->PlaybackHandle = CreateFileA(Filename, GENERIC_READ, 0, 0, OPEN_EXISTING, 0, 0);
-#if 0		
-		LARGE_INTEGER FilePosition;
-		FilePosition.QuadPart = Win32State->TotalSize;
-		SetFilePointerEx(Win32State->PlaybackHandle, FilePosition, 0, FILE_BEGIN);
-#endif	
-		CopyMemory(Win32State->GameMemoryBlock, ReplayBuffer->MemoryBlock, Win32State->TotalSize);
+		Win32State->PlaybackMapping = Win32MapReadOnlyFile(Filename);
+		if (!OpenInputStream(&Win32State->InputReader, Win32State->PlaybackMapping.Memory, Win32State->PlaybackMapping.Size))
+		{
+			//Missing, or recorded by a build with a different game_input_buffer
+			Win32UnmapFile(&Win32State->PlaybackMapping);
+			Win32State->InputPlayingIndex = 0;
+			return;
+		}
+
+		Win32CompleteAllWork(Win32State->LowPriorityQueue);
+		Win32LockAudio();
+		uint64_t StartCycles = __rdtsc();
+		platform_snapshot_stats Stats = RestorePlatformMemory(&GlobalGameMemory, &ReplayBuffer->Snapshot);
+		Win32UnlockAudio();
+		Win32State->BackbufferIsStale = true;
+		Win32ReportSnapshot("Restore", Stats, __rdtsc() - StartCycles);
 	}
 }
 
 internal void
 Win32EndRecordingInput(win32_state* Win32State)
 {
+	//Index at the end, then the real header over the placeholder
+	DWORD BytesWritten;
+	input_stream_header Header = EndInputStream(&Win32State->InputWriter);
+	WriteFile(Win32State->RecordingHandle, Win32State->InputWriter.Index,
+		Header.IndexCount*sizeof(input_stream_index_entry), &BytesWritten, 0);
+
+	LARGE_INTEGER FilePosition = {};
+	SetFilePointerEx(Win32State->RecordingHandle, FilePosition, 0, FILE_BEGIN);
+	WriteFile(Win32State->RecordingHandle, &Header, sizeof(Header), &BytesWritten, 0);
+
 	CloseHandle(Win32State->RecordingHandle);
 	Win32State->InputRecordingIndex = 0;
 }
@@ -501,31 +806,119 @@ Win32EndRecordingInput(win32_state* Win32State)
 internal void
 Win32EndInputPlayback(win32_state* Win32State)
 {
-	CloseHandle(Win32State->PlaybackHandle);
+	Win32UnmapFile(&Win32State->PlaybackMapping);
 	Win32State->InputPlayingIndex = 0;
 }
 
 internal void
 Win32RecordInput(win32_state* Win32State, game_input_buffer* NewInput)
 {
+	//Keyframe the state this input is about to be applied to, so playback can seek straight here
+	state_ring* StateRing = Win32State->StateRing;
+	uint32_t FrameIndex = Win32State->InputWriter.FrameCount;
+	if (StateRing && ((FrameIndex % StateRing->KeyframeInterval) == 0))
+	{
+		Win32CompleteAllWork(Win32State->LowPriorityQueue);
+		Win32LockAudio();
+		platform_snapshot_stats Stats;
+		bool32 Captured = CaptureStateKeyframe(StateRing, FrameIndex, &Stats);
+		Win32UnlockAudio();
+		if (!Captured)
+		{
+			OutputDebugString("State ring: keyframe does not fit in the budget\n");
+		}
+	}
+
+	uint8_t Encoded[INPUT_STREAM_MAX_FRAME_SIZE];
+	uint32_t EncodedSize = EncodeInputFrame(&Win32State->InputWriter, NewInput, Encoded);
+
 	DWORD BytesWritten;
-	WriteFile(Win32State->RecordingHandle, NewInput, sizeof(*NewInput), &BytesWritten, 0);
+	WriteFile(Win32State->RecordingHandle, Encoded, EncodedSize, &BytesWritten, 0);
 }
 
 internal void
 Win32PlaybackInput(win32_state* Win32State, game_input_buffer* NewInput)
 {
-	DWORD BytesRead;
-	if (ReadFile(Win32State->PlaybackHandle, NewInput, sizeof(*NewInput), &BytesRead, 0))
+	if (!DecodeNextInputFrame(&Win32State->InputReader, NewInput))
 	{
-		if (BytesRead == 0)
+		int playing_index = Win32State->InputPlayingIndex;
+		Win32EndInputPlayback(Win32State);
+		Win32BeginInputPlayback(Win32State, playing_index);
+		if (Win32State->InputPlayingIndex)
 		{
-			int playing_index = Win32State->InputPlayingIndex;
-			Win32EndInputPlayback(Win32State);
-			Win32BeginInputPlayback(Win32State, playing_index);
-			ReadFile(Win32State->PlaybackHandle, NewInput, sizeof(*NewInput), &BytesRead, 0);
+			DecodeNextInputFrame(&Win32State->InputReader, NewInput);
 		}
-	}		
+	}
+}
+
+/*
+	Jumps playback to TargetFrame: restores the newest keyframe at or before it (or the recording's start
+	snapshot when the ring has none that early), then runs the game forward on the recorded input.
+	Playing forward from where playback already is skips the restore when that is no further.
+*/
+internal void
+Win32SeekInputPlayback(win32_state* Win32State, win32_game_code* Game, game_memory* GameMemory,
+	game_offscreen_buffer* Buffer, uint32_t TargetFrame)
+{
+	input_stream_reader* Reader = &Win32State->InputReader;
+	uint32_t FrameCount = Reader->Header->FrameCount;
+	if (FrameCount == 0)
+	{
+		//Cut short while recording - no count, so nowhere to seek to
+		return;
+	}
+	TargetFrame = (TargetFrame < FrameCount) ? TargetFrame : FrameCount - 1;
+
+	uint64_t StartCycles = __rdtsc();
+	Win32CompleteAllWork(Win32State->LowPriorityQueue);
+	Win32LockAudio();
+
+	state_ring* StateRing = Win32State->StateRing;
+	int32_t KeyframeIndex = StateRing ? FindKeyframe(StateRing, TargetFrame) : -1;
+	uint32_t RestoreFrame = (KeyframeIndex >= 0) ? GetKeyframe(StateRing, KeyframeIndex)->FrameIndex : 0;
+	uint32_t StartFrame = Reader->FrameIndex;
+	bool32 Restored = false;
+	if ((StartFrame > TargetFrame) || (StartFrame < RestoreFrame))
+	{
+		platform_snapshot_stats Stats;
+		if (KeyframeIndex >= 0)
+		{
+			Stats = RestoreStateKeyframe(StateRing, KeyframeIndex);
+		}
+		else
+		{
+			Stats = RestorePlatformMemory(&GlobalGameMemory, &Win32GetReplayBuffer(Win32State, Win32State->InputPlayingIndex)->Snapshot);
+		}
+		SeekInputStream(Reader, RestoreFrame);
+		StartFrame = RestoreFrame;
+		Restored = true;
+		Win32ReportSnapshot("Seek restore", Stats, __rdtsc() - StartCycles);
+	}
+
+	//The same updates playback would have run, just not presented - sound is not part of replay anyway,
+	//and the mixer stays locked out until the game has caught up
+	game_input_buffer Input;
+	while ((Reader->FrameIndex < TargetFrame) && DecodeNextInputFrame(Reader, &Input))
+	{
+		//Only the first frame after a restore has to repaint - the ones after it follow on from its pixels
+		Buffer->Dirty = {};
+		Buffer->Dirty.FullFrame = Restored;
+		Restored = false;
+		if (Game->UpdateAndRender)
+		{
+			Game->UpdateAndRender(GameMemory, Buffer, &Input);
+		}
+	}
+	Win32UnlockAudio();
+
+	//Whatever those frames drew never reached the window, and a restore with nothing replayed still left the
+	//backbuffer ahead of the state
+	Win32State->BackbufferIsStale = true;
+
+	char Message[256];
+	sprintf_s(Message, "Seek to frame %u: from frame %u, %u frames replayed, %.02f Mcycles\n",
+		TargetFrame, StartFrame, Reader->FrameIndex - StartFrame, (float)(__rdtsc() - StartCycles) / (1000.0f * 1000.0f));
+	OutputDebugString(Message);
 }
 
 internal void
@@ -597,6 +990,31 @@ Win32ProcessPendingMessages(game_controller_input* KeyboardController, win32_sta
 								Win32EndInputPlayback(Win32State);
 						}
 					}
+					else if (((VKCode == VK_OEM_4) || (VKCode == VK_OEM_6)) && Win32State->InputPlayingIndex)
+					{
+						//[ and ] scrub playback back and forward; the seek itself happens in the frame loop
+						if (IsDown)
+						{
+							uint32_t FromFrame = Win32State->PlaybackSeekPending ?
+								Win32State->PlaybackSeekFrame : Win32State->InputReader.FrameIndex;
+							if (VKCode == VK_OEM_4)
+							{
+								Win32State->PlaybackSeekFrame = (FromFrame > WIN32_SCRUB_FRAMES) ? FromFrame - WIN32_SCRUB_FRAMES : 0;
+							}
+							else
+							{
+								Win32State->PlaybackSeekFrame = FromFrame + WIN32_SCRUB_FRAMES;
+							}
+							Win32State->PlaybackSeekPending = true;
+						}
+					}
+					else if (VKCode == 'M')
+					{
+						if (IsDown)
+						{
+							Win32State->StatsRequested = true;
+						}
+					}
 					else if (VKCode == 'P')
 					{
 						if(IsDown)
@@ -646,7 +1064,7 @@ LRESULT CALLBACK MainWindowCallback(HWND Window, UINT Message, WPARAM WParam, LP
 			HDC DeviceContext = BeginPaint(Window, &Paint);
 			RECT ClientRect;
 			GetClientRect(Window, &ClientRect);
-			Win32CopyBufferToWindow(&GlobalBackbuffer, DeviceContext, ClientRect);
+			Win32CopyBufferToWindow(&GlobalBackbuffer, DeviceContext, ClientRect, 0);
 			EndPaint(Window, &Paint);
 		}break;
 		default:
@@ -659,6 +1077,96 @@ LRESULT CALLBACK MainWindowCallback(HWND Window, UINT Message, WPARAM WParam, LP
 }
 
 
+internal
+PLATFORM_ADD_ENTRY(Win32AddEntry)
+{
+	uint32_t NewNextEntryToWrite = (Queue->NextEntryToWrite + 1) % ArrayCount(Queue->Entries);
+	Assert(NewNextEntryToWrite != Queue->NextEntryToRead);
+	platform_work_queue_entry* Entry = &Queue->Entries[Queue->NextEntryToWrite];
+	Entry->Callback = Callback;
+	Entry->Data = Data;
+	++Queue->CompletionGoal;
+
+	//The entry has to be visible before the index that publishes it
+	_WriteBarrier();
+	Queue->NextEntryToWrite = NewNextEntryToWrite;
+	ReleaseSemaphore(Queue->SemaphoreHandle, 1, 0);
+}
+
+//Returns true when the queue was empty and the caller can go to sleep
+internal bool
+Win32DoNextWorkQueueEntry(platform_work_queue* Queue)
+{
+	bool ShouldSleep = false;
+
+	uint32_t OriginalNextEntryToRead = Queue->NextEntryToRead;
+	uint32_t NewNextEntryToRead = (OriginalNextEntryToRead + 1) % ArrayCount(Queue->Entries);
+	if (OriginalNextEntryToRead != Queue->NextEntryToWrite)
+	{
+		uint32_t Index = InterlockedCompareExchange((LONG volatile*)&Queue->NextEntryToRead,
+			NewNextEntryToRead, OriginalNextEntryToRead);
+		if (Index == OriginalNextEntryToRead)
+		{
+			platform_work_queue_entry Entry = Queue->Entries[Index];
+			Entry.Callback(Queue, Entry.Data);
+			InterlockedIncrement((LONG volatile*)&Queue->CompletionCount);
+		}
+	}
+	else
+	{
+		ShouldSleep = true;
+	}
+
+	return(ShouldSleep);
+}
+
+internal
+PLATFORM_COMPLETE_ALL_WORK(Win32CompleteAllWork)
+{
+	while (Queue->CompletionGoal != Queue->CompletionCount)
+	{
+		Win32DoNextWorkQueueEntry(Queue);
+	}
+
+	Queue->CompletionGoal = 0;
+	Queue->CompletionCount = 0;
+}
+
+DWORD WINAPI
+WorkerThreadProc(LPVOID lpParameter)
+{
+	platform_work_queue* Queue = (platform_work_queue*)lpParameter;
+	DEBUG_THREAD_NAME("Worker");
+	for (;;)
+	{
+		if (Win32DoNextWorkQueueEntry(Queue))
+		{
+			WaitForSingleObjectEx(Queue->SemaphoreHandle, INFINITE, FALSE);
+		}
+	}
+}
+
+//One worker per logical core besides the main thread, which also chews through entries while it waits
+internal void
+Win32MakeQueue(platform_work_queue* Queue, uint32_t ThreadCount)
+{
+	Queue->CompletionGoal = 0;
+	Queue->CompletionCount = 0;
+	Queue->NextEntryToWrite = 0;
+	Queue->NextEntryToRead = 0;
+
+	uint32_t InitialCount = 0;
+	uint32_t MaximumCount = ThreadCount ? ThreadCount : 1;
+	Queue->SemaphoreHandle = CreateSemaphoreEx(0, InitialCount, MaximumCount, 0, 0, SEMAPHORE_ALL_ACCESS);
+
+	for (uint32_t ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex++)
+	{
+		DWORD ThreadID;
+		HANDLE ThreadHandle = CreateThread(0, 0, WorkerThreadProc, Queue, 0, &ThreadID);
+		CloseHandle(ThreadHandle);
+	}
+}
+
 global_variable int64_t PerfCountFrequency;
 inline float 
 Win32GetSecondsElapsed(LARGE_INTEGER Start, LARGE_INTEGER End)
@@ -675,6 +1183,178 @@ Win32GetWallClock()
 	return Result;
 }
 
+//
+// Frame pacing
+//
+
+//Older SDKs don't have it; older Windows refuses it, and the ordinary timer takes over
+#if !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+//Split so the multiply can't overflow however long the machine has been up
+inline uint64_t
+Win32GetNanoseconds(LARGE_INTEGER Counter)
+{
+	uint64_t Seconds = (uint64_t)(Counter.QuadPart / PerfCountFrequency);
+	uint64_t Remainder = (uint64_t)(Counter.QuadPart % PerfCountFrequency);
+	return(Seconds*1000000000ULL + Remainder*1000000000ULL / (uint64_t)PerfCountFrequency);
+}
+
+internal FRAME_PACER_GET_TIME(Win32GetPacerTime)
+{
+	return(Win32GetNanoseconds(Win32GetWallClock()));
+}
+
+internal FRAME_PACER_SLEEP_UNTIL(Win32PacerSleepUntil)
+{
+	win32_frame_timer* FrameTimer = (win32_frame_timer*)Context;
+	uint64_t Now = Win32GetNanoseconds(Win32GetWallClock());
+	if (Deadline <= Now)
+	{
+		return;
+	}
+
+	//A negative due time is relative, in 100ns units
+	LARGE_INTEGER DueTime;
+	DueTime.QuadPart = -(int64_t)((Deadline - Now) / 100);
+	if (FrameTimer->Timer && SetWaitableTimer(FrameTimer->Timer, &DueTime, 0, 0, 0, FALSE))
+	{
+		WaitForSingleObject(FrameTimer->Timer, INFINITE);
+	}
+	else
+	{
+		Sleep((DWORD)((Deadline - Now) / 1000000));
+	}
+}
+
+//Charged a scheduler tick at a time, so it only adds up right over many frames
+internal FRAME_PACER_GET_TIME(Win32GetThreadCPUTime)
+{
+	FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+	if (!GetThreadTimes(GetCurrentThread(), &CreationTime, &ExitTime, &KernelTime, &UserTime))
+	{
+		return(0);
+	}
+	uint64_t Kernel = ((uint64_t)KernelTime.dwHighDateTime << 32) | KernelTime.dwLowDateTime;
+	uint64_t User = ((uint64_t)UserTime.dwHighDateTime << 32) | UserTime.dwLowDateTime;
+	return((Kernel + User)*100);
+}
+
+//
+// Hot reload
+//
+
+//Long enough for the linker between writes to have moved on, short enough not to be noticed
+#define WIN32_RELOAD_SETTLE_MS 50
+
+//A build in progress holds the lock file; a DLL written any other way has to have stopped changing
+internal bool32
+Win32IsDLLReady(win32_game_code_watcher* Watcher, FILETIME* WriteTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA Before;
+	if ((GetFileAttributesA(Watcher->LockFileName) != INVALID_FILE_ATTRIBUTES) ||
+		!GetFileAttributesExA(Watcher->SourceDLLName, GetFileExInfoStandard, &Before) ||
+		(CompareFileTime(&Before.ftLastWriteTime, &Watcher->LoadedWriteTime) == 0))
+	{
+		return(false);
+	}
+
+	Sleep(WIN32_RELOAD_SETTLE_MS);
+	WIN32_FILE_ATTRIBUTE_DATA After;
+	bool32 Result = (GetFileAttributesA(Watcher->LockFileName) == INVALID_FILE_ATTRIBUTES) &&
+		GetFileAttributesExA(Watcher->SourceDLLName, GetFileExInfoStandard, &After) &&
+		(After.nFileSizeLow || After.nFileSizeHigh) &&
+		(After.nFileSizeLow == Before.nFileSizeLow) && (After.nFileSizeHigh == Before.nFileSizeHigh) &&
+		(CompareFileTime(&After.ftLastWriteTime, &Before.ftLastWriteTime) == 0);
+	*WriteTime = After.ftLastWriteTime;
+	return(Result);
+}
+
+//Whatever the changes were, the DLL on disk decides - anything not ready yet sends more changes when it is
+DWORD WINAPI
+Win32GameCodeWatcherThreadProc(LPVOID lpParameter)
+{
+	win32_game_code_watcher* Watcher = (win32_game_code_watcher*)lpParameter;
+	DEBUG_THREAD_NAME("Game code watcher");
+	HANDLE Directory = CreateFileA(Watcher->DirectoryName, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		0, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, 0);
+	if (Directory == INVALID_HANDLE_VALUE)
+	{
+		OutputDebugString("Can't watch the executable's directory, so the game won't reload\n");
+		return(0);
+	}
+
+	DWORD Changes[1024];
+	DWORD BytesReturned;
+	while (ReadDirectoryChangesW(Directory, Changes, sizeof(Changes), FALSE,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, &BytesReturned, 0, 0))
+	{
+		FILETIME WriteTime;
+		if (!Win32IsDLLReady(Watcher, &WriteTime))
+		{
+			continue;
+		}
+
+		//The main loop takes the last one at its next frame
+		while (Watcher->IsPending)
+		{
+			Sleep(1);
+		}
+		CompletePreviousReadsBeforeFutureReads;
+		Win32UnloadGameCode(&Watcher->Retired);
+
+		LARGE_INTEGER LoadStart = Win32GetWallClock();
+		win32_game_code Code = Win32LoadGameCode(Watcher->SourceDLLName, Watcher->TempDLLNames[Watcher->NextTempIndex]);
+		Watcher->LoadSeconds = Win32GetSecondsElapsed(LoadStart, Win32GetWallClock());
+		Watcher->LoadedWriteTime = WriteTime;
+		if (Code.IsValid)
+		{
+			Watcher->NextTempIndex ^= 1;
+			Watcher->Pending = Code;
+			CompletePreviousWritesBeforeFutureWrites;
+			Watcher->IsPending = 1;
+		}
+		else
+		{
+			Win32UnloadGameCode(&Code);
+		}
+	}
+
+	CloseHandle(Directory);
+	return(0);
+}
+
+internal void
+Win32StartGameCodeWatcher(win32_game_code_watcher* Watcher, win32_game_code* Loaded)
+{
+	Watcher->LoadedWriteTime = Loaded->DLLLastWriteTime;
+	DWORD ThreadID;
+	HANDLE Thread = CreateThread(0, 0, Win32GameCodeWatcherThreadProc, Watcher, 0, &ThreadID);
+	CloseHandle(Thread);
+}
+
+#if BABL_PROFILE
+//Everything still in the debug rings, for chrome://tracing or Perfetto
+internal void
+Win32WriteDebugTrace(char* Filename)
+{
+	FILE* File = 0;
+	if (!GlobalDebugTable || (fopen_s(&File, Filename, "wb") != 0))
+	{
+		OutputDebugString("Couldn't write the trace\n");
+		return;
+	}
+	debug_trace_stats Stats = WriteChromeTrace(GlobalDebugTable, File, Win32GetNanoseconds(Win32GetWallClock()));
+	fclose(File);
+
+	char Buffer[MAX_PATH + 128];
+	sprintf_s(Buffer, "Trace: %llu blocks from %u threads in %s; %llu events overwritten, %llu unpaired\n",
+		Stats.BlockCount, Stats.ThreadCount, Filename, Stats.OverwrittenEventCount, Stats.UnpairedEventCount);
+	OutputDebugString(Buffer);
+}
+#endif
+
 int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLine, int ShowCode)
 {
 	win32_state Win32State = {};
@@ -686,8 +1366,19 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 	char SourceGameCodeDLLFullPath[MAX_PATH];
 	Win32BuildExePathFilename(&Win32State, "babl.dll", sizeof(SourceGameCodeDLLFullPath), SourceGameCodeDLLFullPath);
 	
-	char TempGameCodeDLLFullPath[MAX_PATH];
-	Win32BuildExePathFilename(&Win32State, "babl_temp.dll", sizeof(TempGameCodeDLLFullPath), TempGameCodeDLLFullPath);
+	char LockFileFullPath[MAX_PATH];
+	Win32BuildExePathFilename(&Win32State, "lock.tmp", sizeof(LockFileFullPath), LockFileFullPath);
+
+	char EXEDirectory[MAX_PATH];
+	Win32BuildExePathFilename(&Win32State, "", sizeof(EXEDirectory), EXEDirectory);
+
+	//Two temp copies, since the one that is loaded can't be copied over
+	static win32_game_code_watcher Watcher;
+	Watcher.SourceDLLName = SourceGameCodeDLLFullPath;
+	Watcher.LockFileName = LockFileFullPath;
+	Watcher.DirectoryName = EXEDirectory;
+	Win32BuildExePathFilename(&Win32State, "babl_temp_0.dll", sizeof(Watcher.TempDLLNames[0]), Watcher.TempDLLNames[0]);
+	Win32BuildExePathFilename(&Win32State, "babl_temp_1.dll", sizeof(Watcher.TempDLLNames[1]), Watcher.TempDLLNames[1]);
 
 	WNDCLASS WindowClass = {};
 	WindowClass.style = CS_HREDRAW | CS_VREDRAW;
@@ -696,12 +1387,34 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 	WindowClass.lpszClassName = "BablClass";
 
 	Win32LoadXInput();
-	
+
 	LARGE_INTEGER PerfCountFrequencyResult;
 	QueryPerformanceFrequency(&PerfCountFrequencyResult);
 	PerfCountFrequency = PerfCountFrequencyResult.QuadPart;
 
+#if BABL_PROFILE
+	//Before any thread starts, so every one of them finds it. It stays out of game memory, which the state ring
+	//snapshots and restores wholesale while the audio threads keep recording
+	uint64_t DebugStorageSize = Megabytes(64);
+	void* DebugStorage = VirtualAlloc(0, DebugStorageSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	GlobalDebugTable = InitializeDebugTable(DebugStorage, DebugStorageSize, Win32GetNanoseconds(Win32GetWallClock()));
+	DEBUG_THREAD_NAME("Main");
+#endif
+
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	uint32_t RenderThreadCount = (SystemInfo.dwNumberOfProcessors > 1) ? SystemInfo.dwNumberOfProcessors - 1 : 0;
+	platform_work_queue RenderQueue = {};
+	Win32MakeQueue(&RenderQueue, RenderThreadCount);
+
+	//Asset loads are mostly waiting on the disk, so a couple of threads is plenty and they stay off the render workers
+	platform_work_queue LowPriorityQueue = {};
+	Win32MakeQueue(&LowPriorityQueue, 2);
+
 	int64_t LastCycleCount = __rdtsc();
+
+	//Starts due, so the first frame prints them
+	uint32_t FramesSinceStats = WIN32_STATS_FRAMES;
 	if (RegisterClassA(&WindowClass))
 	{
 		HWND Window =
@@ -714,17 +1427,22 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 				MonitorRefreshHz = 60;
 			float GameUpdateHz = MonitorRefreshHz / 2.0f;
 
-			DWORD MinimumAudioLatencyBytes = 0;
-			float AudioLatencySeconds = 0;
 			float TargetSecondsPerFrame = 1.0f / GameUpdateHz;
 			UINT DesiredSchedulerMS = 1;
-			bool SleepIsGranular = timeBeginPeriod(DesiredSchedulerMS) == TIMERR_NOERROR;
+			timeBeginPeriod(DesiredSchedulerMS);
+
+			win32_frame_timer FrameTimer = {};
+			FrameTimer.Timer = CreateWaitableTimerExW(0, 0, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+			FrameTimer.IsHighResolution = (FrameTimer.Timer != 0);
+			if (!FrameTimer.Timer)
+			{
+				FrameTimer.Timer = CreateWaitableTimerExW(0, 0, 0, TIMER_ALL_ACCESS);
+			}
 
 			win32_sound_output SoundOutput = {};
 			SoundOutput.SamplesPerSecond = 48000;
 			SoundOutput.BytesPerSample = sizeof(int16_t) * 2;
 			SoundOutput.SecondaryBufferSize = SoundOutput.SamplesPerSecond * SoundOutput.BytesPerSample;
-			SoundOutput.SafetyBytes = (int)((float)SoundOutput.BytesPerSample * (float)SoundOutput.SamplesPerSecond / GameUpdateHz / 2.0f);
 			
 			Win32InitDSound(Window, SoundOutput.SecondaryBufferSize, SoundOutput.SamplesPerSecond);
 			
@@ -762,8 +1480,14 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 			GameMemory.PermanentStorageSize = Megabytes(64);
 			GameMemory.TransientStorageSize = Gigabytes(1);
 			
+			//Reserve the lot, commit only as the game's arenas grow, and never more than the ceiling
+			uint64_t CommitCeiling = Megabytes(512);
 			Win32State.TotalSize = GameMemory.PermanentStorageSize + GameMemory.TransientStorageSize;
-			Win32State.GameMemoryBlock = VirtualAlloc(BaseAddress, Win32State.TotalSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE); //| MEM_LARGE_PAGES larger page sizes reduces cache misses on translation lookaside buffer
+			if (ReservePlatformMemory(&GlobalGameMemory, BaseAddress, Win32State.TotalSize, CommitCeiling))
+			{
+				Win32State.GameMemoryBlock = GlobalGameMemory.Base;
+			}
+			GameMemory.PlatformCommitMemory = Win32CommitMemory;
 			
 			GameMemory.PermanentStorage = Win32State.GameMemoryBlock;
 			GameMemory.TransientStorage = ((uint8_t*)GameMemory.PermanentStorage + GameMemory.PermanentStorageSize);
@@ -784,10 +1508,30 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 				ReplayBuffer->MemoryBlock = MapViewOfFile(ReplayBuffer->MemoryMap, FILE_MAP_ALL_ACCESS, 0, 0, Win32State.TotalSize);
 				if(ReplayBuffer->MemoryBlock)
 				{
-					 
+					AddPlatformMemorySnapshot(&GlobalGameMemory, &ReplayBuffer->Snapshot, ReplayBuffer->MemoryBlock);
 				}
 			}
 
+			//Without the ring, seeking falls back to replaying from the start of the recording
+			if (Win32State.GameMemoryBlock &&
+				InitializeStateRing(&GlobalStateRing, &GlobalGameMemory, WIN32_STATE_RING_BUDGET, WIN32_KEYFRAME_INTERVAL))
+			{
+				Win32State.StateRing = &GlobalStateRing;
+			}
+
+			GameMemory.DebugTable = GlobalDebugTable;
+			GameMemory.RenderQueue = &RenderQueue;
+			GameMemory.LowPriorityQueue = &LowPriorityQueue;
+			Win32State.LowPriorityQueue = &LowPriorityQueue;
+			GameMemory.PlatformAddEntry = Win32AddEntry;
+			GameMemory.PlatformCompleteAllWork = Win32CompleteAllWork;
+			GameMemory.PlatformMapReadOnlyFile = Win32MapReadOnlyFile;
+			GameMemory.PlatformUnmapFile = Win32UnmapFile;
+			GameMemory.PlatformGetFileStamp = Win32GetFileStamp;
+			GameMemory.PlatformOpenFile = Win32OpenFile;
+			GameMemory.PlatformReadDataFromFile = Win32ReadDataFromFile;
+			GameMemory.PlatformCloseFile = Win32CloseFile;
+
 			GameMemory.DEBUGPlatformReadEntireFile = DEBUGPlatformReadEntireFile;
 			GameMemory.DEBUGPlatformWriteEntireFile = DEBUGPlatformWriteEntireFile;
 			GameMemory.DEBUGPlatformFreeFileMemory = DEBUGPlatformFreeFileMemory;
@@ -807,22 +1551,52 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 				Running = true;
 
 				LARGE_INTEGER BeginCounter = Win32GetWallClock();
-
-				bool SoundIsValid = false;
-				DWORD LastPlayCursor = 0;
-				DWORD LastWriteCursor = 0;
-				DWORD DEBUGLastPlayCursorIndex = 0;
-				DWORD DEBUGLastPlayCursor[15] = {0};
-
-				win32_game_code Game = Win32LoadGameCode(SourceGameCodeDLLFullPath, TempGameCodeDLLFullPath);
+				frame_pacer Pacer;
+				InitializeFramePacer(&Pacer, (uint64_t)(1e9f*TargetSecondsPerFrame), Win32GetNanoseconds(BeginCounter));
+				frame_pacer_clock PacerClock = {&FrameTimer, Win32GetPacerTime, Win32PacerSleepUntil, Win32GetThreadCPUTime};
+
+				win32_game_code Game = Win32LoadGameCode(SourceGameCodeDLLFullPath, Watcher.TempDLLNames[0]);
+				Watcher.NextTempIndex = 1;
+				Win32StartGameCodeWatcher(&Watcher, &Game);
+
+				//The mixer no longer waits on frames, so a frame's worth queued is plenty to ride out the scheduler
+				static audio_stream_block AudioBlocks[16];
+				uint32_t AudioBlockCount = (uint32_t)ArrayCount(AudioBlocks);
+				uint32_t TargetBlocks = (uint32_t)((float)SoundOutput.SamplesPerSecond / GameUpdateHz / AUDIO_STREAM_BLOCK_SAMPLES) + 1;
+				TargetBlocks = (TargetBlocks < AudioBlockCount) ? TargetBlocks : AudioBlockCount - 1;
+				InitializeAudioStream(&GlobalAudio.Stream, AudioBlocks, AudioBlockCount, TargetBlocks, SoundOutput.SamplesPerSecond);
+				GlobalAudio.Output = &SoundOutput;
+				GlobalAudio.Samples = Samples;
+				InitializeAudioSync(&GlobalAudio.Sync, SoundOutput.SecondaryBufferSize, SoundOutput.BytesPerSample,
+					SoundOutput.SamplesPerSecond);
+				GlobalAudio.Game = &Game;
+				GlobalAudio.GameMemory = &GameMemory;
+				Win32StartAudio(&GlobalAudio);
 				
 				while (Running)
 				{
-					FILETIME NewDLLWriteTime = Win32GetLastWriteTime(SourceGameCodeDLLFullPath);
-					if (CompareFileTime(&NewDLLWriteTime, &Game.DLLLastWriteTime) != 0)
+					TIMED_BLOCK("Frame");
+
+					//The watcher has already loaded it, and frees the old one later
+					if (Watcher.IsPending)
 					{
-						Win32UnloadGameCode(&Game);
-						Game = Win32LoadGameCode(SourceGameCodeDLLFullPath, TempGameCodeDLLFullPath);
+						TIMED_BLOCK("SwapGameCode");
+						CompletePreviousReadsBeforeFutureReads;
+						LARGE_INTEGER SwapStart = Win32GetWallClock();
+
+						//Queued asset loads point at code in the old DLL, and so might the mixer be
+						Win32CompleteAllWork(&LowPriorityQueue);
+						Win32LockAudio();
+						Watcher.Retired = Game;
+						Game = Watcher.Pending;
+						Win32UnlockAudio();
+						CompletePreviousWritesBeforeFutureWrites;
+						Watcher.IsPending = 0;
+
+						char ReloadBuffer[256];
+						sprintf_s(ReloadBuffer, "Hot reload: swapped in %.03fms, loaded in %.01fms off the main thread\n",
+							1000.0f*Win32GetSecondsElapsed(SwapStart, Win32GetWallClock()), 1000.0f*Watcher.LoadSeconds);
+						OutputDebugString(ReloadBuffer);
 					}
 
 					game_controller_input* OldKeyboardController = &OldInput->Controllers[0];
@@ -903,6 +1677,11 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 						Buffer.Height = GlobalBackbuffer.Height;
 						Buffer.Pitch = GlobalBackbuffer.Pitch;
 
+						if (Win32State.InputPlayingIndex && Win32State.PlaybackSeekPending)
+						{
+							Win32SeekInputPlayback(&Win32State, &Game, &GameMemory, &Buffer, Win32State.PlaybackSeekFrame);
+							Win32State.PlaybackSeekPending = false;
+						}
 						if (Win32State.InputRecordingIndex)
 						{
 							Win32RecordInput(&Win32State, NewInput);
@@ -912,110 +1691,23 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 							Win32PlaybackInput(&Win32State, NewInput);
 						}
 
+						Buffer.Dirty.FullFrame = Win32State.BackbufferIsStale;
+						Win32State.BackbufferIsStale = false;
+
 						//Hook into the main game loop
 						if(Game.UpdateAndRender)
 							Game.UpdateAndRender(&GameMemory, &Buffer, NewInput); 
 
-						LARGE_INTEGER AudioWallClock = Win32GetWallClock();
-						float FromBeginToAudioSeconds = Win32GetSecondsElapsed(BeginCounter, AudioWallClock);
-
 						game_input_buffer* Temp = NewInput;
 						NewInput = OldInput;
 						OldInput = Temp;
 
-						DWORD ByteToLock = 0, BytesToWrite = 0;
-						DWORD TargetCursor = 0;
-						DWORD PlayCursor = 0, WriteCursor = 0;
-						if (SecondaryBuffer->GetCurrentPosition(&PlayCursor, &WriteCursor) == DS_OK)
+						uint32_t MissedFrameCount = Pacer.MissedFrameCount;
 						{
-							LastPlayCursor = PlayCursor;
-							LastWriteCursor = WriteCursor;
-							if (!SoundIsValid)
-							{
-								SoundOutput.RunningSampleIndex = WriteCursor / SoundOutput.BytesPerSample;
-								SoundIsValid = true;
-							}
-
-							ByteToLock = (SoundOutput.RunningSampleIndex * SoundOutput.BytesPerSample) % SoundOutput.SecondaryBufferSize;
-
-							DWORD ExpectedSoundBytesPerFrame = (int)((float)SoundOutput.SamplesPerSecond * (float)SoundOutput.BytesPerSample / GameUpdateHz);
-							DWORD ActualSoundBytesThisFrame = (DWORD)(TargetSecondsPerFrame - FromBeginToAudioSeconds);
-							DWORD FrameBoundaryByte = PlayCursor + ActualSoundBytesThisFrame;
-							DWORD SafeWriteCursor = WriteCursor;
-							if (SafeWriteCursor < PlayCursor)
-							{
-								SafeWriteCursor += SoundOutput.SecondaryBufferSize;
-							}
-							Assert(SafeWriteCursor >= PlayCursor);
-							SafeWriteCursor += SoundOutput.SafetyBytes;
-							//Casey never really signed off on the efficacy of this audio sync code
-							//In particular, the target write cursor may need to be more consistently aligned with the write cursor
-							//I.e. use smarter across-frame statistics to predict where we should be writing based on game update loop
-							bool AudioCardIsLatent = (SafeWriteCursor) >= FrameBoundaryByte;
-							if (AudioCardIsLatent)
-							{
-								TargetCursor = (WriteCursor + ExpectedSoundBytesPerFrame + SoundOutput.SafetyBytes);
-							}
-							else
-							{
-								TargetCursor = (FrameBoundaryByte + ExpectedSoundBytesPerFrame);
-							}
-							TargetCursor = TargetCursor % SoundOutput.SecondaryBufferSize;
-
-							if (ByteToLock > TargetCursor)
-							{
-								BytesToWrite = SoundOutput.SecondaryBufferSize - ByteToLock;
-								BytesToWrite += TargetCursor;
-							}
-							else
-							{
-								BytesToWrite = TargetCursor - ByteToLock;
-							}
-
-							game_sound_buffer SoundBuffer = {};
-							SoundBuffer.SamplesPerSecond = SoundOutput.SamplesPerSecond;
-							SoundBuffer.SampleCount = BytesToWrite / SoundOutput.BytesPerSample;
-							SoundBuffer.Samples = Samples;
-
-							//Hook into the game service for sound logic
-							if(Game.GetSoundSamples)
-								Game.GetSoundSamples(&GameMemory, &SoundBuffer);
-
-							DWORD UnwrappedWriteCursor = WriteCursor;
-							if (UnwrappedWriteCursor < PlayCursor)
-							{
-								UnwrappedWriteCursor += SoundOutput.SecondaryBufferSize;
-							}
-							MinimumAudioLatencyBytes = UnwrappedWriteCursor - PlayCursor;
-							AudioLatencySeconds = (float)(MinimumAudioLatencyBytes / SoundOutput.BytesPerSample / SoundOutput.SamplesPerSecond);
-							Win32FillSoundBuffer(&SoundOutput, ByteToLock, BytesToWrite, &SoundBuffer);
+							TIMED_BLOCK("WaitForNextFrame");
+							WaitForNextFrame(&Pacer, &PacerClock);
 						}
-						else
-							SoundIsValid = false;
-
-						LARGE_INTEGER WorkCounter = Win32GetWallClock();
-						float SecondsElapsedForWork = Win32GetSecondsElapsed(BeginCounter, WorkCounter);
-						float SecondsElapsedForFrame = SecondsElapsedForWork;
-
-						if (SecondsElapsedForFrame < TargetSecondsPerFrame)
-						{
-							if (SleepIsGranular)
-							{
-								DWORD SleepMS = (DWORD)((TargetSecondsPerFrame - SecondsElapsedForFrame) * 1000.0f);
-								if (SleepMS > 0)
-									Sleep(SleepMS);
-							}
-							//LARGE_INTEGER WaitCounter = Win32GetWallClock();
-							//float TestSecondsElapsedForFrame = Win32GetSecondsElapsed(BeginCounter, WaitCounter);
-							//Assert(TestSecondsElapsedForFrame < TargetSecondsPerFrame);
-							while (SecondsElapsedForFrame < TargetSecondsPerFrame)
-							{
-
-								LARGE_INTEGER WaitCounter = Win32GetWallClock();
-								SecondsElapsedForFrame = Win32GetSecondsElapsed(BeginCounter, WaitCounter);
-							}
-						}
-						else
+						if (Pacer.MissedFrameCount != MissedFrameCount)
 						{
 							//Missed our target framerate
 							OutputDebugString("Missed our target");
@@ -1028,26 +1720,9 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 
 						HDC DeviceContext = GetDC(Window);
 						GetClientRect(Window, &ClientRect);
-#if 0
-						Win32DebugSyncDisplay(&GlobalBackbuffer, DEBUGLastPlayCursor,
-							&SoundOutput, TargetSecondsPerFrame);
-#endif
-						Win32CopyBufferToWindow(&GlobalBackbuffer, DeviceContext, ClientRect);
+						uint64_t BytesPresented = Win32CopyBufferToWindow(&GlobalBackbuffer, DeviceContext, ClientRect, &Buffer.Dirty);
 						ReleaseDC(Window, DeviceContext);
 
-#if BABL_INTERNAL
-						{
-							DWORD DEBUGPlayCursor = PlayCursor;
-							//Tighten up sound logic so that we can predict how long the game update loop will be
-							//This will ensure that we are always writing ahead of the play cursor for direct sound
-
-							DEBUGLastPlayCursor[DEBUGLastPlayCursorIndex++] = DEBUGPlayCursor;
-							if (DEBUGLastPlayCursorIndex >= ArrayCount(DEBUGLastPlayCursor))
-							{
-								DEBUGLastPlayCursorIndex = 0;
-							}
-						}
-#endif
 						int64_t EndCycleCount = __rdtsc();
 						int64_t CyclesElapsed = EndCycleCount - LastCycleCount;
 						LastCycleCount = EndCycleCount;
@@ -1056,10 +1731,72 @@ int CALLBACK WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, LPSTR CommandLi
 						float MHZ = CyclesElapsed / (1000.0f * 1000.0f);
 
 						char time_buffer[256];
-						sprintf_s(time_buffer, "Milliseconds/frame: %.02fms, %.02fFPS, %.02fMHz\n", time_elapsed_ms, FPS, MHZ);
+						sprintf_s(time_buffer, "Milliseconds/frame: %.02fms, %.02fFPS, %.02fMHz, %.02fKB presented\n", time_elapsed_ms, FPS, MHZ,
+							(float)BytesPresented / 1024.0f);
 						OutputDebugString(time_buffer);
+
+						//The rest only every WIN32_STATS_FRAMES frames, or on M - a run of debug string calls every frame, right
+						//after the wait, is time taken straight out of the next frame
+						if ((++FramesSinceStats >= WIN32_STATS_FRAMES) || Win32State.StatsRequested)
+						{
+							FramesSinceStats = 0;
+							Win32State.StatsRequested = false;
+
+							render_group_stats* RenderStats = &Buffer.RenderStats;
+							sprintf_s(time_buffer, "Render: %u entries, %u merged, %u culled in tiles, %u tiles skipped, %u bytes pushed, %.02f Mcycles\n",
+								RenderStats->EntryCount, RenderStats->MergedCount, RenderStats->CulledCount, RenderStats->SkippedTileCount,
+								RenderStats->PushBufferBytes, (float)RenderStats->RenderCycles / (1000.0f * 1000.0f));
+							OutputDebugString(time_buffer);
+
+							platform_memory_stats MemoryStats = GetPlatformMemoryStats(&GlobalGameMemory, true);
+							sprintf_s(time_buffer, "Game memory: %lluKB committed, %lluKB reserved, %lluKB touched\n",
+								MemoryStats.Committed / 1024, MemoryStats.Reserved / 1024, MemoryStats.Touched / 1024);
+							OutputDebugString(time_buffer);
+
+							//Read from the device thread's counters as they stand - a frame stale at worst
+							audio_stream* Stream = &GlobalAudio.Stream;
+							float MillisecondsPerSample = 1000.0f / (float)Stream->SamplesPerSecond;
+							sprintf_s(time_buffer, "Audio: %u underruns, %.01fms queued (%.01f min, %.01f mean, %.01f max)\n",
+								Stream->UnderrunCount, (float)GetAudioStreamQueuedSamples(Stream)*MillisecondsPerSample,
+								(float)Stream->MinOccupancy*MillisecondsPerSample,
+								Stream->OccupancyReadings ? (float)Stream->OccupancyTotal / (float)Stream->OccupancyReadings*MillisecondsPerSample : 0.0f,
+								(float)Stream->MaxOccupancy*MillisecondsPerSample);
+							OutputDebugString(time_buffer);
+
+							audio_sync* Sync = &GlobalAudio.Sync;
+							float MillisecondsPerByte = 1000.0f / (float)Sync->BytesPerSecond;
+							sprintf_s(time_buffer, "DirectSound: %u underruns, %.01fms mean latency (%.01f max), %.01fms safety, granule %.01fms\n",
+								Sync->UnderrunCount,
+								Sync->LatencyReadings ? (float)Sync->LatencyTotal / (float)Sync->LatencyReadings*MillisecondsPerByte : 0.0f,
+								(float)Sync->MaxLatency*MillisecondsPerByte, (float)Sync->SafetyBytes*MillisecondsPerByte,
+								(float)Sync->Granule*MillisecondsPerByte);
+							OutputDebugString(time_buffer);
+
+							float Frames = (float)Pacer.FrameCount;
+							sprintf_s(time_buffer, "Pacing (%s timer): %.02fms margin, %.03fms spun and %.03fms CPU per frame waiting, %u missed, %u late wakes\n",
+								FrameTimer.IsHighResolution ? "high-resolution" : "ordinary", (float)Pacer.Margin / 1e6f,
+								(float)Pacer.SpinNanoseconds / Frames / 1e6f, (float)Pacer.WaitCPUNanoseconds / Frames / 1e6f,
+								Pacer.MissedFrameCount, Pacer.LateWakeCount);
+							OutputDebugString(time_buffer);
+
+							int Length = sprintf_s(time_buffer, "Frame jitter us: ");
+							for (uint32_t Bucket = 0; Bucket < FRAME_PACER_HISTOGRAM_BUCKETS - 1; Bucket++)
+							{
+								Length += sprintf_s(time_buffer + Length, sizeof(time_buffer) - Length, "<%llu:%u ",
+									GetFramePacerBucketLimit(Bucket) / 1000, Pacer.JitterHistogram[Bucket]);
+							}
+							sprintf_s(time_buffer + Length, sizeof(time_buffer) - Length, "more:%u\n",
+								Pacer.JitterHistogram[FRAME_PACER_HISTOGRAM_BUCKETS - 1]);
+							OutputDebugString(time_buffer);
+						}
 					}
 				}
+
+#if BABL_PROFILE
+				char TraceFilename[MAX_PATH];
+				Win32BuildExePathFilename(&Win32State, "babl_trace.json", sizeof(TraceFilename), TraceFilename);
+				Win32WriteDebugTrace(TraceFilename);
+#endif
 			}
 		}
 	}
@@ -10,13 +10,64 @@ struct win32_game_code
 	bool IsValid;
 };
 
+/*
+	Hot reload, off the main thread. The watcher blocks in ReadDirectoryChangesW until something next to the
+	executable changes, then waits for the build to be done with the DLL - no lock.tmp (build.bat holds it while cl
+	writes the DLL and its PDB), and the same size and write time across a short settle - before it copies it into
+	whichever temp slot isn't loaded and loads it there. All the main loop does is swap the new code in between frames.
+
+	Pending is the watcher's until it sets IsPending, and the main loop's until it clears it. Retired is the DLL
+	the main loop swapped out, which the watcher frees before it next copies over that slot.
+*/
+struct win32_game_code_watcher
+{
+	char* SourceDLLName;
+	char* LockFileName;
+	char* DirectoryName;
+	char TempDLLNames[2][MAX_PATH];
+
+	win32_game_code Pending;
+	win32_game_code Retired;
+	uint32_t volatile IsPending;
+
+	//Watcher's: the write time it last loaded (or failed to), and how long the last load took
+	uint32_t NextTempIndex;
+	FILETIME LoadedWriteTime;
+	float LoadSeconds;
+};
+
+//What the frame pacer sleeps on: a high-resolution waitable timer where Windows has them, otherwise an ordinary one,
+//which fires only as finely as timeBeginPeriod asks for
+struct win32_frame_timer
+{
+	HANDLE Timer;
+	bool32 IsHighResolution;
+};
+
 struct win32_sound_output
 {
 	int SamplesPerSecond;
 	int BytesPerSample;
 	DWORD SecondaryBufferSize;
-	DWORD SafetyBytes;
-	uint32_t RunningSampleIndex;
+};
+
+//The mixer thread and the thread that feeds DirectSound, either side of an audio_stream (see babl_audio_stream.h)
+struct win32_audio
+{
+	audio_stream Stream;
+	win32_sound_output* Output;
+	int16_t* Samples;
+
+	//Held by the mixer while it is in game code, and by the main thread while it swaps the DLL or game memory
+	CRITICAL_SECTION GameCodeLock;
+	win32_game_code* Game;
+	game_memory* GameMemory;
+
+	//Released by the device thread every time it takes samples, so the mixer tops the ring straight back up
+	HANDLE MixerWake;
+
+	//The device thread's, for deciding how far past the write cursor to keep DirectSound written
+	audio_sync Sync;
 };
 
 struct win32_offscreen_buffer
@@ -35,19 +86,65 @@ struct win32_replay_buffer
 	HANDLE MemoryMap;
 	char ReplayFilename[MAX_PATH];
 	void* MemoryBlock;
+	platform_memory_snapshot Snapshot;
 };
 
+struct platform_work_queue_entry
+{
+	platform_work_queue_callback* Callback;
+	void* Data;
+};
+
+//Single writer (the main thread), many readers (the workers plus the main thread while it waits in CompleteAllWork)
+struct platform_work_queue
+{
+	uint32_t volatile CompletionGoal;
+	uint32_t volatile CompletionCount;
+
+	uint32_t volatile NextEntryToWrite;
+	uint32_t volatile NextEntryToRead;
+	HANDLE SemaphoreHandle;
+
+	platform_work_queue_entry Entries[1024];
+};
+
+//Keyframe often enough that a seek replays only a handful of frames; pages shared between keyframes keep it cheap
+#define WIN32_KEYFRAME_INTERVAL 8
+#define WIN32_STATE_RING_BUDGET Megabytes(256)
+
+//How far one press of [ or ] moves playback
+#define WIN32_SCRUB_FRAMES 150
+
+//How often the frame stats past the frame time line are printed - they include asking the OS how much of game
+//memory is resident, a walk over every committed page. M prints them right away
+#define WIN32_STATS_FRAMES 300
+
 struct win32_state
 {
 	uint64_t TotalSize;
 	void* GameMemoryBlock;
 	win32_replay_buffer ReplayBuffers[4];
 
+	//Drained before snapshots - its workers write into game memory
+	platform_work_queue* LowPriorityQueue;
+
 	HANDLE RecordingHandle;
 	int InputRecordingIndex;
+	input_stream_writer InputWriter;
 
-	HANDLE PlaybackHandle;
+	platform_file_mapping PlaybackMapping;
 	int InputPlayingIndex;
+	input_stream_reader InputReader;
+
+	//Keyframes taken while recording - 0 if there was not the memory for them
+	state_ring* StateRing;
+	uint32_t PlaybackSeekFrame;
+	bool32 PlaybackSeekPending;
+
+	//Set when game memory was restored or frames ran without being presented - the next frame asks for a full repaint
+	bool32 BackbufferIsStale;
+
+	bool32 StatsRequested;
 
 	char EXEFileName[MAX_PATH];
 	char* OnePastLastSlash;